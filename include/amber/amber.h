@@ -17,7 +17,9 @@
 
 #include "amber/result.h"
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace amber {
 
@@ -30,6 +32,34 @@ struct Options {
   EngineType engine = EngineType::kVulkan;
   void* default_device = nullptr;
   bool parse_only = false;
+  // Validate shaders on a background thread while the engine creates shader
+  // modules, instead of during parsing.
+  bool async_shader_validation = false;
+  // Directories searched for files named by GLSL #include directives.
+  std::vector<std::string> shader_include_paths;
+  // Directory the engine's pipeline cache is loaded from before the script
+  // and stored to after it. Empty keeps the cache for the script only.
+  std::string pipeline_cache_directory;
+  // Create every pipeline a second time without the pipeline cache, to
+  // report the creation time with and without it.
+  bool compare_pipeline_cache = false;
+  // Record the hash of every probe hash command in the Result, without
+  // failing when it differs from the expected hash. Used to collect golden
+  // hashes.
+  bool record_content_hashes = false;
+  // Compare large probes on the device, reading back the probed data only
+  // when it fails. Probes the device cannot compare are done on the host.
+  bool probe_on_device = false;
+  // Stop comparing a probed rectangle at its first failing pixel, instead of
+  // counting every failing pixel for the error message.
+  bool probe_early_exit = false;
+  // The most threads a large probed rectangle is split across. 0 uses one
+  // per hardware thread.
+  uint32_t probe_max_threads = 0;
+  // Keep the shader modules created on |default_device| after Execute()
+  // returns, so later scripts on the device can reuse them. Amber::
+  // ReleaseDevice() must then be called before the device is destroyed.
+  bool retain_shader_modules = false;
 };
 
 class Amber {
@@ -38,6 +68,11 @@ class Amber {
   ~Amber();
 
   amber::Result Execute(const std::string& data, const Options& opts);
+
+  // Destroys the shader modules kept on an application provided
+  // Options::default_device by Options::retain_shader_modules. Must be called
+  // before the application destroys |device|.
+  void ReleaseDevice(EngineType engine, void* device);
 };
 
 }  // namespace amber
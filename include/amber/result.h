@@ -15,11 +15,105 @@
 #ifndef AMBER_RESULT_H_
 #define AMBER_RESULT_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 namespace amber {
 
+// Statistics gathered for a single shader while executing a script. Times
+// are wall clock milliseconds; stages which did not run are left at zero.
+struct ShaderStats {
+  std::string name;
+  // Size of the shader source, in bytes.
+  size_t source_size = 0;
+  // Size of the SPIR-V module before and after optimization, in words.
+  size_t spirv_words = 0;
+  size_t optimized_spirv_words = 0;
+  // GLSL preprocessing and compilation.
+  double compile_ms = 0.0;
+  // Assembling SPIR-V text or decoding SPIR-V hex and binary files.
+  double assemble_ms = 0.0;
+  double validate_ms = 0.0;
+  double optimize_ms = 0.0;
+  // Time the engine spent creating the shader module.
+  double shader_module_ms = 0.0;
+  // Time the engine spent creating the driver pipeline the shader is
+  // attached to. Left at zero when nothing drew or dispatched with it.
+  double pipeline_creation_ms = 0.0;
+
+  // The time spent on this shader, excluding pipeline creation which is
+  // shared with the other shaders of the pipeline.
+  double TotalMs() const {
+    return compile_ms + assemble_ms + validate_ms + optimize_ms +
+           shader_module_ms;
+  }
+};
+
+// Statistics of the engine's shader module cache, for the device the script
+// ran on. The counts include earlier scripts run on the same device.
+struct ShaderModuleCacheStats {
+  // Shaders which reused an existing module.
+  uint64_t hits = 0;
+  // Shaders which needed a new module.
+  uint64_t misses = 0;
+  // Modules currently held by the cache.
+  size_t modules = 0;
+};
+
+// Statistics of the engine's pipeline cache for a script.
+struct PipelineCacheStats {
+  size_t pipelines = 0;
+  // Total time spent creating pipelines through the cache.
+  double cached_ms = 0.0;
+  // Total time spent creating the same pipelines without a cache. Only
+  // measured when Options::compare_pipeline_cache is set.
+  double uncached_ms = 0.0;
+  // Size of the persisted cache data read before and written after the
+  // script, in bytes.
+  size_t loaded_bytes = 0;
+  size_t stored_bytes = 0;
+};
+
+// Statistics of the engine's device memory allocator for a script.
+struct DeviceMemoryStats {
+  // Memory blocks resources are sub-allocated from.
+  size_t blocks = 0;
+  // Resources too large to share a block, which got memory of their own.
+  size_t dedicated_allocations = 0;
+  // Device memory allocated from the driver, in bytes, blocks and dedicated
+  // allocations together.
+  uint64_t reserved_bytes = 0;
+  // Device memory used by resources, current and highest, in bytes.
+  uint64_t used_bytes = 0;
+  uint64_t peak_used_bytes = 0;
+  // Free ranges left in the blocks, their total size and the size of the
+  // largest one, in bytes.
+  size_t free_ranges = 0;
+  uint64_t free_bytes = 0;
+  uint64_t largest_free_range_bytes = 0;
+
+  // The share of the free block memory which cannot serve an allocation as
+  // large as the largest free range, from 0 (none) to 1.
+  double Fragmentation() const {
+    if (free_bytes == 0)
+      return 0.0;
+    return 1.0 - static_cast<double>(largest_free_range_bytes) /
+                     static_cast<double>(free_bytes);
+  }
+};
+
+// The hash computed by a probe hash command.
+struct ContentHash {
+  // What was hashed, as written after "probe hash" in the script: empty for
+  // the color attachment, or "ssbo <set>:<binding>".
+  std::string target;
+  std::string algorithm;
+  uint64_t hash = 0;
+  uint64_t expected_hash = 0;
+};
+
 class Result {
  public:
   Result();
@@ -38,11 +132,51 @@ class Result {
   void SetBufferData(const std::vector<uint8_t>& data) { buffer_data_ = data; }
   const std::vector<uint8_t>& BufferData() const { return buffer_data_; }
 
+  void SetShaderStats(const std::vector<ShaderStats>& stats) {
+    shader_stats_ = stats;
+  }
+  const std::vector<ShaderStats>& GetShaderStats() const {
+    return shader_stats_;
+  }
+
+  void SetShaderModuleCacheStats(const ShaderModuleCacheStats& stats) {
+    shader_module_cache_stats_ = stats;
+  }
+  const ShaderModuleCacheStats& GetShaderModuleCacheStats() const {
+    return shader_module_cache_stats_;
+  }
+
+  void SetPipelineCacheStats(const PipelineCacheStats& stats) {
+    pipeline_cache_stats_ = stats;
+  }
+  const PipelineCacheStats& GetPipelineCacheStats() const {
+    return pipeline_cache_stats_;
+  }
+
+  void SetDeviceMemoryStats(const DeviceMemoryStats& stats) {
+    device_memory_stats_ = stats;
+  }
+  const DeviceMemoryStats& GetDeviceMemoryStats() const {
+    return device_memory_stats_;
+  }
+
+  void SetContentHashes(const std::vector<ContentHash>& hashes) {
+    content_hashes_ = hashes;
+  }
+  const std::vector<ContentHash>& GetContentHashes() const {
+    return content_hashes_;
+  }
+
  private:
   bool succeeded_;
   std::string error_;
   std::vector<uint8_t> image_data_;
   std::vector<uint8_t> buffer_data_;
+  std::vector<ShaderStats> shader_stats_;
+  ShaderModuleCacheStats shader_module_cache_stats_;
+  PipelineCacheStats pipeline_cache_stats_;
+  DeviceMemoryStats device_memory_stats_;
+  std::vector<ContentHash> content_hashes_;
 };
 
 }  // namespace amber
@@ -14,7 +14,10 @@
 
 #include "amber/amber.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cinttypes>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <vector>
@@ -30,6 +33,16 @@ struct Options {
   std::string buffer_filename;
   long buffer_binding_index = 0;
   bool parse_only = false;
+  bool async_shader_validation = false;
+  bool show_shader_stats = false;
+  std::string pipeline_cache_directory;
+  bool compare_pipeline_cache = false;
+  bool show_memory_stats = false;
+  bool print_hashes = false;
+  bool device_probes = false;
+  bool probe_early_exit = false;
+  long probe_threads = 0;
+  std::vector<std::string> include_paths;
   bool show_help = false;
   bool show_version_info = false;
 };
@@ -38,6 +51,21 @@ const char kUsage[] = R"(Usage: amber [options] SCRIPT
 
  options:
   -p             -- Parse input files only; Don't execute
+  -I <dir>       -- Add <dir> to the GLSL #include search path.
+  --async-validation -- Validate shaders while the engine creates pipelines.
+  --shader-stats -- Print per shader compile statistics, most costly first.
+  --pipeline-cache <dir> -- Load and store the pipeline cache in <dir>.
+  --pipeline-cache-compare -- Report pipeline creation time with and without
+                 the pipeline cache.
+  --memory-stats -- Print device memory allocator statistics.
+  --print-hashes -- Print the hash computed by every probe hash command, as
+                 a command to paste into the script. Mismatched hashes do
+                 not fail the script.
+  --device-probes -- Compare large probes on the device, reading back only
+                 the probes which fail.
+  --probe-early-exit -- Stop a probe at its first failing pixel.
+  --probe-threads <n> -- Split large probes across at most <n> threads.
+                 Defaults to one per hardware thread.
   -i <filename>  -- Write rendering to <filename> as a PPM image.
   -b <filename>  -- Write contents of a UBO or SSBO to <filename>.
   -B <buffer>    -- Index of buffer to write. Defaults buffer 0.
@@ -64,6 +92,38 @@ bool ParseArgs(const std::vector<std::string>& args, Options* opts) {
       }
       opts->buffer_filename = args[i];
 
+    } else if (arg == "-I") {
+      ++i;
+      if (i >= args.size()) {
+        std::cerr << "Missing value for -I argument." << std::endl;
+        return false;
+      }
+      opts->include_paths.push_back(args[i]);
+
+    } else if (arg == "--pipeline-cache") {
+      ++i;
+      if (i >= args.size()) {
+        std::cerr << "Missing value for --pipeline-cache argument."
+                  << std::endl;
+        return false;
+      }
+      opts->pipeline_cache_directory = args[i];
+
+    } else if (arg == "--probe-threads") {
+      ++i;
+      if (i >= args.size()) {
+        std::cerr << "Missing value for --probe-threads argument."
+                  << std::endl;
+        return false;
+      }
+      opts->probe_threads = strtol(args[i].c_str(), nullptr, 10);
+
+      if (opts->probe_threads < 0) {
+        std::cerr << "Invalid value for --probe-threads, must be 0 or greater."
+                  << std::endl;
+        return false;
+      }
+
     } else if (arg == "-B") {
       ++i;
       if (i >= args.size()) {
@@ -83,6 +143,20 @@ bool ParseArgs(const std::vector<std::string>& args, Options* opts) {
       opts->show_version_info = true;
     } else if (arg == "-p") {
       opts->parse_only = true;
+    } else if (arg == "--async-validation") {
+      opts->async_shader_validation = true;
+    } else if (arg == "--shader-stats") {
+      opts->show_shader_stats = true;
+    } else if (arg == "--memory-stats") {
+      opts->show_memory_stats = true;
+    } else if (arg == "--print-hashes") {
+      opts->print_hashes = true;
+    } else if (arg == "--device-probes") {
+      opts->device_probes = true;
+    } else if (arg == "--probe-early-exit") {
+      opts->probe_early_exit = true;
+    } else if (arg == "--pipeline-cache-compare") {
+      opts->compare_pipeline_cache = true;
     } else {
       opts->input_filename = args[i];
     }
@@ -121,6 +195,58 @@ std::string ReadFile(const std::string& input_file) {
   return std::string(data.begin(), data.end());
 }
 
+void PrintShaderStats(std::vector<amber::ShaderStats> stats,
+                      const amber::ShaderModuleCacheStats& module_stats) {
+  std::stable_sort(stats.begin(), stats.end(),
+                   [](const amber::ShaderStats& a,
+                      const amber::ShaderStats& b) {
+                     return a.TotalMs() > b.TotalMs();
+                   });
+
+  printf("%-32s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n", "Shader", "Bytes",
+         "Words", "OptWords", "Compile", "Assemble", "Validate", "Optimize",
+         "Module", "Pipeline");
+  for (const auto& s : stats) {
+    printf("%-32s %8zu %8zu %8zu %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n",
+           s.name.c_str(), s.source_size, s.spirv_words,
+           s.optimized_spirv_words, s.compile_ms, s.assemble_ms,
+           s.validate_ms, s.optimize_ms, s.shader_module_ms,
+           s.pipeline_creation_ms);
+  }
+  printf("Times are in milliseconds.\n");
+  printf("Shader module cache: %" PRIu64 " hits, %" PRIu64
+         " misses, %zu modules\n",
+         module_stats.hits, module_stats.misses, module_stats.modules);
+}
+
+void PrintPipelineCacheStats(const amber::PipelineCacheStats& stats) {
+  printf("Pipeline cache: %zu pipelines, %.2f ms with the cache",
+         stats.pipelines, stats.cached_ms);
+  if (stats.uncached_ms > 0.0)
+    printf(", %.2f ms without", stats.uncached_ms);
+  printf(", %zu bytes loaded, %zu bytes stored\n", stats.loaded_bytes,
+         stats.stored_bytes);
+}
+
+void PrintDeviceMemoryStats(const amber::DeviceMemoryStats& stats) {
+  printf("Device memory: %zu blocks, %zu dedicated allocations, %" PRIu64
+         " bytes reserved\n",
+         stats.blocks, stats.dedicated_allocations, stats.reserved_bytes);
+  printf("  %" PRIu64 " bytes used, %" PRIu64 " bytes at peak\n",
+         stats.used_bytes, stats.peak_used_bytes);
+  printf("  %zu free ranges, %" PRIu64 " bytes free, largest %" PRIu64
+         " bytes, %.1f%% fragmented\n",
+         stats.free_ranges, stats.free_bytes, stats.largest_free_range_bytes,
+         stats.Fragmentation() * 100.0);
+}
+
+void PrintContentHashes(const std::vector<amber::ContentHash>& hashes) {
+  for (const auto& hash : hashes) {
+    printf("probe hash %s%s%s 0x%016" PRIx64 "\n", hash.target.c_str(),
+           hash.target.empty() ? "" : " ", hash.algorithm.c_str(), hash.hash);
+  }
+}
+
 }  // namespace
 
 int main(int argc, const char** argv) {
@@ -157,7 +283,26 @@ int main(int argc, const char** argv) {
   amber::Amber vk;
   amber::Options amber_options;
   amber_options.parse_only = options.parse_only;
+  amber_options.async_shader_validation = options.async_shader_validation;
+  amber_options.shader_include_paths = options.include_paths;
+  amber_options.pipeline_cache_directory = options.pipeline_cache_directory;
+  amber_options.compare_pipeline_cache = options.compare_pipeline_cache;
+  amber_options.record_content_hashes = options.print_hashes;
+  amber_options.probe_on_device = options.device_probes;
+  amber_options.probe_early_exit = options.probe_early_exit;
+  amber_options.probe_max_threads =
+      static_cast<uint32_t>(options.probe_threads);
   amber::Result result = vk.Execute(data, amber_options);
+  if (options.show_shader_stats)
+    PrintShaderStats(result.GetShaderStats(),
+                     result.GetShaderModuleCacheStats());
+  if (options.compare_pipeline_cache)
+    PrintPipelineCacheStats(result.GetPipelineCacheStats());
+  if (options.show_memory_stats)
+    PrintDeviceMemoryStats(result.GetDeviceMemoryStats());
+  if (options.print_hashes)
+    PrintContentHashes(result.GetContentHashes());
+
   if (!result.IsSuccess()) {
     std::cerr << result.Error() << std::endl;
     return 1;
@@ -15,6 +15,7 @@
 #include "amber/amber.h"
 
 #include "src/amber_impl.h"
+#include "src/engine.h"
 
 namespace amber {
 
@@ -27,4 +28,8 @@ amber::Result Amber::Execute(const std::string& input, const Options& opts) {
   return impl.Execute(input, opts);
 }
 
+void Amber::ReleaseDevice(EngineType engine, void* device) {
+  Engine::ReleaseDevice(engine, device);
+}
+
 }  // namespace amber
@@ -41,6 +41,14 @@ amber::Result AmberImpl::Execute(const std::string& input,
     executor = MakeUnique<vkscript::Executor>();
   }
 
+  const bool async_validation =
+      opts.async_shader_validation && !opts.parse_only;
+  parser->SetSkipShaderValidation(async_validation);
+  executor->SetAsyncShaderValidation(async_validation);
+  parser->SetShaderIncludePaths(opts.shader_include_paths);
+  executor->SetShaderIncludePaths(opts.shader_include_paths);
+  executor->SetRecordContentHashes(opts.record_content_hashes);
+
   Result r = parser->Parse(input);
   if (!r.IsSuccess())
     return r;
@@ -52,6 +60,11 @@ amber::Result AmberImpl::Execute(const std::string& input,
   if (!engine)
     return Result("Failed to create engine");
 
+  engine->SetPipelineCacheOptions(opts.pipeline_cache_directory,
+                                  opts.compare_pipeline_cache);
+  engine->SetProbeOnDevice(opts.probe_on_device);
+  engine->SetPixelProbeOptions(opts.probe_early_exit, opts.probe_max_threads);
+  engine->SetRetainShaderModules(opts.retain_shader_modules);
   if (opts.default_device)
     r = engine->InitializeWithDevice(opts.default_device);
   else
@@ -61,10 +74,22 @@ amber::Result AmberImpl::Execute(const std::string& input,
     return r;
 
   r = executor->Execute(engine.get(), parser->GetScript());
-  if (!r.IsSuccess())
-    return r;
+  // Read before shutdown, which releases the modules of devices Amber created
+  // and the device memory.
+  const ShaderModuleCacheStats module_stats =
+      engine->GetShaderModuleCacheStats();
+  const DeviceMemoryStats memory_stats = engine->GetDeviceMemoryStats();
+  if (r.IsSuccess())
+    r = engine->Shutdown();
+  else
+    engine->Shutdown();
 
-  return engine->Shutdown();
+  r.SetShaderStats(executor->GetShaderStats());
+  r.SetShaderModuleCacheStats(module_stats);
+  r.SetPipelineCacheStats(engine->GetPipelineCacheStats());
+  r.SetDeviceMemoryStats(memory_stats);
+  r.SetContentHashes(executor->GetContentHashes());
+  return r;
 }
 
 }  // namespace amber
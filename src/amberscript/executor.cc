@@ -14,19 +14,320 @@
 
 #include "src/amberscript/executor.h"
 
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "src/amberscript/script.h"
+#include "src/shader_compiler.h"
+#include "src/timer.h"
+
 namespace amber {
 namespace amberscript {
+namespace {
+
+// A compiled permutation of a pipeline shader.
+struct Variant {
+  std::vector<uint32_t> data;
+  ShaderStats stats;
+};
+
+amber::PipelineType ToEnginePipelineType(PipelineType type) {
+  return type == PipelineType::kCompute ? amber::PipelineType::kCompute
+                                        : amber::PipelineType::kGraphics;
+}
+
+// The SPIR-V ExecutionModel of the entry points for shaders of |type|.
+uint32_t ToExecutionModel(ShaderType type) {
+  switch (type) {
+    case ShaderType::kVertex:
+      return 0;
+    case ShaderType::kTessellationControl:
+      return 1;
+    case ShaderType::kTessellationEvaluation:
+      return 2;
+    case ShaderType::kGeometry:
+      return 3;
+    case ShaderType::kFragment:
+      return 4;
+    case ShaderType::kCompute:
+      break;
+  }
+  return 5;
+}
+
+// Checks that the module compiled for |info| declares the entry point and
+// every specialization constant the pipeline sets for it.
+Result CheckReflection(const Pipeline::ShaderInfo& info,
+                       const ShaderReflection& reflection) {
+  const Shader* shader = info.GetShader();
+  const uint32_t model = ToExecutionModel(shader->GetType());
+  const std::string entry_point = info.GetEntryPoint();
+  bool found = false;
+  for (const auto& declared : reflection.entry_points) {
+    if (declared.name == entry_point && declared.execution_model == model)
+      found = true;
+  }
+  if (!found) {
+    return Result("shader " + shader->GetName() + " has no entry point " +
+                  entry_point + " for its shader type");
+  }
+
+  for (const auto& constant : info.GetSpecialization()) {
+    if (std::find(reflection.spec_ids.begin(), reflection.spec_ids.end(),
+                  constant.first) == reflection.spec_ids.end()) {
+      return Result("shader " + shader->GetName() +
+                    " has no specialization constant with ID " +
+                    std::to_string(constant.first));
+    }
+  }
+  return {};
+}
+
+std::string VariantName(const std::string& name,
+                        const Shader::Defines& defines) {
+  if (defines.empty())
+    return name;
+
+  std::string variant_name = name + "[";
+  for (size_t i = 0; i < defines.size(); ++i) {
+    if (i > 0)
+      variant_name += ",";
+    variant_name += defines[i].first + "=" + defines[i].second;
+  }
+  return variant_name + "]";
+}
+
+// Runs the optimizations of |info| over |variant|. The optimizer expects
+// valid SPIR-V, so this only runs once the variant is validated.
+Result OptimizeVariant(const Pipeline::ShaderInfo& info, Variant* variant) {
+  if (info.GetShaderOptimizations().empty())
+    return {};
+
+  ShaderCompiler sc;
+  Result r;
+  std::tie(r, variant->data) =
+      sc.Optimize(variant->data, info.GetShaderOptimizations());
+  if (!r.IsSuccess())
+    return r;
+
+  variant->stats.optimize_ms = sc.GetStats().optimize_ms;
+  variant->stats.optimized_spirv_words = variant->data.size();
+  return {};
+}
+
+// Compiles a variant of the shader in |info|. Variants which are validated
+// later are not optimized yet.
+std::pair<Result, Variant> CompileVariant(
+    const Pipeline::ShaderInfo& info,
+    const Shader::Defines& defines,
+    bool skip_validation,
+    const std::vector<std::string>& include_paths) {
+  const Shader* shader = info.GetShader();
+
+  ShaderCompiler sc;
+  sc.SetSkipValidation(skip_validation);
+  sc.SetDefines(defines);
+  sc.SetIncludePaths(include_paths);
+
+  Variant variant;
+  Result r;
+  std::tie(r, variant.data) = sc.Compile(
+      shader->GetType(), shader->GetFormat(), shader->GetData());
+  if (!r.IsSuccess())
+    return {r, {}};
+
+  r = CheckReflection(info, sc.GetReflection());
+  if (!r.IsSuccess())
+    return {r, {}};
+
+  variant.stats = sc.GetStats();
+  variant.stats.name = VariantName(shader->GetName(), defines);
+  variant.stats.optimized_spirv_words = variant.data.size();
+
+  if (!skip_validation) {
+    r = OptimizeVariant(info, &variant);
+    if (!r.IsSuccess())
+      return {r, {}};
+  }
+  return {{}, variant};
+}
+
+// Compiles every variant of the shader in |info|, running up to one compile
+// per hardware thread. Variants which produce the same SPIR-V as an earlier
+// variant are dropped, as running them again would not test anything new.
+Result CompileVariants(const Pipeline::ShaderInfo& info,
+                       bool skip_validation,
+                       const std::vector<std::string>& include_paths,
+                       std::vector<Variant>* variants) {
+  const auto permutations = info.GetShader()->GetVariants();
+  const size_t batch_size =
+      std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+               static_cast<size_t>(1));
+
+  std::set<std::vector<uint32_t>> seen;
+  for (size_t start = 0; start < permutations.size(); start += batch_size) {
+    const size_t end = std::min(start + batch_size, permutations.size());
+
+    std::vector<std::future<std::pair<Result, Variant>>> jobs;
+    for (size_t i = start; i < end; ++i) {
+      const Shader::Defines* defines = &permutations[i];
+      jobs.push_back(std::async(std::launch::async, [&info, defines,
+                                                     skip_validation,
+                                                     &include_paths]() {
+        return CompileVariant(info, *defines, skip_validation, include_paths);
+      }));
+    }
+
+    for (auto& job : jobs) {
+      auto result = job.get();
+      if (!result.first.IsSuccess())
+        return result.first;
+      if (!seen.insert(result.second.data).second)
+        continue;
+
+      variants->push_back(std::move(result.second));
+    }
+  }
+  return {};
+}
+
+// Sets the pipeline creation time of |stats| from |first| on, the stats of the
+// engine's current pipeline. The engine creates the driver pipeline at the
+// first draw or dispatch, so this is called once the pipeline is done with.
+void SetPipelineCreationMs(Engine* engine,
+                           size_t first,
+                           std::vector<ShaderStats>* stats) {
+  const double pipeline_ms = engine->GetPipelineCreationMs();
+  for (size_t i = first; i < stats->size(); ++i)
+    (*stats)[i].pipeline_creation_ms = pipeline_ms;
+}
+
+}  // namespace
 
 Executor::Executor() : amber::Executor() {}
 
 Executor::~Executor() = default;
 
-Result Executor::Execute(Engine*, const amber::Script* src_script) {
+Result Executor::Execute(Engine* engine, const amber::Script* src_script) {
   if (!src_script->IsAmberScript())
     return Result("AmberScript executor called with non-amber script source");
 
-  // const amberscript::Script* script = ToAmberScript(src_script);
+  const amberscript::Script* script = ToAmberScript(src_script);
+  shader_stats_.clear();
+
+  bool needs_reset = false;
+  size_t pipeline_stats = 0;
+  for (const auto& pipeline : script->GetPipelines()) {
+    const auto& shaders = pipeline->GetShaders();
+
+    std::vector<std::vector<Variant>> shader_variants(shaders.size());
+    // With async validation each variant is validated, and then optimized,
+    // on a thread of its own.
+    std::vector<std::vector<std::future<Result>>> validations(shaders.size());
+    for (size_t i = 0; i < shaders.size(); ++i) {
+      Result r = CompileVariants(shaders[i], async_shader_validation_,
+                                 shader_include_paths_, &shader_variants[i]);
+      if (!r.IsSuccess())
+        return r;
+
+      if (!async_shader_validation_)
+        continue;
+
+      const Pipeline::ShaderInfo* info = &shaders[i];
+      for (auto& variant : shader_variants[i]) {
+        Variant* v = &variant;
+        validations[i].push_back(std::async(std::launch::async, [info, v]() {
+          ShaderCompiler sc;
+          Result r = sc.Validate(v->data);
+          v->stats.validate_ms = sc.GetStats().validate_ms;
+          if (!r.IsSuccess())
+            return r;
+
+          return OptimizeVariant(*info, v);
+        }));
+      }
+    }
+
+    // Run the pipeline once for every combination of its shader variants.
+    std::vector<size_t> current(shaders.size(), 0);
+    while (true) {
+      if (needs_reset) {
+        SetPipelineCreationMs(engine, pipeline_stats, &shader_stats_);
+        Result r = engine->ResetPipeline();
+        if (!r.IsSuccess())
+          return r;
+      }
+      needs_reset = true;
+
+      for (size_t i = 0; i < shaders.size(); ++i) {
+        const ShaderType type = shaders[i].GetShader()->GetType();
+        Variant& variant = shader_variants[i][current[i]];
+
+        // The optimized module is only known once the variant is validated.
+        if (!validations[i].empty() &&
+            !shaders[i].GetShaderOptimizations().empty()) {
+          auto& validation = validations[i][current[i]];
+          if (validation.valid()) {
+            Result r = validation.get();
+            if (!r.IsSuccess())
+              return r;
+          }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        Result r = engine->SetShader(type, variant.data);
+        if (!r.IsSuccess())
+          return r;
+
+        variant.stats.shader_module_ms = MillisecondsSince(start);
+
+        if (!shaders[i].GetSpecialization().empty()) {
+          r = engine->SetShaderSpecialization(type,
+                                              shaders[i].GetSpecialization());
+          if (!r.IsSuccess())
+            return r;
+        }
+      }
+
+      for (auto& shader_validations : validations) {
+        for (auto& validation : shader_validations) {
+          if (!validation.valid())
+            continue;
+
+          Result r = validation.get();
+          if (!r.IsSuccess())
+            return r;
+        }
+      }
+
+      Result r =
+          engine->CreatePipeline(ToEnginePipelineType(pipeline->GetType()));
+      if (!r.IsSuccess())
+        return r;
+
+      pipeline_stats = shader_stats_.size();
+      for (size_t i = 0; i < shaders.size(); ++i)
+        shader_stats_.push_back(shader_variants[i][current[i]].stats);
+
+      size_t next = 0;
+      for (; next < current.size(); ++next) {
+        if (++current[next] < shader_variants[next].size())
+          break;
+        current[next] = 0;
+      }
+      if (next == current.size())
+        break;
+    }
+  }
 
+  SetPipelineCreationMs(engine, pipeline_stats, &shader_stats_);
   return {};
 }
 
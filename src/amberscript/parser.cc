@@ -15,12 +15,36 @@
 #include "src/amberscript/parser.h"
 
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <set>
 
 #include "src/make_unique.h"
 #include "src/tokenizer.h"
 
 namespace amber {
 namespace amberscript {
+namespace {
+
+// Formats |val| with the fewest digits that read back as the same double,
+// keeping a decimal point so the define stays a floating point literal.
+std::string FormatDouble(double val) {
+  char buf[32];
+  for (int precision = 1; precision <= 17; ++precision) {
+    snprintf(buf, sizeof(buf), "%.*g", precision, val);
+    if (strtod(buf, nullptr) == val)
+      break;
+  }
+
+  std::string str(buf);
+  if (str.find_first_of(".eEn") == std::string::npos)
+    str += ".0";
+  return str;
+}
+
+}  // namespace
 
 Parser::Parser() : amber::Parser() {}
 
@@ -44,6 +68,8 @@ Result Parser::Parse(const std::string& data) {
     std::string tok = token->AsString();
     if (tok == "SHADER") {
       r = ParseShaderBlock();
+    } else if (tok == "SHADER_VARIANTS") {
+      r = ParseShaderVariants();
     } else if (tok == "PIPELINE") {
       r = ParsePipelineBlock();
     } else {
@@ -84,6 +110,8 @@ Result Parser::ToShaderFormat(const std::string& str, ShaderFormat* fmt) {
     *fmt = ShaderFormat::kSpirvAsm;
   else if (str == "SPIRV-HEX")
     *fmt = ShaderFormat::kSpirvHex;
+  else if (str == "SPIRV-BIN")
+    *fmt = ShaderFormat::kSpirvBin;
   else
     return Result("unknown shader format: " + str);
   return {};
@@ -154,6 +182,21 @@ Result Parser::ParseShaderBlock() {
 
   shader->SetFormat(format);
 
+  // SPIR-V binaries are loaded from the named file when compiled.
+  if (format == ShaderFormat::kSpirvBin) {
+    token = tokenizer_->NextToken();
+    if (!token->IsString())
+      return Result("missing file name for SHADER SPIRV-BIN");
+
+    shader->SetData(token->AsString());
+
+    r = script_.AddShader(std::move(shader));
+    if (!r.IsSuccess())
+      return r;
+
+    return ValidateEndOfStatement("SHADER SPIRV-BIN");
+  }
+
   r = ValidateEndOfStatement("SHADER command");
   if (!r.IsSuccess())
     return r;
@@ -175,6 +218,63 @@ Result Parser::ParseShaderBlock() {
   return ValidateEndOfStatement("END");
 }
 
+Result Parser::ParseShaderVariants() {
+  auto token = tokenizer_->NextToken();
+  if (!token->IsString())
+    return Result("missing shader name in SHADER_VARIANTS command");
+
+  auto* shader = script_.GetShader(token->AsString());
+  if (!shader)
+    return Result("unknown shader in SHADER_VARIANTS command");
+  if (shader->GetFormat() != ShaderFormat::kGlsl)
+    return Result("SHADER_VARIANTS requires a GLSL shader");
+  if (!shader->GetVariantDefines().empty())
+    return Result("duplicate SHADER_VARIANTS for shader: " +
+                  shader->GetName());
+
+  Result r = ValidateEndOfStatement("SHADER_VARIANTS command");
+  if (!r.IsSuccess())
+    return r;
+
+  std::set<std::string> seen;
+  while (true) {
+    token = tokenizer_->NextToken();
+    if (token->IsEOL())
+      continue;
+    if (token->IsEOS())
+      return Result("SHADER_VARIANTS missing END command");
+    if (!token->IsString())
+      return Result("SHADER_VARIANTS define names must be strings");
+    if (token->AsString() == "END")
+      break;
+
+    Shader::VariantDefine define;
+    define.name = token->AsString();
+    if (seen.count(define.name) != 0)
+      return Result("duplicate define (" + define.name +
+                    ") in SHADER_VARIANTS");
+    seen.insert(define.name);
+
+    for (token = tokenizer_->NextToken(); !token->IsEOL() && !token->IsEOS();
+         token = tokenizer_->NextToken()) {
+      if (token->IsString() || token->IsHex())
+        define.values.push_back(token->AsString());
+      else if (token->IsInteger())
+        define.values.push_back(std::to_string(token->AsInt64()));
+      else
+        define.values.push_back(FormatDouble(token->AsDouble()));
+    }
+    if (define.values.empty()) {
+      return Result("missing values for define (" + define.name +
+                    ") in SHADER_VARIANTS");
+    }
+
+    shader->AddVariantDefine(define);
+  }
+
+  return ValidateEndOfStatement("END");
+}
+
 Result Parser::ParsePipelineBlock() {
   auto token = tokenizer_->NextToken();
   if (!token->IsString())
@@ -213,6 +313,8 @@ Result Parser::ParsePipelineBlock() {
       r = ParsePipelineEntryPoint(pipeline.get());
     } else if (tok == "SHADER_OPTIMIZATION") {
       r = ParsePipelineShaderOptimizations(pipeline.get());
+    } else if (tok == "SPECIALIZE") {
+      r = ParsePipelineSpecialize(pipeline.get());
     } else {
       r = Result("unknown token in pipeline block: " + tok);
     }
@@ -305,5 +407,80 @@ Result Parser::ParsePipelineShaderOptimizations(Pipeline* pipeline) {
   return ValidateEndOfStatement("SHADER_OPTIMIZATION command");
 }
 
+Result Parser::ParsePipelineSpecialize(Pipeline* pipeline) {
+  auto token = tokenizer_->NextToken();
+  if (!token->IsString())
+    return Result("missing shader name in SPECIALIZE command");
+
+  auto* shader = script_.GetShader(token->AsString());
+  if (!shader)
+    return Result("unknown shader in SPECIALIZE command");
+
+  token = tokenizer_->NextToken();
+  if (!token->IsString() || token->AsString() != "ID")
+    return Result("expected ID in SPECIALIZE command");
+
+  token = tokenizer_->NextToken();
+  if (!token->IsInteger())
+    return Result("invalid constant ID in SPECIALIZE command");
+
+  uint32_t spec_id = token->AsUint32();
+
+  token = tokenizer_->NextToken();
+  if (!token->IsString() || token->AsString() != "AS")
+    return Result("expected AS in SPECIALIZE command");
+
+  token = tokenizer_->NextToken();
+  if (!token->IsString())
+    return Result("missing data type in SPECIALIZE command");
+
+  std::string type = token->AsString();
+  token = tokenizer_->NextToken();
+
+  uint32_t value = 0;
+  if (type == "uint32") {
+    if (!token->IsInteger())
+      return Result("invalid value in SPECIALIZE command");
+    if (token->IsNegative() ||
+        token->AsUint64() > std::numeric_limits<uint32_t>::max()) {
+      return Result("uint32 value out of range in SPECIALIZE command");
+    }
+
+    value = token->AsUint32();
+  } else if (type == "int32") {
+    if (!token->IsInteger())
+      return Result("invalid value in SPECIALIZE command");
+
+    // Negative values are stored two's complement in the 64-bit token value.
+    int64_t v = token->AsInt64();
+    if (token->IsNegative() != (v < 0) ||
+        v < std::numeric_limits<int32_t>::min() ||
+        v > std::numeric_limits<int32_t>::max()) {
+      return Result("int32 value out of range in SPECIALIZE command");
+    }
+
+    value = token->AsUint32();
+  } else if (type == "float") {
+    if (!token->IsInteger() && !token->IsDouble())
+      return Result("invalid value in SPECIALIZE command");
+
+    Result r = token->ConvertToDouble();
+    if (!r.IsSuccess())
+      return r;
+
+    float f = token->AsFloat();
+    memcpy(&value, &f, sizeof(value));
+  } else {
+    return Result("invalid data type '" + type +
+                  "' in SPECIALIZE command, must be uint32, int32 or float");
+  }
+
+  Result r = pipeline->AddShaderSpecialization(shader, spec_id, value);
+  if (!r.IsSuccess())
+    return r;
+
+  return ValidateEndOfStatement("SPECIALIZE command");
+}
+
 }  // namespace amberscript
 }  // namespace amber
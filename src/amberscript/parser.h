@@ -46,10 +46,12 @@ class Parser : public amber::Parser {
   Result ValidateEndOfStatement(const std::string& name);
 
   Result ParseShaderBlock();
+  Result ParseShaderVariants();
   Result ParsePipelineBlock();
   Result ParsePipelineAttach(Pipeline*);
   Result ParsePipelineEntryPoint(Pipeline*);
   Result ParsePipelineShaderOptimizations(Pipeline*);
+  Result ParsePipelineSpecialize(Pipeline*);
 
   amberscript::Script script_;
   std::unique_ptr<Tokenizer> tokenizer_;
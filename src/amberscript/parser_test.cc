@@ -350,6 +350,38 @@ INSTANTIATE_TEST_CASE_P(
                     ShaderFormatData{"SPIRV-ASM", ShaderFormat::kSpirvAsm},
                     ShaderFormatData{"SPIRV-HEX", ShaderFormat::kSpirvHex}), );
 
+TEST_F(AmberScriptParserTest, ShaderSpirvBin) {
+  std::string in = "SHADER vertex my_shader SPIRV-BIN shaders/my_shader.spv";
+
+  Parser parser;
+  Result r = parser.Parse(in);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  auto script = ToAmberScript(parser.GetScript());
+  const auto& shaders = script->GetShaders();
+  ASSERT_EQ(1U, shaders.size());
+  EXPECT_EQ(ShaderFormat::kSpirvBin, shaders[0]->GetFormat());
+  EXPECT_EQ("shaders/my_shader.spv", shaders[0]->GetData());
+}
+
+TEST_F(AmberScriptParserTest, ShaderSpirvBinMissingFile) {
+  std::string in = "SHADER vertex my_shader SPIRV-BIN";
+
+  Parser parser;
+  Result r = parser.Parse(in);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("1: missing file name for SHADER SPIRV-BIN", r.Error());
+}
+
+TEST_F(AmberScriptParserTest, ShaderSpirvBinExtraParams) {
+  std::string in = "SHADER vertex my_shader SPIRV-BIN a.spv b.spv";
+
+  Parser parser;
+  Result r = parser.Parse(in);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("1: extra parameters after SHADER SPIRV-BIN", r.Error());
+}
+
 TEST_F(AmberScriptParserTest, DuplicateShaderName) {
   std::string in = R"(
 SHADER vertex my_shader GLSL
@@ -814,6 +846,279 @@ END
   EXPECT_EQ(my_geom_opts, shaders[2].GetShaderOptimizations());
 }
 
+TEST_F(AmberScriptParserTest, PipelineSpecialization) {
+  std::string in = R"(
+SHADER compute my_shader GLSL
+# shader
+END
+PIPELINE compute my_pipeline
+  ATTACH my_shader
+  SPECIALIZE my_shader ID 1 AS uint32 4
+  SPECIALIZE my_shader ID 2 AS int32 -3
+  SPECIALIZE my_shader ID 5 AS float 1.5
+END
+)";
+
+  Parser parser;
+  Result r = parser.Parse(in);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  auto script = ToAmberScript(parser.GetScript());
+  const auto& pipelines = script->GetPipelines();
+  ASSERT_EQ(1U, pipelines.size());
+
+  const auto& shaders = pipelines[0]->GetShaders();
+  ASSERT_EQ(1U, shaders.size());
+
+  const auto& spec = shaders[0].GetSpecialization();
+  ASSERT_EQ(3U, spec.size());
+  EXPECT_EQ(4U, spec.at(1));
+  EXPECT_EQ(static_cast<uint32_t>(-3), spec.at(2));
+  EXPECT_EQ(0x3fc00000U, spec.at(5));
+}
+
+TEST_F(AmberScriptParserTest, PipelineSpecializationLimits) {
+  std::string in = R"(
+SHADER compute my_shader GLSL
+# shader
+END
+PIPELINE compute my_pipeline
+  ATTACH my_shader
+  SPECIALIZE my_shader ID 1 AS uint32 4294967295
+  SPECIALIZE my_shader ID 2 AS int32 -2147483648
+  SPECIALIZE my_shader ID 3 AS int32 2147483647
+END
+)";
+
+  Parser parser;
+  Result r = parser.Parse(in);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  auto script = ToAmberScript(parser.GetScript());
+  const auto& spec = script->GetPipelines()[0]->GetShaders()[0]
+                         .GetSpecialization();
+  ASSERT_EQ(3U, spec.size());
+  EXPECT_EQ(0xffffffffU, spec.at(1));
+  EXPECT_EQ(0x80000000U, spec.at(2));
+  EXPECT_EQ(0x7fffffffU, spec.at(3));
+}
+
+TEST_F(AmberScriptParserTest, PipelineSpecializationDuplicateId) {
+  std::string in = R"(
+SHADER compute my_shader GLSL
+# shader
+END
+PIPELINE compute my_pipeline
+  ATTACH my_shader
+  SPECIALIZE my_shader ID 1 AS uint32 4
+  SPECIALIZE my_shader ID 1 AS uint32 5
+END)";
+
+  Parser parser;
+  Result r = parser.Parse(in);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("8: duplicate specialization constant ID (1) set on shader",
+            r.Error());
+}
+
+TEST_F(AmberScriptParserTest, PipelineSpecializationUnAttachedShader) {
+  std::string in = R"(
+SHADER compute my_shader GLSL
+# shader
+END
+PIPELINE compute my_pipeline
+  SPECIALIZE my_shader ID 1 AS uint32 4
+END)";
+
+  Parser parser;
+  Result r = parser.Parse(in);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("6: unknown shader specified for specialization: my_shader",
+            r.Error());
+}
+
+struct SpecializationErrorData {
+  const char* in;
+  const char* error;
+};
+using AmberScriptParserSpecializationErrorTest =
+    testing::TestWithParam<SpecializationErrorData>;
+TEST_P(AmberScriptParserSpecializationErrorTest, Errors) {
+  const auto& test_data = GetParam();
+  std::string in = std::string(R"(
+SHADER compute my_shader GLSL
+# shader
+END
+PIPELINE compute my_pipeline
+  ATTACH my_shader
+  )") + test_data.in + "\nEND";
+
+  Parser parser;
+  Result r = parser.Parse(in);
+  ASSERT_FALSE(r.IsSuccess()) << test_data.in;
+  EXPECT_EQ(std::string("7: ") + test_data.error, r.Error()) << test_data.in;
+}
+INSTANTIATE_TEST_CASE_P(
+    AmberScriptParserSpecializationErrorTests,
+    AmberScriptParserSpecializationErrorTest,
+    testing::Values(
+        SpecializationErrorData{"SPECIALIZE other ID 1 AS uint32 1",
+                                "unknown shader in SPECIALIZE command"},
+        SpecializationErrorData{"SPECIALIZE my_shader 1 AS uint32 1",
+                                "expected ID in SPECIALIZE command"},
+        SpecializationErrorData{"SPECIALIZE my_shader ID a AS uint32 1",
+                                "invalid constant ID in SPECIALIZE command"},
+        SpecializationErrorData{"SPECIALIZE my_shader ID 1 uint32 1",
+                                "expected AS in SPECIALIZE command"},
+        SpecializationErrorData{"SPECIALIZE my_shader ID 1 AS uint32 a",
+                                "invalid value in SPECIALIZE command"},
+        SpecializationErrorData{
+            "SPECIALIZE my_shader ID 1 AS uint32 4294967296",
+            "uint32 value out of range in SPECIALIZE command"},
+        SpecializationErrorData{
+            "SPECIALIZE my_shader ID 1 AS uint32 -1",
+            "uint32 value out of range in SPECIALIZE command"},
+        SpecializationErrorData{
+            "SPECIALIZE my_shader ID 1 AS int32 2147483648",
+            "int32 value out of range in SPECIALIZE command"},
+        SpecializationErrorData{
+            "SPECIALIZE my_shader ID 1 AS int32 -2147483649",
+            "int32 value out of range in SPECIALIZE command"},
+        SpecializationErrorData{
+            "SPECIALIZE my_shader ID 1 AS double 1",
+            "invalid data type 'double' in SPECIALIZE command, must be "
+            "uint32, int32 or float"},
+        SpecializationErrorData{
+            "SPECIALIZE my_shader ID 1 AS uint32 1 2",
+            "extra parameters after SPECIALIZE command"}), );
+
+TEST_F(AmberScriptParserTest, ShaderVariants) {
+  std::string in = R"(
+SHADER fragment my_shader GLSL
+# shader
+END
+SHADER_VARIANTS my_shader
+  USE_FOG 0 1
+  NUM_LIGHTS 1 4 8
+  MODE fast
+END
+)";
+
+  Parser parser;
+  Result r = parser.Parse(in);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  auto script = ToAmberScript(parser.GetScript());
+  const auto& shaders = script->GetShaders();
+  ASSERT_EQ(1U, shaders.size());
+
+  const auto& defines = shaders[0]->GetVariantDefines();
+  ASSERT_EQ(3U, defines.size());
+  EXPECT_EQ("USE_FOG", defines[0].name);
+  EXPECT_EQ(std::vector<std::string>({"0", "1"}), defines[0].values);
+  EXPECT_EQ("NUM_LIGHTS", defines[1].name);
+  EXPECT_EQ(std::vector<std::string>({"1", "4", "8"}), defines[1].values);
+  EXPECT_EQ("MODE", defines[2].name);
+  EXPECT_EQ(std::vector<std::string>({"fast"}), defines[2].values);
+
+  const auto variants = shaders[0]->GetVariants();
+  ASSERT_EQ(6U, variants.size());
+
+  Shader::Defines first = {{"USE_FOG", "0"}, {"NUM_LIGHTS", "1"},
+                           {"MODE", "fast"}};
+  EXPECT_EQ(first, variants[0]);
+  Shader::Defines second = {{"USE_FOG", "1"}, {"NUM_LIGHTS", "1"},
+                            {"MODE", "fast"}};
+  EXPECT_EQ(second, variants[1]);
+  Shader::Defines last = {{"USE_FOG", "1"}, {"NUM_LIGHTS", "8"},
+                          {"MODE", "fast"}};
+  EXPECT_EQ(last, variants[5]);
+}
+
+TEST_F(AmberScriptParserTest, ShaderVariantsFloatValues) {
+  std::string in = R"(
+SHADER fragment my_shader GLSL
+# shader
+END
+SHADER_VARIANTS my_shader
+  SCALE 1.5 0.1 2.0 -0.25
+END
+)";
+
+  Parser parser;
+  Result r = parser.Parse(in);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  auto script = ToAmberScript(parser.GetScript());
+  const auto& defines = script->GetShaders()[0]->GetVariantDefines();
+  ASSERT_EQ(1U, defines.size());
+  EXPECT_EQ(std::vector<std::string>({"1.5", "0.1", "2.0", "-0.25"}),
+            defines[0].values);
+}
+
+TEST_F(AmberScriptParserTest, ShaderWithoutVariants) {
+  std::string in = R"(
+SHADER fragment my_shader GLSL
+# shader
+END
+)";
+
+  Parser parser;
+  Result r = parser.Parse(in);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  auto script = ToAmberScript(parser.GetScript());
+  const auto variants = script->GetShaders()[0]->GetVariants();
+  ASSERT_EQ(1U, variants.size());
+  EXPECT_TRUE(variants[0].empty());
+}
+
+struct ShaderVariantsErrorData {
+  const char* in;
+  const char* error;
+};
+using AmberScriptParserShaderVariantsErrorTest =
+    testing::TestWithParam<ShaderVariantsErrorData>;
+TEST_P(AmberScriptParserShaderVariantsErrorTest, Errors) {
+  const auto& test_data = GetParam();
+  std::string in = std::string(R"(
+SHADER fragment my_shader GLSL
+# shader
+END
+SHADER vertex my_vertex PASSTHROUGH
+)") + test_data.in;
+
+  Parser parser;
+  Result r = parser.Parse(in);
+  ASSERT_FALSE(r.IsSuccess()) << test_data.in;
+  EXPECT_EQ(test_data.error, r.Error()) << test_data.in;
+}
+INSTANTIATE_TEST_CASE_P(
+    AmberScriptParserShaderVariantsErrorTests,
+    AmberScriptParserShaderVariantsErrorTest,
+    testing::Values(
+        ShaderVariantsErrorData{
+            "SHADER_VARIANTS other\nA 1\nEND",
+            "6: unknown shader in SHADER_VARIANTS command"},
+        ShaderVariantsErrorData{
+            "SHADER_VARIANTS my_vertex\nA 1\nEND",
+            "6: SHADER_VARIANTS requires a GLSL shader"},
+        ShaderVariantsErrorData{
+            "SHADER_VARIANTS my_shader extra\nA 1\nEND",
+            "6: extra parameters after SHADER_VARIANTS command"},
+        ShaderVariantsErrorData{"SHADER_VARIANTS my_shader\nA 1\n",
+                                "8: SHADER_VARIANTS missing END command"},
+        ShaderVariantsErrorData{
+            "SHADER_VARIANTS my_shader\nA\nEND",
+            "8: missing values for define (A) in SHADER_VARIANTS"},
+        ShaderVariantsErrorData{
+            "SHADER_VARIANTS my_shader\nA 1\nA 2\nEND",
+            "8: duplicate define (A) in SHADER_VARIANTS"},
+        ShaderVariantsErrorData{
+            "SHADER_VARIANTS my_shader\nA 1\nEND\n"
+            "SHADER_VARIANTS my_shader\nB 1\nEND",
+            "9: duplicate SHADER_VARIANTS for shader: my_shader"}), );
+
 TEST_F(AmberScriptParserTest, PipelineShaderOptmizationInvalidShader) {
   std::string in = R"(
 PIPELINE graphics my_pipeline
@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <set>
+#include <string>
 
 namespace amber {
 namespace amberscript {
@@ -102,6 +103,28 @@ Result Pipeline::SetShaderEntryPoint(const Shader* shader,
                 shader->GetName());
 }
 
+Result Pipeline::AddShaderSpecialization(const Shader* shader,
+                                         uint32_t spec_id,
+                                         uint32_t value) {
+  if (!shader)
+    return Result("invalid shader specified for specialization");
+
+  for (auto& info : shaders_) {
+    if (info.GetShader() == shader) {
+      if (info.GetSpecialization().count(spec_id) != 0) {
+        return Result("duplicate specialization constant ID (" +
+                      std::to_string(spec_id) + ") set on shader");
+      }
+
+      info.AddSpecialization(spec_id, value);
+      return {};
+    }
+  }
+
+  return Result("unknown shader specified for specialization: " +
+                shader->GetName());
+}
+
 Result Pipeline::Validate() const {
   if (pipeline_type_ == PipelineType::kGraphics)
     return ValidateGraphics();
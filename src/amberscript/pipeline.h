@@ -15,6 +15,7 @@
 #ifndef SRC_AMBERSCRIPT_PIPELINE_H_
 #define SRC_AMBERSCRIPT_PIPELINE_H_
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -46,10 +47,20 @@ class Pipeline {
     void SetEntryPoint(const std::string& ep) { entry_point_ = ep; }
     std::string GetEntryPoint() const { return entry_point_; }
 
+    // Specialization constants, mapping the constant id to the raw 32 bit
+    // value.
+    void AddSpecialization(uint32_t spec_id, uint32_t value) {
+      specialization_[spec_id] = value;
+    }
+    const std::map<uint32_t, uint32_t>& GetSpecialization() const {
+      return specialization_;
+    }
+
    private:
     const Shader* shader_ = nullptr;
     std::vector<std::string> shader_optimizations_;
     std::string entry_point_;
+    std::map<uint32_t, uint32_t> specialization_;
   };
 
   Pipeline(PipelineType type);
@@ -66,6 +77,9 @@ class Pipeline {
   Result SetShaderEntryPoint(const Shader* shader, const std::string& name);
   Result SetShaderOptimizations(const Shader* shader,
                                 const std::vector<std::string>& opts);
+  Result AddShaderSpecialization(const Shader* shader,
+                                 uint32_t spec_id,
+                                 uint32_t value);
 
   // Validates that the pipeline has been created correctly.
   Result Validate() const;
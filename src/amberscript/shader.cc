@@ -21,5 +21,20 @@ Shader::Shader(ShaderType type) : shader_type_(type) {}
 
 Shader::~Shader() = default;
 
+std::vector<Shader::Defines> Shader::GetVariants() const {
+  std::vector<Defines> variants(1);
+  for (const auto& define : variant_defines_) {
+    std::vector<Defines> expanded;
+    for (const auto& value : define.values) {
+      for (const auto& variant : variants) {
+        expanded.push_back(variant);
+        expanded.back().emplace_back(define.name, value);
+      }
+    }
+    variants = std::move(expanded);
+  }
+  return variants;
+}
+
 }  // namespace amberscript
 }  // namespace amber
@@ -16,6 +16,8 @@
 #define SRC_AMBERSCRIPT_SHADER_H_
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "src/shader_data.h"
 
@@ -24,6 +26,15 @@ namespace amberscript {
 
 class Shader {
  public:
+  // A #define which takes each of |values| in turn when the shader variants
+  // are expanded.
+  struct VariantDefine {
+    std::string name;
+    std::vector<std::string> values;
+  };
+  // The NAME=value assignments making up a single variant.
+  using Defines = std::vector<std::pair<std::string, std::string>>;
+
   Shader(ShaderType type);
   ~Shader();
 
@@ -38,11 +49,24 @@ class Shader {
   void SetData(const std::string& data) { data_ = data; }
   const std::string& GetData() const { return data_; }
 
+  void AddVariantDefine(const VariantDefine& define) {
+    variant_defines_.push_back(define);
+  }
+  const std::vector<VariantDefine>& GetVariantDefines() const {
+    return variant_defines_;
+  }
+
+  // Returns every permutation of the variant defines, with the first define
+  // varying fastest. A shader without variants has a single, empty,
+  // permutation.
+  std::vector<Defines> GetVariants() const;
+
  private:
   ShaderType shader_type_;
   ShaderFormat shader_format_;
   std::string data_;
   std::string name_;
+  std::vector<VariantDefine> variant_defines_;
 };
 
 }  // namespace amberscript
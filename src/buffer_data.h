@@ -15,10 +15,26 @@
 #ifndef SRC_BUFFER_DATA_H_
 #define SRC_BUFFER_DATA_H_
 
+#include <cstddef>
+#include <cstdint>
+
 namespace amber {
 
+class Format;
+
 enum class BufferType { kFramebuffer = 0, kVertexData, kIndices };
 
+// A view of buffer data which is already in its binary layout. Element i,
+// of |format|, starts |i * stride| bytes after |data|. A |stride| of 0
+// means the elements are tightly packed. The view does not own |data| or
+// |format|.
+struct BufferView {
+  const void* data = nullptr;
+  size_t size_in_bytes = 0;
+  const Format* format = nullptr;
+  uint32_t stride = 0;
+};
+
 }  // namespace amber
 
 #endif  // SRC_BUFFER_DATA_H_
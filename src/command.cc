@@ -68,6 +68,14 @@ ProbeSSBOCommand* Command::AsProbeSSBO() {
   return static_cast<ProbeSSBOCommand*>(this);
 }
 
+ProbeHashCommand* Command::AsProbeHash() {
+  return static_cast<ProbeHashCommand*>(this);
+}
+
+ProbeImageCommand* Command::AsProbeImage() {
+  return static_cast<ProbeImageCommand*>(this);
+}
+
 ToleranceCommand* Command::AsTolerance() {
   return static_cast<ToleranceCommand*>(this);
 }
@@ -100,6 +108,21 @@ ProbeSSBOCommand::ProbeSSBOCommand() : Command(Type::kProbeSSBO) {}
 
 ProbeSSBOCommand::~ProbeSSBOCommand() = default;
 
+ProbeHashCommand::ProbeHashCommand() : Command(Type::kProbeHash) {}
+
+ProbeHashCommand::~ProbeHashCommand() = default;
+
+std::string ProbeHashCommand::GetTargetName() const {
+  if (!is_ssbo_)
+    return "";
+  return "ssbo " + std::to_string(descriptor_set_id_) + ":" +
+         std::to_string(binding_num_);
+}
+
+ProbeImageCommand::ProbeImageCommand() : Command(Type::kProbeImage) {}
+
+ProbeImageCommand::~ProbeImageCommand() = default;
+
 ToleranceCommand::ToleranceCommand() : Command(Type::kTolerance) {}
 
 ToleranceCommand::~ToleranceCommand() = default;
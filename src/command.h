@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "src/command_data.h"
+#include "src/content_hash.h"
 #include "src/datum_type.h"
 #include "src/pipeline_data.h"
 #include "src/shader_data.h"
@@ -38,6 +39,8 @@ class EntryPointCommand;
 class PatchParameterVerticesCommand;
 class ProbeCommand;
 class ProbeSSBOCommand;
+class ProbeHashCommand;
+class ProbeImageCommand;
 class BufferCommand;
 class ToleranceCommand;
 
@@ -56,6 +59,8 @@ class Command {
     kPipelineProperties,
     kProbe,
     kProbeSSBO,
+    kProbeHash,
+    kProbeImage,
     kBuffer,
     kTolerance,
   };
@@ -67,6 +72,8 @@ class Command {
   bool IsCompute() const { return command_type_ == Type::kCompute; }
   bool IsProbe() const { return command_type_ == Type::kProbe; }
   bool IsProbeSSBO() const { return command_type_ == Type::kProbeSSBO; }
+  bool IsProbeHash() const { return command_type_ == Type::kProbeHash; }
+  bool IsProbeImage() const { return command_type_ == Type::kProbeImage; }
   bool IsBuffer() const { return command_type_ == Type::kBuffer; }
   bool IsTolerance() const { return command_type_ == Type::kTolerance; }
   bool IsClear() const { return command_type_ == Type::kClear; }
@@ -89,6 +96,8 @@ class Command {
   PatchParameterVerticesCommand* AsPatchParameterVertices();
   ProbeCommand* AsProbe();
   ProbeSSBOCommand* AsProbeSSBO();
+  ProbeHashCommand* AsProbeHash();
+  ProbeImageCommand* AsProbeImage();
   BufferCommand* AsBuffer();
   ToleranceCommand* AsTolerance();
 
@@ -293,6 +302,74 @@ class ProbeSSBOCommand : public Command {
   std::vector<Value> values_;
 };
 
+// Checks the hash of the whole color attachment, or of a whole storage
+// buffer, against an expected value.
+class ProbeHashCommand : public Command {
+ public:
+  ProbeHashCommand();
+  ~ProbeHashCommand() override;
+
+  void SetIsSSBO() { is_ssbo_ = true; }
+  bool IsSSBO() const { return is_ssbo_; }
+
+  void SetDescriptorSet(uint32_t id) { descriptor_set_id_ = id; }
+  uint32_t GetDescriptorSet() const { return descriptor_set_id_; }
+
+  void SetBinding(uint32_t id) { binding_num_ = id; }
+  uint32_t GetBinding() const { return binding_num_; }
+
+  void SetAlgorithm(ContentHashAlgorithm algorithm) { algorithm_ = algorithm; }
+  ContentHashAlgorithm GetAlgorithm() const { return algorithm_; }
+
+  void SetExpectedHash(uint64_t hash) { expected_hash_ = hash; }
+  uint64_t GetExpectedHash() const { return expected_hash_; }
+
+  // Returns what is hashed as written in the script, "ssbo <set>:<binding>"
+  // or an empty string for the color attachment.
+  std::string GetTargetName() const;
+
+ private:
+  bool is_ssbo_ = false;
+  uint32_t descriptor_set_id_ = 0;
+  uint32_t binding_num_ = 0;
+  ContentHashAlgorithm algorithm_ = ContentHashAlgorithm::kXXH64;
+  uint64_t expected_hash_ = 0;
+};
+
+// Compares the whole color attachment with a reference image file. The
+// thresholds apply to every channel and are in 8 bit steps. Without any
+// threshold set every difference is allowed.
+class ProbeImageCommand : public Command {
+ public:
+  ProbeImageCommand();
+  ~ProbeImageCommand() override;
+
+  void SetFilename(const std::string& filename) { filename_ = filename; }
+  const std::string& GetFilename() const { return filename_; }
+
+  // The file a PPM image of the differences is written to, or empty.
+  void SetDiffFilename(const std::string& filename) {
+    diff_filename_ = filename;
+  }
+  const std::string& GetDiffFilename() const { return diff_filename_; }
+
+  void SetMaxError(uint32_t max_error) { max_error_ = max_error; }
+  uint32_t GetMaxError() const { return max_error_; }
+
+  void SetMaxRMSE(double rmse) { max_rmse_ = rmse; }
+  double GetMaxRMSE() const { return max_rmse_; }
+
+  void SetMinPSNR(double psnr) { min_psnr_ = psnr; }
+  double GetMinPSNR() const { return min_psnr_; }
+
+ private:
+  std::string filename_;
+  std::string diff_filename_;
+  uint32_t max_error_ = 255;
+  double max_rmse_ = 255.0;
+  double min_psnr_ = 0.0;
+};
+
 class BufferCommand : public Command {
  public:
   enum class BufferType {
@@ -0,0 +1,186 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "src/content_hash.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace amber {
+namespace {
+
+const uint64_t kPrime1 = 11400714785074694791ULL;
+const uint64_t kPrime2 = 14029467366897019727ULL;
+const uint64_t kPrime3 = 1609587929392839161ULL;
+const uint64_t kPrime4 = 9650029242287828579ULL;
+const uint64_t kPrime5 = 2870177450012600261ULL;
+
+const size_t kStripeSize = 32;
+
+inline uint64_t RotateLeft(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+// The hash is defined on little endian words, which is the host order on
+// every platform Amber runs on.
+inline uint64_t Read64(const uint8_t* p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint32_t Read32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint64_t Round(uint64_t lane, uint64_t input) {
+  lane += input * kPrime2;
+  lane = RotateLeft(lane, 31);
+  return lane * kPrime1;
+}
+
+inline uint64_t MergeRound(uint64_t hash, uint64_t lane) {
+  hash ^= Round(0, lane);
+  return hash * kPrime1 + kPrime4;
+}
+
+// Consumes the whole stripes of |size| bytes at |p| and returns the number
+// of bytes consumed.
+size_t ConsumeStripes(const uint8_t* p, size_t size, uint64_t* lanes) {
+  uint64_t v1 = lanes[0];
+  uint64_t v2 = lanes[1];
+  uint64_t v3 = lanes[2];
+  uint64_t v4 = lanes[3];
+
+  const uint8_t* const start = p;
+  const uint8_t* const end = p + (size - size % kStripeSize);
+  for (; p < end; p += kStripeSize) {
+    v1 = Round(v1, Read64(p));
+    v2 = Round(v2, Read64(p + 8));
+    v3 = Round(v3, Read64(p + 16));
+    v4 = Round(v4, Read64(p + 24));
+  }
+
+  lanes[0] = v1;
+  lanes[1] = v2;
+  lanes[2] = v3;
+  lanes[3] = v4;
+  return static_cast<size_t>(p - start);
+}
+
+}  // namespace
+
+ContentHasher::ContentHasher() {
+  lanes_[0] = kPrime1 + kPrime2;
+  lanes_[1] = kPrime2;
+  lanes_[2] = 0;
+  lanes_[3] = 0 - kPrime1;
+}
+
+ContentHasher::~ContentHasher() = default;
+
+void ContentHasher::Update(const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  total_size_ += size;
+
+  if (pending_size_ > 0) {
+    const size_t fill = std::min(kStripeSize - pending_size_, size);
+    memcpy(pending_ + pending_size_, p, fill);
+    pending_size_ += fill;
+    p += fill;
+    size -= fill;
+    if (pending_size_ < kStripeSize)
+      return;
+
+    ConsumeStripes(pending_, kStripeSize, lanes_);
+    pending_size_ = 0;
+  }
+
+  const size_t consumed = ConsumeStripes(p, size, lanes_);
+  pending_size_ = size - consumed;
+  memcpy(pending_, p + consumed, pending_size_);
+}
+
+uint64_t ContentHasher::Digest() const {
+  uint64_t hash;
+  if (total_size_ >= kStripeSize) {
+    hash = RotateLeft(lanes_[0], 1) + RotateLeft(lanes_[1], 7) +
+           RotateLeft(lanes_[2], 12) + RotateLeft(lanes_[3], 18);
+    for (uint64_t lane : lanes_)
+      hash = MergeRound(hash, lane);
+  } else {
+    hash = kPrime5;
+  }
+  hash += total_size_;
+
+  const uint8_t* p = pending_;
+  const uint8_t* const end = pending_ + pending_size_;
+  for (; p + 8 <= end; p += 8) {
+    hash ^= Round(0, Read64(p));
+    hash = RotateLeft(hash, 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end) {
+    hash ^= static_cast<uint64_t>(Read32(p)) * kPrime1;
+    hash = RotateLeft(hash, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    hash ^= *p * kPrime5;
+    hash = RotateLeft(hash, 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+uint64_t HashRows(const void* data,
+                  size_t row_size,
+                  uint32_t rows,
+                  size_t row_pitch) {
+  ContentHasher hasher;
+  if (row_pitch == row_size) {
+    hasher.Update(data, row_size * rows);
+    return hasher.Digest();
+  }
+
+  const uint8_t* row = static_cast<const uint8_t*>(data);
+  for (uint32_t y = 0; y < rows; ++y, row += row_pitch)
+    hasher.Update(row, row_size);
+  return hasher.Digest();
+}
+
+const char* ContentHashAlgorithmName(ContentHashAlgorithm algorithm) {
+  switch (algorithm) {
+    case ContentHashAlgorithm::kXXH64:
+      return "xxh64";
+  }
+  return "";
+}
+
+std::string ContentHashToString(uint64_t hash) {
+  char str[19];
+  snprintf(str, sizeof(str), "0x%016" PRIx64, hash);
+  return str;
+}
+
+}  // namespace amber
@@ -0,0 +1,69 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef SRC_CONTENT_HASH_H_
+#define SRC_CONTENT_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace amber {
+
+// Algorithms the probe hash command can check contents with.
+enum class ContentHashAlgorithm : uint8_t {
+  // XXH64 with a seed of 0, as computed by the reference xxHash library.
+  kXXH64 = 0,
+};
+
+// Computes the XXH64 hash of data given in any number of pieces. The hash
+// only depends on the concatenated bytes, not on how they were split, so
+// images are hashed a row at a time without their row padding. Whole 32 byte
+// stripes are read straight from the input into four independent lanes.
+class ContentHasher {
+ public:
+  ContentHasher();
+  ~ContentHasher();
+
+  void Update(const void* data, size_t size);
+
+  // Returns the hash of the bytes given so far. More bytes can be added
+  // afterwards.
+  uint64_t Digest() const;
+
+ private:
+  uint64_t lanes_[4];
+  uint8_t pending_[32];
+  size_t pending_size_ = 0;
+  uint64_t total_size_ = 0;
+};
+
+// Returns the hash of the |row_size| bytes at the start of each of |rows|
+// rows, |row_pitch| bytes apart. Any padding after a row is skipped, so the
+// hash is that of the tightly packed rows.
+uint64_t HashRows(const void* data,
+                  size_t row_size,
+                  uint32_t rows,
+                  size_t row_pitch);
+
+// Returns the name of |algorithm| used in scripts.
+const char* ContentHashAlgorithmName(ContentHashAlgorithm algorithm);
+
+// Returns |hash| as 0x followed by 16 hexadecimal digits.
+std::string ContentHashToString(uint64_t hash);
+
+}  // namespace amber
+
+#endif  // SRC_CONTENT_HASH_H_
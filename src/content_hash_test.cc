@@ -0,0 +1,93 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "src/content_hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace amber {
+namespace {
+
+uint64_t HashString(const std::string& str) {
+  ContentHasher hasher;
+  hasher.Update(str.data(), str.size());
+  return hasher.Digest();
+}
+
+}  // namespace
+
+using ContentHashTest = testing::Test;
+
+TEST_F(ContentHashTest, ReferenceValues) {
+  EXPECT_EQ(0xef46db3751d8e999ULL, HashString(""));
+  EXPECT_EQ(0xd24ec4f1a98c6e5bULL, HashString("a"));
+  EXPECT_EQ(0x44bc2cf5ad770999ULL, HashString("abc"));
+  EXPECT_EQ(0xfbcea83c8a378bf1ULL,
+            HashString("Nobody inspects the spammish repetition"));
+}
+
+TEST_F(ContentHashTest, IndependentOfPieces) {
+  std::vector<uint8_t> data(1000);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<uint8_t>(i * 7 + 3);
+
+  ContentHasher whole;
+  whole.Update(data.data(), data.size());
+  const uint64_t expected = whole.Digest();
+
+  for (size_t piece : {1U, 3U, 8U, 31U, 32U, 33U, 100U}) {
+    ContentHasher hasher;
+    for (size_t i = 0; i < data.size(); i += piece)
+      hasher.Update(data.data() + i, std::min(piece, data.size() - i));
+    EXPECT_EQ(expected, hasher.Digest()) << piece;
+  }
+}
+
+TEST_F(ContentHashTest, RowsIgnorePadding) {
+  const size_t row_size = 4 * 13;
+  const uint32_t rows = 9;
+  std::vector<uint8_t> packed(row_size * rows);
+  for (size_t i = 0; i < packed.size(); ++i)
+    packed[i] = static_cast<uint8_t>(i);
+
+  const uint64_t expected = HashRows(packed.data(), row_size, rows, row_size);
+  ContentHasher hasher;
+  hasher.Update(packed.data(), packed.size());
+  EXPECT_EQ(hasher.Digest(), expected);
+
+  // The same rows with the padding a driver could add are hashed the same.
+  for (size_t row_pitch : {row_size + 4, row_size + 12, size_t(256)}) {
+    std::vector<uint8_t> padded(row_pitch * rows, 0xcd);
+    for (uint32_t y = 0; y < rows; ++y) {
+      memcpy(padded.data() + y * row_pitch, packed.data() + y * row_size,
+             row_size);
+    }
+    EXPECT_EQ(expected, HashRows(padded.data(), row_size, rows, row_pitch))
+        << row_pitch;
+  }
+}
+
+TEST_F(ContentHashTest, ToString) {
+  EXPECT_EQ("0x0000000000000000", ContentHashToString(0));
+  EXPECT_EQ("0xef46db3751d8e999", ContentHashToString(0xef46db3751d8e999ULL));
+  EXPECT_STREQ("xxh64", ContentHashAlgorithmName(ContentHashAlgorithm::kXXH64));
+}
+
+}  // namespace amber
@@ -23,6 +23,14 @@ EngineDawn::EngineDawn() : Engine() {}
 
 EngineDawn::~EngineDawn() = default;
 
+void EngineDawn::SetPipelineCacheOptions(const std::string&, bool) {}
+
+void EngineDawn::SetProbeOnDevice(bool) {}
+
+void EngineDawn::SetPixelProbeOptions(bool, uint32_t) {}
+
+void EngineDawn::SetRetainShaderModules(bool) {}
+
 Result EngineDawn::Initialize() {
   if (device_)
     return Result("Dawn:Initialize device_ already exists");
@@ -58,10 +66,20 @@ Result EngineDawn::AddRequirement(Feature, const Format*) {
   return Result("Dawn:AddRequirement not implemented");
 }
 
+Result EngineDawn::ResetPipeline() {
+  return Result("Dawn:ResetPipeline not implemented");
+}
+
 Result EngineDawn::SetShader(ShaderType, const std::vector<uint32_t>&) {
   return Result("Dawn:SetShader not implemented");
 }
 
+Result EngineDawn::SetShaderSpecialization(
+    ShaderType,
+    const std::map<uint32_t, uint32_t>&) {
+  return Result("Dawn:SetShaderSpecialization not implemented");
+}
+
 Result EngineDawn::SetBuffer(BufferType,
                              uint8_t,
                              const Format&,
@@ -69,6 +87,10 @@ Result EngineDawn::SetBuffer(BufferType,
   return Result("Dawn:SetBuffer not implemented");
 }
 
+Result EngineDawn::SetBufferData(BufferType, uint8_t, const BufferView&) {
+  return Result("Dawn:SetBufferData not implemented");
+}
+
 Result EngineDawn::DoClearColor(const ClearColorCommand*) {
   return Result("Dawn:DoClearColor not implemented");
 }
@@ -114,6 +136,14 @@ Result EngineDawn::DoProbeSSBO(const ProbeSSBOCommand*) {
   return Result("Dawn:DoProbeSSBO not implemented");
 }
 
+Result EngineDawn::DoProbeHash(const ProbeHashCommand*, uint64_t*) {
+  return Result("Dawn:DoProbeHash not implemented");
+}
+
+Result EngineDawn::ReadColorAttachment(Rgba8Image*) {
+  return Result("Dawn:ReadColorAttachment not implemented");
+}
+
 Result EngineDawn::DoBuffer(const BufferCommand*) {
   return Result("Dawn:DoBuffer not implemented");
 }
@@ -122,5 +152,21 @@ Result EngineDawn::DoTolerance(const ToleranceCommand*) {
   return Result("Dawn:DoTolerance not implemented");
 }
 
+ShaderModuleCacheStats EngineDawn::GetShaderModuleCacheStats() {
+  return {};
+}
+
+PipelineCacheStats EngineDawn::GetPipelineCacheStats() {
+  return {};
+}
+
+double EngineDawn::GetPipelineCreationMs() {
+  return 0.0;
+}
+
+DeviceMemoryStats EngineDawn::GetDeviceMemoryStats() {
+  return {};
+}
+
 }  // namespace dawn
 }  // namespace amber
@@ -28,6 +28,11 @@ class EngineDawn : public Engine {
   ~EngineDawn() override;
 
   // Engine
+  void SetPipelineCacheOptions(const std::string& directory,
+                               bool compare) override;
+  void SetProbeOnDevice(bool probe_on_device) override;
+  void SetPixelProbeOptions(bool early_exit, uint32_t max_threads) override;
+  void SetRetainShaderModules(bool retain) override;
   // Initialize with a default device.
   Result Initialize() override;
   // Initialize with a given device, specified as a pointer-to-::dawn::Device
@@ -35,12 +40,19 @@ class EngineDawn : public Engine {
   Result InitializeWithDevice(void* default_device) override;
   Result Shutdown() override;
   Result CreatePipeline(PipelineType) override;
+  Result ResetPipeline() override;
   Result AddRequirement(Feature feature, const Format*) override;
   Result SetShader(ShaderType type, const std::vector<uint32_t>& data) override;
+  Result SetShaderSpecialization(
+      ShaderType type,
+      const std::map<uint32_t, uint32_t>& constants) override;
   Result SetBuffer(BufferType type,
                    uint8_t location,
                    const Format& format,
                    const std::vector<Value>& data) override;
+  Result SetBufferData(BufferType type,
+                       uint8_t location,
+                       const BufferView& view) override;
   Result DoClearColor(const ClearColorCommand* cmd) override;
   Result DoClearStencil(const ClearStencilCommand* cmd) override;
   Result DoClearDepth(const ClearDepthCommand* cmd) override;
@@ -53,8 +65,14 @@ class EngineDawn : public Engine {
       const PatchParameterVerticesCommand* cmd) override;
   Result DoProbe(const ProbeCommand* cmd) override;
   Result DoProbeSSBO(const ProbeSSBOCommand* cmd) override;
+  Result DoProbeHash(const ProbeHashCommand* cmd, uint64_t* hash) override;
+  Result ReadColorAttachment(Rgba8Image* image) override;
   Result DoBuffer(const BufferCommand* cmd) override;
   Result DoTolerance(const ToleranceCommand* cmd) override;
+  ShaderModuleCacheStats GetShaderModuleCacheStats() override;
+  PipelineCacheStats GetPipelineCacheStats() override;
+  double GetPipelineCreationMs() override;
+  DeviceMemoryStats GetDeviceMemoryStats() override;
 
  private:
   ::dawn::Device device_;
@@ -47,6 +47,20 @@ std::unique_ptr<Engine> Engine::Create(EngineType type) {
   return engine;
 }
 
+// static
+void Engine::ReleaseDevice(EngineType type, void* device) {
+  switch (type) {
+    case EngineType::kVulkan:
+#if AMBER_ENGINE_VULKAN
+      vulkan::EngineVulkan::ReleaseDevice(device);
+#endif  // AMBER_ENGINE_VULKAN
+      break;
+    case EngineType::kDawn:
+      break;
+  }
+  (void)device;
+}
+
 Engine::Engine() = default;
 
 Engine::~Engine() = default;
@@ -15,7 +15,9 @@
 #ifndef ENGINE_H_
 #define ENGINE_H_
 
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "amber/amber.h"
@@ -28,6 +30,8 @@
 
 namespace amber {
 
+struct Rgba8Image;
+
 enum class PipelineType : uint8_t {
   kCompute = 0,
   kGraphics,
@@ -37,8 +41,32 @@ class Engine {
  public:
   static std::unique_ptr<Engine> Create(EngineType type);
 
+  // Releases the resources an engine of |type| keeps for the application
+  // provided |device| between scripts.
+  static void ReleaseDevice(EngineType type, void* device);
+
   virtual ~Engine();
 
+  // Set where the pipeline cache is persisted, and whether pipelines are
+  // also created without the cache to compare creation times. Must be called
+  // before the engine is initialized.
+  virtual void SetPipelineCacheOptions(const std::string& directory,
+                                       bool compare) = 0;
+
+  // Set whether large probes are compared on the device, reading back the
+  // probed data only when it fails. Must be called before the engine is
+  // initialized.
+  virtual void SetProbeOnDevice(bool probe_on_device) = 0;
+
+  // Set whether probes stop at the first failing pixel, and the most threads
+  // a probed rectangle is split across. 0 uses one per hardware thread.
+  // Must be called before the engine is initialized.
+  virtual void SetPixelProbeOptions(bool early_exit, uint32_t max_threads) = 0;
+
+  // Set whether shader modules are kept on an application provided device
+  // after the engine is shut down, for later engines on the device to reuse.
+  virtual void SetRetainShaderModules(bool retain) = 0;
+
   // Initialize the engine.
   virtual Result Initialize() = 0;
 
@@ -56,16 +84,34 @@ class Engine {
   // Create graphics pipeline.
   virtual Result CreatePipeline(PipelineType type) = 0;
 
+  // Destroy the pipeline and the shaders set for it, so a new pipeline can be
+  // created without re-initializing the engine.
+  virtual Result ResetPipeline() = 0;
+
   // Set the shader of |type| to the binary |data|.
   virtual Result SetShader(ShaderType type,
                            const std::vector<uint32_t>& data) = 0;
 
+  // Set the specialization constants used by the shader of |type|.
+  // |constants| maps a specialization constant id to its 32 bit value.
+  virtual Result SetShaderSpecialization(
+      ShaderType type,
+      const std::map<uint32_t, uint32_t>& constants) = 0;
+
   // Provides the data for a given buffer to be bound at the given location.
   virtual Result SetBuffer(BufferType type,
                            uint8_t location,
                            const Format& format,
                            const std::vector<Value>& data) = 0;
 
+  // Provides the data for a given buffer, already in its binary layout, to be
+  // bound at the given location. The data is not copied until it is sent to
+  // the device, by the next draw, so |view.data| and |view.format| must stay
+  // valid until then.
+  virtual Result SetBufferData(BufferType type,
+                               uint8_t location,
+                               const BufferView& view) = 0;
+
   // Execute the clear color command
   virtual Result DoClearColor(const ClearColorCommand* cmd) = 0;
 
@@ -100,12 +146,37 @@ class Engine {
   // Execute the probe ssbo command
   virtual Result DoProbeSSBO(const ProbeSSBOCommand* cmd) = 0;
 
+  // Execute the probe hash command, storing the hash of the color attachment
+  // or storage buffer it names in |hash|. Only the bytes of the texels or
+  // values are hashed, never row padding, so the hash does not depend on the
+  // driver's layout of the data.
+  virtual Result DoProbeHash(const ProbeHashCommand* cmd, uint64_t* hash) = 0;
+
+  // Reads back the whole color attachment into |image|, converting each
+  // channel to 8 bits. Normalized values are rounded to the nearest step and
+  // values outside [0, 1] are clamped.
+  virtual Result ReadColorAttachment(Rgba8Image* image) = 0;
+
   // Execute the buffer command
   virtual Result DoBuffer(const BufferCommand* cmd) = 0;
 
   // Execute the tolerance command
   virtual Result DoTolerance(const ToleranceCommand* cmd) = 0;
 
+  // Returns the statistics of the engine's shader module cache.
+  virtual ShaderModuleCacheStats GetShaderModuleCacheStats() = 0;
+
+  // Returns the statistics of the engine's pipeline cache.
+  virtual PipelineCacheStats GetPipelineCacheStats() = 0;
+
+  // Returns the time spent creating the driver objects of the current
+  // pipeline. Engines may create them at the first draw or dispatch, so this
+  // is zero until the pipeline has been used.
+  virtual double GetPipelineCreationMs() = 0;
+
+  // Returns the statistics of the engine's device memory allocator.
+  virtual DeviceMemoryStats GetDeviceMemoryStats() = 0;
+
  protected:
   Engine();
 };
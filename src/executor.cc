@@ -14,10 +14,90 @@
 
 #include "src/executor.h"
 
+#include <string>
+
+#include "src/content_hash.h"
+#include "src/reference_image.h"
+
 namespace amber {
 
 Executor::Executor() = default;
 
 Executor::~Executor() = default;
 
+Result Executor::ProbeHash(Engine* engine, const ProbeHashCommand* cmd) {
+  uint64_t hash = 0;
+  Result r = engine->DoProbeHash(cmd, &hash);
+  if (!r.IsSuccess())
+    return r;
+
+  ContentHash content_hash;
+  content_hash.target = cmd->GetTargetName();
+  content_hash.algorithm = ContentHashAlgorithmName(cmd->GetAlgorithm());
+  content_hash.hash = hash;
+  content_hash.expected_hash = cmd->GetExpectedHash();
+  content_hashes_.push_back(content_hash);
+
+  if (record_content_hashes_ || hash == cmd->GetExpectedHash())
+    return {};
+
+  const std::string target = content_hash.target.empty()
+                                 ? std::string("color attachment")
+                                 : content_hash.target;
+  return Result("Probe hash failed for " + target + "\n  Expected " +
+                content_hash.algorithm + ": " +
+                ContentHashToString(cmd->GetExpectedHash()) +
+                "\n  Actual " + content_hash.algorithm + ": " +
+                ContentHashToString(hash));
+}
+
+Result Executor::ProbeImage(Engine* engine, const ProbeImageCommand* cmd) {
+  Rgba8Image actual;
+  Result r = engine->ReadColorAttachment(&actual);
+  if (!r.IsSuccess())
+    return r;
+
+  Rgba8Image expected;
+  r = LoadReferenceImage(cmd->GetFilename(), actual.width, actual.height,
+                         &expected);
+  if (!r.IsSuccess())
+    return r;
+
+  const bool write_diff = !cmd->GetDiffFilename().empty();
+  Rgba8Image diff;
+  const ImageErrorStats stats =
+      CompareImages(actual, expected, write_diff ? &diff : nullptr);
+  if (write_diff) {
+    r = WritePpmImage(cmd->GetDiffFilename(), diff);
+    if (!r.IsSuccess())
+      return r;
+  }
+
+  bool passed = true;
+  std::string max_errors;
+  std::string rmses;
+  std::string psnrs;
+  for (uint32_t c = 0; c < expected.channels; ++c) {
+    passed = passed && stats.max_error[c] <= cmd->GetMaxError() &&
+             stats.rmse[c] <= cmd->GetMaxRMSE() &&
+             stats.psnr[c] >= cmd->GetMinPSNR();
+
+    const std::string separator = c == 0 ? "" : ", ";
+    max_errors += separator + std::to_string(stats.max_error[c]);
+    rmses += separator + std::to_string(stats.rmse[c]);
+    psnrs += separator + std::to_string(stats.psnr[c]);
+  }
+  if (passed)
+    return {};
+
+  return Result("Probe image failed for " + cmd->GetFilename() + " in " +
+                std::to_string(stats.differing_texels) + " texels" +
+                "\n  Max error: " + max_errors + " (allowed " +
+                std::to_string(cmd->GetMaxError()) + ")" +
+                "\n  RMSE: " + rmses + " (allowed " +
+                std::to_string(cmd->GetMaxRMSE()) + ")" + "\n  PSNR: " +
+                psnrs + " (required " + std::to_string(cmd->GetMinPSNR()) +
+                ")");
+}
+
 }  // namespace amber
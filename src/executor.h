@@ -15,6 +15,9 @@
 #ifndef SRC_EXECUTOR_H_
 #define SRC_EXECUTOR_H_
 
+#include <string>
+#include <vector>
+
 #include "amber/result.h"
 #include "src/engine.h"
 #include "src/script.h"
@@ -27,8 +30,48 @@ class Executor {
 
   virtual Result Execute(Engine*, const Script*) = 0;
 
+  // When set, shaders are validated on background threads while the engine
+  // creates its shader modules. Execution stops before pipeline creation if
+  // any shader fails validation.
+  void SetAsyncShaderValidation(bool async) {
+    async_shader_validation_ = async;
+  }
+
+  // Directories searched for files named by GLSL #include directives.
+  void SetShaderIncludePaths(const std::vector<std::string>& paths) {
+    shader_include_paths_ = paths;
+  }
+
+  // Statistics for the shaders processed by the last call to Execute().
+  const std::vector<ShaderStats>& GetShaderStats() const {
+    return shader_stats_;
+  }
+
+  // When set, probe hash commands record their hash without checking it.
+  void SetRecordContentHashes(bool record) { record_content_hashes_ = record; }
+
+  // Hashes computed by the probe hash commands of the last call to
+  // Execute().
+  const std::vector<ContentHash>& GetContentHashes() const {
+    return content_hashes_;
+  }
+
  protected:
   Executor();
+
+  // Has |engine| hash what |cmd| names, records the hash and compares it
+  // with the expected hash of |cmd|.
+  Result ProbeHash(Engine* engine, const ProbeHashCommand* cmd);
+
+  // Compares the color attachment of |engine| with the reference image of
+  // |cmd| and writes the diff image it asks for.
+  Result ProbeImage(Engine* engine, const ProbeImageCommand* cmd);
+
+  bool async_shader_validation_ = false;
+  std::vector<std::string> shader_include_paths_;
+  std::vector<ShaderStats> shader_stats_;
+  bool record_content_hashes_ = false;
+  std::vector<ContentHash> content_hashes_;
 };
 
 }  // namespace amber
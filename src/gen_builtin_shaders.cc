@@ -0,0 +1,111 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Build time tool which assembles and validates the built-in shaders from
+// src/shader_data.h and writes them out as constexpr SPIR-V word arrays.
+
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "spirv-tools/libspirv.hpp"
+#include "src/shader_data.h"
+
+namespace {
+
+struct BuiltinShader {
+  const char* name;
+  const char* source;
+};
+
+const BuiltinShader kBuiltinShaders[] = {
+    {"kPassThroughShaderSpirv", amber::kPassThroughShader},
+    {"kProbeVerifyShaderSpirv", amber::kProbeVerifyShader},
+};
+
+bool Assemble(const BuiltinShader& shader, std::vector<uint32_t>* words) {
+  std::string spv_errors;
+  spvtools::SpirvTools tools(SPV_ENV_UNIVERSAL_1_0);
+  tools.SetMessageConsumer([&spv_errors](spv_message_level_t, const char*,
+                                         const spv_position_t& position,
+                                         const char* message) {
+    spv_errors += "line " + std::to_string(position.index) + ": " + message +
+                  "\n";
+  });
+
+  if (!tools.Assemble(shader.source, words,
+                      spvtools::SpirvTools::kDefaultAssembleOption)) {
+    fprintf(stderr, "%s: assembly failed:\n%s", shader.name,
+            spv_errors.c_str());
+    return false;
+  }
+
+  spvtools::ValidatorOptions options;
+  if (!tools.Validate(words->data(), words->size(), options)) {
+    fprintf(stderr, "%s: validation failed:\n%s", shader.name,
+            spv_errors.c_str());
+    return false;
+  }
+  return true;
+}
+
+void WriteShader(FILE* out,
+                 const BuiltinShader& shader,
+                 const std::vector<uint32_t>& words) {
+  fprintf(out, "constexpr uint32_t %s[] = {", shader.name);
+  for (size_t i = 0; i < words.size(); ++i) {
+    fprintf(out, "%s0x%08" PRIx32 ",", i % 6 == 0 ? "\n    " : " ",
+            words[i]);
+  }
+  fprintf(out, "\n};\n\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <output header>\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<std::vector<uint32_t>> assembled;
+  for (const auto& shader : kBuiltinShaders) {
+    std::vector<uint32_t> words;
+    if (!Assemble(shader, &words))
+      return 1;
+    assembled.push_back(words);
+  }
+
+  FILE* out = fopen(argv[1], "w");
+  if (!out) {
+    fprintf(stderr, "Unable to open %s\n", argv[1]);
+    return 1;
+  }
+
+  fprintf(out,
+          "// Generated by gen_builtin_shaders from src/shader_data.h. "
+          "Do not edit.\n\n"
+          "#ifndef SRC_BUILTIN_SHADERS_H_\n"
+          "#define SRC_BUILTIN_SHADERS_H_\n\n"
+          "#include <cstdint>\n\n"
+          "namespace amber {\n\n");
+  for (size_t i = 0; i < assembled.size(); ++i)
+    WriteShader(out, kBuiltinShaders[i], assembled[i]);
+  fprintf(out,
+          "}  // namespace amber\n\n"
+          "#endif  // SRC_BUILTIN_SHADERS_H_\n");
+
+  return fclose(out) == 0 ? 0 : 1;
+}
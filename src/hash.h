@@ -0,0 +1,38 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_HASH_H_
+#define SRC_HASH_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace amber {
+
+const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+// FNV-1a hash of the SPIR-V words.
+inline uint64_t HashWords(const std::vector<uint32_t>& binary) {
+  uint64_t hash = kFnvOffsetBasis;
+  for (uint32_t word : binary) {
+    hash ^= word;
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+}  // namespace amber
+
+#endif  // SRC_HASH_H_
@@ -16,6 +16,7 @@
 #define SRC_PARSER_H_
 
 #include <string>
+#include <vector>
 
 #include "amber/result.h"
 #include "src/script.h"
@@ -29,8 +30,20 @@ class Parser {
   virtual Result Parse(const std::string& data) = 0;
   virtual const Script* GetScript() const = 0;
 
+  // When set, shaders are compiled without being validated. The executor is
+  // then expected to validate them, see Executor::SetAsyncShaderValidation.
+  void SetSkipShaderValidation(bool skip) { skip_shader_validation_ = skip; }
+
+  // Directories searched for files named by GLSL #include directives.
+  void SetShaderIncludePaths(const std::vector<std::string>& paths) {
+    shader_include_paths_ = paths;
+  }
+
  protected:
   Parser();
+
+  bool skip_shader_validation_ = false;
+  std::vector<std::string> shader_include_paths_;
 };
 
 }  // namespace amber
@@ -0,0 +1,307 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "src/reference_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace amber {
+namespace {
+
+// Squared errors of up to 65025 are summed in 32 bits for this many texels
+// at most, before they are added to the 64 bit totals.
+const size_t kChunkTexels = 16384;
+
+struct Totals {
+  uint64_t squared_error[4] = {};
+  uint32_t max_error[4] = {};
+  uint64_t differing_texels = 0;
+};
+
+void CompareChunkScalar(const uint8_t* actual,
+                        const uint8_t* expected,
+                        size_t count,
+                        uint32_t channels,
+                        uint8_t* diff,
+                        Totals* totals) {
+  uint32_t squared_error[4] = {};
+  for (size_t i = 0; i < count; ++i, actual += 4, expected += 4) {
+    bool differs = false;
+    for (uint32_t c = 0; c < 4; ++c) {
+      uint32_t error = 0;
+      if (c < channels) {
+        error = actual[c] > expected[c]
+                    ? static_cast<uint32_t>(actual[c] - expected[c])
+                    : static_cast<uint32_t>(expected[c] - actual[c]);
+      }
+      squared_error[c] += error * error;
+      totals->max_error[c] = std::max(totals->max_error[c], error);
+      differs |= error != 0;
+      if (diff)
+        diff[4 * i + c] = static_cast<uint8_t>(error);
+    }
+    if (differs)
+      ++totals->differing_texels;
+  }
+
+  for (uint32_t c = 0; c < 4; ++c)
+    totals->squared_error[c] += squared_error[c];
+}
+
+#if defined(__SSE2__)
+// Each 32 bit lane of the accumulators holds one channel, as one texel is
+// widened to four lanes at a time.
+void CompareChunk(const uint8_t* actual,
+                  const uint8_t* expected,
+                  size_t count,
+                  uint32_t channels,
+                  uint8_t* diff,
+                  Totals* totals) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mask =
+      _mm_set1_epi32(channels == 4 ? -1 : static_cast<int32_t>(0x00ffffff));
+  __m128i squared_error = zero;
+  __m128i max_error = zero;
+  __m128i equal_texels = zero;
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128i a =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(actual + 4 * i));
+    const __m128i e =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(expected + 4 * i));
+    const __m128i error = _mm_and_si128(
+        _mm_or_si128(_mm_subs_epu8(a, e), _mm_subs_epu8(e, a)), mask);
+    if (diff)
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(diff + 4 * i), error);
+
+    max_error = _mm_max_epu8(max_error, error);
+    equal_texels = _mm_sub_epi32(equal_texels, _mm_cmpeq_epi32(error, zero));
+
+    const __m128i lo = _mm_unpacklo_epi8(error, zero);
+    const __m128i hi = _mm_unpackhi_epi8(error, zero);
+    const __m128i lo_squared = _mm_mullo_epi16(lo, lo);
+    const __m128i hi_squared = _mm_mullo_epi16(hi, hi);
+    squared_error = _mm_add_epi32(
+        squared_error, _mm_add_epi32(_mm_unpacklo_epi16(lo_squared, zero),
+                                     _mm_unpackhi_epi16(lo_squared, zero)));
+    squared_error = _mm_add_epi32(
+        squared_error, _mm_add_epi32(_mm_unpacklo_epi16(hi_squared, zero),
+                                     _mm_unpackhi_epi16(hi_squared, zero)));
+  }
+
+  uint32_t squared[4];
+  uint32_t equal[4];
+  uint8_t max[16];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(squared), squared_error);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(equal), equal_texels);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(max), max_error);
+  totals->differing_texels += i - equal[0] - equal[1] - equal[2] - equal[3];
+  for (uint32_t c = 0; c < 4; ++c) {
+    totals->squared_error[c] += squared[c];
+    totals->max_error[c] = std::max(
+        {totals->max_error[c], static_cast<uint32_t>(max[c]),
+         static_cast<uint32_t>(max[4 + c]), static_cast<uint32_t>(max[8 + c]),
+         static_cast<uint32_t>(max[12 + c])});
+  }
+
+  CompareChunkScalar(actual + 4 * i, expected + 4 * i, count - i, channels,
+                     diff ? diff + 4 * i : nullptr, totals);
+}
+#else
+void CompareChunk(const uint8_t* actual,
+                  const uint8_t* expected,
+                  size_t count,
+                  uint32_t channels,
+                  uint8_t* diff,
+                  Totals* totals) {
+  CompareChunkScalar(actual, expected, count, channels, diff, totals);
+}
+#endif  // defined(__SSE2__)
+
+bool IsPpmSpace(uint8_t ch) {
+  return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\v' ||
+         ch == '\f';
+}
+
+Result ParsePpm(const std::string& path,
+                const std::vector<uint8_t>& data,
+                uint32_t width,
+                uint32_t height,
+                Rgba8Image* image) {
+  // Width, height and maximum value, each after spaces and comments.
+  uint32_t values[3];
+  size_t pos = 2;
+  for (uint32_t& value : values) {
+    while (pos < data.size()) {
+      if (IsPpmSpace(data[pos])) {
+        ++pos;
+      } else if (data[pos] == '#') {
+        while (pos < data.size() && data[pos] != '\n')
+          ++pos;
+      } else {
+        break;
+      }
+    }
+    if (pos == data.size() || data[pos] < '0' || data[pos] > '9')
+      return Result("Invalid PPM header in reference image " + path);
+
+    value = 0;
+    for (; pos < data.size() && data[pos] >= '0' && data[pos] <= '9'; ++pos) {
+      value = value * 10 + static_cast<uint32_t>(data[pos] - '0');
+      if (value > 65535)
+        return Result("Invalid PPM header in reference image " + path);
+    }
+  }
+  // A single space ends the header.
+  if (pos == data.size() || !IsPpmSpace(data[pos]))
+    return Result("Invalid PPM header in reference image " + path);
+  ++pos;
+
+  if (values[2] != 255) {
+    return Result("Reference image " + path +
+                  " must have a maximum value of 255");
+  }
+  if (values[0] != width || values[1] != height) {
+    return Result("Reference image " + path + " is " +
+                  std::to_string(values[0]) + "x" + std::to_string(values[1]) +
+                  " but the color attachment is " + std::to_string(width) +
+                  "x" + std::to_string(height));
+  }
+
+  const size_t count = static_cast<size_t>(width) * height;
+  if (data.size() - pos < 3 * count)
+    return Result("Reference image " + path + " is truncated");
+
+  image->width = width;
+  image->height = height;
+  image->channels = 3;
+  image->texels.resize(4 * count);
+  const uint8_t* src = data.data() + pos;
+  uint8_t* dst = image->texels.data();
+  for (size_t i = 0; i < count; ++i, src += 3, dst += 4) {
+    dst[0] = src[0];
+    dst[1] = src[1];
+    dst[2] = src[2];
+    dst[3] = 255;
+  }
+  return {};
+}
+
+}  // namespace
+
+Result LoadReferenceImage(const std::string& path,
+                          uint32_t width,
+                          uint32_t height,
+                          Rgba8Image* image) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file)
+    return Result("Unable to open reference image " + path);
+
+  std::vector<uint8_t> data;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (size > 0) {
+    data.resize(static_cast<size_t>(size));
+    if (fread(data.data(), 1, data.size(), file) != data.size())
+      data.clear();
+  }
+  fclose(file);
+
+  if (data.size() >= 2 && data[0] == 'P' && data[1] == '6')
+    return ParsePpm(path, data, width, height, image);
+
+  const size_t expected_size = static_cast<size_t>(width) * height * 4;
+  if (data.size() != expected_size) {
+    return Result("Raw reference image " + path + " has " +
+                  std::to_string(data.size()) + " bytes but the color " +
+                  "attachment needs " + std::to_string(expected_size));
+  }
+
+  image->width = width;
+  image->height = height;
+  image->channels = 4;
+  image->texels = std::move(data);
+  return {};
+}
+
+Result WritePpmImage(const std::string& path, const Rgba8Image& image) {
+  const size_t count = static_cast<size_t>(image.width) * image.height;
+  std::vector<uint8_t> rgb(3 * count);
+  for (size_t i = 0; i < count; ++i) {
+    rgb[3 * i] = image.texels[4 * i];
+    rgb[3 * i + 1] = image.texels[4 * i + 1];
+    rgb[3 * i + 2] = image.texels[4 * i + 2];
+  }
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file)
+    return Result("Unable to write image " + path);
+
+  const std::string header = "P6\n" + std::to_string(image.width) + " " +
+                             std::to_string(image.height) + "\n255\n";
+  bool written =
+      fwrite(header.data(), 1, header.size(), file) == header.size() &&
+      fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+  written = fclose(file) == 0 && written;
+  if (!written)
+    return Result("Unable to write image " + path);
+
+  return {};
+}
+
+ImageErrorStats CompareImages(const Rgba8Image& actual,
+                              const Rgba8Image& expected,
+                              Rgba8Image* diff) {
+  const size_t count = static_cast<size_t>(actual.width) * actual.height;
+  if (diff) {
+    diff->width = actual.width;
+    diff->height = actual.height;
+    diff->channels = expected.channels;
+    diff->texels.resize(4 * count);
+  }
+
+  Totals totals;
+  for (size_t start = 0; start < count; start += kChunkTexels) {
+    CompareChunk(actual.texels.data() + 4 * start,
+                 expected.texels.data() + 4 * start,
+                 std::min(kChunkTexels, count - start), expected.channels,
+                 diff ? diff->texels.data() + 4 * start : nullptr, &totals);
+  }
+
+  ImageErrorStats stats;
+  stats.differing_texels = totals.differing_texels;
+  for (uint32_t c = 0; c < 4; ++c) {
+    stats.max_error[c] = totals.max_error[c];
+    stats.rmse[c] =
+        count == 0 ? 0.0
+                   : std::sqrt(static_cast<double>(totals.squared_error[c]) /
+                               static_cast<double>(count));
+    stats.psnr[c] = stats.rmse[c] == 0.0
+                        ? std::numeric_limits<double>::infinity()
+                        : 20.0 * std::log10(255.0 / stats.rmse[c]);
+  }
+  return stats;
+}
+
+}  // namespace amber
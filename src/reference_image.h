@@ -0,0 +1,71 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef SRC_REFERENCE_IMAGE_H_
+#define SRC_REFERENCE_IMAGE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "amber/result.h"
+
+namespace amber {
+
+// An image of 8 bit RGBA texels, tightly packed with the top row first.
+struct Rgba8Image {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  // The channels the image has values for, 3 when it has no alpha. The
+  // alpha bytes of such images are ignored.
+  uint32_t channels = 4;
+  std::vector<uint8_t> texels;
+};
+
+// The differences between two images for red, green, blue and alpha, in
+// 8 bit steps.
+struct ImageErrorStats {
+  uint32_t max_error[4] = {};
+  double rmse[4] = {};
+  // Peak signal to noise ratio in dB, infinite for equal channels.
+  double psnr[4] = {};
+  // Texels which differ in any compared channel.
+  uint64_t differing_texels = 0;
+};
+
+// Loads a reference image for a |width| x |height| color attachment from
+// |path|. Files starting with "P6" are binary PPM images with a maximum value
+// of 255, which must have the size of the attachment. Other files are read as
+// raw RGBA texels and must hold exactly one texel for each pixel.
+Result LoadReferenceImage(const std::string& path,
+                          uint32_t width,
+                          uint32_t height,
+                          Rgba8Image* image);
+
+// Writes the red, green and blue channels of |image| to |path| as a binary
+// PPM image.
+Result WritePpmImage(const std::string& path, const Rgba8Image& image);
+
+// Compares |actual| with |expected|, which must have the same size, in the
+// channels of |expected|. When |diff| is not null it receives the absolute
+// difference of each channel. The images are compared 4 texels at a time with
+// SSE2, in one pass.
+ImageErrorStats CompareImages(const Rgba8Image& actual,
+                              const Rgba8Image& expected,
+                              Rgba8Image* diff);
+
+}  // namespace amber
+
+#endif  // SRC_REFERENCE_IMAGE_H_
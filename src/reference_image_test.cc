@@ -0,0 +1,242 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "src/reference_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace amber {
+namespace {
+
+Rgba8Image MakeImage(uint32_t width, uint32_t height, uint8_t seed) {
+  Rgba8Image image;
+  image.width = width;
+  image.height = height;
+  image.texels.resize(4 * width * height);
+  for (size_t i = 0; i < image.texels.size(); ++i)
+    image.texels[i] = static_cast<uint8_t>(i * 13 + seed);
+  return image;
+}
+
+void WriteFile(const std::string& path, const std::string& data) {
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(file != nullptr);
+  fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+}
+
+// Returns a path in the temp directory that is unique to this run, so
+// concurrent test runs sharing the directory do not see each other's files.
+std::string UniqueTempPath(const std::string& name,
+                           const std::string& extension) {
+  return testing::TempDir() + name + "_" +
+         std::to_string(
+             std::chrono::steady_clock::now().time_since_epoch().count()) +
+         extension;
+}
+
+// Removes the file at |path| when it goes out of scope, so a failed
+// assertion does not leave it in the temp directory.
+class ScopedFileRemover {
+ public:
+  explicit ScopedFileRemover(const std::string& path) : path_(path) {}
+  ~ScopedFileRemover() { remove(path_.c_str()); }
+
+ private:
+  std::string path_;
+};
+
+}  // namespace
+
+using ReferenceImageTest = testing::Test;
+
+TEST_F(ReferenceImageTest, EqualImages) {
+  Rgba8Image image = MakeImage(7, 5, 0);
+  ImageErrorStats stats = CompareImages(image, image, nullptr);
+  EXPECT_EQ(0U, stats.differing_texels);
+  for (uint32_t c = 0; c < 4; ++c) {
+    EXPECT_EQ(0U, stats.max_error[c]);
+    EXPECT_EQ(0.0, stats.rmse[c]);
+    EXPECT_TRUE(std::isinf(stats.psnr[c]));
+  }
+}
+
+TEST_F(ReferenceImageTest, Metrics) {
+  // 7 texels, so the last one is compared outside of the 4 texel blocks.
+  Rgba8Image expected = MakeImage(7, 1, 0);
+  Rgba8Image actual = expected;
+  actual.texels[0] = static_cast<uint8_t>(actual.texels[0] + 10);
+  actual.texels[4 * 3 + 1] = static_cast<uint8_t>(actual.texels[4 * 3 + 1] - 3);
+  actual.texels[4 * 6 + 1] = static_cast<uint8_t>(actual.texels[4 * 6 + 1] + 4);
+  actual.texels[4 * 6 + 3] = static_cast<uint8_t>(actual.texels[4 * 6 + 3] - 1);
+
+  Rgba8Image diff;
+  ImageErrorStats stats = CompareImages(actual, expected, &diff);
+  EXPECT_EQ(3U, stats.differing_texels);
+  EXPECT_EQ(10U, stats.max_error[0]);
+  EXPECT_EQ(4U, stats.max_error[1]);
+  EXPECT_EQ(0U, stats.max_error[2]);
+  EXPECT_EQ(1U, stats.max_error[3]);
+  EXPECT_DOUBLE_EQ(std::sqrt(100.0 / 7.0), stats.rmse[0]);
+  EXPECT_DOUBLE_EQ(std::sqrt(25.0 / 7.0), stats.rmse[1]);
+  EXPECT_DOUBLE_EQ(std::sqrt(1.0 / 7.0), stats.rmse[3]);
+  EXPECT_DOUBLE_EQ(20.0 * std::log10(255.0 / std::sqrt(100.0 / 7.0)),
+                   stats.psnr[0]);
+
+  ASSERT_EQ(7U, diff.width);
+  ASSERT_EQ(1U, diff.height);
+  ASSERT_EQ(actual.texels.size(), diff.texels.size());
+  EXPECT_EQ(10U, diff.texels[0]);
+  EXPECT_EQ(3U, diff.texels[4 * 3 + 1]);
+  EXPECT_EQ(4U, diff.texels[4 * 6 + 1]);
+  EXPECT_EQ(1U, diff.texels[4 * 6 + 3]);
+  EXPECT_EQ(0U, diff.texels[4 * 6 + 2]);
+}
+
+TEST_F(ReferenceImageTest, LargeImageMatchesPerTexelSums) {
+  // More texels than are summed in 32 bits at once.
+  Rgba8Image expected = MakeImage(301, 199, 0);
+  Rgba8Image actual = MakeImage(301, 199, 91);
+
+  uint64_t squared_error[4] = {};
+  uint32_t max_error[4] = {};
+  for (size_t i = 0; i < actual.texels.size(); ++i) {
+    const int error = std::abs(actual.texels[i] - expected.texels[i]);
+    squared_error[i % 4] += static_cast<uint64_t>(error * error);
+    max_error[i % 4] = std::max(max_error[i % 4], static_cast<uint32_t>(error));
+  }
+
+  ImageErrorStats stats = CompareImages(actual, expected, nullptr);
+  EXPECT_EQ(301U * 199U, stats.differing_texels);
+  for (uint32_t c = 0; c < 4; ++c) {
+    EXPECT_EQ(max_error[c], stats.max_error[c]);
+    EXPECT_DOUBLE_EQ(std::sqrt(squared_error[c] / (301.0 * 199.0)),
+                     stats.rmse[c]);
+  }
+}
+
+TEST_F(ReferenceImageTest, AlphaIgnoredWithoutAlpha) {
+  Rgba8Image expected = MakeImage(5, 1, 0);
+  expected.channels = 3;
+  Rgba8Image actual = expected;
+  actual.texels[3] = static_cast<uint8_t>(actual.texels[3] + 50);
+  actual.texels[4 * 4 + 3] = static_cast<uint8_t>(actual.texels[4 * 4 + 3] + 1);
+
+  ImageErrorStats stats = CompareImages(actual, expected, nullptr);
+  EXPECT_EQ(0U, stats.differing_texels);
+  EXPECT_EQ(0U, stats.max_error[3]);
+}
+
+TEST_F(ReferenceImageTest, PpmRoundTrip) {
+  const std::string path = UniqueTempPath("amber_reference_image", ".ppm");
+  ScopedFileRemover remover(path);
+  Rgba8Image image = MakeImage(3, 2, 5);
+  Result r = WritePpmImage(path, image);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  Rgba8Image loaded;
+  r = LoadReferenceImage(path, 3, 2, &loaded);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(3U, loaded.width);
+  EXPECT_EQ(2U, loaded.height);
+  EXPECT_EQ(3U, loaded.channels);
+  ASSERT_EQ(image.texels.size(), loaded.texels.size());
+  for (size_t i = 0; i < image.texels.size(); ++i) {
+    if (i % 4 == 3)
+      EXPECT_EQ(255U, loaded.texels[i]);
+    else
+      EXPECT_EQ(image.texels[i], loaded.texels[i]) << i;
+  }
+
+  r = LoadReferenceImage(path, 2, 3, &loaded);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Reference image " + path +
+                " is 3x2 but the color attachment is 2x3",
+            r.Error());
+}
+
+TEST_F(ReferenceImageTest, PpmHeaderWithComments) {
+  const std::string path = UniqueTempPath("amber_reference_image", ".ppm");
+  ScopedFileRemover remover(path);
+  WriteFile(path, std::string("P6 # a comment\n1\n# another\n1 255\n") +
+                      std::string("\x01\x02\x03", 3));
+
+  Rgba8Image image;
+  Result r = LoadReferenceImage(path, 1, 1, &image);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  ASSERT_EQ(4U, image.texels.size());
+  EXPECT_EQ(1U, image.texels[0]);
+  EXPECT_EQ(2U, image.texels[1]);
+  EXPECT_EQ(3U, image.texels[2]);
+}
+
+TEST_F(ReferenceImageTest, PpmErrors) {
+  const std::string path = UniqueTempPath("amber_reference_image", ".ppm");
+  ScopedFileRemover remover(path);
+  Rgba8Image image;
+
+  WriteFile(path, "P6\n1 1\n65535\n");
+  Result r = LoadReferenceImage(path, 1, 1, &image);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Reference image " + path + " must have a maximum value of 255",
+            r.Error());
+
+  WriteFile(path, "P6\n1 x\n255\n");
+  r = LoadReferenceImage(path, 1, 1, &image);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Invalid PPM header in reference image " + path, r.Error());
+
+  WriteFile(path, "P6\n2 1\n255\nabc");
+  r = LoadReferenceImage(path, 2, 1, &image);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Reference image " + path + " is truncated", r.Error());
+}
+
+TEST_F(ReferenceImageTest, RawImage) {
+  const std::string path = UniqueTempPath("amber_reference_image", ".raw");
+  ScopedFileRemover remover(path);
+  WriteFile(path, "abcdefgh");
+
+  Rgba8Image image;
+  Result r = LoadReferenceImage(path, 2, 1, &image);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(4U, image.channels);
+  EXPECT_EQ(std::vector<uint8_t>({'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h'}),
+            image.texels);
+
+  r = LoadReferenceImage(path, 1, 1, &image);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Raw reference image " + path +
+                " has 8 bytes but the color attachment needs 4",
+            r.Error());
+}
+
+TEST_F(ReferenceImageTest, MissingFile) {
+  Rgba8Image image;
+  Result r = LoadReferenceImage("/nonexistent/amber.ppm", 1, 1, &image);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Unable to open reference image /nonexistent/amber.ppm",
+            r.Error());
+}
+
+}  // namespace amber
@@ -15,11 +15,25 @@
 #include "src/shader_compiler.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
 
 #include "spirv-tools/libspirv.hpp"
 #include "spirv-tools/linker.hpp"
+#include "spirv-tools/optimizer.hpp"
+#include "src/builtin_shaders.h"
+#include "src/hash.h"
+#include "src/make_unique.h"
+#include "src/shader_library.h"
+#include "src/timer.h"
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wold-style-cast"
@@ -28,89 +42,582 @@
 #include "third_party/shaderc/libshaderc/include/shaderc/shaderc.hpp"
 #pragma clang diagnostic pop
 
-namespace amber {
-
-ShaderCompiler::ShaderCompiler() = default;
+#include <sys/stat.h>
 
-ShaderCompiler::~ShaderCompiler() = default;
+namespace amber {
+namespace {
 
-std::pair<Result, std::vector<uint32_t>> ShaderCompiler::Compile(
-    ShaderType type,
-    ShaderFormat fmt,
-    const std::string& data) const {
-  std::string spv_errors;
-  // TODO(dsinclair): Vulkan env should be an option.
-  spvtools::SpirvTools tools(SPV_ENV_UNIVERSAL_1_0);
-  tools.SetMessageConsumer([&spv_errors](spv_message_level_t level, const char*,
-                                         const spv_position_t& position,
-                                         const char* message) {
+spvtools::MessageConsumer ErrorConsumer(std::string* spv_errors) {
+  return [spv_errors](spv_message_level_t level, const char*,
+                      const spv_position_t& position, const char* message) {
     switch (level) {
       case SPV_MSG_FATAL:
       case SPV_MSG_INTERNAL_ERROR:
       case SPV_MSG_ERROR:
-        spv_errors += "error: line " + std::to_string(position.index) + ": " +
-                      message + "\n";
+        *spv_errors += "error: line " + std::to_string(position.index) +
+                       ": " + message + "\n";
         break;
       case SPV_MSG_WARNING:
-        spv_errors += "warning: line " + std::to_string(position.index) + ": " +
-                      message + "\n";
+        *spv_errors += "warning: line " + std::to_string(position.index) +
+                       ": " + message + "\n";
         break;
       case SPV_MSG_INFO:
-        spv_errors += "info: line " + std::to_string(position.index) + ": " +
-                      message + "\n";
+        *spv_errors += "info: line " + std::to_string(position.index) +
+                       ": " + message + "\n";
         break;
       case SPV_MSG_DEBUG:
         break;
     }
-  });
+  };
+}
+
+bool IsHexSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' ||
+         c == '\v';
+}
+
+// Maps a character to the value of the hex digit it represents.
+class HexTable {
+ public:
+  static const uint8_t kNotHex = 0xff;
+
+  HexTable() {
+    memset(values_, kNotHex, sizeof(values_));
+    for (uint8_t i = 0; i < 10; ++i)
+      values_['0' + i] = i;
+    for (uint8_t i = 0; i < 6; ++i) {
+      values_['a' + i] = static_cast<uint8_t>(10 + i);
+      values_['A' + i] = static_cast<uint8_t>(10 + i);
+    }
+  }
+
+  uint8_t Get(char c) const { return values_[static_cast<uint8_t>(c)]; }
+
+ private:
+  uint8_t values_[256];
+};
+
+const HexTable& GetHexTable() {
+  static const HexTable* table = new HexTable();
+  return *table;
+}
+
+const uint32_t kSpirvMagicNumberSwapped = 0x03022307;
+
+// Returns the modification time of |st| in nanoseconds, where the platform
+// records it with that precision.
+int64_t ModificationTimeNs(const struct stat& st) {
+  const int64_t kNsPerSecond = 1000000000;
+#if defined(__APPLE__)
+  return static_cast<int64_t>(st.st_mtimespec.tv_sec) * kNsPerSecond +
+         st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+  return static_cast<int64_t>(st.st_mtime) * kNsPerSecond;
+#else
+  return static_cast<int64_t>(st.st_mtim.tv_sec) * kNsPerSecond +
+         st.st_mtim.tv_nsec;
+#endif
+}
+
+// Contents of the files pulled in by #include, shared by every compile in
+// the process. An entry is reloaded when the nanosecond modification time or
+// the size of its file changes, so rewriting a header within the same second
+// is still picked up.
+class IncludeCache {
+ public:
+  // Returns the contents of |path|, or nullptr if it can not be read.
+  std::shared_ptr<const std::string> Get(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG)
+      return nullptr;
+
+    const int64_t mtime_ns = ModificationTimeNs(st);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = files_.find(path);
+    if (it != files_.end() && it->second.mtime_ns == mtime_ns &&
+        it->second.size == st.st_size) {
+      return it->second.contents;
+    }
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+      return nullptr;
+
+    std::string contents(static_cast<size_t>(st.st_size), '\0');
+    size_t read = fread(&contents[0], 1, contents.size(), file);
+    fclose(file);
+    if (read != contents.size())
+      return nullptr;
+
+    Entry& entry = files_[path];
+    entry.mtime_ns = mtime_ns;
+    entry.size = st.st_size;
+    entry.contents = std::make_shared<const std::string>(std::move(contents));
+    return entry.contents;
+  }
+
+ private:
+  struct Entry {
+    int64_t mtime_ns = 0;
+    off_t size = 0;
+    std::shared_ptr<const std::string> contents;
+  };
+
+  std::mutex mutex_;
+  std::map<std::string, Entry> files_;
+};
+
+IncludeCache& GetIncludeCache() {
+  static IncludeCache* cache = new IncludeCache();
+  return *cache;
+}
+
+// Resolves #include directives against the directory of the including file
+// and then the configured search paths.
+class Includer : public shaderc::CompileOptions::IncluderInterface {
+ public:
+  explicit Includer(const std::vector<std::string>& search_paths)
+      : search_paths_(search_paths) {}
+  ~Includer() override = default;
+
+  shaderc_include_result* GetInclude(const char* requested_source,
+                                     shaderc_include_type type,
+                                     const char* requesting_source,
+                                     size_t) override {
+    std::unique_ptr<Include> include = MakeUnique<Include>();
+
+    const std::string requested = requested_source;
+    std::vector<std::string> candidates;
+    if (!requested.empty() && requested[0] == '/') {
+      candidates.push_back(requested);
+    } else {
+      if (type == shaderc_include_type_relative) {
+        std::string requesting = requesting_source;
+        size_t slash = requesting.find_last_of("/\\");
+        if (slash != std::string::npos)
+          candidates.push_back(requesting.substr(0, slash + 1) + requested);
+      }
+      for (const auto& path : search_paths_) {
+        if (path.empty())
+          continue;
+
+        char last = path.back();
+        candidates.push_back(last == '/' || last == '\\'
+                                 ? path + requested
+                                 : path + "/" + requested);
+      }
+      // Fall back to the working directory if there is nowhere else to look.
+      if (candidates.empty())
+        candidates.push_back(requested);
+    }
+
+    for (const auto& path : candidates) {
+      include->contents = GetIncludeCache().Get(path);
+      if (include->contents) {
+        include->name = path;
+        break;
+      }
+    }
+
+    if (include->contents) {
+      include->result.content = include->contents->data();
+      include->result.content_length = include->contents->size();
+    } else {
+      // An empty source name tells shaderc the include failed, with the
+      // content holding the error message.
+      include->error =
+          std::string("Unable to find include file: ") + requested_source;
+      include->result.content = include->error.data();
+      include->result.content_length = include->error.size();
+    }
+    include->result.source_name = include->name.data();
+    include->result.source_name_length = include->name.size();
+    include->result.user_data = include.get();
+    return &(include.release()->result);
+  }
+
+  void ReleaseInclude(shaderc_include_result* data) override {
+    delete static_cast<Include*>(data->user_data);
+  }
+
+ private:
+  struct Include {
+    shaderc_include_result result = {};
+    std::string name;
+    std::string error;
+    std::shared_ptr<const std::string> contents;
+  };
+
+  std::vector<std::string> search_paths_;
+};
+
+// Validation results keyed by the FNV-1a hash of the SPIR-V words combined
+// with the word count. Shared by every ShaderCompiler in the process.
+class ValidationCache {
+ public:
+  using Key = std::pair<uint64_t, size_t>;
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      return static_cast<size_t>(key.first ^ key.second);
+    }
+  };
+
+  static Key KeyFor(const std::vector<uint32_t>& binary) {
+    return {HashWords(binary), binary.size()};
+  }
+
+  // Modules with the same key are told apart by their words, so a hash
+  // collision is a miss rather than the result of another module.
+  bool Find(const std::vector<uint32_t>& binary, Result* result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = results_.find(KeyFor(binary));
+    if (it == results_.end())
+      return false;
+
+    for (const auto& module : it->second) {
+      if (module.binary == binary) {
+        *result = module.result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Insert(const std::vector<uint32_t>& binary, const Result& result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    results_[KeyFor(binary)].push_back({binary, result});
+  }
+
+ private:
+  struct Module {
+    std::vector<uint32_t> binary;
+    Result result;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<Key, std::vector<Module>, KeyHash> results_;
+};
+
+// Optimized modules, keyed like the validation results by the module they
+// were optimized from. Modules with the same key are told apart by their
+// words and the space separated list of passes.
+class OptimizationCache {
+ public:
+  bool Find(const std::vector<uint32_t>& binary,
+            const std::string& passes,
+            std::vector<uint32_t>* result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = modules_.find(ValidationCache::KeyFor(binary));
+    if (it == modules_.end())
+      return false;
+
+    for (const auto& module : it->second) {
+      if (module.passes == passes && module.input == binary) {
+        *result = module.output;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Insert(const std::vector<uint32_t>& binary,
+              const std::string& passes,
+              const std::vector<uint32_t>& result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    modules_[ValidationCache::KeyFor(binary)].push_back(
+        {binary, passes, result});
+  }
+
+ private:
+  struct Module {
+    std::vector<uint32_t> input;
+    std::string passes;
+    std::vector<uint32_t> output;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<ValidationCache::Key,
+                     std::vector<Module>,
+                     ValidationCache::KeyHash>
+      modules_;
+};
+
+ValidationCache& GetValidationCache() {
+  static ValidationCache* cache = new ValidationCache();
+  return *cache;
+}
+
+OptimizationCache& GetOptimizationCache() {
+  static OptimizationCache* cache = new OptimizationCache();
+  return *cache;
+}
+
+// Built-in shaders which were assembled and validated at build time.
+struct BuiltinShader {
+  const char* source;
+  size_t source_size;
+  const uint32_t* words;
+  size_t word_count;
+};
+
+const BuiltinShader kBuiltinShaders[] = {
+    {kPassThroughShader, sizeof(kPassThroughShader) - 1,
+     kPassThroughShaderSpirv,
+     sizeof(kPassThroughShaderSpirv) / sizeof(kPassThroughShaderSpirv[0])},
+};
+
+const BuiltinShader* FindBuiltinShader(const std::string& data) {
+  for (const auto& shader : kBuiltinShaders) {
+    if (data.size() == shader.source_size &&
+        data.compare(0, data.size(), shader.source, shader.source_size) == 0) {
+      return &shader;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+ShaderCompiler::ShaderCompiler() = default;
+
+ShaderCompiler::~ShaderCompiler() = default;
+
+std::pair<Result, std::vector<uint32_t>> ShaderCompiler::Compile(
+    ShaderType type,
+    ShaderFormat fmt,
+    const std::string& data) const {
+  if (!defines_.empty() && fmt != ShaderFormat::kGlsl)
+    return {Result("Shader defines are only supported for GLSL"), {}};
+
+  stats_ = ShaderStats();
+  stats_.source_size = data.size();
+  reflection_ = ShaderReflection();
+
+  if (fmt == ShaderFormat::kSpirvAsm) {
+    const BuiltinShader* builtin = FindBuiltinShader(data);
+    if (builtin) {
+      stats_.spirv_words = builtin->word_count;
+      std::vector<uint32_t> words(builtin->words,
+                                  builtin->words + builtin->word_count);
+      reflection_ = ShaderLibrary::Reflect(words);
+      return {{}, words};
+    }
+  }
+
+  // Binary files can change on disk and the files pulled in by #include are
+  // not part of the key, so those shaders do not go through the library.
+  const bool use_library =
+      fmt != ShaderFormat::kSpirvBin &&
+      (fmt != ShaderFormat::kGlsl ||
+       data.find("#include") == std::string::npos);
+  ShaderLibrary::Key key;
+  if (use_library) {
+    key = ShaderLibrary::MakeKey(type, fmt, data, defines_);
+    auto shader = ShaderLibrary::Get().Find(key);
+    if (shader) {
+      stats_.spirv_words = shader->spirv.size();
+      if (!skip_validation_) {
+        Result r = Validate(shader->spirv);
+        if (!r.IsSuccess())
+          return {r, {}};
+      }
+      reflection_ = shader->reflection;
+      return {{}, shader->spirv};
+    }
+  }
+
+  std::string spv_errors;
+  // TODO(dsinclair): Vulkan env should be an option.
+  spvtools::SpirvTools tools(SPV_ENV_UNIVERSAL_1_0);
+  tools.SetMessageConsumer(ErrorConsumer(&spv_errors));
 
+  auto start = std::chrono::steady_clock::now();
   std::vector<uint32_t> results;
   if (fmt == ShaderFormat::kGlsl) {
     Result r = CompileGlsl(type, data, &results);
     if (!r.IsSuccess())
       return {r, {}};
+
+    stats_.compile_ms = MillisecondsSince(start);
   } else if (fmt == ShaderFormat::kSpirvAsm) {
     if (!tools.Assemble(data, &results,
                         spvtools::SpirvTools::kDefaultAssembleOption)) {
       return {Result("Shader assembly failed: " + spv_errors), {}};
     }
+    stats_.assemble_ms = MillisecondsSince(start);
   } else if (fmt == ShaderFormat::kSpirvHex) {
     Result r = ParseHex(data, &results);
     if (!r.IsSuccess())
-      return {Result("Unable to parse shader hex."), {}};
+      return {Result("Unable to parse shader hex: " + r.Error()), {}};
+
+    stats_.assemble_ms = MillisecondsSince(start);
+  } else if (fmt == ShaderFormat::kSpirvBin) {
+    Result r = LoadSpirvBinary(data, &results);
+    if (!r.IsSuccess())
+      return {r, {}};
+
+    // |data| is the file name, so report the size of the file instead.
+    stats_.source_size = results.size() * sizeof(uint32_t);
+    stats_.assemble_ms = MillisecondsSince(start);
   } else {
     return {Result("Invalid shader format"), results};
   }
+  stats_.spirv_words = results.size();
+
+  if (!skip_validation_) {
+    Result r = Validate(results);
+    if (!r.IsSuccess())
+      return {r, {}};
+  }
+
+  if (use_library)
+    reflection_ = ShaderLibrary::Get().Insert(key, results)->reflection;
+  else
+    reflection_ = ShaderLibrary::Reflect(results);
+
+  return {{}, results};
+}
+
+Result ShaderCompiler::Validate(const std::vector<uint32_t>& binary) const {
+  ValidationCache& cache = GetValidationCache();
+
+  auto start = std::chrono::steady_clock::now();
+  Result r;
+  if (cache.Find(binary, &r)) {
+    stats_.validate_ms = MillisecondsSince(start);
+    return r;
+  }
+
+  std::string spv_errors;
+  // TODO(dsinclair): Vulkan env should be an option.
+  spvtools::SpirvTools tools(SPV_ENV_UNIVERSAL_1_0);
+  tools.SetMessageConsumer(ErrorConsumer(&spv_errors));
 
   spvtools::ValidatorOptions options;
-  if (!tools.Validate(results.data(), results.size(), options))
-    return {Result("Invalid shader: " + spv_errors), {}};
+  if (!tools.Validate(binary.data(), binary.size(), options))
+    r = Result("Invalid shader: " + spv_errors);
+
+  cache.Insert(binary, r);
+  stats_.validate_ms = MillisecondsSince(start);
+  return r;
+}
+
+std::pair<Result, std::vector<uint32_t>> ShaderCompiler::Optimize(
+    const std::vector<uint32_t>& binary,
+    const std::vector<std::string>& passes) const {
+  stats_.optimized_spirv_words = binary.size();
+  if (passes.empty())
+    return {{}, binary};
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::string> flags;
+  std::string pass_list;
+  for (const auto& pass : passes) {
+    flags.push_back(pass.substr(0, 2) == "--" ? pass : "--" + pass);
+    pass_list += flags.back() + " ";
+  }
+
+  OptimizationCache& cache = GetOptimizationCache();
+  std::vector<uint32_t> results;
+  if (!cache.Find(binary, pass_list, &results)) {
+    std::string spv_errors;
+    // TODO(dsinclair): Vulkan env should be an option.
+    spvtools::Optimizer optimizer(SPV_ENV_UNIVERSAL_1_0);
+    optimizer.SetMessageConsumer(ErrorConsumer(&spv_errors));
+    if (!optimizer.RegisterPassesFromFlags(flags))
+      return {Result("Invalid optimizations: " + spv_errors), {}};
+    if (!optimizer.Run(binary.data(), binary.size(), &results))
+      return {Result("Optimizations failed: " + spv_errors), {}};
 
+    cache.Insert(binary, pass_list, results);
+  }
+
+  stats_.optimize_ms = MillisecondsSince(start);
+  stats_.optimized_spirv_words = results.size();
   return {{}, results};
 }
 
 Result ShaderCompiler::ParseHex(const std::string& data,
                                 std::vector<uint32_t>* result) const {
-  size_t used = 0;
-  const char* str = data.c_str();
-  uint8_t converted = 0;
-  uint32_t tmp = 0;
-  while (used < data.length()) {
-    char* new_pos = nullptr;
-    long v = std::strtol(str, &new_pos, 16);
+  const HexTable& table = GetHexTable();
+  const char* pos = data.data();
+  const char* end = pos + data.size();
 
-    ++converted;
+  // Each byte takes at least 3 characters, "NN ".
+  result->reserve(data.size() / 12);
 
-    // TODO(dsinclair): Is this actually right?
-    tmp = tmp | (static_cast<uint32_t>(v) << (8 * (converted - 1)));
-    if (converted == 4) {
-      result->push_back(tmp);
-      tmp = 0;
-      converted = 0;
+  uint32_t word = 0;
+  uint32_t shift = 0;
+  while (pos < end) {
+    if (IsHexSpace(*pos)) {
+      ++pos;
+      continue;
     }
 
-    used += static_cast<size_t>(new_pos - str);
-    str = new_pos;
+    if (end - pos > 2 && pos[0] == '0' && (pos[1] == 'x' || pos[1] == 'X'))
+      pos += 2;
+
+    uint32_t value = table.Get(*pos);
+    if (value == HexTable::kNotHex)
+      return Result("invalid hex byte at offset " +
+                    std::to_string(pos - data.data()));
+    ++pos;
+
+    if (pos < end && table.Get(*pos) != HexTable::kNotHex) {
+      value = (value << 4) | table.Get(*pos);
+      ++pos;
+    }
+    if (pos < end && !IsHexSpace(*pos))
+      return Result("invalid hex byte at offset " +
+                    std::to_string(pos - data.data()));
+
+    // The bytes are in SPIR-V file order, which is little endian, so the
+    // first byte of each group of four is the least significant.
+    word |= value << shift;
+    shift += 8;
+    if (shift == 32) {
+      result->push_back(word);
+      word = 0;
+      shift = 0;
+    }
+  }
+
+  if (shift != 0)
+    return Result("hex data is not a whole number of words");
+
+  return {};
+}
+
+Result ShaderCompiler::LoadSpirvBinary(const std::string& filename,
+                                       std::vector<uint32_t>* result) const {
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (!file)
+    return Result("Unable to open SPIR-V binary: " + filename);
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (size <= 0 || size % static_cast<long>(sizeof(uint32_t)) != 0) {
+    fclose(file);
+    return Result("SPIR-V binary " + filename +
+                  " is not a whole number of words");
+  }
+
+  // Read straight into the result so the words are only copied once.
+  result->resize(static_cast<size_t>(size) / sizeof(uint32_t));
+  size_t read = fread(result->data(), sizeof(uint32_t), result->size(), file);
+  fclose(file);
+  if (read != result->size())
+    return Result("Unable to read SPIR-V binary: " + filename);
+
+  // SPIR-V may be stored in either byte order; the magic number tells us
+  // which one was used.
+  if ((*result)[0] == kSpirvMagicNumberSwapped) {
+    for (auto& word : *result) {
+      word = ((word & 0xff) << 24) | ((word & 0xff00) << 8) |
+             ((word >> 8) & 0xff00) | (word >> 24);
+    }
   }
   return {};
 }
@@ -120,6 +627,9 @@ Result ShaderCompiler::CompileGlsl(ShaderType shader_type,
                                    std::vector<uint32_t>* result) const {
   shaderc::Compiler compiler;
   shaderc::CompileOptions options;
+  options.SetIncluder(MakeUnique<Includer>(include_paths_));
+  for (const auto& define : defines_)
+    options.AddMacroDefinition(define.first, define.second);
 
   shaderc_shader_kind kind;
   if (shader_type == ShaderType::kCompute)
@@ -15,11 +15,14 @@
 #ifndef SRC_SHADER_COMPILER_H_
 #define SRC_SHADER_COMPILER_H_
 
+#include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "amber/result.h"
 #include "src/shader_data.h"
+#include "src/shader_library.h"
 
 namespace amber {
 
@@ -28,14 +31,63 @@ class ShaderCompiler {
   ShaderCompiler();
   ~ShaderCompiler();
 
+  // When set, Compile() returns the binary without validating it. The caller
+  // is then responsible for calling Validate(), possibly on another thread.
+  void SetSkipValidation(bool skip) { skip_validation_ = skip; }
+
+  // Sets the NAME=value macro definitions used when compiling GLSL.
+  void SetDefines(const std::vector<std::pair<std::string, std::string>>& d) {
+    defines_ = d;
+  }
+
+  // Sets the directories searched for files named by GLSL #include
+  // directives. Included files are cached for the life of the process and
+  // re-read when their modification time changes.
+  void SetIncludePaths(const std::vector<std::string>& paths) {
+    include_paths_ = paths;
+  }
+
   std::pair<Result, std::vector<uint32_t>>
   Compile(ShaderType type, ShaderFormat fmt, const std::string& data) const;
 
+  // Validates |binary|. Results are memoized process wide, keyed by a hash of
+  // the SPIR-V words and checked against the stored words, so a module
+  // already seen by this or an earlier compile is not validated again. Safe
+  // to call from multiple threads, each with its own ShaderCompiler.
+  Result Validate(const std::vector<uint32_t>& binary) const;
+
+  // Runs the SPIRV-Tools optimization passes named in |passes| over |binary|.
+  // Pass names are spirv-opt flags, with or without the leading "--". The
+  // optimizer expects valid SPIR-V, so |binary| must be validated first. The
+  // optimized modules are memoized process wide, keyed by the input module
+  // and the pass list.
+  std::pair<Result, std::vector<uint32_t>> Optimize(
+      const std::vector<uint32_t>& binary,
+      const std::vector<std::string>& passes) const;
+
+  // Returns the sizes and stage timings recorded by the last Compile() and
+  // any Validate() and Optimize() calls made after it. The name is left for
+  // the caller to fill in.
+  const ShaderStats& GetStats() const { return stats_; }
+
+  // Returns the entry points and specialization constant ids of the module
+  // produced by the last successful Compile(). Shaders from the shader
+  // library reuse the reflection stored with the entry.
+  const ShaderReflection& GetReflection() const { return reflection_; }
+
  private:
   Result ParseHex(const std::string& data, std::vector<uint32_t>* result) const;
+  Result LoadSpirvBinary(const std::string& filename,
+                         std::vector<uint32_t>* result) const;
   Result CompileGlsl(ShaderType shader_type,
                      const std::string& data,
                      std::vector<uint32_t>* result) const;
+
+  bool skip_validation_ = false;
+  std::vector<std::pair<std::string, std::string>> defines_;
+  std::vector<std::string> include_paths_;
+  mutable ShaderStats stats_;
+  mutable ShaderReflection reflection_;
 };
 
 }  // namespace amber
@@ -13,7 +13,15 @@
 // limitations under the License.
 
 #include "src/shader_compiler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <string>
+
 #include "gtest/gtest.h"
+#include "src/builtin_shaders.h"
+#include "src/shader_library.h"
 #include "src/vkscript/section_parser.h"  // For the passthrough vertex shader
 
 namespace amber {
@@ -76,6 +84,17 @@ const char kHexShader[] =
    0x3e 0x00 0x03 0x00 0x14 0x00 0x00 0x00 0x12 0x00 0x00 0x00
    0xfd 0x00 0x01 0x00 0x38 0x00 0x01 0x00)";
 
+// Removes the file at |path| when it goes out of scope, so a failed
+// assertion does not leave it in the temp directory.
+class ScopedFileRemover {
+ public:
+  explicit ScopedFileRemover(const std::string& path) : path_(path) {}
+  ~ScopedFileRemover() { remove(path_.c_str()); }
+
+ private:
+  std::string path_;
+};
+
 }  // namespace
 
 using ShaderCompilerTest = testing::Test;
@@ -99,6 +118,97 @@ void main() {
   EXPECT_EQ(0x07230203, shader[0]);  // Verify SPIR-V header present.
 }
 
+TEST_F(ShaderCompilerTest, CompilesGlslWithDefines) {
+  std::string contents = R"(
+#version 420
+layout(location = 0) in vec4 position;
+
+#ifndef SCALE
+#error SCALE must be defined
+#endif
+
+void main() {
+  gl_Position = position * SCALE;
+})";
+
+  ShaderCompiler sc;
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kGlsl, contents);
+  ASSERT_FALSE(r.IsSuccess());
+
+  sc.SetDefines({{"SCALE", "2.0"}});
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kGlsl, contents);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  std::vector<uint32_t> other;
+  sc.SetDefines({{"SCALE", "3.0"}});
+  std::tie(r, other) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kGlsl, contents);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_NE(shader, other);
+}
+
+TEST_F(ShaderCompilerTest, CompilesGlslWithInclude) {
+  // Use a header name unique to this run so concurrent test runs sharing the
+  // temp directory do not see each other's header.
+  const std::string header =
+      "amber_shader_compiler_test_" +
+      std::to_string(
+          std::chrono::steady_clock::now().time_since_epoch().count()) +
+      ".h";
+  std::string contents = R"(
+#version 420
+#include ")" + header + R"("
+layout(location = 0) in vec4 position;
+
+void main() {
+  gl_Position = Scale(position);
+})";
+
+  std::string filename = testing::TempDir() + header;
+  ScopedFileRemover remover(filename);
+  FILE* file = fopen(filename.c_str(), "wb");
+  ASSERT_TRUE(file != nullptr);
+  fputs("vec4 Scale(vec4 v) { return v * 2.0; }\n", file);
+  fclose(file);
+
+  ShaderCompiler sc;
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kGlsl, contents);
+  ASSERT_FALSE(r.IsSuccess()) << "include should not be found without paths";
+
+  sc.SetIncludePaths({testing::TempDir()});
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kGlsl, contents);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  // Changing the header must not return the cached copy.
+  file = fopen(filename.c_str(), "wb");
+  ASSERT_TRUE(file != nullptr);
+  fputs("vec4 Scale(vec4 v) { return v * undefined_value; }\n", file);
+  fclose(file);
+
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kGlsl, contents);
+  ASSERT_FALSE(r.IsSuccess());
+}
+
+TEST_F(ShaderCompilerTest, DefinesRequireGlsl) {
+  ShaderCompiler sc;
+  sc.SetDefines({{"SCALE", "2.0"}});
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) = sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvAsm,
+                                   kPassThroughShader);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Shader defines are only supported for GLSL", r.Error());
+}
+
 TEST_F(ShaderCompilerTest, CompilesSpirvAsm) {
   ShaderCompiler sc;
   Result r;
@@ -110,6 +220,18 @@ TEST_F(ShaderCompilerTest, CompilesSpirvAsm) {
   EXPECT_EQ(0x07230203, shader[0]);  // Verify SPIR-V header present.
 }
 
+TEST_F(ShaderCompilerTest, PassThroughShaderIsPrecompiled) {
+  ShaderCompiler sc;
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) = sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvAsm,
+                                   kPassThroughShader);
+  ASSERT_TRUE(r.IsSuccess());
+  EXPECT_EQ(std::vector<uint32_t>(std::begin(kPassThroughShaderSpirv),
+                                  std::end(kPassThroughShaderSpirv)),
+            shader);
+}
+
 TEST_F(ShaderCompilerTest, CompilesSpirvHex) {
   ShaderCompiler sc;
   Result r;
@@ -121,6 +243,62 @@ TEST_F(ShaderCompilerTest, CompilesSpirvHex) {
   EXPECT_EQ(0x07230203, shader[0]);  // Verify SPIR-V header present.
 }
 
+TEST_F(ShaderCompilerTest, RecordsStats) {
+  ShaderCompiler sc;
+  sc.SetSkipValidation(true);
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex, kHexShader);
+  ASSERT_TRUE(r.IsSuccess());
+
+  const ShaderStats& stats = sc.GetStats();
+  EXPECT_EQ(std::string(kHexShader).size(), stats.source_size);
+  EXPECT_EQ(shader.size(), stats.spirv_words);
+  EXPECT_EQ(0.0, stats.compile_ms);
+  EXPECT_GE(stats.assemble_ms, 0.0);
+  EXPECT_EQ(0.0, stats.validate_ms);
+  EXPECT_EQ(0.0, stats.optimize_ms);
+}
+
+TEST_F(ShaderCompilerTest, StoresShadersInLibrary) {
+  ShaderCompiler sc;
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex, kHexShader);
+  ASSERT_TRUE(r.IsSuccess());
+
+  auto stored = ShaderLibrary::Get().Find(ShaderLibrary::MakeKey(
+      ShaderType::kVertex, ShaderFormat::kSpirvHex, kHexShader, {}));
+  ASSERT_NE(nullptr, stored);
+  EXPECT_EQ(shader, stored->spirv);
+
+  std::vector<uint32_t> again;
+  std::tie(r, again) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex, kHexShader);
+  ASSERT_TRUE(r.IsSuccess());
+  EXPECT_EQ(shader, again);
+}
+
+TEST_F(ShaderCompilerTest, ReportsReflection) {
+  ShaderCompiler sc;
+  for (int i = 0; i < 2; ++i) {
+    // The second compile is served from the shader library.
+    Result r;
+    std::vector<uint32_t> shader;
+    std::tie(r, shader) =
+        sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex, kHexShader);
+    ASSERT_TRUE(r.IsSuccess());
+
+    const ShaderReflection& reflection = sc.GetReflection();
+    ASSERT_EQ(1U, reflection.entry_points.size());
+    EXPECT_EQ("main", reflection.entry_points[0].name);
+    EXPECT_EQ(0U, reflection.entry_points[0].execution_model);
+    EXPECT_TRUE(reflection.spec_ids.empty());
+  }
+}
+
 TEST_F(ShaderCompilerTest, InvalidSpirvHex) {
   std::string contents = kHexShader;
   contents[3] = '0';
@@ -142,10 +320,170 @@ TEST_F(ShaderCompilerTest, InvalidHex) {
   std::tie(r, shader) =
       sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex, "aaaaaaaaa");
   ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Unable to parse shader hex: invalid hex byte at offset 2",
+            r.Error());
+}
+
+TEST_F(ShaderCompilerTest, HexWithoutPrefixes) {
+  ShaderCompiler sc;
+  sc.SetSkipValidation(true);
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) = sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex,
+                                   "03 02 23 07\n\t0x00 0X00 01 0");
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  ASSERT_EQ(2U, shader.size());
+  EXPECT_EQ(0x07230203U, shader[0]);
+  EXPECT_EQ(0x00010000U, shader[1]);
+}
+
+TEST_F(ShaderCompilerTest, HexPartialWord) {
+  ShaderCompiler sc;
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex, "0x03 0x02");
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Unable to parse shader hex: hex data is not a whole number of "
+            "words",
+            r.Error());
+}
+
+TEST_F(ShaderCompilerTest, HexInvalidByte) {
+  ShaderCompiler sc;
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) = sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex,
+                                   "0x03 0x023 0x07 0x23");
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Unable to parse shader hex: invalid hex byte at offset 9",
+            r.Error());
+}
+
+TEST_F(ShaderCompilerTest, CompilesSpirvBin) {
+  ShaderCompiler hex_sc;
+  Result r;
+  std::vector<uint32_t> expected;
+  std::tie(r, expected) =
+      hex_sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex, kHexShader);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  std::string filename = testing::TempDir() + "amber_shader_compiler_test.spv";
+  FILE* file = fopen(filename.c_str(), "wb");
+  ASSERT_TRUE(file != nullptr);
+  fwrite(expected.data(), sizeof(uint32_t), expected.size(), file);
+  fclose(file);
+
+  ShaderCompiler sc;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvBin, filename);
+  remove(filename.c_str());
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(expected, shader);
+}
+
+TEST_F(ShaderCompilerTest, MissingSpirvBin) {
+  ShaderCompiler sc;
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) = sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvBin,
+                                   "/does/not/exist.spv");
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Unable to open SPIR-V binary: /does/not/exist.spv", r.Error());
+}
+
+TEST_F(ShaderCompilerTest, SkipValidation) {
+  std::string contents = kHexShader;
+  contents[3] = '0';
+
+  ShaderCompiler sc;
+  sc.SetSkipValidation(true);
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex, contents);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_FALSE(shader.empty());
+
+  r = sc.Validate(shader);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Invalid shader: error: line 0: Invalid SPIR-V magic number.\n",
+            r.Error());
+}
+
+TEST_F(ShaderCompilerTest, ValidateIsRepeatable) {
+  ShaderCompiler sc;
+  sc.SetSkipValidation(true);
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex, kHexShader);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  // The second call is answered from the validation cache.
+  EXPECT_TRUE(sc.Validate(shader).IsSuccess());
+  EXPECT_TRUE(ShaderCompiler().Validate(shader).IsSuccess());
+
+  std::vector<uint32_t> broken = shader;
+  broken[0] = 0;
+  r = sc.Validate(broken);
+  ASSERT_FALSE(r.IsSuccess());
+  r = sc.Validate(broken);
+  ASSERT_FALSE(r.IsSuccess());
   EXPECT_EQ("Invalid shader: error: line 0: Invalid SPIR-V magic number.\n",
             r.Error());
 }
 
+TEST_F(ShaderCompilerTest, Optimize) {
+  ShaderCompiler sc;
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex, kHexShader);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  std::vector<uint32_t> optimized;
+  std::tie(r, optimized) = sc.Optimize(shader, {"strip-debug"});
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_LT(optimized.size(), shader.size());
+  EXPECT_TRUE(sc.Validate(optimized).IsSuccess());
+
+  // The leading -- is optional and the cached result is returned.
+  std::vector<uint32_t> cached;
+  std::tie(r, cached) = sc.Optimize(shader, {"--strip-debug"});
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(optimized, cached);
+}
+
+TEST_F(ShaderCompilerTest, OptimizeWithoutPasses) {
+  ShaderCompiler sc;
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex, kHexShader);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  std::vector<uint32_t> optimized;
+  std::tie(r, optimized) = sc.Optimize(shader, {});
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(shader, optimized);
+}
+
+TEST_F(ShaderCompilerTest, OptimizeInvalidPass) {
+  ShaderCompiler sc;
+  Result r;
+  std::vector<uint32_t> shader;
+  std::tie(r, shader) =
+      sc.Compile(ShaderType::kVertex, ShaderFormat::kSpirvHex, kHexShader);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  std::vector<uint32_t> optimized;
+  std::tie(r, optimized) = sc.Optimize(shader, {"not-a-real-pass"});
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ(0U, r.Error().find("Invalid optimizations: "));
+}
+
 TEST_F(ShaderCompilerTest, FailsOnInvalidShader) {
   std::string contents = "Just Random\nText()\nThat doesn't work.";
 
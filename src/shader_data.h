@@ -25,6 +25,7 @@ enum class ShaderFormat : uint8_t {
   kGlsl,
   kSpirvAsm,
   kSpirvHex,
+  kSpirvBin,
 };
 
 enum class ShaderType : uint8_t {
@@ -81,6 +82,166 @@ const char kPassThroughShader[] = R"(; SPIR-V
                OpReturn
                OpFunctionEnd)";
 
+// Compares values in a storage buffer against bounds on the device, for
+// probes which should not read the values back. Value i of the value_count
+// values from word first_word of binding 0 passes when it is in
+// [bounds[2 * j], bounds[2 * j + 1]] of binding 1, with j = i % bounds_count.
+// Values are floats, or bytes counted from the first byte of first_word when
+// unorm8 is set. Binding 2 gets the number of failing values and the lowest
+// failing index, and must start as 0 and 0xffffffff.
+const char kProbeVerifyShader[] = R"(; SPIR-V
+; Version: 1.0
+; Bound: 92
+; Schema: 0
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint GLCompute %main "main" %invocation_id %num_groups
+               OpExecutionMode %main LocalSize 64 1 1
+               OpName %main "main"
+               OpName %Values "Values"
+               OpName %values "values"
+               OpName %Bounds "Bounds"
+               OpName %bounds "bounds"
+               OpName %Mismatches "Mismatches"
+               OpMemberName %Mismatches 0 "count"
+               OpMemberName %Mismatches 1 "first"
+               OpName %mismatches "mismatches"
+               OpName %Params "Params"
+               OpMemberName %Params 0 "first_word"
+               OpMemberName %Params 1 "value_count"
+               OpMemberName %Params 2 "bounds_count"
+               OpMemberName %Params 3 "unorm8"
+               OpName %params "params"
+               OpName %i "i"
+               OpDecorate %invocation_id BuiltIn GlobalInvocationId
+               OpDecorate %num_groups BuiltIn NumWorkgroups
+               OpDecorate %_runtimearr_uint ArrayStride 4
+               OpMemberDecorate %Values 0 NonWritable
+               OpMemberDecorate %Values 0 Offset 0
+               OpDecorate %Values BufferBlock
+               OpDecorate %values DescriptorSet 0
+               OpDecorate %values Binding 0
+               OpDecorate %_runtimearr_float ArrayStride 4
+               OpMemberDecorate %Bounds 0 NonWritable
+               OpMemberDecorate %Bounds 0 Offset 0
+               OpDecorate %Bounds BufferBlock
+               OpDecorate %bounds DescriptorSet 0
+               OpDecorate %bounds Binding 1
+               OpMemberDecorate %Mismatches 0 Offset 0
+               OpMemberDecorate %Mismatches 1 Offset 4
+               OpDecorate %Mismatches BufferBlock
+               OpDecorate %mismatches DescriptorSet 0
+               OpDecorate %mismatches Binding 2
+               OpMemberDecorate %Params 0 Offset 0
+               OpMemberDecorate %Params 1 Offset 4
+               OpMemberDecorate %Params 2 Offset 8
+               OpMemberDecorate %Params 3 Offset 12
+               OpDecorate %Params Block
+       %void = OpTypeVoid
+  %void_func = OpTypeFunction %void
+       %bool = OpTypeBool
+       %uint = OpTypeInt 32 0
+      %float = OpTypeFloat 32
+     %v3uint = OpTypeVector %uint 3
+     %uint_0 = OpConstant %uint 0
+     %uint_1 = OpConstant %uint 1
+     %uint_2 = OpConstant %uint 2
+     %uint_3 = OpConstant %uint 3
+     %uint_4 = OpConstant %uint 4
+     %uint_8 = OpConstant %uint 8
+    %uint_64 = OpConstant %uint 64
+   %uint_255 = OpConstant %uint 255
+%_ptr_Input_v3uint = OpTypePointer Input %v3uint
+%_ptr_Input_uint = OpTypePointer Input %uint
+%invocation_id = OpVariable %_ptr_Input_v3uint Input
+%num_groups = OpVariable %_ptr_Input_v3uint Input
+%_runtimearr_uint = OpTypeRuntimeArray %uint
+     %Values = OpTypeStruct %_runtimearr_uint
+%_ptr_Uniform_Values = OpTypePointer Uniform %Values
+     %values = OpVariable %_ptr_Uniform_Values Uniform
+%_runtimearr_float = OpTypeRuntimeArray %float
+     %Bounds = OpTypeStruct %_runtimearr_float
+%_ptr_Uniform_Bounds = OpTypePointer Uniform %Bounds
+     %bounds = OpVariable %_ptr_Uniform_Bounds Uniform
+ %Mismatches = OpTypeStruct %uint %uint
+%_ptr_Uniform_Mismatches = OpTypePointer Uniform %Mismatches
+ %mismatches = OpVariable %_ptr_Uniform_Mismatches Uniform
+     %Params = OpTypeStruct %uint %uint %uint %uint
+%_ptr_PushConstant_Params = OpTypePointer PushConstant %Params
+     %params = OpVariable %_ptr_PushConstant_Params PushConstant
+%_ptr_PushConstant_uint = OpTypePointer PushConstant %uint
+%_ptr_Uniform_uint = OpTypePointer Uniform %uint
+%_ptr_Uniform_float = OpTypePointer Uniform %float
+%_ptr_Function_uint = OpTypePointer Function %uint
+       %main = OpFunction %void None %void_func
+      %entry = OpLabel
+          %i = OpVariable %_ptr_Function_uint Function
+    %gid_ptr = OpAccessChain %_ptr_Input_uint %invocation_id %uint_0
+        %gid = OpLoad %uint %gid_ptr
+ %groups_ptr = OpAccessChain %_ptr_Input_uint %num_groups %uint_0
+     %groups = OpLoad %uint %groups_ptr
+     %stride = OpIMul %uint %groups %uint_64
+%first_word_ptr = OpAccessChain %_ptr_PushConstant_uint %params %uint_0
+ %first_word = OpLoad %uint %first_word_ptr
+%value_count_ptr = OpAccessChain %_ptr_PushConstant_uint %params %uint_1
+%value_count = OpLoad %uint %value_count_ptr
+%bounds_count_ptr = OpAccessChain %_ptr_PushConstant_uint %params %uint_2
+%bounds_count = OpLoad %uint %bounds_count_ptr
+ %unorm8_ptr = OpAccessChain %_ptr_PushConstant_uint %params %uint_3
+ %unorm8_int = OpLoad %uint %unorm8_ptr
+     %unorm8 = OpINotEqual %bool %unorm8_int %uint_0
+ %first_byte = OpIMul %uint %first_word %uint_4
+               OpStore %i %gid
+               OpBranch %loop
+       %loop = OpLabel
+               OpLoopMerge %loop_end %continue None
+               OpBranch %check
+      %check = OpLabel
+      %index = OpLoad %uint %i
+   %in_range = OpULessThan %bool %index %value_count
+               OpBranchConditional %in_range %body %loop_end
+       %body = OpLabel
+ %byte_index = OpIAdd %uint %first_byte %index
+  %byte_word = OpShiftRightLogical %uint %byte_index %uint_2
+ %float_word = OpIAdd %uint %first_word %index
+ %word_index = OpSelect %uint %unorm8 %byte_word %float_word
+   %word_ptr = OpAccessChain %_ptr_Uniform_uint %values %uint_0 %word_index
+       %word = OpLoad %uint %word_ptr
+  %byte_lane = OpBitwiseAnd %uint %byte_index %uint_3
+      %shift = OpIMul %uint %byte_lane %uint_8
+    %shifted = OpShiftRightLogical %uint %word %shift
+       %byte = OpBitwiseAnd %uint %shifted %uint_255
+ %byte_value = OpConvertUToF %float %byte
+%float_value = OpBitcast %float %word
+      %value = OpSelect %float %unorm8 %byte_value %float_value
+      %bound = OpUMod %uint %index %bounds_count
+   %lo_index = OpIMul %uint %bound %uint_2
+   %hi_index = OpIAdd %uint %lo_index %uint_1
+     %lo_ptr = OpAccessChain %_ptr_Uniform_float %bounds %uint_0 %lo_index
+         %lo = OpLoad %float %lo_ptr
+     %hi_ptr = OpAccessChain %_ptr_Uniform_float %bounds %uint_0 %hi_index
+         %hi = OpLoad %float %hi_ptr
+   %above_lo = OpFOrdGreaterThanEqual %bool %value %lo
+   %below_hi = OpFOrdLessThanEqual %bool %value %hi
+     %passes = OpLogicalAnd %bool %above_lo %below_hi
+               OpSelectionMerge %next_value None
+               OpBranchConditional %passes %next_value %mismatch
+   %mismatch = OpLabel
+  %count_ptr = OpAccessChain %_ptr_Uniform_uint %mismatches %uint_0
+  %old_count = OpAtomicIAdd %uint %count_ptr %uint_1 %uint_0 %uint_1
+  %first_ptr = OpAccessChain %_ptr_Uniform_uint %mismatches %uint_1
+  %old_first = OpAtomicUMin %uint %first_ptr %uint_1 %uint_0 %index
+               OpBranch %next_value
+ %next_value = OpLabel
+               OpBranch %continue
+   %continue = OpLabel
+       %next = OpIAdd %uint %index %stride
+               OpStore %i %next
+               OpBranch %loop
+   %loop_end = OpLabel
+               OpReturn
+               OpFunctionEnd)";
+
 }  // namespace amber
 
 #endif  // SRC_SHADER_DATA_H_
@@ -0,0 +1,133 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/shader_library.h"
+
+namespace amber {
+namespace {
+
+const size_t kSpirvHeaderWords = 5;
+const uint32_t kOpEntryPoint = 15;
+const uint32_t kOpDecorate = 71;
+const uint32_t kOpFunction = 54;
+const uint32_t kDecorationSpecId = 1;
+
+// Serializes the fields passed to Add(). Strings are length prefixed so "ab" +
+// "c" and "a" + "bc" differ.
+class KeyBuilder {
+ public:
+  void Add(const std::string& str) {
+    key_ += std::to_string(str.size());
+    key_ += ':';
+    key_ += str;
+  }
+
+  void Add(uint8_t value) { key_ += static_cast<char>(value); }
+
+  ShaderLibrary::Key GetKey() { return std::move(key_); }
+
+ private:
+  ShaderLibrary::Key key_;
+};
+
+// Reads the nul terminated SPIR-V literal string starting at |words|.
+std::string ReadLiteralString(const uint32_t* words, size_t count) {
+  std::string str;
+  for (size_t i = 0; i < count; ++i) {
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+      char c = static_cast<char>((words[i] >> shift) & 0xff);
+      if (c == '\0')
+        return str;
+      str.push_back(c);
+    }
+  }
+  return str;
+}
+
+}  // namespace
+
+// static
+ShaderLibrary& ShaderLibrary::Get() {
+  static ShaderLibrary* library = new ShaderLibrary();
+  return *library;
+}
+
+// static
+ShaderLibrary::Key ShaderLibrary::MakeKey(
+    ShaderType type,
+    ShaderFormat format,
+    const std::string& source,
+    const std::vector<std::pair<std::string, std::string>>& defines) {
+  KeyBuilder builder;
+  builder.Add(static_cast<uint8_t>(type));
+  builder.Add(static_cast<uint8_t>(format));
+  builder.Add(source);
+  for (const auto& define : defines) {
+    builder.Add(define.first);
+    builder.Add(define.second);
+  }
+  return builder.GetKey();
+}
+
+// static
+ShaderReflection ShaderLibrary::Reflect(const std::vector<uint32_t>& spirv) {
+  ShaderReflection reflection;
+  size_t i = kSpirvHeaderWords;
+  while (i < spirv.size()) {
+    const uint32_t word_count = spirv[i] >> 16;
+    const uint32_t opcode = spirv[i] & 0xffff;
+    if (word_count == 0 || i + word_count > spirv.size())
+      break;
+    // Entry points and decorations all come before the first function.
+    if (opcode == kOpFunction)
+      break;
+
+    if (opcode == kOpEntryPoint && word_count >= 4) {
+      ShaderReflection::EntryPoint entry_point;
+      entry_point.execution_model = spirv[i + 1];
+      entry_point.name = ReadLiteralString(&spirv[i + 3], word_count - 3);
+      reflection.entry_points.push_back(entry_point);
+    } else if (opcode == kOpDecorate && word_count >= 4 &&
+               spirv[i + 2] == kDecorationSpecId) {
+      reflection.spec_ids.push_back(spirv[i + 3]);
+    }
+    i += word_count;
+  }
+  return reflection;
+}
+
+ShaderLibrary::ShaderLibrary() = default;
+
+ShaderLibrary::~ShaderLibrary() = default;
+
+std::shared_ptr<const ShaderLibrary::Shader> ShaderLibrary::Find(
+    const Key& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = shaders_.find(key);
+  return it == shaders_.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<const ShaderLibrary::Shader> ShaderLibrary::Insert(
+    const Key& key,
+    std::vector<uint32_t> spirv) {
+  // Reflect outside of the lock, it only touches the new entry.
+  auto shader = std::make_shared<Shader>();
+  shader->reflection = Reflect(spirv);
+  shader->spirv = std::move(spirv);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  return shaders_.emplace(key, std::move(shader)).first->second;
+}
+
+}  // namespace amber
@@ -0,0 +1,89 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_SHADER_LIBRARY_H_
+#define SRC_SHADER_LIBRARY_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "src/shader_data.h"
+
+namespace amber {
+
+// Information read back out of a SPIR-V module.
+struct ShaderReflection {
+  struct EntryPoint {
+    std::string name;
+    // The SPIR-V ExecutionModel of the entry point.
+    uint32_t execution_model = 0;
+  };
+
+  std::vector<EntryPoint> entry_points;
+  // The SpecId decorations in the module, in declaration order.
+  std::vector<uint32_t> spec_ids;
+};
+
+// A process wide library of compiled shaders, keyed by the shader source and
+// the options it was compiled with. Scripts run one after another in the same
+// process share the compiled SPIR-V instead of compiling the same source
+// again. Entries are immutable and never evicted. Thread safe.
+class ShaderLibrary {
+ public:
+  // A compiled shader. Entries are shared between every user of the library
+  // and must not be modified.
+  struct Shader {
+    std::vector<uint32_t> spirv;
+    ShaderReflection reflection;
+  };
+
+  // The shader type, format, source and defines, serialized so that keys
+  // only compare equal when all of them match.
+  using Key = std::string;
+
+  static ShaderLibrary& Get();
+
+  static Key MakeKey(
+      ShaderType type,
+      ShaderFormat format,
+      const std::string& source,
+      const std::vector<std::pair<std::string, std::string>>& defines);
+
+  // Parses the entry points and specialization constant ids out of |spirv|.
+  static ShaderReflection Reflect(const std::vector<uint32_t>& spirv);
+
+  // Returns the shader stored for |key|, or nullptr if there is none.
+  std::shared_ptr<const Shader> Find(const Key& key);
+
+  // Stores |spirv| for |key|, returning the library's copy. If another thread
+  // stored the key first, its entry is returned instead.
+  std::shared_ptr<const Shader> Insert(const Key& key,
+                                       std::vector<uint32_t> spirv);
+
+ private:
+  ShaderLibrary();
+  ~ShaderLibrary();
+
+  std::mutex mutex_;
+  std::unordered_map<Key, std::shared_ptr<const Shader>> shaders_;
+};
+
+}  // namespace amber
+
+#endif  // SRC_SHADER_LIBRARY_H_
@@ -0,0 +1,117 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/shader_library.h"
+#include "gtest/gtest.h"
+
+namespace amber {
+
+using ShaderLibraryTest = testing::Test;
+
+TEST_F(ShaderLibraryTest, KeyDependsOnEverything) {
+  const auto key = ShaderLibrary::MakeKey(
+      ShaderType::kVertex, ShaderFormat::kGlsl, "source", {{"A", "1"}});
+
+  EXPECT_EQ(key, ShaderLibrary::MakeKey(ShaderType::kVertex,
+                                        ShaderFormat::kGlsl, "source",
+                                        {{"A", "1"}}));
+  EXPECT_NE(key, ShaderLibrary::MakeKey(ShaderType::kFragment,
+                                        ShaderFormat::kGlsl, "source",
+                                        {{"A", "1"}}));
+  EXPECT_NE(key, ShaderLibrary::MakeKey(ShaderType::kVertex,
+                                        ShaderFormat::kSpirvAsm, "source",
+                                        {{"A", "1"}}));
+  EXPECT_NE(key, ShaderLibrary::MakeKey(ShaderType::kVertex,
+                                        ShaderFormat::kGlsl, "sources",
+                                        {{"A", "1"}}));
+  EXPECT_NE(key, ShaderLibrary::MakeKey(ShaderType::kVertex,
+                                        ShaderFormat::kGlsl, "source",
+                                        {{"A", "2"}}));
+  EXPECT_NE(key, ShaderLibrary::MakeKey(ShaderType::kVertex,
+                                        ShaderFormat::kGlsl, "source", {}));
+  EXPECT_NE(key, ShaderLibrary::MakeKey(ShaderType::kVertex,
+                                        ShaderFormat::kGlsl, "source",
+                                        {{"A1", ""}}));
+}
+
+TEST_F(ShaderLibraryTest, FindAfterInsert) {
+  const auto key = ShaderLibrary::MakeKey(
+      ShaderType::kCompute, ShaderFormat::kSpirvHex, "FindAfterInsert", {});
+  EXPECT_EQ(nullptr, ShaderLibrary::Get().Find(key));
+
+  auto inserted = ShaderLibrary::Get().Insert(key, {0x07230203, 0x00010000});
+  ASSERT_NE(nullptr, inserted);
+
+  auto found = ShaderLibrary::Get().Find(key);
+  EXPECT_EQ(inserted, found);
+  EXPECT_EQ(std::vector<uint32_t>({0x07230203, 0x00010000}), found->spirv);
+
+  // A second insert keeps the first entry.
+  EXPECT_EQ(inserted, ShaderLibrary::Get().Insert(key, {1, 2, 3}));
+}
+
+TEST_F(ShaderLibraryTest, Reflect) {
+  const std::vector<uint32_t> spirv = {
+      // Header
+      0x07230203, 0x00010000, 0x00080001, 0x00000010, 0x00000000,
+      // OpEntryPoint Fragment %1 "main"
+      0x0005000f, 0x00000004, 0x00000001, 0x6e69616d, 0x00000000,
+      // OpDecorate %2 SpecId 7
+      0x00040047, 0x00000002, 0x00000001, 0x00000007,
+      // OpDecorate %3 SpecId 12
+      0x00040047, 0x00000003, 0x00000001, 0x0000000c,
+      // OpDecorate %3 Binding 0
+      0x00040047, 0x00000003, 0x00000021, 0x00000000,
+      // OpFunction %4 %1 None %5
+      0x00050036, 0x00000004, 0x00000001, 0x00000000, 0x00000005,
+      // Not an annotation, but after the first function so not read.
+      0x00040047, 0x00000006, 0x00000001, 0x00000009,
+  };
+
+  ShaderReflection reflection = ShaderLibrary::Reflect(spirv);
+  ASSERT_EQ(1U, reflection.entry_points.size());
+  EXPECT_EQ("main", reflection.entry_points[0].name);
+  EXPECT_EQ(4U, reflection.entry_points[0].execution_model);
+  EXPECT_EQ(std::vector<uint32_t>({7, 12}), reflection.spec_ids);
+}
+
+TEST_F(ShaderLibraryTest, ReflectTruncated) {
+  const std::vector<uint32_t> spirv = {
+      0x07230203, 0x00010000, 0x00080001, 0x00000010, 0x00000000,
+      // OpEntryPoint claiming more words than remain.
+      0x0009000f, 0x00000004, 0x00000001,
+  };
+
+  ShaderReflection reflection = ShaderLibrary::Reflect(spirv);
+  EXPECT_TRUE(reflection.entry_points.empty());
+  EXPECT_TRUE(reflection.spec_ids.empty());
+}
+
+TEST_F(ShaderLibraryTest, InsertReflects) {
+  const auto key = ShaderLibrary::MakeKey(
+      ShaderType::kCompute, ShaderFormat::kSpirvHex, "InsertReflects", {});
+  auto inserted = ShaderLibrary::Get().Insert(
+      key, {0x07230203, 0x00010000, 0x00080001, 0x00000010, 0x00000000,
+            // OpEntryPoint GLCompute %1 "main"
+            0x0005000f, 0x00000005, 0x00000001, 0x6e69616d, 0x00000000,
+            // OpDecorate %2 SpecId 3
+            0x00040047, 0x00000002, 0x00000001, 0x00000003});
+  ASSERT_NE(nullptr, inserted);
+  ASSERT_EQ(1U, inserted->reflection.entry_points.size());
+  EXPECT_EQ("main", inserted->reflection.entry_points[0].name);
+  EXPECT_EQ(5U, inserted->reflection.entry_points[0].execution_model);
+  EXPECT_EQ(std::vector<uint32_t>({3}), inserted->reflection.spec_ids);
+}
+
+}  // namespace amber
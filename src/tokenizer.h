@@ -52,6 +52,7 @@ class Token {
   bool IsCloseBracket() const {
     return type_ == TokenType::kString && string_value_ == ")";
   }
+  bool IsNegative() const { return is_negative_; }
 
   void SetNegative() { is_negative_ = true; }
   void SetStringValue(const std::string& val) { string_value_ = val; }
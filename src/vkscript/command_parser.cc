@@ -721,6 +721,10 @@ Result CommandParser::ProcessProbe(bool relative) {
   // The SSBO syntax is different from probe or probe all so handle specially.
   if (token->AsString() == "ssbo")
     return ProcessProbeSSBO();
+  if (token->AsString() == "hash")
+    return ProcessProbeHash();
+  if (token->AsString() == "image")
+    return ProcessProbeImage();
 
   auto cmd = MakeUnique<ProbeCommand>();
   if (relative)
@@ -1852,5 +1856,119 @@ Result CommandParser::ProcessProbeSSBO() {
   return {};
 }
 
+Result CommandParser::ProcessProbeHash() {
+  auto cmd = MakeUnique<ProbeHashCommand>();
+
+  auto token = tokenizer_->NextToken();
+  if (token->IsString() && token->AsString() == "ssbo") {
+    cmd->SetIsSSBO();
+
+    token = tokenizer_->NextToken();
+    if (!token->IsInteger())
+      return Result("Invalid binding value for probe hash command");
+
+    uint32_t val = token->AsUint32();
+
+    token = tokenizer_->NextToken();
+    if (token->IsString() && token->AsString().size() >= 2 &&
+        token->AsString()[0] == ':') {
+      cmd->SetDescriptorSet(val);
+
+      auto substr = token->AsString().substr(1);
+      uint64_t binding_val = strtoul(substr.c_str(), nullptr, 10);
+      if (binding_val > std::numeric_limits<uint32_t>::max())
+        return Result("binding value too large in probe hash command");
+
+      cmd->SetBinding(static_cast<uint32_t>(binding_val));
+      token = tokenizer_->NextToken();
+    } else {
+      cmd->SetBinding(val);
+    }
+  }
+
+  if (token->IsEOL() || token->IsEOS())
+    return Result("Missing algorithm for probe hash command");
+  if (!token->IsString())
+    return Result("Invalid algorithm for probe hash command");
+  if (token->AsString() != "xxh64")
+    return Result("Unknown algorithm for probe hash command: " +
+                  token->AsString());
+
+  cmd->SetAlgorithm(ContentHashAlgorithm::kXXH64);
+
+  token = tokenizer_->NextToken();
+  if (token->IsEOL() || token->IsEOS())
+    return Result("Missing hash value for probe hash command");
+
+  // The value is 0x followed by up to 16 hexadecimal digits.
+  if (!token->IsHex() || token->AsString().size() > 18 ||
+      token->AsString().find_first_not_of("0123456789abcdefABCDEF", 2) !=
+          std::string::npos) {
+    return Result("Invalid hash value for probe hash command");
+  }
+
+  cmd->SetExpectedHash(token->AsHex());
+
+  token = tokenizer_->NextToken();
+  if (!token->IsEOS() && !token->IsEOL())
+    return Result("Extra parameter to probe hash command");
+
+  commands_.push_back(std::move(cmd));
+  return {};
+}
+
+Result CommandParser::ProcessProbeImage() {
+  auto cmd = MakeUnique<ProbeImageCommand>();
+
+  auto token = tokenizer_->NextToken();
+  if (token->IsEOL() || token->IsEOS())
+    return Result("Missing filename for probe image command");
+  if (!token->IsString())
+    return Result("Invalid filename for probe image command");
+
+  cmd->SetFilename(token->AsString());
+
+  bool has_threshold = false;
+  for (token = tokenizer_->NextToken(); !token->IsEOS() && !token->IsEOL();
+       token = tokenizer_->NextToken()) {
+    if (!token->IsString())
+      return Result("Invalid parameter for probe image command");
+
+    const std::string name = token->AsString();
+    token = tokenizer_->NextToken();
+    if (name == "diff") {
+      if (!token->IsString())
+        return Result("Invalid diff filename for probe image command");
+
+      cmd->SetDiffFilename(token->AsString());
+      continue;
+    }
+    if (name != "max_error" && name != "rmse" && name != "psnr")
+      return Result("Unknown parameter for probe image command: " + name);
+
+    Result r = token->ConvertToDouble();
+    if (!r.IsSuccess() || token->AsDouble() < 0.0)
+      return Result("Invalid " + name + " value for probe image command");
+
+    if (name == "max_error") {
+      if (token->AsDouble() > 255.0)
+        return Result("Invalid max_error value for probe image command");
+      cmd->SetMaxError(static_cast<uint32_t>(token->AsDouble()));
+    } else if (name == "rmse") {
+      cmd->SetMaxRMSE(token->AsDouble());
+    } else {
+      cmd->SetMinPSNR(token->AsDouble());
+    }
+    has_threshold = true;
+  }
+
+  // Without thresholds the images must be equal.
+  if (!has_threshold)
+    cmd->SetMaxError(0);
+
+  commands_.push_back(std::move(cmd));
+  return {};
+}
+
 }  // namespace vkscript
 }  // namespace amber
@@ -92,6 +92,8 @@ class CommandParser {
   Result ProcessEntryPoint(const std::string& name);
   Result ProcessProbe(bool relative);
   Result ProcessProbeSSBO();
+  Result ProcessProbeHash();
+  Result ProcessProbeImage();
   Result ProcessTopology();
   Result ProcessPolygonMode();
   Result ProcessLogicOp();
@@ -3448,6 +3448,167 @@ TEST_F(CommandParserTest, ProbeSSBOWithMissingAllData) {
             r.Error());
 }
 
+TEST_F(CommandParserTest, ProbeHash) {
+  std::string data = "probe hash xxh64 0x0123456789abcdef";
+
+  CommandParser cp;
+  Result r = cp.Parse(data);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  auto& cmds = cp.Commands();
+  ASSERT_EQ(1U, cmds.size());
+  ASSERT_TRUE(cmds[0]->IsProbeHash());
+
+  auto* cmd = cmds[0]->AsProbeHash();
+  EXPECT_FALSE(cmd->IsSSBO());
+  EXPECT_EQ(ContentHashAlgorithm::kXXH64, cmd->GetAlgorithm());
+  EXPECT_EQ(0x0123456789abcdefULL, cmd->GetExpectedHash());
+  EXPECT_EQ("", cmd->GetTargetName());
+}
+
+TEST_F(CommandParserTest, ProbeHashSSBO) {
+  std::string data = "probe hash ssbo 5 xxh64 0xFEDCBA9876543210";
+
+  CommandParser cp;
+  Result r = cp.Parse(data);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  auto& cmds = cp.Commands();
+  ASSERT_EQ(1U, cmds.size());
+  ASSERT_TRUE(cmds[0]->IsProbeHash());
+
+  auto* cmd = cmds[0]->AsProbeHash();
+  EXPECT_TRUE(cmd->IsSSBO());
+  EXPECT_EQ(0U, cmd->GetDescriptorSet());
+  EXPECT_EQ(5U, cmd->GetBinding());
+  EXPECT_EQ(0xfedcba9876543210ULL, cmd->GetExpectedHash());
+  EXPECT_EQ("ssbo 0:5", cmd->GetTargetName());
+}
+
+TEST_F(CommandParserTest, ProbeHashSSBOWithDescriptorSet) {
+  std::string data = "probe hash ssbo 3:6 xxh64 0x1f";
+
+  CommandParser cp;
+  Result r = cp.Parse(data);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  auto& cmds = cp.Commands();
+  ASSERT_EQ(1U, cmds.size());
+  ASSERT_TRUE(cmds[0]->IsProbeHash());
+
+  auto* cmd = cmds[0]->AsProbeHash();
+  EXPECT_TRUE(cmd->IsSSBO());
+  EXPECT_EQ(3U, cmd->GetDescriptorSet());
+  EXPECT_EQ(6U, cmd->GetBinding());
+  EXPECT_EQ(0x1fULL, cmd->GetExpectedHash());
+}
+
+TEST_F(CommandParserTest, ProbeHashErrors) {
+  struct {
+    const char* data;
+    const char* error;
+  } cases[] = {
+      {"probe hash", "Missing algorithm for probe hash command"},
+      {"probe hash 1", "Invalid algorithm for probe hash command"},
+      {"probe hash md5 0x1",
+       "Unknown algorithm for probe hash command: md5"},
+      {"probe hash xxh64", "Missing hash value for probe hash command"},
+      {"probe hash xxh64 12", "Invalid hash value for probe hash command"},
+      {"probe hash xxh64 0x12g4", "Invalid hash value for probe hash command"},
+      {"probe hash xxh64 0x0123456789abcdef0",
+       "Invalid hash value for probe hash command"},
+      {"probe hash xxh64 0x1 0x2", "Extra parameter to probe hash command"},
+      {"probe hash ssbo xxh64 0x1",
+       "Invalid binding value for probe hash command"},
+  };
+
+  for (const auto& test : cases) {
+    CommandParser cp;
+    Result r = cp.Parse(test.data);
+    ASSERT_FALSE(r.IsSuccess()) << test.data;
+    EXPECT_EQ(test.error, r.Error()) << test.data;
+  }
+}
+
+TEST_F(CommandParserTest, ProbeImage) {
+  std::string data = "probe image ref/frame.ppm";
+
+  CommandParser cp;
+  Result r = cp.Parse(data);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  auto& cmds = cp.Commands();
+  ASSERT_EQ(1U, cmds.size());
+  ASSERT_TRUE(cmds[0]->IsProbeImage());
+
+  auto* cmd = cmds[0]->AsProbeImage();
+  EXPECT_EQ("ref/frame.ppm", cmd->GetFilename());
+  EXPECT_EQ("", cmd->GetDiffFilename());
+  EXPECT_EQ(0U, cmd->GetMaxError());
+  EXPECT_DOUBLE_EQ(255.0, cmd->GetMaxRMSE());
+  EXPECT_DOUBLE_EQ(0.0, cmd->GetMinPSNR());
+}
+
+TEST_F(CommandParserTest, ProbeImageWithThresholds) {
+  std::string data =
+      "probe image frame.raw rmse 1.5 psnr 40 diff out/diff.ppm max_error 8";
+
+  CommandParser cp;
+  Result r = cp.Parse(data);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  auto& cmds = cp.Commands();
+  ASSERT_EQ(1U, cmds.size());
+  ASSERT_TRUE(cmds[0]->IsProbeImage());
+
+  auto* cmd = cmds[0]->AsProbeImage();
+  EXPECT_EQ("frame.raw", cmd->GetFilename());
+  EXPECT_EQ("out/diff.ppm", cmd->GetDiffFilename());
+  EXPECT_EQ(8U, cmd->GetMaxError());
+  EXPECT_DOUBLE_EQ(1.5, cmd->GetMaxRMSE());
+  EXPECT_DOUBLE_EQ(40.0, cmd->GetMinPSNR());
+}
+
+TEST_F(CommandParserTest, ProbeImageThresholdAllowsOtherErrors) {
+  std::string data = "probe image frame.ppm psnr 30.5";
+
+  CommandParser cp;
+  Result r = cp.Parse(data);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  auto* cmd = cp.Commands()[0]->AsProbeImage();
+  EXPECT_EQ(255U, cmd->GetMaxError());
+  EXPECT_DOUBLE_EQ(255.0, cmd->GetMaxRMSE());
+  EXPECT_DOUBLE_EQ(30.5, cmd->GetMinPSNR());
+}
+
+TEST_F(CommandParserTest, ProbeImageErrors) {
+  struct {
+    const char* data;
+    const char* error;
+  } cases[] = {
+      {"probe image", "Missing filename for probe image command"},
+      {"probe image 12", "Invalid filename for probe image command"},
+      {"probe image a.ppm 3", "Invalid parameter for probe image command"},
+      {"probe image a.ppm ssim 0.9",
+       "Unknown parameter for probe image command: ssim"},
+      {"probe image a.ppm max_error 256",
+       "Invalid max_error value for probe image command"},
+      {"probe image a.ppm rmse -1",
+       "Invalid rmse value for probe image command"},
+      {"probe image a.ppm psnr", "Invalid psnr value for probe image command"},
+      {"probe image a.ppm diff",
+       "Invalid diff filename for probe image command"},
+  };
+
+  for (const auto& test : cases) {
+    CommandParser cp;
+    Result r = cp.Parse(test.data);
+    ASSERT_FALSE(r.IsSuccess()) << test.data;
+    EXPECT_EQ(test.error, r.Error()) << test.data;
+  }
+}
+
 struct ComparatorTest {
   const char* name;
   ProbeSSBOCommand::Comparator op;
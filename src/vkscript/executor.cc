@@ -14,10 +14,16 @@
 
 #include "src/vkscript/executor.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <future>
+#include <memory>
 #include <vector>
 
 #include "src/engine.h"
+#include "src/shader_compiler.h"
+#include "src/timer.h"
 #include "src/vkscript/nodes.h"
 #include "src/vkscript/script.h"
 
@@ -47,21 +53,54 @@ Result Executor::Execute(Engine* engine, const amber::Script* src_script) {
     }
   }
 
-  // Process Shader nodes
+  // Process Shader nodes. The stats are reserved up front as the async
+  // validations write into them.
+  shader_stats_.clear();
+  shader_stats_.reserve(static_cast<size_t>(
+      std::count_if(script->Nodes().begin(), script->Nodes().end(),
+                    [](const std::unique_ptr<Node>& node) {
+                      return node->IsShader();
+                    })));
+
   PipelineType pipeline_type = PipelineType::kGraphics;
+  std::vector<std::future<Result>> validations;
   for (const auto& node : script->Nodes()) {
     if (!node->IsShader())
       continue;
 
     const auto shader = node->AsShader();
+    shader_stats_.push_back(shader->GetStats());
+    if (async_shader_validation_) {
+      const std::vector<uint32_t>* data = &shader->GetData();
+      double* validate_ms = &shader_stats_.back().validate_ms;
+      validations.push_back(
+          std::async(std::launch::async, [data, validate_ms]() {
+            ShaderCompiler sc;
+            Result r = sc.Validate(*data);
+            *validate_ms = sc.GetStats().validate_ms;
+            return r;
+          }));
+    }
+
+    auto start = std::chrono::steady_clock::now();
     Result r = engine->SetShader(shader->GetShaderType(), shader->GetData());
     if (!r.IsSuccess())
       return r;
 
+    shader_stats_.back().shader_module_ms = MillisecondsSince(start);
+
     if (shader->GetShaderType() == ShaderType::kCompute)
       pipeline_type = PipelineType::kCompute;
   }
 
+  // The driver consumes the SPIR-V at pipeline creation, so every shader must
+  // have passed validation before we get there.
+  for (auto& validation : validations) {
+    Result r = validation.get();
+    if (!r.IsSuccess())
+      return r;
+  }
+
   // TODO(jaebaek): Support multiple pipelines.
   Result r = engine->CreatePipeline(pipeline_type);
   if (!r.IsSuccess())
@@ -107,6 +146,7 @@ Result Executor::Execute(Engine* engine, const amber::Script* src_script) {
   }
 
   // Process Test nodes
+  content_hashes_.clear();
   for (const auto& node : script->Nodes()) {
     if (!node->IsTest())
       continue;
@@ -134,19 +174,32 @@ Result Executor::Execute(Engine* engine, const amber::Script* src_script) {
         r = engine->DoProbe(cmd->AsProbe());
       } else if (cmd->IsProbeSSBO()) {
         r = engine->DoProbeSSBO(cmd->AsProbeSSBO());
+      } else if (cmd->IsProbeHash()) {
+        r = ProbeHash(engine, cmd->AsProbeHash());
+      } else if (cmd->IsProbeImage()) {
+        r = ProbeImage(engine, cmd->AsProbeImage());
       } else if (cmd->IsBuffer()) {
         r = engine->DoBuffer(cmd->AsBuffer());
       } else if (cmd->IsTolerance()) {
         r = engine->DoTolerance(cmd->AsTolerance());
       } else {
-        return Result("Unknown command type");
+        r = Result("Unknown command type");
       }
 
       if (!r.IsSuccess())
-        return r;
+        break;
     }
+    if (!r.IsSuccess())
+      break;
   }
-  return {};
+
+  // The engine creates the driver pipeline at the first draw or dispatch, so
+  // its creation time is only known once the commands have run.
+  const double pipeline_ms = engine->GetPipelineCreationMs();
+  for (auto& stats : shader_stats_)
+    stats.pipeline_creation_ms = pipeline_ms;
+
+  return r;
 }
 
 }  // namespace vkscript
@@ -13,15 +13,41 @@
 // limitations under the License.
 
 #include "src/vkscript/executor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
 #include "gtest/gtest.h"
 #include "src/engine.h"
 #include "src/make_unique.h"
+#include "src/reference_image.h"
+#include "src/shader_data.h"
 #include "src/vkscript/parser.h"
 
 namespace amber {
 namespace vkscript {
 namespace {
 
+// Returns a temp directory path with a per-run suffix.
+std::string UniqueTempPath(const std::string& name,
+                           const std::string& extension) {
+  return testing::TempDir() + name + "_" +
+         std::to_string(
+             std::chrono::steady_clock::now().time_since_epoch().count()) +
+         extension;
+}
+
+// Deletes |path| on scope exit, including early ASSERT returns.
+class ScopedFileRemover {
+ public:
+  explicit ScopedFileRemover(const std::string& path) : path_(path) {}
+  ~ScopedFileRemover() { remove(path_.c_str()); }
+
+ private:
+  std::string path_;
+};
+
 class EngineStub : public Engine {
  public:
   struct Require {
@@ -35,6 +61,10 @@ class EngineStub : public Engine {
   ~EngineStub() override = default;
 
   // Engine
+  void SetPipelineCacheOptions(const std::string&, bool) override {}
+  void SetProbeOnDevice(bool) override {}
+  void SetPixelProbeOptions(bool, uint32_t) override {}
+  void SetRetainShaderModules(bool) override {}
   Result Initialize() override { return {}; }
 
   Result InitializeWithDevice(void*) override { return {}; }
@@ -51,6 +81,7 @@ class EngineStub : public Engine {
     return {};
   }
   Result CreatePipeline(PipelineType) override { return {}; }
+  Result ResetPipeline() override { return {}; }
 
   void FailShaderCommand() { fail_shader_command_ = true; }
   const std::vector<ShaderType>& GetShaderTypesSeen() const {
@@ -63,6 +94,11 @@ class EngineStub : public Engine {
     shaders_seen_.push_back(type);
     return {};
   }
+  Result SetShaderSpecialization(
+      ShaderType,
+      const std::map<uint32_t, uint32_t>&) override {
+    return {};
+  }
 
   uint8_t GetBufferCallCount() const { return buffer_call_count_; }
   BufferType GetBufferType(size_t idx) const { return buffer_types_[idx]; }
@@ -82,6 +118,9 @@ class EngineStub : public Engine {
     buffer_values_.push_back(data);
     return {};
   }
+  Result SetBufferData(BufferType, uint8_t, const BufferView&) override {
+    return {};
+  }
 
   void FailClearColorCommand() { fail_clear_color_command_ = true; }
   bool DidClearColorCommand() { return did_clear_color_command_ = true; }
@@ -199,6 +238,18 @@ class EngineStub : public Engine {
     return {};
   }
 
+  void SetProbeHash(uint64_t hash) { probe_hash_ = hash; }
+  Result DoProbeHash(const ProbeHashCommand*, uint64_t* hash) override {
+    *hash = probe_hash_;
+    return {};
+  }
+
+  void SetColorAttachment(const Rgba8Image& image) { color_ = image; }
+  Result ReadColorAttachment(Rgba8Image* image) override {
+    *image = color_;
+    return {};
+  }
+
   void FailBufferCommand() { fail_buffer_command_ = true; }
   bool DidBufferCommand() const { return did_buffer_command_; }
   Result DoBuffer(const BufferCommand*) override {
@@ -219,7 +270,14 @@ class EngineStub : public Engine {
     return {};
   }
 
+  ShaderModuleCacheStats GetShaderModuleCacheStats() override { return {}; }
+  PipelineCacheStats GetPipelineCacheStats() override { return {}; }
+  void SetPipelineCreationMs(double ms) { pipeline_creation_ms_ = ms; }
+  double GetPipelineCreationMs() override { return pipeline_creation_ms_; }
+  DeviceMemoryStats GetDeviceMemoryStats() override { return {}; }
+
  private:
+  double pipeline_creation_ms_ = 0.0;
   bool fail_requirements_ = false;
   bool fail_shader_command_ = false;
   bool fail_clear_command_ = false;
@@ -233,6 +291,8 @@ class EngineStub : public Engine {
   bool fail_patch_command_ = false;
   bool fail_probe_command_ = false;
   bool fail_probe_ssbo_command_ = false;
+  uint64_t probe_hash_ = 0;
+  Rgba8Image color_;
   bool fail_buffer_command_ = false;
   bool fail_tolerance_command_ = false;
 
@@ -268,6 +328,10 @@ class EngineCountingStub : public Engine {
   ~EngineCountingStub() override = default;
 
   // Engine
+  void SetPipelineCacheOptions(const std::string&, bool) override {}
+  void SetProbeOnDevice(bool) override {}
+  void SetPixelProbeOptions(bool, uint32_t) override {}
+  void SetRetainShaderModules(bool) override {}
   Result Initialize() override { return {}; }
 
   Result InitializeWithDevice(void*) override { return {}; }
@@ -282,6 +346,7 @@ class EngineCountingStub : public Engine {
     return {};
   }
   Result CreatePipeline(PipelineType) override { return {}; }
+  Result ResetPipeline() override { return {}; }
 
   int32_t GetShaderStageIdx() const { return shader_stage_; }
   uint32_t GetShaderCount() const { return shader_stage_count_; }
@@ -290,12 +355,20 @@ class EngineCountingStub : public Engine {
     shader_stage_ = stage_count_++;
     return {};
   }
+  Result SetShaderSpecialization(
+      ShaderType,
+      const std::map<uint32_t, uint32_t>&) override {
+    return {};
+  }
   Result SetBuffer(BufferType,
                    uint8_t,
                    const Format&,
                    const std::vector<Value>&) override {
     return {};
   }
+  Result SetBufferData(BufferType, uint8_t, const BufferView&) override {
+    return {};
+  }
 
   Result DoClearColor(const ClearColorCommand*) override { return {}; }
   Result DoClearStencil(const ClearStencilCommand*) override { return {}; }
@@ -311,9 +384,18 @@ class EngineCountingStub : public Engine {
   }
   Result DoProbe(const ProbeCommand*) override { return {}; }
   Result DoProbeSSBO(const ProbeSSBOCommand*) override { return {}; }
+  Result DoProbeHash(const ProbeHashCommand*, uint64_t*) override {
+    return {};
+  }
+  Result ReadColorAttachment(Rgba8Image*) override { return {}; }
   Result DoBuffer(const BufferCommand*) override { return {}; }
   Result DoTolerance(const ToleranceCommand*) override { return {}; }
 
+  ShaderModuleCacheStats GetShaderModuleCacheStats() override { return {}; }
+  PipelineCacheStats GetPipelineCacheStats() override { return {}; }
+  double GetPipelineCreationMs() override { return 0.0; }
+  DeviceMemoryStats GetDeviceMemoryStats() override { return {}; }
+
  private:
   int32_t stage_count_ = 0;
   int32_t require_stage_ = -1;
@@ -452,6 +534,59 @@ void main() {}
   EXPECT_EQ(ShaderType::kFragment, shader_types[1]);
 }
 
+TEST_F(VkScriptExecutorTest, RecordsShaderStats) {
+  std::string input = R"(
+[vertex shader passthrough]
+[fragment shader]
+#version 430
+void main() {}
+)";
+
+  Parser parser;
+  ASSERT_TRUE(parser.Parse(input).IsSuccess());
+
+  auto engine = MakeEngine();
+
+  Executor ex;
+  Result r = ex.Execute(engine.get(), parser.GetScript());
+  ASSERT_TRUE(r.IsSuccess());
+
+  const auto& stats = ex.GetShaderStats();
+  ASSERT_EQ(2U, stats.size());
+  EXPECT_EQ("vertex shader", stats[0].name);
+  EXPECT_EQ(std::string(kPassThroughShader).size(), stats[0].source_size);
+  EXPECT_NE(0U, stats[0].spirv_words);
+  EXPECT_EQ("fragment shader", stats[1].name);
+  EXPECT_EQ(std::string("#version 430\nvoid main() {}\n").size(),
+            stats[1].source_size);
+  EXPECT_NE(0U, stats[1].spirv_words);
+}
+
+TEST_F(VkScriptExecutorTest, RecordsPipelineCreationTime) {
+  std::string input = R"(
+[vertex shader passthrough]
+[test]
+clear
+)";
+
+  Parser parser;
+  ASSERT_TRUE(parser.Parse(input).IsSuccess());
+
+  // The engine reports the time once the commands have run, including when
+  // one of them fails.
+  auto engine = MakeEngine();
+  ToStub(engine.get())->SetPipelineCreationMs(2.5);
+  ToStub(engine.get())->FailClearCommand();
+
+  Executor ex;
+  Result r = ex.Execute(engine.get(), parser.GetScript());
+  ASSERT_FALSE(r.IsSuccess());
+
+  const auto& stats = ex.GetShaderStats();
+  ASSERT_EQ(1U, stats.size());
+  EXPECT_EQ(2.5, stats[0].pipeline_creation_ms);
+}
+
 TEST_F(VkScriptExecutorTest, ShaderFailure) {
   std::string input = R"(
 [vertex shader passthrough]
@@ -910,6 +1045,140 @@ probe ssbo vec3 0 2 <= 2 3 4)";
   EXPECT_EQ("probe ssbo command failed", r.Error());
 }
 
+TEST_F(VkScriptExecutorTest, ProbeHashCommand) {
+  std::string input = R"(
+[test]
+probe hash ssbo 1:2 xxh64 0x1234)";
+
+  Parser parser;
+  ASSERT_TRUE(parser.Parse(input).IsSuccess());
+
+  auto engine = MakeEngine();
+  ToStub(engine.get())->SetProbeHash(0x1234);
+
+  Executor ex;
+  Result r = ex.Execute(engine.get(), parser.GetScript());
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  const auto& hashes = ex.GetContentHashes();
+  ASSERT_EQ(1U, hashes.size());
+  EXPECT_EQ("ssbo 1:2", hashes[0].target);
+  EXPECT_EQ("xxh64", hashes[0].algorithm);
+  EXPECT_EQ(0x1234U, hashes[0].hash);
+  EXPECT_EQ(0x1234U, hashes[0].expected_hash);
+}
+
+TEST_F(VkScriptExecutorTest, ProbeHashCommandFailure) {
+  std::string input = R"(
+[test]
+probe hash xxh64 0x1234)";
+
+  Parser parser;
+  ASSERT_TRUE(parser.Parse(input).IsSuccess());
+
+  auto engine = MakeEngine();
+  ToStub(engine.get())->SetProbeHash(0xabcd);
+
+  Executor ex;
+  Result r = ex.Execute(engine.get(), parser.GetScript());
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ(
+      "Probe hash failed for color attachment\n"
+      "  Expected xxh64: 0x0000000000001234\n"
+      "  Actual xxh64: 0x000000000000abcd",
+      r.Error());
+}
+
+TEST_F(VkScriptExecutorTest, ProbeHashCommandRecord) {
+  std::string input = R"(
+[test]
+probe hash xxh64 0x1234
+probe hash xxh64 0x5678)";
+
+  Parser parser;
+  ASSERT_TRUE(parser.Parse(input).IsSuccess());
+
+  auto engine = MakeEngine();
+  ToStub(engine.get())->SetProbeHash(0xabcd);
+
+  Executor ex;
+  ex.SetRecordContentHashes(true);
+  Result r = ex.Execute(engine.get(), parser.GetScript());
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  const auto& hashes = ex.GetContentHashes();
+  ASSERT_EQ(2U, hashes.size());
+  EXPECT_EQ("", hashes[0].target);
+  EXPECT_EQ(0xabcdU, hashes[0].hash);
+  EXPECT_EQ(0x1234U, hashes[0].expected_hash);
+  EXPECT_EQ(0xabcdU, hashes[1].hash);
+  EXPECT_EQ(0x5678U, hashes[1].expected_hash);
+}
+
+TEST_F(VkScriptExecutorTest, ProbeImageCommand) {
+  Rgba8Image color;
+  color.width = 2;
+  color.height = 1;
+  color.texels = {10, 20, 30, 255, 40, 50, 60, 255};
+
+  const std::string reference = UniqueTempPath("amber_executor", ".ppm");
+  ScopedFileRemover reference_remover(reference);
+  Rgba8Image expected = color;
+  expected.texels[5] = 53;
+  ASSERT_TRUE(WritePpmImage(reference, expected).IsSuccess());
+
+  const std::string diff = UniqueTempPath("amber_executor_diff", ".ppm");
+  ScopedFileRemover diff_remover(diff);
+  Parser parser;
+  ASSERT_TRUE(parser
+                  .Parse("[test]\nprobe image " + reference +
+                         " max_error 3 diff " + diff)
+                  .IsSuccess());
+
+  auto engine = MakeEngine();
+  ToStub(engine.get())->SetColorAttachment(color);
+
+  Executor ex;
+  Result r = ex.Execute(engine.get(), parser.GetScript());
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  Rgba8Image diff_image;
+  r = LoadReferenceImage(diff, 2, 1, &diff_image);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(std::vector<uint8_t>({0, 0, 0, 255, 0, 3, 0, 255}),
+            diff_image.texels);
+}
+
+TEST_F(VkScriptExecutorTest, ProbeImageCommandFailure) {
+  Rgba8Image color;
+  color.width = 2;
+  color.height = 1;
+  color.texels = {10, 20, 30, 255, 40, 50, 60, 255};
+
+  const std::string reference = UniqueTempPath("amber_executor", ".ppm");
+  ScopedFileRemover reference_remover(reference);
+  Rgba8Image expected = color;
+  expected.texels[5] = 54;
+  ASSERT_TRUE(WritePpmImage(reference, expected).IsSuccess());
+
+  Parser parser;
+  ASSERT_TRUE(parser.Parse("[test]\nprobe image " + reference + " max_error 3")
+                  .IsSuccess());
+
+  auto engine = MakeEngine();
+  ToStub(engine.get())->SetColorAttachment(color);
+
+  Executor ex;
+  Result r = ex.Execute(engine.get(), parser.GetScript());
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Probe image failed for " + reference +
+                " in 1 texels\n"
+                "  Max error: 0, 4, 0 (allowed 3)\n"
+                "  RMSE: 0.000000, 2.828427, 0.000000 (allowed 255.000000)\n"
+                "  PSNR: inf, 39.099904, inf (required 0.000000)",
+            r.Error());
+}
+
 TEST_F(VkScriptExecutorTest, VertexData) {
   std::string input = R"(
 [vertex data]
@@ -43,8 +43,13 @@ VertexDataNode* Node::AsVertexData() {
   return static_cast<VertexDataNode*>(this);
 }
 
-ShaderNode::ShaderNode(ShaderType type, std::vector<uint32_t> shader)
-    : Node(NodeType::kShader), type_(type), shader_(std::move(shader)) {}
+ShaderNode::ShaderNode(ShaderType type,
+                       std::vector<uint32_t> shader,
+                       const ShaderStats& stats)
+    : Node(NodeType::kShader),
+      type_(type),
+      shader_(std::move(shader)),
+      stats_(stats) {}
 
 ShaderNode::~ShaderNode() = default;
 
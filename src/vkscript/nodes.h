@@ -19,6 +19,7 @@
 #include <memory>
 #include <vector>
 
+#include "amber/result.h"
 #include "src/command.h"
 #include "src/feature.h"
 #include "src/format.h"
@@ -59,15 +60,20 @@ class Node {
 
 class ShaderNode : public Node {
  public:
-  ShaderNode(ShaderType type, std::vector<uint32_t> shader);
+  ShaderNode(ShaderType type,
+             std::vector<uint32_t> shader,
+             const ShaderStats& stats);
   ~ShaderNode() override;
 
   ShaderType GetShaderType() const { return type_; }
   const std::vector<uint32_t>& GetData() const { return shader_; }
+  // The statistics recorded while compiling the shader.
+  const ShaderStats& GetStats() const { return stats_; }
 
  private:
   ShaderType type_;
   std::vector<uint32_t> shader_;
+  ShaderStats stats_;
 };
 
 class RequireNode : public Node {
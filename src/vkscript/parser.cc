@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <cassert>
 #include <limits>
+#include <string>
 
 #include "src/shader_compiler.h"
 #include "src/tokenizer.h"
@@ -146,6 +147,25 @@ Feature NameToFeature(const std::string& name) {
   return Feature::kUnknown;
 }
 
+// Names the shader after its section, as vkscript shaders are unnamed.
+std::string ShaderTypeToSectionName(ShaderType type) {
+  switch (type) {
+    case ShaderType::kCompute:
+      return "compute shader";
+    case ShaderType::kGeometry:
+      return "geometry shader";
+    case ShaderType::kFragment:
+      return "fragment shader";
+    case ShaderType::kVertex:
+      return "vertex shader";
+    case ShaderType::kTessellationControl:
+      return "tessellation control shader";
+    case ShaderType::kTessellationEvaluation:
+      return "tessellation evaluation shader";
+  }
+  return "shader";
+}
+
 }  // namespace
 
 Parser::Parser() : amber::Parser() {}
@@ -188,6 +208,8 @@ Result Parser::ProcessSection(const SectionParser::Section& section) {
 
 Result Parser::ProcessShaderBlock(const SectionParser::Section& section) {
   ShaderCompiler sc;
+  sc.SetSkipValidation(skip_shader_validation_);
+  sc.SetIncludePaths(shader_include_paths_);
 
   assert(SectionParser::HasShader(section.section_type));
 
@@ -198,7 +220,9 @@ Result Parser::ProcessShaderBlock(const SectionParser::Section& section) {
   if (!r.IsSuccess())
     return r;
 
-  script_.AddShader(section.shader_type, std::move(shader));
+  ShaderStats stats = sc.GetStats();
+  stats.name = ShaderTypeToSectionName(section.shader_type);
+  script_.AddShader(section.shader_type, std::move(shader), stats);
 
   return {};
 }
@@ -34,8 +34,11 @@ void Script::AddRequireNode(std::unique_ptr<RequireNode> node) {
   test_nodes_.push_back(std::move(tn));
 }
 
-void Script::AddShader(ShaderType type, std::vector<uint32_t> shader) {
-  test_nodes_.push_back(MakeUnique<ShaderNode>(type, std::move(shader)));
+void Script::AddShader(ShaderType type,
+                       std::vector<uint32_t> shader,
+                       const ShaderStats& stats) {
+  test_nodes_.push_back(
+      MakeUnique<ShaderNode>(type, std::move(shader), stats));
 }
 
 void Script::AddIndices(const std::vector<uint16_t>& indices) {
@@ -18,6 +18,7 @@
 #include <memory>
 #include <vector>
 
+#include "amber/result.h"
 #include "src/command.h"
 #include "src/make_unique.h"
 #include "src/script.h"
@@ -36,7 +37,7 @@ class Script : public amber::Script {
   ~Script() override;
 
   void AddRequireNode(std::unique_ptr<RequireNode> node);
-  void AddShader(ShaderType, std::vector<uint32_t>);
+  void AddShader(ShaderType, std::vector<uint32_t>, const ShaderStats&);
   void AddIndices(const std::vector<uint16_t>& indices);
   void AddVertexData(std::unique_ptr<VertexDataNode> node);
   void SetTestCommands(std::vector<std::unique_ptr<Command>> commands);
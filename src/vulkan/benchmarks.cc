@@ -0,0 +1,217 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Timings of the host side probe, verify and upload paths. These are not run
+// by amber_unittests; build and run amber_benchmarks to print them.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/timer.h"
+#include "src/vkscript/format_parser.h"
+#include "src/vulkan/bit_copy.h"
+#include "src/vulkan/buffer_verifier.h"
+#include "src/vulkan/pixel_verifier.h"
+#include "src/vulkan/small_float.h"
+#include "src/vulkan/texel_packer.h"
+#include "src/vulkan/texel_unpacker.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+std::unique_ptr<Format> ParseFormat(const std::string& name) {
+  auto format = vkscript::FormatParser().Parse(name);
+  EXPECT_TRUE(format != nullptr) << name;
+  return format;
+}
+
+// Whole window probes of a 4096x4096 frame buffer.
+void BenchmarkPixelVerifier(uint32_t max_threads, bool early_exit) {
+  const uint32_t size = 4096;
+  const float red_rgba[4] = {1.0f, 0.0f, 0.0f, 1.0f};
+  const uint8_t red[4] = {255, 0, 0, 255};
+  std::vector<uint8_t> frame(size * size * 4);
+  for (size_t i = 0; i < frame.size(); i += 4)
+    memcpy(&frame[i], red, 4);
+  // A single failure at the very end, so early exit scans everything too.
+  frame[frame.size() - 2] = 10;
+
+  auto format = ParseFormat("R8G8B8A8_UNORM");
+  ASSERT_TRUE(format != nullptr);
+  TexelUnpacker rgba8;
+  Result r = rgba8.Initialize(*format);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  PixelVerifier verifier;
+  verifier.SetMaxThreads(max_threads);
+  verifier.SetEarlyExit(early_exit);
+  PixelVerifier::Mismatches mismatches;
+
+  const int kIterations = 10;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; ++i) {
+    r = verifier.Verify(rgba8, frame.data(), size * 4, size, size, red_rgba,
+                        true, &mismatches);
+    ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  }
+  printf("%s thread(s)%s: %.2f ms per probe\n",
+         max_threads == 0 ? "all" : std::to_string(max_threads).c_str(),
+         early_exit ? ", early exit" : "",
+         MillisecondsSince(start) / kIterations);
+  EXPECT_EQ(1U, mismatches.count);
+}
+
+// The per component BitCopy loop the packer replaces.
+void PackWithBitCopy(const Format& format,
+                     const std::vector<Value>& values,
+                     uint32_t count,
+                     uint8_t* dst,
+                     uint32_t stride) {
+  const Value* value = values.data();
+  for (uint32_t i = 0; i < count; ++i, dst += stride) {
+    if (format.GetPackSize()) {
+      BitCopy::CopyValueToBuffer(dst, *value++, 0, format.GetPackSize());
+      continue;
+    }
+
+    uint8_t bit_offset = 0;
+    for (const auto& component : format.GetComponents()) {
+      BitCopy::CopyValueToBuffer(dst, *value++, bit_offset,
+                                 component.num_bits);
+      bit_offset = static_cast<uint8_t>(bit_offset + component.num_bits);
+    }
+  }
+}
+
+void BenchmarkSmallFloat(const char* name,
+                         void (*bulk)(const float*, size_t, uint16_t*),
+                         uint16_t (*single)(float)) {
+  const size_t kCount = 16 * 1024 * 1024;
+  std::vector<float> src(kCount);
+  for (size_t i = 0; i < kCount; ++i)
+    src[i] = static_cast<float>(i % 100000) * 0.37f;
+  std::vector<uint16_t> dst(kCount);
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kCount; ++i)
+    dst[i] = single(src[i]);
+  const double single_ms = MillisecondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  bulk(src.data(), kCount, dst.data());
+  const double bulk_ms = MillisecondsSince(start);
+
+  printf("%s: %.0f M/s one at a time, %.0f M/s bulk\n", name,
+         kCount / single_ms / 1000.0, kCount / bulk_ms / 1000.0);
+}
+
+}  // namespace
+
+using Benchmark = testing::Test;
+
+TEST_F(Benchmark, PixelVerifierSingleThread) {
+  BenchmarkPixelVerifier(1, false);
+}
+
+TEST_F(Benchmark, PixelVerifierAllThreads) {
+  BenchmarkPixelVerifier(0, false);
+}
+
+TEST_F(Benchmark, PixelVerifierEarlyExit) {
+  BenchmarkPixelVerifier(0, true);
+}
+
+// Uploads of 10M vertices with a position and a color attribute, as
+// VertexBuffer lays them out.
+TEST_F(Benchmark, TexelPacker10MVertices) {
+  const uint32_t kVertices = 10 * 1000 * 1000;
+  auto position = ParseFormat("R32G32_SFLOAT");
+  auto color = ParseFormat("R8G8B8A8_UNORM");
+  ASSERT_TRUE(position != nullptr && color != nullptr);
+
+  std::vector<Value> positions(kVertices * 2);
+  for (uint32_t i = 0; i < positions.size(); ++i)
+    positions[i].SetDoubleValue(1.5 + i * 0.375 - (i % 3) * 4.0);
+  std::vector<Value> colors(kVertices * 4);
+  for (uint32_t i = 0; i < colors.size(); ++i)
+    colors[i].SetIntValue(i);
+  const uint32_t stride = position->GetByteSize() + color->GetByteSize();
+
+  std::vector<uint8_t> expected(static_cast<size_t>(stride) * kVertices);
+  auto start = std::chrono::steady_clock::now();
+  PackWithBitCopy(*position, positions, kVertices, expected.data(), stride);
+  PackWithBitCopy(*color, colors, kVertices,
+                  expected.data() + position->GetByteSize(), stride);
+  printf("BitCopy per component: %.1f ms\n", MillisecondsSince(start));
+
+  std::vector<uint8_t> actual(expected.size());
+  start = std::chrono::steady_clock::now();
+  TexelPacker packer;
+  Result r = packer.Initialize(*position);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  packer.Pack(positions.data(), kVertices, actual.data(), stride);
+  r = packer.Initialize(*color);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  packer.Pack(colors.data(), kVertices, actual.data() + position->GetByteSize(),
+              stride);
+  printf("TexelPacker: %.1f ms\n", MillisecondsSince(start));
+
+  EXPECT_TRUE(expected == actual);
+}
+
+TEST_F(Benchmark, SmallFloatThroughput) {
+  BenchmarkSmallFloat("half", FloatsToHalfs, FloatToHalf);
+  BenchmarkSmallFloat("ufloat11", FloatsToUFloat11s, FloatToUFloat11);
+  BenchmarkSmallFloat("ufloat10", FloatsToUFloat10s, FloatToUFloat10);
+}
+
+// A 64 MB buffer of floats.
+TEST_F(Benchmark, BufferVerifier16MFloats) {
+  const size_t kCount = 16 * 1024 * 1024;
+  std::vector<float> actual(kCount);
+  std::vector<Value> expected(kCount);
+  for (size_t i = 0; i < kCount; ++i) {
+    actual[i] = static_cast<float>(i % 1000) * 0.25f;
+    expected[i].SetDoubleValue(static_cast<double>(actual[i]));
+  }
+  std::vector<uint8_t> bytes(kCount * sizeof(float));
+  memcpy(bytes.data(), actual.data(), bytes.size());
+
+  ProbeSSBOCommand command;
+  DatumType datum_type;
+  datum_type.SetType(DataType::kFloat);
+  command.SetDatumType(datum_type);
+  command.SetValues(std::move(expected));
+  BufferVerifier verifier;
+
+  using Comparator = ProbeSSBOCommand::Comparator;
+  for (const auto comparator : {Comparator::kEqual, Comparator::kFuzzyEqual,
+                                Comparator::kLessOrEqual}) {
+    command.SetComparator(comparator);
+    auto start = std::chrono::steady_clock::now();
+    Result r = verifier.Verify(&command, bytes.data());
+    printf("Comparator %d: %.1f ms\n", static_cast<int>(comparator),
+           MillisecondsSince(start));
+    EXPECT_TRUE(r.IsSuccess()) << r.Error();
+  }
+}
+
+}  // namespace vulkan
+}  // namespace amber
@@ -17,6 +17,8 @@
 #include <cassert>
 #include <cstring>
 
+#include "src/vulkan/small_float.h"
+
 namespace amber {
 namespace vulkan {
 
@@ -113,54 +115,20 @@ void BitCopy::CopyBits(uint8_t* dst,
   }
 }
 
-// static
-uint16_t BitCopy::FloatExponent(const uint32_t hex_float) {
-  uint32_t exponent = ((hex_float >> 23U) & ((1U << 8U) - 1U)) - 127U + 15U;
-  const uint32_t half_exponent_mask = (1U << 5U) - 1U;
-  assert((exponent & ~half_exponent_mask) == 0U);
-  return static_cast<uint16_t>(exponent & half_exponent_mask);
-}
-
 // static
 uint16_t BitCopy::FloatToHexFloat(float value, uint8_t bits) {
   switch (bits) {
     case 10:
-      return FloatToHexFloat10(value);
+      return FloatToUFloat10(value);
     case 11:
-      return FloatToHexFloat11(value);
+      return FloatToUFloat11(value);
     case 16:
-      return FloatToHexFloat16(value);
+      return FloatToHalf(value);
   }
 
   assert(false && "Invalid bits");
   return 0;
 }
 
-// static
-uint16_t BitCopy::FloatToHexFloat16(const float value) {
-  uint32_t hex;
-  memcpy(&hex, &value, sizeof(float));
-  return static_cast<uint16_t>(FloatSign(hex) << 15U) |
-         static_cast<uint16_t>(FloatExponent(hex) << 10U) | FloatMantissa(hex);
-}
-
-// static
-uint16_t BitCopy::FloatToHexFloat11(const float value) {
-  uint32_t hex;
-  memcpy(&hex, &value, sizeof(float));
-  assert(FloatSign(hex) == 0);
-  return static_cast<uint16_t>(FloatExponent(hex) << 6U) |
-         static_cast<uint16_t>(FloatMantissa(hex) >> 4U);
-}
-
-// static
-uint16_t BitCopy::FloatToHexFloat10(const float value) {
-  uint32_t hex;
-  memcpy(&hex, &value, sizeof(float));
-  assert(FloatSign(hex) == 0);
-  return static_cast<uint16_t>(FloatExponent(hex) << 5U) |
-         static_cast<uint16_t>(FloatMantissa(hex) >> 5U);
-}
-
 }  // namespace vulkan
 }  // namespace amber
@@ -28,20 +28,6 @@ class BitCopy {
                                 uint8_t bit_offset,
                                 uint8_t bits);
 
- private:
-  BitCopy() = delete;
-
-  ~BitCopy() = delete;
-
-  static void ShiftBufferBits(uint8_t* buffer,
-                              uint8_t length_bytes,
-                              uint8_t shift_bits);
-
-  static void CopyBits(uint8_t* dst,
-                       const uint8_t* src,
-                       uint8_t bit_offset,
-                       uint8_t bits);
-
   // Convert float to small float format.
   // See https://www.khronos.org/opengl/wiki/Small_Float_Formats
   // and https://en.wikipedia.org/wiki/IEEE_754.
@@ -53,7 +39,8 @@ class BitCopy {
   // 32    1        8       23           127
   // 64    1       11       52          1023
   //
-  // 11 and 10 bits floats are always positive.
+  // 11 and 10 bits floats are always positive, negative values become 0.
+  // Values are rounded to nearest even, see small_float.h.
   // 14 bits float is used only RGB9_E5 format but it does not exist in Vulkan.
   //
   // For example, 1234 in 32 bits float = 1.0011010010 * 2^10 with base 2.
@@ -61,19 +48,20 @@ class BitCopy {
   // 1.0011010010 * 2^10 --> 0 (sign) / 10 + 127 (exp) / 0011010010 (Mantissa)
   //                     --> 0x449a4000
   static uint16_t FloatToHexFloat(float value, uint8_t bits);
-  static uint16_t FloatToHexFloat16(const float value);
-  static uint16_t FloatToHexFloat11(const float value);
-  static uint16_t FloatToHexFloat10(const float value);
 
-  static uint16_t FloatSign(const uint32_t hex_float) {
-    return static_cast<uint16_t>(hex_float >> 31U);
-  }
+ private:
+  BitCopy() = delete;
+
+  ~BitCopy() = delete;
 
-  static uint16_t FloatExponent(const uint32_t hex_float);
+  static void ShiftBufferBits(uint8_t* buffer,
+                              uint8_t length_bytes,
+                              uint8_t shift_bits);
 
-  static uint16_t FloatMantissa(const uint32_t hex_float) {
-    return static_cast<uint16_t>((hex_float & ((1U << 23U) - 1U)) >> 13U);
-  }
+  static void CopyBits(uint8_t* dst,
+                       const uint8_t* src,
+                       uint8_t bit_offset,
+                       uint8_t bits);
 };
 
 }  // namespace vulkan
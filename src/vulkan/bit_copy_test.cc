@@ -279,30 +279,30 @@ TEST_F(BitCopyTest, CopyFloat16) {
 
   // 16 bits
   //         Sig / Exp / Mantissa     Sig / Exp / Mantissa
-  // 12.34 =   0 / 130 /  4550820 -->   0 /  18 /      555
+  // 12.34 =   0 / 130 /  4550820 -->   0 /  18 /      556
   value.SetDoubleValue(12.34);
   data[0] = 0;
   data[1] = 0;
   BitCopy::CopyValueToBuffer(data, value, 0, 16);
-  ExpectBitsEQ<uint16_t>(data, 18987);
+  ExpectBitsEQ<uint16_t>(data, 18988);
 
   // 11 bits
   //         Sig / Exp / Mantissa     Sig / Exp / Mantissa
-  // 5.67 =    0 / 129 /  3502244 -->        17 /       26
+  // 5.67 =    0 / 129 /  3502244 -->        17 /       27
   value.SetDoubleValue(5.67);
   data[0] = 0;
   data[1] = 0;
   BitCopy::CopyValueToBuffer(data, value, 3, 11);
-  ExpectBitsEQ<uint16_t>(data, 8912);
+  ExpectBitsEQ<uint16_t>(data, 8920);
 
   // 10 bits
   //         Sig / Exp / Mantissa     Sig / Exp / Mantissa
-  // 0.89 =    0 / 126 /  6543114 -->        14 /       24
+  // 0.89 =    0 / 126 /  6543114 -->        14 /       25
   value.SetDoubleValue(0.89);
   data[0] = 0;
   data[1] = 0;
   BitCopy::CopyValueToBuffer(data, value, 2, 10);
-  ExpectBitsEQ<uint16_t>(data, 1888);
+  ExpectBitsEQ<uint16_t>(data, 1892);
 }
 
 TEST_F(BitCopyTest, CopyFloat) {
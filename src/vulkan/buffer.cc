@@ -14,13 +14,16 @@
 
 #include "src/vulkan/buffer.h"
 
+#include <cstring>
+
 namespace amber {
 namespace vulkan {
 
 Buffer::Buffer(VkDevice device,
                size_t size,
-               const VkPhysicalDeviceMemoryProperties& properties)
-    : Resource(device, size, properties) {}
+               MemoryAllocator* allocator,
+               StagingRing* staging_ring)
+    : Resource(device, size, allocator), staging_ring_(staging_ring) {}
 
 Buffer::~Buffer() = default;
 
@@ -30,17 +33,29 @@ Result Buffer::Initialize(const VkBufferUsageFlags usage) {
     return r;
 
   AllocateResult allocate_result = AllocateAndBindMemoryToVkBuffer(
-      buffer_, &memory_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+      buffer_, &allocation_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
   if (!allocate_result.r.IsSuccess())
     return allocate_result.r;
 
   if (CheckMemoryHostAccessible(allocate_result.memory_type_index)) {
     is_buffer_host_accessible_ = true;
-    return MapMemory(memory_);
+    return MapMemory(allocation_);
   }
 
   is_buffer_host_accessible_ = false;
-  return Resource::Initialize();
+  return {};
+}
+
+Result Buffer::MapForUpload() {
+  if (is_buffer_host_accessible_)
+    return {};
+
+  Result r = staging_ring_->Allocate(GetSize(), 1, &staging_region_);
+  if (!r.IsSuccess())
+    return r;
+
+  SetHostAccessibleMemoryPtr(staging_region_.ptr);
+  return {};
 }
 
 Result Buffer::CreateVkBufferView(VkFormat format) {
@@ -63,11 +78,71 @@ void Buffer::CopyToDevice(VkCommandBuffer command) {
     return;
 
   VkBufferCopy region = {};
-  region.srcOffset = 0;
+  region.srcOffset = staging_region_.offset;
   region.dstOffset = 0;
   region.size = GetSize();
 
-  vkCmdCopyBuffer(command, GetHostAccessibleBuffer(), buffer_, 1, &region);
+  vkCmdCopyBuffer(command, staging_region_.buffer, buffer_, 1, &region);
+}
+
+Result Buffer::CopyRangeToDevice(VkCommandBuffer command,
+                                 size_t offset,
+                                 size_t size,
+                                 const void* data) {
+  StagingRing::Region staging_region;
+  Result r = staging_ring_->Allocate(size, 4, &staging_region);
+  if (!r.IsSuccess())
+    return r;
+  std::memcpy(staging_region.ptr, data, size);
+
+  VkBufferCopy region = {};
+  region.srcOffset = staging_region.offset;
+  region.dstOffset = offset;
+  region.size = size;
+  vkCmdCopyBuffer(command, staging_region.buffer, buffer_, 1, &region);
+  return {};
+}
+
+Result Buffer::CopyToHost(VkCommandBuffer command,
+                          size_t offset,
+                          size_t size) {
+  VkBufferMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask =
+      VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = is_buffer_host_accessible_
+                              ? VK_ACCESS_HOST_READ_BIT
+                              : VK_ACCESS_TRANSFER_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = buffer_;
+  barrier.offset = offset;
+  barrier.size = size;
+  vkCmdPipelineBarrier(command, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       is_buffer_host_accessible_
+                           ? VK_PIPELINE_STAGE_HOST_BIT
+                           : VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+  if (is_buffer_host_accessible_) {
+    host_offset_ = 0;
+    return {};
+  }
+
+  StagingRing::Region staging_region;
+  Result r = staging_ring_->Allocate(size, 8, &staging_region);
+  if (!r.IsSuccess())
+    return r;
+  SetHostAccessibleMemoryPtr(staging_region.ptr);
+  host_offset_ = offset;
+
+  VkBufferCopy region = {};
+  region.srcOffset = offset;
+  region.dstOffset = staging_region.offset;
+  region.size = size;
+  vkCmdCopyBuffer(command, buffer_, staging_region.buffer, 1, &region);
+
+  return {};
 }
 
 void Buffer::Shutdown() {
@@ -83,10 +158,8 @@ void Buffer::Shutdown() {
     buffer_ = VK_NULL_HANDLE;
   }
 
-  if (memory_ != VK_NULL_HANDLE) {
-    vkFreeMemory(GetDevice(), memory_, nullptr);
-    memory_ = VK_NULL_HANDLE;
-  }
+  FreeMemory(&allocation_);
+  Resource::Shutdown();
 }
 
 }  // namespace vulkan
@@ -17,6 +17,7 @@
 
 #include "amber/result.h"
 #include "src/vulkan/resource.h"
+#include "src/vulkan/staging_ring.h"
 #include "vulkan/vulkan.h"
 
 namespace amber {
@@ -26,7 +27,8 @@ class Buffer : public Resource {
  public:
   Buffer(VkDevice device,
          size_t size,
-         const VkPhysicalDeviceMemoryProperties& properties);
+         MemoryAllocator* allocator,
+         StagingRing* staging_ring);
   ~Buffer() override;
 
   Result Initialize(const VkBufferUsageFlags usage);
@@ -34,24 +36,50 @@ class Buffer : public Resource {
   Result CreateVkBufferView(VkFormat format);
   VkBufferView GetVkBufferView() const { return view_; }
 
+  // Makes HostAccessibleMemoryPtr() point to memory the contents of the
+  // buffer are written to before CopyToDevice(). Buffers without host
+  // visible memory get a region of the staging ring.
+  Result MapForUpload();
+
   // TODO(jaebaek): Determine copy all or partial data
   void CopyToDevice(VkCommandBuffer command);
 
-  // Resource
-  VkDeviceMemory GetHostAccessMemory() const override {
-    if (is_buffer_host_accessible_)
-      return memory_;
+  // Records a copy of the |size| bytes at |data| to |offset| of the buffer.
+  // The bytes go through a region of the staging ring even when the buffer
+  // is host visible, so commands recorded before the copy still see the
+  // earlier contents.
+  Result CopyRangeToDevice(VkCommandBuffer command,
+                           size_t offset,
+                           size_t size,
+                           const void* data);
+
+  // Records a copy of the |size| bytes at |offset| of the buffer to the
+  // host, after the shader writes before it. Buffers without host visible
+  // memory are copied into a region of the staging ring, which holds the
+  // data until the ring is next allocated from.
+  Result CopyToHost(VkCommandBuffer command, size_t offset, size_t size);
 
-    return Resource::GetHostAccessMemory();
+  // Returns the host copy of the byte at |offset|, which must be inside the
+  // range last copied by CopyToHost().
+  const uint8_t* HostAccessibleBytePtr(size_t offset) const {
+    return static_cast<const uint8_t*>(HostAccessibleMemoryPtr()) + offset -
+           host_offset_;
   }
 
+  size_t GetSizeInBytes() const { return GetSize(); }
+
+  // Resource
   void Shutdown() override;
 
  private:
   VkBuffer buffer_ = VK_NULL_HANDLE;
   VkBufferView view_ = VK_NULL_HANDLE;
-  VkDeviceMemory memory_ = VK_NULL_HANDLE;
+  MemoryAllocator::Allocation allocation_;
   bool is_buffer_host_accessible_ = false;
+  StagingRing* staging_ring_ = nullptr;
+  StagingRing::Region staging_region_;
+  // Offset in the buffer of the host copy.
+  size_t host_offset_ = 0;
 };
 
 }  // namespace vulkan
@@ -0,0 +1,265 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/buffer_descriptor.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include "src/command.h"
+#include "src/make_unique.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+size_t SizeOfDataType(DataType type) {
+  switch (type) {
+    case DataType::kInt8:
+    case DataType::kUint8:
+      return 1;
+    case DataType::kInt16:
+    case DataType::kUint16:
+      return 2;
+    case DataType::kInt32:
+    case DataType::kUint32:
+    case DataType::kFloat:
+      return 4;
+    case DataType::kInt64:
+    case DataType::kUint64:
+    case DataType::kDouble:
+      return 8;
+  }
+  return 0;
+}
+
+template <typename T>
+void Store(T value, uint8_t* dst) {
+  std::memcpy(dst, &value, sizeof(T));
+}
+
+void StoreValue(const Value& value, DataType type, uint8_t* dst) {
+  switch (type) {
+    case DataType::kInt8:
+      Store(value.AsInt8(), dst);
+      break;
+    case DataType::kInt16:
+      Store(value.AsInt16(), dst);
+      break;
+    case DataType::kInt32:
+      Store(value.AsInt32(), dst);
+      break;
+    case DataType::kInt64:
+      Store(value.AsInt64(), dst);
+      break;
+    case DataType::kUint8:
+      Store(value.AsUint8(), dst);
+      break;
+    case DataType::kUint16:
+      Store(value.AsUint16(), dst);
+      break;
+    case DataType::kUint32:
+      Store(value.AsUint32(), dst);
+      break;
+    case DataType::kUint64:
+      Store(value.AsUint64(), dst);
+      break;
+    case DataType::kFloat:
+      Store(value.AsFloat(), dst);
+      break;
+    case DataType::kDouble:
+      Store(value.AsDouble(), dst);
+      break;
+  }
+}
+
+}  // namespace
+
+BufferDescriptor::BufferDescriptor(DescriptorType type,
+                                   uint32_t desc_set,
+                                   uint32_t binding)
+    : Descriptor(type, desc_set, binding) {}
+
+BufferDescriptor::~BufferDescriptor() = default;
+
+// static
+void BufferDescriptor::WriteValues(const BufferCommand* command,
+                                   std::vector<uint8_t>* data) {
+  const DataType type = command->GetDatumType().GetType();
+  const size_t value_size = SizeOfDataType(type);
+  const auto& values = command->GetValues();
+  const size_t offset = command->GetOffset();
+  const size_t end = offset + value_size * values.size();
+  if (end > data->size())
+    data->resize(end);
+
+  uint8_t* dst = data->data() + offset;
+  for (const auto& value : values) {
+    StoreValue(value, type, dst);
+    dst += value_size;
+  }
+}
+
+void BufferDescriptor::AddData(const BufferCommand* command) {
+  if (command->IsSSBO() && !command->IsSubdata()) {
+    Resize(command->GetSize());
+    return;
+  }
+
+  const size_t old_size = data_.size();
+  const size_t offset = command->GetOffset();
+  WriteValues(command, &data_);
+
+  // Bytes between the old end and the offset are uploaded as zeros.
+  const size_t end =
+      offset + SizeOfDataType(command->GetDatumType().GetType()) *
+                   command->GetValues().size();
+  AddDirtyRange(std::min(offset, old_size), end);
+}
+
+void BufferDescriptor::Resize(size_t size) {
+  const size_t old_size = data_.size();
+  data_.resize(size);
+  if (size > old_size) {
+    AddDirtyRange(old_size, size);
+    return;
+  }
+
+  auto it = dirty_ranges_.begin();
+  while (it != dirty_ranges_.end()) {
+    if (it->first >= size) {
+      it = dirty_ranges_.erase(it);
+      continue;
+    }
+    it->second = std::min(it->second, size);
+    ++it;
+  }
+}
+
+void BufferDescriptor::AddDirtyRange(size_t begin, size_t end) {
+  if (begin >= end)
+    return;
+
+  // Ranges which overlap or touch the new one are merged into it.
+  std::vector<std::pair<size_t, size_t>> ranges;
+  ranges.reserve(dirty_ranges_.size() + 1);
+  bool inserted = false;
+  for (const auto& range : dirty_ranges_) {
+    if (range.second < begin) {
+      ranges.push_back(range);
+    } else if (range.first > end) {
+      if (!inserted) {
+        ranges.emplace_back(begin, end);
+        inserted = true;
+      }
+      ranges.push_back(range);
+    } else {
+      begin = std::min(begin, range.first);
+      end = std::max(end, range.second);
+    }
+  }
+  if (!inserted)
+    ranges.emplace_back(begin, end);
+  dirty_ranges_.swap(ranges);
+}
+
+Result BufferDescriptor::CreateOrResizeBuffer(VkDevice device,
+                                              MemoryAllocator* allocator,
+                                              StagingRing* staging_ring,
+                                              CommandBuffer* command) {
+  if (data_.empty()) {
+    return Result("Vulkan::Buffer at descriptor set " +
+                  std::to_string(GetDescriptorSet()) + " binding " +
+                  std::to_string(GetBinding()) + " has no data");
+  }
+
+  const VkBufferUsageFlags usage =
+      (IsStorageBuffer() ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+                         : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) |
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  auto buffer =
+      MakeUnique<Buffer>(device, data_.size(), allocator, staging_ring);
+  Result r = buffer->Initialize(usage);
+  if (!r.IsSuccess())
+    return r;
+
+  // The copy from the buffer replaced by the last resize has completed.
+  if (old_buffer_) {
+    old_buffer_->Shutdown();
+    old_buffer_ = nullptr;
+  }
+
+  if (buffer_) {
+    r = command->BeginIfNotInRecording();
+    if (!r.IsSuccess())
+      return r;
+
+    // The shaders may have written the old buffer. The uploads after the
+    // copy write the new one, and the shaders and readbacks read it.
+    VkCommandBuffer cmd = command->GetCommandBuffer();
+    RecordMemoryBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                        VK_ACCESS_SHADER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        VK_ACCESS_TRANSFER_READ_BIT);
+
+    VkBufferCopy region = {};
+    region.size = std::min(buffer_->GetSizeInBytes(), data_.size());
+    vkCmdCopyBuffer(cmd, buffer_->GetVkBuffer(), buffer->GetVkBuffer(), 1,
+                    &region);
+
+    RecordMemoryBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        VK_ACCESS_TRANSFER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                        VK_ACCESS_TRANSFER_WRITE_BIT |
+                            VK_ACCESS_TRANSFER_READ_BIT |
+                            VK_ACCESS_UNIFORM_READ_BIT |
+                            VK_ACCESS_SHADER_READ_BIT |
+                            VK_ACCESS_SHADER_WRITE_BIT);
+    old_buffer_ = std::move(buffer_);
+  }
+
+  buffer_ = std::move(buffer);
+  return {};
+}
+
+Result BufferDescriptor::RecordUpload(VkCommandBuffer command) {
+  // Ranges are dropped once recorded, so an upload which fails when the
+  // staging ring is full can be continued in the next batch.
+  Result r;
+  size_t recorded = 0;
+  for (; recorded < dirty_ranges_.size(); ++recorded) {
+    const auto& range = dirty_ranges_[recorded];
+    r = buffer_->CopyRangeToDevice(command, range.first,
+                                   range.second - range.first,
+                                   data_.data() + range.first);
+    if (!r.IsSuccess())
+      break;
+  }
+  dirty_ranges_.erase(
+      dirty_ranges_.begin(),
+      dirty_ranges_.begin() + static_cast<std::ptrdiff_t>(recorded));
+  return r;
+}
+
+void BufferDescriptor::Shutdown() {
+  if (old_buffer_)
+    old_buffer_->Shutdown();
+  if (buffer_)
+    buffer_->Shutdown();
+}
+
+}  // namespace vulkan
+}  // namespace amber
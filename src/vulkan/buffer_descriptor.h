@@ -0,0 +1,100 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_VULKAN_BUFFER_DESCRIPTOR_H_
+#define SRC_VULKAN_BUFFER_DESCRIPTOR_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "amber/result.h"
+#include "src/vulkan/buffer.h"
+#include "src/vulkan/command.h"
+#include "src/vulkan/descriptor.h"
+#include "src/vulkan/memory_allocator.h"
+#include "src/vulkan/staging_ring.h"
+#include "vulkan/vulkan.h"
+
+namespace amber {
+
+class BufferCommand;
+
+namespace vulkan {
+
+// A storage or uniform buffer descriptor. The contents given by buffer
+// commands are kept on the host and only the ranges written since the last
+// upload are copied to the device, so data the shaders wrote elsewhere in
+// the buffer is kept.
+class BufferDescriptor : public Descriptor {
+ public:
+  BufferDescriptor(DescriptorType type, uint32_t desc_set, uint32_t binding);
+  ~BufferDescriptor();
+
+  // Writes the values of |command| at its offset into |data|, growing
+  // |data| when they end past it.
+  static void WriteValues(const BufferCommand* command,
+                          std::vector<uint8_t>* data);
+
+  // Sets the size of the buffer for ssbo size commands, and writes the
+  // values of the others.
+  void AddData(const BufferCommand* command);
+
+  const std::vector<uint8_t>& GetData() const { return data_; }
+
+  // The ranges of GetData() written since the last upload, as begin and end
+  // offsets in increasing order.
+  const std::vector<std::pair<size_t, size_t>>& GetDirtyRanges() const {
+    return dirty_ranges_;
+  }
+  bool HasPendingUpload() const { return !dirty_ranges_.empty(); }
+
+  // Whether the buffer is not created yet or has another size than the
+  // data.
+  bool NeedsBuffer() const {
+    return !buffer_ || buffer_->GetSizeInBytes() != data_.size();
+  }
+
+  // Creates the buffer for the size of the data. A buffer which is resized
+  // keeps its contents: a copy to the new buffer is recorded into
+  // |command|. The old buffer is destroyed by the next call, so the
+  // commands recorded before it must have completed by then.
+  Result CreateOrResizeBuffer(VkDevice device,
+                              MemoryAllocator* allocator,
+                              StagingRing* staging_ring,
+                              CommandBuffer* command);
+
+  // Records copies of the dirty ranges to the buffer. Ranges recorded before
+  // a failure are no longer dirty.
+  Result RecordUpload(VkCommandBuffer command);
+
+  Buffer* GetBuffer() const { return buffer_.get(); }
+
+  void Shutdown();
+
+ private:
+  void AddDirtyRange(size_t begin, size_t end);
+  void Resize(size_t size);
+
+  std::vector<uint8_t> data_;
+  std::vector<std::pair<size_t, size_t>> dirty_ranges_;
+  std::unique_ptr<Buffer> buffer_;
+  // The buffer replaced by the last resize, which the copy reads.
+  std::unique_ptr<Buffer> old_buffer_;
+};
+
+}  // namespace vulkan
+}  // namespace amber
+
+#endif  // SRC_VULKAN_BUFFER_DESCRIPTOR_H_
@@ -0,0 +1,147 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/buffer_descriptor.h"
+
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/command.h"
+#include "src/make_unique.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+using Ranges = std::vector<std::pair<size_t, size_t>>;
+
+std::unique_ptr<BufferCommand> SizeCommand(uint32_t size) {
+  auto command = MakeUnique<BufferCommand>(BufferCommand::BufferType::kSSBO);
+  command->SetSize(size);
+  return command;
+}
+
+std::unique_ptr<BufferCommand> FloatCommand(BufferCommand::BufferType type,
+                                            uint32_t offset,
+                                            const std::vector<float>& floats) {
+  auto command = MakeUnique<BufferCommand>(type);
+  if (type == BufferCommand::BufferType::kSSBO)
+    command->SetIsSubdata();
+  command->SetOffset(offset);
+
+  DatumType datum_type;
+  datum_type.SetType(DataType::kFloat);
+  command->SetDatumType(datum_type);
+
+  std::vector<Value> values(floats.size());
+  for (size_t i = 0; i < floats.size(); ++i)
+    values[i].SetDoubleValue(floats[i]);
+  command->SetValues(std::move(values));
+  return command;
+}
+
+std::unique_ptr<BufferCommand> SubdataCommand(uint32_t offset,
+                                              const std::vector<float>& f) {
+  return FloatCommand(BufferCommand::BufferType::kSSBO, offset, f);
+}
+
+}  // namespace
+
+using BufferDescriptorTest = testing::Test;
+
+TEST_F(BufferDescriptorTest, SizeCommand) {
+  BufferDescriptor descriptor(DescriptorType::kStorageBuffer, 0, 1);
+  descriptor.AddData(SizeCommand(16).get());
+
+  EXPECT_EQ(std::vector<uint8_t>(16, 0), descriptor.GetData());
+  EXPECT_EQ(Ranges({{0, 16}}), descriptor.GetDirtyRanges());
+  EXPECT_TRUE(descriptor.NeedsBuffer());
+}
+
+TEST_F(BufferDescriptorTest, SubdataWritesValues) {
+  BufferDescriptor descriptor(DescriptorType::kStorageBuffer, 0, 0);
+  descriptor.AddData(SizeCommand(16).get());
+  descriptor.AddData(SubdataCommand(4, {1.0f, 2.0f}).get());
+
+  const auto& data = descriptor.GetData();
+  ASSERT_EQ(16U, data.size());
+  float values[2];
+  std::memcpy(values, data.data() + 4, sizeof(values));
+  EXPECT_EQ(1.0f, values[0]);
+  EXPECT_EQ(2.0f, values[1]);
+  EXPECT_EQ(0, data[0]);
+  EXPECT_EQ(0, data[12]);
+}
+
+TEST_F(BufferDescriptorTest, DirtyRangesMerge) {
+  BufferDescriptor descriptor(DescriptorType::kStorageBuffer, 0, 0);
+  descriptor.AddData(SubdataCommand(0, {1.0f}).get());
+  descriptor.AddData(SubdataCommand(12, {1.0f}).get());
+  descriptor.AddData(SubdataCommand(24, {1.0f}).get());
+  EXPECT_EQ(Ranges({{0, 28}}), descriptor.GetDirtyRanges());
+
+  BufferDescriptor sized(DescriptorType::kStorageBuffer, 0, 0);
+  sized.AddData(SizeCommand(64).get());
+  // The uploads of the size command are still pending, so a new write is
+  // part of them.
+  sized.AddData(SubdataCommand(8, {1.0f}).get());
+  EXPECT_EQ(Ranges({{0, 64}}), sized.GetDirtyRanges());
+}
+
+TEST_F(BufferDescriptorTest, SubdataPastEndGrows) {
+  BufferDescriptor descriptor(DescriptorType::kUniformBuffer, 1, 2);
+  descriptor.AddData(
+      FloatCommand(BufferCommand::BufferType::kUniform, 8, {3.0f}).get());
+
+  // The bytes before the offset are uploaded as zeros.
+  EXPECT_EQ(12U, descriptor.GetData().size());
+  EXPECT_EQ(Ranges({{0, 12}}), descriptor.GetDirtyRanges());
+}
+
+TEST_F(BufferDescriptorTest, ShrinkClipsDirtyRanges) {
+  BufferDescriptor descriptor(DescriptorType::kStorageBuffer, 0, 0);
+  descriptor.AddData(SizeCommand(32).get());
+  descriptor.AddData(SizeCommand(8).get());
+  EXPECT_EQ(8U, descriptor.GetData().size());
+  EXPECT_EQ(Ranges({{0, 8}}), descriptor.GetDirtyRanges());
+}
+
+TEST_F(BufferDescriptorTest, WriteValuesPacksIntegers) {
+  BufferCommand command(BufferCommand::BufferType::kPushConstant);
+  command.SetOffset(2);
+
+  DatumType datum_type;
+  datum_type.SetType(DataType::kInt16);
+  command.SetDatumType(datum_type);
+
+  std::vector<Value> values(2);
+  values[0].SetIntValue(static_cast<uint64_t>(-2));
+  values[1].SetIntValue(300);
+  command.SetValues(std::move(values));
+
+  std::vector<uint8_t> data;
+  BufferDescriptor::WriteValues(&command, &data);
+  ASSERT_EQ(6U, data.size());
+
+  int16_t written[2];
+  std::memcpy(written, data.data() + 2, sizeof(written));
+  EXPECT_EQ(-2, written[0]);
+  EXPECT_EQ(300, written[1]);
+}
+
+}  // namespace vulkan
+}  // namespace amber
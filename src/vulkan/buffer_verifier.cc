@@ -0,0 +1,571 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/buffer_verifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+using Comparator = ProbeSSBOCommand::Comparator;
+
+const double kDefaultTolerance = 0.01;
+
+// Values compared before looking for the ones which failed.
+const size_t kBlockSize = 64;
+
+#if defined(__SSE2__)
+__m128i Not(__m128i mask) {
+  return _mm_xor_si128(mask, _mm_set1_epi32(-1));
+}
+#endif  // defined(__SSE2__)
+
+// A value |a| passes a comparator against |lo| and |hi|. Fuzzy equality
+// checks |a| is in [lo, hi], the others compare |a| with the expected value
+// in |lo|. Pass() does not branch, so loops of it vectorize. Pass4() does
+// the same for four 32 bit lanes and sets all bits of the lanes which pass.
+struct Equal {
+  static const char* Name() { return "=="; }
+  template <typename T>
+  static bool Pass(T a, T lo, T) {
+    return a == lo;
+  }
+#if defined(__SSE2__)
+  static __m128 Pass4(__m128 a, __m128 lo, __m128) {
+    return _mm_cmpeq_ps(a, lo);
+  }
+  static __m128i Pass4(__m128i a, __m128i lo, __m128i) {
+    return _mm_cmpeq_epi32(a, lo);
+  }
+#endif  // defined(__SSE2__)
+};
+
+struct NotEqual {
+  static const char* Name() { return "!="; }
+  template <typename T>
+  static bool Pass(T a, T lo, T) {
+    return a != lo;
+  }
+#if defined(__SSE2__)
+  static __m128 Pass4(__m128 a, __m128 lo, __m128) {
+    return _mm_cmpneq_ps(a, lo);
+  }
+  static __m128i Pass4(__m128i a, __m128i lo, __m128i) {
+    return Not(_mm_cmpeq_epi32(a, lo));
+  }
+#endif  // defined(__SSE2__)
+};
+
+struct FuzzyEqual {
+  static const char* Name() { return "~="; }
+  template <typename T>
+  static bool Pass(T a, T lo, T hi) {
+    return (a >= lo) & (a <= hi);
+  }
+#if defined(__SSE2__)
+  static __m128 Pass4(__m128 a, __m128 lo, __m128 hi) {
+    return _mm_and_ps(_mm_cmpge_ps(a, lo), _mm_cmple_ps(a, hi));
+  }
+  static __m128i Pass4(__m128i a, __m128i lo, __m128i hi) {
+    return Not(_mm_or_si128(_mm_cmplt_epi32(a, lo), _mm_cmpgt_epi32(a, hi)));
+  }
+#endif  // defined(__SSE2__)
+};
+
+struct Less {
+  static const char* Name() { return "<"; }
+  template <typename T>
+  static bool Pass(T a, T lo, T) {
+    return a < lo;
+  }
+#if defined(__SSE2__)
+  static __m128 Pass4(__m128 a, __m128 lo, __m128) {
+    return _mm_cmplt_ps(a, lo);
+  }
+  static __m128i Pass4(__m128i a, __m128i lo, __m128i) {
+    return _mm_cmplt_epi32(a, lo);
+  }
+#endif  // defined(__SSE2__)
+};
+
+struct LessOrEqual {
+  static const char* Name() { return "<="; }
+  template <typename T>
+  static bool Pass(T a, T lo, T) {
+    return a <= lo;
+  }
+#if defined(__SSE2__)
+  static __m128 Pass4(__m128 a, __m128 lo, __m128) {
+    return _mm_cmple_ps(a, lo);
+  }
+  static __m128i Pass4(__m128i a, __m128i lo, __m128i) {
+    return Not(_mm_cmpgt_epi32(a, lo));
+  }
+#endif  // defined(__SSE2__)
+};
+
+struct Greater {
+  static const char* Name() { return ">"; }
+  template <typename T>
+  static bool Pass(T a, T lo, T) {
+    return a > lo;
+  }
+#if defined(__SSE2__)
+  static __m128 Pass4(__m128 a, __m128 lo, __m128) {
+    return _mm_cmpgt_ps(a, lo);
+  }
+  static __m128i Pass4(__m128i a, __m128i lo, __m128i) {
+    return _mm_cmpgt_epi32(a, lo);
+  }
+#endif  // defined(__SSE2__)
+};
+
+struct GreaterOrEqual {
+  static const char* Name() { return ">="; }
+  template <typename T>
+  static bool Pass(T a, T lo, T) {
+    return a >= lo;
+  }
+#if defined(__SSE2__)
+  static __m128 Pass4(__m128 a, __m128 lo, __m128) {
+    return _mm_cmpge_ps(a, lo);
+  }
+  static __m128i Pass4(__m128i a, __m128i lo, __m128i) {
+    return Not(_mm_cmplt_epi32(a, lo));
+  }
+#endif  // defined(__SSE2__)
+};
+
+// Whether all |count| values of a block pass.
+template <typename T, typename Compare>
+struct Block {
+  static bool Passes(const T* a, const T* lo, const T* hi, size_t count) {
+    bool pass = true;
+    for (size_t i = 0; i < count; ++i)
+      pass &= Compare::Pass(a[i], lo[i], hi[i]);
+    return pass;
+  }
+};
+
+#if defined(__SSE2__)
+template <typename Compare>
+struct Block<float, Compare> {
+  static bool Passes(const float* a,
+                     const float* lo,
+                     const float* hi,
+                     size_t count) {
+    __m128 pass = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      pass = _mm_and_ps(pass, Compare::Pass4(_mm_loadu_ps(a + i),
+                                             _mm_loadu_ps(lo + i),
+                                             _mm_loadu_ps(hi + i)));
+    }
+    bool tail_pass = true;
+    for (; i < count; ++i)
+      tail_pass &= Compare::Pass(a[i], lo[i], hi[i]);
+    return tail_pass && _mm_movemask_ps(pass) == 0xf;
+  }
+};
+
+// Unsigned values are moved to the signed range first, which keeps their
+// order for the signed compares of SSE2.
+template <typename T, typename Compare>
+struct Int32Block {
+  static __m128i Load(const T* values, __m128i bias) {
+    return _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(values)), bias);
+  }
+
+  static bool Passes(const T* a, const T* lo, const T* hi, size_t count) {
+    const __m128i bias = _mm_set1_epi32(
+        std::is_signed<T>::value ? 0 : std::numeric_limits<int32_t>::min());
+    __m128i pass = _mm_set1_epi32(-1);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      pass = _mm_and_si128(
+          pass, Compare::Pass4(Load(a + i, bias), Load(lo + i, bias),
+                               Load(hi + i, bias)));
+    }
+    bool tail_pass = true;
+    for (; i < count; ++i)
+      tail_pass &= Compare::Pass(a[i], lo[i], hi[i]);
+    return tail_pass && _mm_movemask_epi8(pass) == 0xffff;
+  }
+};
+
+template <typename Compare>
+struct Block<int32_t, Compare> : Int32Block<int32_t, Compare> {};
+
+template <typename Compare>
+struct Block<uint32_t, Compare> : Int32Block<uint32_t, Compare> {};
+#endif  // defined(__SSE2__)
+
+struct Failures {
+  uint64_t count = 0;
+  // Indices of the first failing values.
+  std::vector<size_t> indices;
+};
+
+// Compares the |count| values at |data| against the bounds.
+template <typename T, typename Compare>
+void FindMismatches(const uint8_t* data,
+                    const T* lo,
+                    const T* hi,
+                    size_t count,
+                    size_t max_reported,
+                    Failures* mismatches) {
+  // The buffer data need not be aligned for T.
+  T block[kBlockSize];
+  for (size_t start = 0; start < count; start += kBlockSize) {
+    const size_t n = std::min(kBlockSize, count - start);
+    memcpy(block, data + start * sizeof(T), n * sizeof(T));
+    if (Block<T, Compare>::Passes(block, lo + start, hi + start, n))
+      continue;
+
+    for (size_t i = 0; i < n; ++i) {
+      if (Compare::Pass(block[i], lo[start + i], hi[start + i]))
+        continue;
+
+      ++mismatches->count;
+      if (mismatches->indices.size() < max_reported)
+        mismatches->indices.push_back(start + i);
+    }
+  }
+}
+
+template <typename T>
+T ValueAs(const Value& value) {
+  return std::is_floating_point<T>::value ? static_cast<T>(value.AsDouble())
+                                          : static_cast<T>(value.AsInt64());
+}
+
+// The tolerance for value |index| of |command|. A vecN, and each column of a
+// matMxN, uses the first N tolerances, so the index is taken within the
+// vector rather than across the whole probe.
+double ToleranceFor(const std::vector<ToleranceCommand::Tolerance>& tolerances,
+                    const ProbeSSBOCommand* command,
+                    size_t index,
+                    double expected) {
+  if (tolerances.empty())
+    return kDefaultTolerance;
+
+  const size_t rows = std::max<size_t>(command->GetDatumType().RowCount(), 1);
+  const auto& tolerance = tolerances[(index % rows) % tolerances.size()];
+  return tolerance.is_percent ? std::fabs(expected) * tolerance.value / 100.0
+                              : tolerance.value;
+}
+
+// The values within |tolerance| of |expected|.
+template <typename T>
+void FuzzyBounds(T expected, double tolerance, T* lo, T* hi, std::true_type) {
+  *lo = static_cast<T>(expected - tolerance);
+  *hi = static_cast<T>(expected + tolerance);
+}
+
+// For integers the bounds are clamped to the range of T.
+template <typename T>
+void FuzzyBounds(T expected, double tolerance, T* lo, T* hi, std::false_type) {
+  const uint64_t kMax = std::numeric_limits<uint64_t>::max();
+  uint64_t steps = 0;
+  if (tolerance >= static_cast<double>(kMax))
+    steps = kMax;
+  else if (tolerance > 0.0)
+    steps = static_cast<uint64_t>(tolerance);
+
+  // Differences of two's complement values are right in unsigned math.
+  const uint64_t value = static_cast<uint64_t>(expected);
+  const uint64_t below =
+      value - static_cast<uint64_t>(std::numeric_limits<T>::min());
+  const uint64_t above =
+      static_cast<uint64_t>(std::numeric_limits<T>::max()) - value;
+  *lo = below > steps ? static_cast<T>(value - steps)
+                      : std::numeric_limits<T>::min();
+  *hi = above > steps ? static_cast<T>(value + steps)
+                      : std::numeric_limits<T>::max();
+}
+
+template <typename T>
+void VerifyValues(const ProbeSSBOCommand* command,
+                  const uint8_t* data,
+                  size_t first,
+                  size_t count,
+                  const std::vector<ToleranceCommand::Tolerance>& tolerances,
+                  uint32_t max_reported,
+                  BufferVerifier::Mismatches* mismatches) {
+  const auto& values = command->GetValues();
+  std::vector<T> lo(count);
+  for (size_t i = 0; i < count; ++i)
+    lo[i] = ValueAs<T>(values[first + i]);
+
+  // Only fuzzy equality has an upper bound.
+  std::vector<T> hi;
+  if (command->GetComparator() == Comparator::kFuzzyEqual) {
+    hi.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+      const T expected = lo[i];
+      FuzzyBounds(expected,
+                  ToleranceFor(tolerances, command, first + i,
+                               static_cast<double>(expected)),
+                  &lo[i], &hi[i], std::is_floating_point<T>());
+    }
+  }
+  const T* hi_data = hi.empty() ? lo.data() : hi.data();
+
+  const size_t left = max_reported > mismatches->reported.size()
+                          ? max_reported - mismatches->reported.size()
+                          : 0;
+  Failures failures;
+  const char* name = "";
+  switch (command->GetComparator()) {
+    case Comparator::kEqual:
+      FindMismatches<T, Equal>(data, lo.data(), hi_data, count, left,
+                               &failures);
+      name = Equal::Name();
+      break;
+    case Comparator::kNotEqual:
+      FindMismatches<T, NotEqual>(data, lo.data(), hi_data, count, left,
+                                  &failures);
+      name = NotEqual::Name();
+      break;
+    case Comparator::kFuzzyEqual:
+      FindMismatches<T, FuzzyEqual>(data, lo.data(), hi_data, count, left,
+                                    &failures);
+      name = FuzzyEqual::Name();
+      break;
+    case Comparator::kLess:
+      FindMismatches<T, Less>(data, lo.data(), hi_data, count, left,
+                              &failures);
+      name = Less::Name();
+      break;
+    case Comparator::kLessOrEqual:
+      FindMismatches<T, LessOrEqual>(data, lo.data(), hi_data, count, left,
+                                     &failures);
+      name = LessOrEqual::Name();
+      break;
+    case Comparator::kGreater:
+      FindMismatches<T, Greater>(data, lo.data(), hi_data, count, left,
+                                 &failures);
+      name = Greater::Name();
+      break;
+    case Comparator::kGreaterOrEqual:
+      FindMismatches<T, GreaterOrEqual>(data, lo.data(), hi_data, count, left,
+                                        &failures);
+      name = GreaterOrEqual::Name();
+      break;
+  }
+
+  mismatches->count += failures.count;
+  for (const size_t index : failures.indices) {
+    T actual;
+    memcpy(&actual, data + index * sizeof(T), sizeof(T));
+    const size_t value = first + index;
+    mismatches->reported.push_back(
+        "Value " + std::to_string(value) + " at offset " +
+        std::to_string(command->GetOffset() + value * sizeof(T)) + ": " +
+        std::to_string(actual) + " is not " + name + " " +
+        std::to_string(ValueAs<T>(values[value])));
+  }
+}
+
+}  // namespace
+
+BufferVerifier::BufferVerifier() = default;
+
+BufferVerifier::~BufferVerifier() = default;
+
+Result BufferVerifier::SetTolerances(
+    const std::vector<ToleranceCommand::Tolerance>& tolerances) {
+  for (const auto& tolerance : tolerances) {
+    if (tolerance.value < 0.0)
+      return Result("Vulkan::Tolerance must not be negative");
+  }
+  tolerances_ = tolerances;
+  return {};
+}
+
+// static
+size_t BufferVerifier::GetProbeSize(const ProbeSSBOCommand* command) {
+  size_t size = 0;
+  switch (command->GetDatumType().GetType()) {
+    case DataType::kInt8:
+    case DataType::kUint8:
+      size = 1;
+      break;
+    case DataType::kInt16:
+    case DataType::kUint16:
+      size = 2;
+      break;
+    case DataType::kInt32:
+    case DataType::kUint32:
+    case DataType::kFloat:
+      size = 4;
+      break;
+    case DataType::kInt64:
+    case DataType::kUint64:
+    case DataType::kDouble:
+      size = 8;
+      break;
+  }
+  return size * command->GetValues().size();
+}
+
+Result BufferVerifier::Verify(const ProbeSSBOCommand* command,
+                              const uint8_t* data) const {
+  Mismatches mismatches;
+  Result r = VerifyRange(command, data, 0, command->GetValues().size(),
+                         &mismatches);
+  if (!r.IsSuccess())
+    return r;
+  return GetResult(command, mismatches);
+}
+
+Result BufferVerifier::VerifyRange(const ProbeSSBOCommand* command,
+                                   const uint8_t* data,
+                                   size_t first,
+                                   size_t count,
+                                   Mismatches* mismatches) const {
+  if (first + count > command->GetValues().size())
+    return Result("Vulkan::Probe SSBO range is out of the values");
+
+  switch (command->GetDatumType().GetType()) {
+    case DataType::kInt8:
+      VerifyValues<int8_t>(command, data, first, count, tolerances_,
+                           max_reported_, mismatches);
+      return {};
+    case DataType::kInt16:
+      VerifyValues<int16_t>(command, data, first, count, tolerances_,
+                            max_reported_, mismatches);
+      return {};
+    case DataType::kInt32:
+      VerifyValues<int32_t>(command, data, first, count, tolerances_,
+                            max_reported_, mismatches);
+      return {};
+    case DataType::kInt64:
+      VerifyValues<int64_t>(command, data, first, count, tolerances_,
+                            max_reported_, mismatches);
+      return {};
+    case DataType::kUint8:
+      VerifyValues<uint8_t>(command, data, first, count, tolerances_,
+                            max_reported_, mismatches);
+      return {};
+    case DataType::kUint16:
+      VerifyValues<uint16_t>(command, data, first, count, tolerances_,
+                             max_reported_, mismatches);
+      return {};
+    case DataType::kUint32:
+      VerifyValues<uint32_t>(command, data, first, count, tolerances_,
+                             max_reported_, mismatches);
+      return {};
+    case DataType::kUint64:
+      VerifyValues<uint64_t>(command, data, first, count, tolerances_,
+                             max_reported_, mismatches);
+      return {};
+    case DataType::kFloat:
+      VerifyValues<float>(command, data, first, count, tolerances_,
+                          max_reported_, mismatches);
+      return {};
+    case DataType::kDouble:
+      VerifyValues<double>(command, data, first, count, tolerances_,
+                           max_reported_, mismatches);
+      return {};
+  }
+  return Result("Vulkan::Probe SSBO with unknown datum type");
+}
+
+// static
+Result BufferVerifier::GetResult(const ProbeSSBOCommand* command,
+                                 const Mismatches& mismatches) {
+  if (mismatches.count == 0)
+    return {};
+
+  std::string error = "Probe SSBO failed in " +
+                      std::to_string(mismatches.count) + " of " +
+                      std::to_string(command->GetValues().size()) + " values";
+  for (const auto& line : mismatches.reported)
+    error += "\n  " + line;
+  if (!mismatches.reported.empty() &&
+      mismatches.count > mismatches.reported.size()) {
+    error += "\n  and " +
+             std::to_string(mismatches.count - mismatches.reported.size()) +
+             " more";
+  }
+  return Result(error);
+}
+
+bool BufferVerifier::GetFloatBounds(const ProbeSSBOCommand* command,
+                                    std::vector<float>* bounds) const {
+  if (command->GetDatumType().GetType() != DataType::kFloat ||
+      command->GetComparator() == Comparator::kNotEqual) {
+    return false;
+  }
+
+  const float kInf = std::numeric_limits<float>::infinity();
+  const auto& values = command->GetValues();
+  bounds->resize(2 * values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    const float expected = ValueAs<float>(values[i]);
+    float* lo = &(*bounds)[2 * i];
+    float* hi = lo + 1;
+    switch (command->GetComparator()) {
+      case Comparator::kEqual:
+        *lo = expected;
+        *hi = expected;
+        break;
+      case Comparator::kNotEqual:
+        break;
+      case Comparator::kFuzzyEqual:
+        FuzzyBounds(expected,
+                    ToleranceFor(tolerances_, command, i,
+                                 static_cast<double>(expected)),
+                    lo, hi, std::true_type());
+        break;
+      // Strict comparisons end one float short of the expected value.
+      // Nothing is less than -inf or greater than inf.
+      case Comparator::kLess:
+        *lo = -kInf;
+        *hi = expected == -kInf ? std::nanf("")
+                                : std::nextafter(expected, -kInf);
+        break;
+      case Comparator::kLessOrEqual:
+        *lo = -kInf;
+        *hi = expected;
+        break;
+      case Comparator::kGreater:
+        *lo = expected == kInf ? std::nanf("")
+                               : std::nextafter(expected, kInf);
+        *hi = kInf;
+        break;
+      case Comparator::kGreaterOrEqual:
+        *lo = expected;
+        *hi = kInf;
+        break;
+    }
+  }
+  return true;
+}
+
+}  // namespace vulkan
+}  // namespace amber
@@ -0,0 +1,94 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_VULKAN_BUFFER_VERIFIER_H_
+#define SRC_VULKAN_BUFFER_VERIFIER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "amber/result.h"
+#include "src/command.h"
+
+namespace amber {
+namespace vulkan {
+
+// Compares the contents of a buffer against the expected values of a probe
+// ssbo command. The buffer holds a tightly packed array of the scalar type
+// of the command, which is compared a block at a time. Blocks of floats and
+// 32 bit integers are compared with SSE2 and the other types in loops the
+// compiler can vectorize. Only blocks with a failing value are looked at one
+// value at a time.
+class BufferVerifier {
+ public:
+  // The failing values found by VerifyRange().
+  struct Mismatches {
+    uint64_t count = 0;
+    // A description of each of the first failing values.
+    std::vector<std::string> reported;
+  };
+
+  BufferVerifier();
+  ~BufferVerifier();
+
+  // Tolerances for fuzzy equality. Value i uses tolerance i modulo the
+  // number of tolerances, so one is given for all values or one for each
+  // component of a vector. Percentages are of the expected value. Without
+  // tolerances values within 0.01 are equal.
+  Result SetTolerances(
+      const std::vector<ToleranceCommand::Tolerance>& tolerances);
+
+  // Sets how many failing values are listed in the result. All of them are
+  // counted.
+  void SetMaxReportedMismatches(uint32_t max) { max_reported_ = max; }
+
+  // Returns the number of bytes the values of |command| take in the buffer.
+  static size_t GetProbeSize(const ProbeSSBOCommand* command);
+
+  // Compares the GetProbeSize() bytes at |data|, which are the contents of
+  // the buffer starting at the offset of |command|, against its values.
+  Result Verify(const ProbeSSBOCommand* command, const uint8_t* data) const;
+
+  // Compares the |count| values of |command| starting at value |first|
+  // against |data|, which holds the buffer contents of just those values,
+  // and adds the failing ones to |mismatches|. Lets large probes be read
+  // back and compared a range at a time.
+  Result VerifyRange(const ProbeSSBOCommand* command,
+                     const uint8_t* data,
+                     size_t first,
+                     size_t count,
+                     Mismatches* mismatches) const;
+
+  // Returns the result of |command| once all of its values were compared
+  // by VerifyRange().
+  static Result GetResult(const ProbeSSBOCommand* command,
+                          const Mismatches& mismatches);
+
+  // Sets |bounds| to a lo, hi pair for each value of |command|, holding the
+  // floats which pass its comparator. Returns false when |command| does not
+  // probe floats, or compares with != which passes more than one range.
+  bool GetFloatBounds(const ProbeSSBOCommand* command,
+                      std::vector<float>* bounds) const;
+
+ private:
+  std::vector<ToleranceCommand::Tolerance> tolerances_;
+  uint32_t max_reported_ = 10;
+};
+
+}  // namespace vulkan
+}  // namespace amber
+
+#endif  // SRC_VULKAN_BUFFER_VERIFIER_H_
@@ -0,0 +1,391 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/buffer_verifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+using Comparator = ProbeSSBOCommand::Comparator;
+
+template <typename T>
+std::vector<uint8_t> ToBytes(const std::vector<T>& values) {
+  std::vector<uint8_t> bytes(values.size() * sizeof(T));
+  memcpy(bytes.data(), values.data(), bytes.size());
+  return bytes;
+}
+
+void SetIntValues(ProbeSSBOCommand* command,
+                  DataType type,
+                  const std::vector<int64_t>& expected) {
+  DatumType datum_type;
+  datum_type.SetType(type);
+  command->SetDatumType(datum_type);
+
+  std::vector<Value> values(expected.size());
+  for (size_t i = 0; i < expected.size(); ++i)
+    values[i].SetIntValue(static_cast<uint64_t>(expected[i]));
+  command->SetValues(std::move(values));
+}
+
+void SetDoubleValues(ProbeSSBOCommand* command,
+                     DataType type,
+                     const std::vector<double>& expected) {
+  DatumType datum_type;
+  datum_type.SetType(type);
+  command->SetDatumType(datum_type);
+
+  std::vector<Value> values(expected.size());
+  for (size_t i = 0; i < expected.size(); ++i)
+    values[i].SetDoubleValue(expected[i]);
+  command->SetValues(std::move(values));
+}
+
+}  // namespace
+
+using BufferVerifierTest = testing::Test;
+
+TEST_F(BufferVerifierTest, EqualFloats) {
+  ProbeSSBOCommand command;
+  SetDoubleValues(&command, DataType::kFloat, {1.5, -2.0, 3.25, 0.0, 8.0});
+  const auto bytes = ToBytes<float>({1.5f, -2.0f, 3.25f, 0.0f, 8.0f});
+
+  BufferVerifier verifier;
+  EXPECT_EQ(20U, BufferVerifier::GetProbeSize(&command));
+  Result r = verifier.Verify(&command, bytes.data());
+  EXPECT_TRUE(r.IsSuccess()) << r.Error();
+}
+
+TEST_F(BufferVerifierTest, ReportsMismatches) {
+  ProbeSSBOCommand command;
+  command.SetOffset(16);
+  SetIntValues(&command, DataType::kInt32, {1, 2, 3, 4, 5});
+  const auto bytes = ToBytes<int32_t>({1, 2, 7, 4, -5});
+
+  BufferVerifier verifier;
+  Result r = verifier.Verify(&command, bytes.data());
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ(
+      "Probe SSBO failed in 2 of 5 values\n"
+      "  Value 2 at offset 24: 7 is not == 3\n"
+      "  Value 4 at offset 32: -5 is not == 5",
+      r.Error());
+}
+
+TEST_F(BufferVerifierTest, BoundsReportedMismatches) {
+  ProbeSSBOCommand command;
+  SetIntValues(&command, DataType::kUint32, std::vector<int64_t>(100, 1));
+  const auto bytes = ToBytes(std::vector<uint32_t>(100, 2));
+
+  BufferVerifier verifier;
+  verifier.SetMaxReportedMismatches(2);
+  Result r = verifier.Verify(&command, bytes.data());
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ(
+      "Probe SSBO failed in 100 of 100 values\n"
+      "  Value 0 at offset 0: 2 is not == 1\n"
+      "  Value 1 at offset 4: 2 is not == 1\n"
+      "  and 98 more",
+      r.Error());
+}
+
+TEST_F(BufferVerifierTest, VerifyRanges) {
+  ProbeSSBOCommand command;
+  command.SetOffset(16);
+  SetIntValues(&command, DataType::kInt32, {1, 2, 3, 4, 5, 6, 7});
+  const auto bytes = ToBytes<int32_t>({1, 9, 3, 4, 8, 6, 0});
+
+  // Ranges of three values, each read from its own copy of the data, are
+  // reported as one probe.
+  BufferVerifier verifier;
+  verifier.SetMaxReportedMismatches(2);
+  BufferVerifier::Mismatches mismatches;
+  for (size_t first = 0; first < 7; first += 3) {
+    const size_t count = std::min<size_t>(3, 7 - first);
+    std::vector<uint8_t> range(bytes.begin() + first * 4,
+                               bytes.begin() + (first + count) * 4);
+    Result r = verifier.VerifyRange(&command, range.data(), first, count,
+                                    &mismatches);
+    ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  }
+
+  Result r = BufferVerifier::GetResult(&command, mismatches);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ(
+      "Probe SSBO failed in 3 of 7 values\n"
+      "  Value 1 at offset 20: 9 is not == 2\n"
+      "  Value 4 at offset 32: 8 is not == 5\n"
+      "  and 1 more",
+      r.Error());
+
+  r = verifier.VerifyRange(&command, bytes.data(), 5, 3, &mismatches);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Vulkan::Probe SSBO range is out of the values", r.Error());
+}
+
+TEST_F(BufferVerifierTest, Comparators) {
+  // Nine values so both the four wide and the one at a time compares run.
+  const std::vector<int32_t> actual = {-3, -2, -1, 0, 1, 2, 3, 4, 5};
+  const auto bytes = ToBytes(actual);
+  struct {
+    Comparator comparator;
+    int64_t expected;
+    uint64_t failures;
+  } cases[] = {
+      {Comparator::kEqual, 1, 8},       {Comparator::kNotEqual, 1, 1},
+      {Comparator::kLess, 1, 5},        {Comparator::kLessOrEqual, 1, 4},
+      {Comparator::kGreater, 1, 5},     {Comparator::kGreaterOrEqual, 1, 4},
+      {Comparator::kGreaterOrEqual, -3, 0},
+  };
+
+  BufferVerifier verifier;
+  verifier.SetMaxReportedMismatches(0);
+  for (const auto& c : cases) {
+    ProbeSSBOCommand command;
+    command.SetComparator(c.comparator);
+    SetIntValues(&command, DataType::kInt32,
+                 std::vector<int64_t>(actual.size(), c.expected));
+
+    Result r = verifier.Verify(&command, bytes.data());
+    if (c.failures == 0) {
+      EXPECT_TRUE(r.IsSuccess()) << r.Error();
+    } else {
+      EXPECT_EQ("Probe SSBO failed in " + std::to_string(c.failures) +
+                    " of 9 values",
+                r.Error());
+    }
+  }
+}
+
+TEST_F(BufferVerifierTest, UnsignedOrder) {
+  ProbeSSBOCommand command;
+  command.SetComparator(Comparator::kGreater);
+  SetIntValues(&command, DataType::kUint32, {1, 1, 1, 1, 1});
+  const auto bytes =
+      ToBytes<uint32_t>({0x80000000U, 0xffffffffU, 2, 0x7fffffffU, 3});
+
+  BufferVerifier verifier;
+  Result r = verifier.Verify(&command, bytes.data());
+  EXPECT_TRUE(r.IsSuccess()) << r.Error();
+}
+
+TEST_F(BufferVerifierTest, FloatNaN) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const auto bytes = ToBytes<float>({nan, 1.0f, 1.0f, 1.0f, nan});
+
+  ProbeSSBOCommand command;
+  SetDoubleValues(&command, DataType::kFloat, {1.0, 1.0, 1.0, 1.0, 1.0});
+  BufferVerifier verifier;
+  verifier.SetMaxReportedMismatches(0);
+  EXPECT_EQ("Probe SSBO failed in 2 of 5 values",
+            verifier.Verify(&command, bytes.data()).Error());
+
+  command.SetComparator(Comparator::kNotEqual);
+  EXPECT_EQ("Probe SSBO failed in 3 of 5 values",
+            verifier.Verify(&command, bytes.data()).Error());
+}
+
+TEST_F(BufferVerifierTest, FuzzyEqualDefaultTolerance) {
+  ProbeSSBOCommand command;
+  command.SetComparator(Comparator::kFuzzyEqual);
+  SetDoubleValues(&command, DataType::kFloat, {1.0, 2.0, 3.0, 4.0, 5.0});
+  const auto bytes = ToBytes<float>({1.005f, 1.995f, 3.0f, 4.02f, 5.0f});
+
+  BufferVerifier verifier;
+  Result r = verifier.Verify(&command, bytes.data());
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ(
+      "Probe SSBO failed in 1 of 5 values\n"
+      "  Value 3 at offset 12: 4.020000 is not ~= 4.000000",
+      r.Error());
+}
+
+TEST_F(BufferVerifierTest, FuzzyEqualToleranceForEachComponent) {
+  ProbeSSBOCommand command;
+  command.SetComparator(Comparator::kFuzzyEqual);
+  SetDoubleValues(&command, DataType::kDouble,
+                  {10.0, 10.0, 10.0, 10.0, 10.0, 10.0});
+  DatumType vec2;
+  vec2.SetType(DataType::kDouble);
+  vec2.SetRowCount(2);
+  command.SetDatumType(vec2);
+  const auto bytes = ToBytes<double>({10.4, 10.9, 11.0, 9.6, 9.1, 9.05});
+
+  // An absolute tolerance for the first component and 10% for the second.
+  std::vector<ToleranceCommand::Tolerance> tolerances;
+  tolerances.emplace_back(false, 0.5);
+  tolerances.emplace_back(true, 10.0);
+
+  BufferVerifier verifier;
+  ASSERT_TRUE(verifier.SetTolerances(tolerances).IsSuccess());
+  verifier.SetMaxReportedMismatches(0);
+  EXPECT_EQ("Probe SSBO failed in 2 of 6 values",
+            verifier.Verify(&command, bytes.data()).Error());
+}
+
+TEST_F(BufferVerifierTest, FuzzyEqualFourTolerancesVec3) {
+  ProbeSSBOCommand command;
+  command.SetComparator(Comparator::kFuzzyEqual);
+  SetDoubleValues(&command, DataType::kFloat,
+                  {10.0, 10.0, 10.0, 10.0, 10.0, 10.0});
+  DatumType vec3;
+  vec3.SetType(DataType::kFloat);
+  vec3.SetRowCount(3);
+  command.SetDatumType(vec3);
+  const auto bytes = ToBytes<float>({10.5f, 11.5f, 12.5f, 12.0f, 11.5f, 12.5f});
+
+  // A vec3 uses the first three tolerances, so the second vector starts over
+  // at the first tolerance instead of using the fourth.
+  std::vector<ToleranceCommand::Tolerance> tolerances;
+  tolerances.emplace_back(false, 1.0);
+  tolerances.emplace_back(false, 2.0);
+  tolerances.emplace_back(false, 3.0);
+  tolerances.emplace_back(false, 100.0);
+
+  BufferVerifier verifier;
+  ASSERT_TRUE(verifier.SetTolerances(tolerances).IsSuccess());
+  EXPECT_EQ(
+      "Probe SSBO failed in 1 of 6 values\n"
+      "  Value 3 at offset 12: 12.000000 is not ~= 10.000000",
+      verifier.Verify(&command, bytes.data()).Error());
+
+  std::vector<float> bounds;
+  ASSERT_TRUE(verifier.GetFloatBounds(&command, &bounds));
+  ASSERT_EQ(12U, bounds.size());
+  EXPECT_FLOAT_EQ(9.0f, bounds[6]);
+  EXPECT_FLOAT_EQ(11.0f, bounds[7]);
+  EXPECT_FLOAT_EQ(7.0f, bounds[10]);
+  EXPECT_FLOAT_EQ(13.0f, bounds[11]);
+}
+
+TEST_F(BufferVerifierTest, FuzzyEqualIntegersClamp) {
+  std::vector<ToleranceCommand::Tolerance> tolerances;
+  tolerances.emplace_back(false, 5.5);
+  BufferVerifier verifier;
+  ASSERT_TRUE(verifier.SetTolerances(tolerances).IsSuccess());
+  verifier.SetMaxReportedMismatches(0);
+
+  ProbeSSBOCommand command;
+  command.SetComparator(Comparator::kFuzzyEqual);
+  SetIntValues(&command, DataType::kInt8, {127, -128, 0, 0});
+  auto bytes = ToBytes<int8_t>({122, -123, 5, -6});
+  EXPECT_EQ("Probe SSBO failed in 1 of 4 values",
+            verifier.Verify(&command, bytes.data()).Error());
+
+  SetIntValues(&command, DataType::kUint8, {2, 253, 2, 253});
+  bytes = ToBytes<uint8_t>({0, 255, 7, 248});
+  EXPECT_TRUE(verifier.Verify(&command, bytes.data()).IsSuccess());
+
+  SetIntValues(&command, DataType::kUint64, {2, 2});
+  bytes = ToBytes<uint64_t>({0, 8});
+  EXPECT_EQ("Probe SSBO failed in 1 of 2 values",
+            verifier.Verify(&command, bytes.data()).Error());
+}
+
+TEST_F(BufferVerifierTest, FloatBoundsMatchComparators) {
+  const float kInf = std::numeric_limits<float>::infinity();
+  const std::vector<float> actual = {
+      -kInf, -1.0f, std::nextafter(1.0f, 0.0f), 1.0f,
+      std::nextafter(1.0f, 2.0f), 1.005f, 1.02f, kInf,
+      std::numeric_limits<float>::quiet_NaN()};
+  const Comparator comparators[] = {
+      Comparator::kEqual,   Comparator::kFuzzyEqual,
+      Comparator::kLess,    Comparator::kLessOrEqual,
+      Comparator::kGreater, Comparator::kGreaterOrEqual,
+  };
+
+  // A value is within its bounds exactly when it passes on the host.
+  BufferVerifier verifier;
+  for (const auto comparator : comparators) {
+    ProbeSSBOCommand command;
+    command.SetComparator(comparator);
+    SetDoubleValues(&command, DataType::kFloat, {1.0});
+
+    std::vector<float> bounds;
+    ASSERT_TRUE(verifier.GetFloatBounds(&command, &bounds));
+    ASSERT_EQ(2U, bounds.size());
+    for (const float a : actual) {
+      const auto bytes = ToBytes<float>({a});
+      const bool passes = verifier.Verify(&command, bytes.data()).IsSuccess();
+      EXPECT_EQ(passes, a >= bounds[0] && a <= bounds[1])
+          << "comparator " << static_cast<int>(comparator) << " value " << a;
+    }
+  }
+
+  ProbeSSBOCommand command;
+  command.SetComparator(Comparator::kNotEqual);
+  SetDoubleValues(&command, DataType::kFloat, {1.0});
+  std::vector<float> bounds;
+  EXPECT_FALSE(verifier.GetFloatBounds(&command, &bounds));
+
+  command.SetComparator(Comparator::kEqual);
+  SetIntValues(&command, DataType::kInt32, {1});
+  EXPECT_FALSE(verifier.GetFloatBounds(&command, &bounds));
+}
+
+TEST_F(BufferVerifierTest, OtherTypes) {
+  BufferVerifier verifier;
+  ProbeSSBOCommand command;
+  command.SetComparator(Comparator::kLess);
+
+  SetIntValues(&command, DataType::kInt64, {0, 1LL << 40});
+  EXPECT_EQ(16U, BufferVerifier::GetProbeSize(&command));
+  auto bytes = ToBytes<int64_t>({-(1LL << 50), (1LL << 40) - 1});
+  EXPECT_TRUE(verifier.Verify(&command, bytes.data()).IsSuccess());
+
+  SetIntValues(&command, DataType::kUint16, {1000, 1000, 1000});
+  EXPECT_EQ(6U, BufferVerifier::GetProbeSize(&command));
+  bytes = ToBytes<uint16_t>({999, 0, 65535});
+  EXPECT_EQ(
+      "Probe SSBO failed in 1 of 3 values\n"
+      "  Value 2 at offset 4: 65535 is not < 1000",
+      verifier.Verify(&command, bytes.data()).Error());
+}
+
+TEST_F(BufferVerifierTest, UnalignedData) {
+  std::vector<float> expected(37);
+  for (size_t i = 0; i < expected.size(); ++i)
+    expected[i] = static_cast<float>(i) * 0.5f;
+
+  std::vector<uint8_t> bytes(expected.size() * sizeof(float) + 1);
+  memcpy(bytes.data() + 1, expected.data(), expected.size() * sizeof(float));
+
+  ProbeSSBOCommand command;
+  SetDoubleValues(&command, DataType::kFloat,
+                  std::vector<double>(expected.begin(), expected.end()));
+  BufferVerifier verifier;
+  Result r = verifier.Verify(&command, bytes.data() + 1);
+  EXPECT_TRUE(r.IsSuccess()) << r.Error();
+}
+
+TEST_F(BufferVerifierTest, NegativeTolerance) {
+  std::vector<ToleranceCommand::Tolerance> tolerances;
+  tolerances.emplace_back(false, -1.0);
+  BufferVerifier verifier;
+  Result r = verifier.SetTolerances(tolerances);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Vulkan::Tolerance must not be negative", r.Error());
+}
+
+}  // namespace vulkan
+}  // namespace amber
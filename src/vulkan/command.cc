@@ -21,6 +21,28 @@
 namespace amber {
 
 namespace vulkan {
+namespace {
+
+// Batches recorded ahead of the device before the host has to wait.
+const size_t kCommandBuffersInFlight = 3;
+
+// Generous, since waiting for results can cover several batches.
+const uint64_t kFenceTimeout = 10000000000; /* nanosecond */
+
+}  // namespace
+
+void RecordMemoryBarrier(VkCommandBuffer command,
+                         VkPipelineStageFlags src_stages,
+                         VkAccessFlags src_access,
+                         VkPipelineStageFlags dst_stages,
+                         VkAccessFlags dst_access) {
+  VkMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = src_access;
+  barrier.dstAccessMask = dst_access;
+  vkCmdPipelineBarrier(command, src_stages, dst_stages, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+}
 
 CommandPool::CommandPool(VkDevice device) : device_(device) {}
 
@@ -42,88 +64,148 @@ void CommandPool::Shutdown() {
   vkDestroyCommandPool(device_, pool_, nullptr);
 }
 
-CommandBuffer::CommandBuffer(VkDevice device, VkCommandPool pool, VkQueue queue)
-    : device_(device), pool_(pool), queue_(queue) {}
+CommandBuffer::CommandBuffer(VkDevice device,
+                             VkCommandPool pool,
+                             VkQueue queue,
+                             StagingRing* staging_ring)
+    : device_(device),
+      pool_(pool),
+      queue_(queue),
+      staging_ring_(staging_ring),
+      frames_(kCommandBuffersInFlight) {}
 
 CommandBuffer::~CommandBuffer() = default;
 
 Result CommandBuffer::Initialize() {
+  std::vector<VkCommandBuffer> commands(frames_.size());
   VkCommandBufferAllocateInfo command_info = {};
   command_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   command_info.commandPool = pool_;
   command_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  command_info.commandBufferCount = 1;
+  command_info.commandBufferCount = static_cast<uint32_t>(commands.size());
 
-  if (vkAllocateCommandBuffers(device_, &command_info, &command_) != VK_SUCCESS)
+  if (vkAllocateCommandBuffers(device_, &command_info, commands.data()) !=
+      VK_SUCCESS) {
     return Result("Vulkan::Calling vkAllocateCommandBuffers Fail");
+  }
 
   VkFenceCreateInfo fence_info = {};
   fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-  if (vkCreateFence(device_, &fence_info, nullptr, &fence_) != VK_SUCCESS)
-    return Result("Vulkan::Calling vkCreateFence Fail");
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    frames_[i].command = commands[i];
+    if (vkCreateFence(device_, &fence_info, nullptr, &frames_[i].fence) !=
+        VK_SUCCESS) {
+      return Result("Vulkan::Calling vkCreateFence Fail");
+    }
+  }
 
   return {};
 }
 
 Result CommandBuffer::BeginIfNotInRecording() {
-  if (state_ == CommandBufferState::kRecording)
+  Frame& frame = frames_[current_];
+  if (frame.state == CommandBufferState::kRecording)
     return {};
 
-  if (state_ != CommandBufferState::kInitial)
+  if (frame.state == CommandBufferState::kPending) {
+    Result r = WaitForFrame(&frame);
+    if (!r.IsSuccess())
+      return r;
+  }
+
+  if (frame.state != CommandBufferState::kInitial)
     return Result("Vulkan::Begin CommandBuffer from Not Valid State");
 
   VkCommandBufferBeginInfo command_begin_info = {};
   command_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   command_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-  if (vkBeginCommandBuffer(command_, &command_begin_info) != VK_SUCCESS)
+  if (vkBeginCommandBuffer(frame.command, &command_begin_info) != VK_SUCCESS)
     return Result("Vulkan::Calling vkBeginCommandBuffer Fail");
 
-  state_ = CommandBufferState::kRecording;
+  frame.state = CommandBufferState::kRecording;
   return {};
 }
 
 Result CommandBuffer::End() {
-  if (state_ != CommandBufferState::kRecording)
+  Frame& frame = frames_[current_];
+  if (frame.state != CommandBufferState::kRecording)
     return Result("Vulkan::End CommandBuffer from Not Valid State");
 
-  if (vkEndCommandBuffer(command_) != VK_SUCCESS)
+  if (vkEndCommandBuffer(frame.command) != VK_SUCCESS)
     return Result("Vulkan::Calling vkEndCommandBuffer Fail");
 
-  state_ = CommandBufferState::kExecutable;
+  frame.state = CommandBufferState::kExecutable;
   return {};
 }
 
-Result CommandBuffer::SubmitAndReset() {
-  if (state_ != CommandBufferState::kExecutable)
+Result CommandBuffer::Submit() {
+  Frame& frame = frames_[current_];
+  if (frame.state != CommandBufferState::kExecutable)
     return Result("Vulkan::Submit CommandBuffer from Not Valid State");
 
-  if (vkResetFences(device_, 1, &fence_) != VK_SUCCESS)
+  if (vkResetFences(device_, 1, &frame.fence) != VK_SUCCESS)
     return Result("Vulkan::Calling vkResetFences Fail");
 
   VkSubmitInfo submit_info = {};
   submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
   submit_info.commandBufferCount = 1;
-  submit_info.pCommandBuffers = &command_;
-  if (vkQueueSubmit(queue_, 1, &submit_info, fence_) != VK_SUCCESS)
+  submit_info.pCommandBuffers = &frame.command;
+  if (vkQueueSubmit(queue_, 1, &submit_info, frame.fence) != VK_SUCCESS)
     return Result("Vulkan::Calling vkQueueSubmit Fail");
 
+  frame.staging_serial = staging_ring_->Submit(frame.fence);
+  frame.state = CommandBufferState::kPending;
+  current_ = (current_ + 1) % frames_.size();
+  return {};
+}
+
+Result CommandBuffer::WaitForFrame(Frame* frame) {
   VkResult r =
-      vkWaitForFences(device_, 1, &fence_, VK_TRUE, 100000000 /* nanosecond */);
+      vkWaitForFences(device_, 1, &frame->fence, VK_TRUE, kFenceTimeout);
   if (r == VK_TIMEOUT)
     return Result("Vulkan::Calling vkWaitForFences Timeout");
   if (r != VK_SUCCESS)
     return Result("Vulkan::Calling vkWaitForFences Fail");
 
-  if (vkResetCommandBuffer(command_, 0) != VK_SUCCESS)
+  // The fence also covers every earlier submission to the queue.
+  staging_ring_->Retire(frame->staging_serial);
+
+  if (vkResetCommandBuffer(frame->command, 0) != VK_SUCCESS)
     return Result("Vulkan::Calling vkResetCommandBuffer Fail");
 
-  state_ = CommandBufferState::kInitial;
+  frame->state = CommandBufferState::kInitial;
   return {};
 }
 
+Result CommandBuffer::Wait() {
+  // Oldest first, starting with the command buffer recorded next.
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    Frame& frame = frames_[(current_ + i) % frames_.size()];
+    if (frame.state != CommandBufferState::kPending)
+      continue;
+
+    Result r = WaitForFrame(&frame);
+    if (!r.IsSuccess())
+      return r;
+  }
+  return {};
+}
+
+Result CommandBuffer::SubmitAndReset() {
+  Result r = Submit();
+  if (!r.IsSuccess())
+    return r;
+
+  return Wait();
+}
+
 void CommandBuffer::Shutdown() {
-  vkDestroyFence(device_, fence_, nullptr);
-  vkFreeCommandBuffers(device_, pool_, 1, &command_);
+  Wait();
+  for (auto& frame : frames_) {
+    vkDestroyFence(device_, frame.fence, nullptr);
+    if (frame.command != VK_NULL_HANDLE)
+      vkFreeCommandBuffers(device_, pool_, 1, &frame.command);
+  }
 }
 
 }  // namespace vulkan
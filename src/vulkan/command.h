@@ -15,7 +15,10 @@
 #ifndef SRC_VULKAN_COMMAND_H_
 #define SRC_VULKAN_COMMAND_H_
 
+#include <vector>
+
 #include "amber/result.h"
+#include "src/vulkan/staging_ring.h"
 #include "vulkan/vulkan.h"
 
 namespace amber {
@@ -32,6 +35,14 @@ enum class CommandBufferState : uint8_t {
   kInvalid,
 };
 
+// Records a global memory barrier from |src_access| at |src_stages| to
+// |dst_access| at |dst_stages| into |command|.
+void RecordMemoryBarrier(VkCommandBuffer command,
+                         VkPipelineStageFlags src_stages,
+                         VkAccessFlags src_access,
+                         VkPipelineStageFlags dst_stages,
+                         VkAccessFlags dst_access);
+
 class CommandPool {
  public:
   explicit CommandPool(VkDevice device);
@@ -46,30 +57,65 @@ class CommandPool {
   VkCommandPool pool_ = VK_NULL_HANDLE;
 };
 
+// A small pool of command buffers which are recorded into in turn. A
+// submission does not wait for the device: the next batch is recorded into
+// the following command buffer while earlier batches execute, and the host
+// waits only when it needs their results or runs out of command buffers.
 class CommandBuffer {
  public:
-  CommandBuffer(VkDevice device, VkCommandPool pool, VkQueue queue);
+  // Staging regions recorded into the command buffer are recycled in
+  // |staging_ring| once the submission which uses them has completed.
+  CommandBuffer(VkDevice device,
+                VkCommandPool pool,
+                VkQueue queue,
+                StagingRing* staging_ring);
   ~CommandBuffer();
 
   Result Initialize();
-  VkCommandBuffer GetCommandBuffer() const { return command_; }
+  // The command buffer currently being recorded.
+  VkCommandBuffer GetCommandBuffer() const {
+    return frames_[current_].command;
+  }
+  // Waits for the submitted batches before releasing the command buffers.
   void Shutdown();
 
   // Do nothing and return if it is already ready to record. If it is in
   // initial state, call command begin API and make it ready to record.
-  // Otherwise, report error.
+  // When the command buffer is still executing an earlier batch, wait for
+  // it first. Otherwise, report error.
   Result BeginIfNotInRecording();
+  // Whether commands are being recorded which have not been submitted.
+  bool IsRecording() const {
+    return frames_[current_].state == CommandBufferState::kRecording;
+  }
 
   Result End();
+  // Submits the recorded batch without waiting for it to complete.
+  Result Submit();
+  // Waits until every submitted batch has completed.
+  Result Wait();
+  // Submits the recorded batch and waits until it has completed.
   Result SubmitAndReset();
 
  private:
+  struct Frame {
+    VkCommandBuffer command = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    CommandBufferState state = CommandBufferState::kInitial;
+    // The staging ring submission the batch used.
+    uint64_t staging_serial = 0;
+  };
+
+  // Waits for the batch of |frame| to complete and makes it ready to record
+  // again.
+  Result WaitForFrame(Frame* frame);
+
   VkDevice device_ = VK_NULL_HANDLE;
   VkCommandPool pool_ = VK_NULL_HANDLE;
   VkQueue queue_ = VK_NULL_HANDLE;
-  VkCommandBuffer command_ = VK_NULL_HANDLE;
-  VkFence fence_ = VK_NULL_HANDLE;
-  CommandBufferState state_ = CommandBufferState::kInitial;
+  StagingRing* staging_ring_ = nullptr;
+  std::vector<Frame> frames_;
+  size_t current_ = 0;
 };
 
 }  // namespace vulkan
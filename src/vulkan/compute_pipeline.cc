@@ -0,0 +1,155 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/compute_pipeline.h"
+
+#include <chrono>
+#include <utility>
+
+#include "src/timer.h"
+#include "src/vulkan/command.h"
+
+namespace amber {
+namespace vulkan {
+
+ComputePipeline::ComputePipeline(
+    VkDevice device,
+    MemoryAllocator* allocator,
+    StagingRing* staging_ring,
+    std::vector<VkPipelineShaderStageCreateInfo> shader_stage_info)
+    : Pipeline(PipelineType::kCompute,
+               device,
+               allocator,
+               staging_ring,
+               std::move(shader_stage_info)) {}
+
+ComputePipeline::~ComputePipeline() = default;
+
+Result ComputePipeline::Initialize(VkCommandPool pool, VkQueue queue) {
+  if (shader_stage_info_.size() != 1 ||
+      shader_stage_info_[0].stage != VK_SHADER_STAGE_COMPUTE_BIT) {
+    return Result("Vulkan::Compute Pipeline needs only a compute shader");
+  }
+
+  return Pipeline::InitializeCommandBuffer(pool, queue);
+}
+
+Result ComputePipeline::CreateVkComputePipeline() {
+  if (pipeline_ != VK_NULL_HANDLE)
+    return Result("Vulkan::Pipeline already created");
+
+  VkComputePipelineCreateInfo pipeline_info = {};
+  pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipeline_info.stage = shader_stage_info_[0];
+  pipeline_info.layout = pipeline_layout_;
+
+  if (compare_pipeline_cache_) {
+    auto start = std::chrono::steady_clock::now();
+    VkPipeline uncached = VK_NULL_HANDLE;
+    if (vkCreateComputePipelines(device_, VK_NULL_HANDLE, 1, &pipeline_info,
+                                 nullptr, &uncached) != VK_SUCCESS) {
+      return Result("Vulkan::Calling vkCreateComputePipelines Fail");
+    }
+    uncached_creation_ms_ += MillisecondsSince(start);
+    vkDestroyPipeline(device_, uncached, nullptr);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  if (vkCreateComputePipelines(device_, pipeline_cache_, 1, &pipeline_info,
+                               nullptr, &pipeline_) != VK_SUCCESS) {
+    return Result("Vulkan::Calling vkCreateComputePipelines Fail");
+  }
+  creation_ms_ += MillisecondsSince(start);
+
+  return {};
+}
+
+Result ComputePipeline::Compute(uint32_t x, uint32_t y, uint32_t z) {
+  // The layout is only known once the buffer commands before the first
+  // dispatch have run, so the pipeline is created here.
+  Result r = PrepareDescriptors();
+  if (!r.IsSuccess())
+    return r;
+
+  if (pipeline_ == VK_NULL_HANDLE) {
+    r = CreateVkComputePipeline();
+    if (!r.IsSuccess())
+      return r;
+  }
+
+  // Probes submit the batch and wait for it, which completes the earlier
+  // dispatches.
+  if (!command_->IsRecording())
+    dispatch_recorded_ = false;
+
+  r = command_->BeginIfNotInRecording();
+  if (!r.IsSuccess())
+    return r;
+
+  VkCommandBuffer command = command_->GetCommandBuffer();
+
+  // Only storage buffers are written by the shaders, so dispatches which
+  // read uniform buffers alone run without waiting for each other.
+  VkPipelineStageFlags src_stages = 0;
+  VkAccessFlags src_access = 0;
+  if (dispatch_recorded_ && HasStorageBuffers()) {
+    src_stages |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    src_access |= VK_ACCESS_SHADER_WRITE_BIT;
+  }
+
+  if (HasPendingUploads()) {
+    // The uploads overwrite data the earlier dispatches use.
+    if (dispatch_recorded_) {
+      RecordMemoryBarrier(command, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                          VK_ACCESS_SHADER_WRITE_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_ACCESS_TRANSFER_WRITE_BIT);
+    }
+
+    r = RecordBufferUploads();
+    if (!r.IsSuccess())
+      return r;
+
+    // Uploads which fill the staging ring submit the batch part way.
+    command = command_->GetCommandBuffer();
+
+    src_stages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+    src_access |= VK_ACCESS_TRANSFER_WRITE_BIT;
+  }
+
+  if (src_stages != 0) {
+    RecordMemoryBarrier(command, src_stages, src_access,
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                        VK_ACCESS_UNIFORM_READ_BIT |
+                            VK_ACCESS_SHADER_READ_BIT |
+                            VK_ACCESS_SHADER_WRITE_BIT);
+  }
+
+  // Probes compared on the device bind their own pipeline in between.
+  vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+  BindDescriptors(VK_PIPELINE_BIND_POINT_COMPUTE);
+  vkCmdDispatch(command, x, y, z);
+
+  dispatch_recorded_ = true;
+  return {};
+}
+
+void ComputePipeline::Shutdown() {
+  // Dispatches no probe read the results of still run.
+  SubmitRecordedCommands();
+  Pipeline::Shutdown();
+}
+
+}  // namespace vulkan
+}  // namespace amber
@@ -0,0 +1,54 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_VULKAN_COMPUTE_PIPELINE_H_
+#define SRC_VULKAN_COMPUTE_PIPELINE_H_
+
+#include <vector>
+
+#include "amber/result.h"
+#include "src/vulkan/pipeline.h"
+#include "vulkan/vulkan.h"
+
+namespace amber {
+namespace vulkan {
+
+class ComputePipeline : public Pipeline {
+ public:
+  ComputePipeline(VkDevice device,
+                  MemoryAllocator* allocator,
+                  StagingRing* staging_ring,
+                  std::vector<VkPipelineShaderStageCreateInfo>);
+  ~ComputePipeline() override;
+
+  Result Initialize(VkCommandPool pool, VkQueue queue);
+  void Shutdown() override;
+
+  // Records a dispatch of |x| by |y| by |z| workgroups. Dispatches are not
+  // submitted one at a time: consecutive ones are recorded into the same
+  // batch, which is submitted when a probe reads their results.
+  Result Compute(uint32_t x, uint32_t y, uint32_t z);
+
+ private:
+  Result CreateVkComputePipeline();
+
+  // Whether a dispatch was recorded since the host last waited for the
+  // device, so later uploads and dispatches must wait for it.
+  bool dispatch_recorded_ = false;
+};
+
+}  // namespace vulkan
+}  // namespace amber
+
+#endif  // SRC_VULKAN_COMPUTE_PIPELINE_H_
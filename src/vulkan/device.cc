@@ -14,21 +14,48 @@
 
 #include "src/vulkan/device.h"
 
+#include <cstdio>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "src/make_unique.h"
+#include "src/vulkan/shader_module_library.h"
 
 namespace amber {
 
 namespace vulkan {
+namespace {
+
+// Large enough for the framebuffer readbacks and vertex data of a script.
+// Larger regions get host buffers of their own.
+const size_t kStagingRingSize = 16 * 1024 * 1024;
+
+}  // namespace
 
 Device::Device() = default;
 Device::Device(VkDevice device) : device_(device), destroy_device_(false) {}
 Device::~Device() = default;
 
 void Device::Shutdown() {
+  if (staging_ring_) {
+    staging_ring_->Shutdown();
+    staging_ring_ = nullptr;
+  }
+
+  if (allocator_) {
+    allocator_->Shutdown();
+    allocator_ = nullptr;
+  }
+
+  if (pipeline_cache_ != VK_NULL_HANDLE) {
+    StorePipelineCache();
+    vkDestroyPipelineCache(device_, pipeline_cache_, nullptr);
+    pipeline_cache_ = VK_NULL_HANDLE;
+  }
+
   if (destroy_device_) {
+    ShaderModuleLibrary::Get().ReleaseDevice(device_);
     vkDestroyDevice(device_, nullptr);
     vkDestroyInstance(instance_, nullptr);
   }
@@ -54,9 +81,104 @@ Result Device::Initialize() {
     if (queue_ == VK_NULL_HANDLE)
       return Result("Vulkan::Calling vkGetDeviceQueue Fail");
   }
+
+  if (!allocator_) {
+    allocator_ =
+        MakeUnique<MemoryAllocator>(device_, physical_memory_properties_);
+  }
+
+  if (!staging_ring_) {
+    staging_ring_ =
+        MakeUnique<StagingRing>(device_, kStagingRingSize, allocator_.get());
+  }
+
+  if (pipeline_cache_ == VK_NULL_HANDLE)
+    return CreatePipelineCache();
+  return {};
+}
+
+std::string Device::GetPipelineCacheFilename() const {
+  // Devices provided by the application do not tell us their physical device.
+  if (pipeline_cache_directory_.empty() || physical_device_ == VK_NULL_HANDLE)
+    return "";
+
+  static const char kHexDigits[] = "0123456789abcdef";
+  std::string uuid;
+  for (uint32_t i = 0; i < VK_UUID_SIZE; ++i) {
+    uint8_t byte = physical_device_properties_.pipelineCacheUUID[i];
+    uuid.push_back(kHexDigits[byte >> 4]);
+    uuid.push_back(kHexDigits[byte & 0xf]);
+  }
+
+  std::string directory = pipeline_cache_directory_;
+  if (directory.back() != '/' && directory.back() != '\\')
+    directory += "/";
+  return directory + "amber_pipeline_cache_" +
+         std::to_string(physical_device_properties_.vendorID) + "_" +
+         std::to_string(physical_device_properties_.deviceID) + "_" + uuid +
+         ".bin";
+}
+
+Result Device::CreatePipelineCache() {
+  std::vector<char> data;
+  const std::string filename = GetPipelineCacheFilename();
+  if (!filename.empty()) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file) {
+      fseek(file, 0, SEEK_END);
+      long size = ftell(file);
+      fseek(file, 0, SEEK_SET);
+      if (size > 0) {
+        data.resize(static_cast<size_t>(size));
+        if (fread(data.data(), 1, data.size(), file) != data.size())
+          data.clear();
+      }
+      fclose(file);
+    }
+  }
+
+  VkPipelineCacheCreateInfo info = {};
+  info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  info.initialDataSize = data.size();
+  info.pInitialData = data.empty() ? nullptr : data.data();
+
+  if (vkCreatePipelineCache(device_, &info, nullptr, &pipeline_cache_) !=
+      VK_SUCCESS) {
+    return Result("Vulkan::Calling vkCreatePipelineCache Fail");
+  }
+
+  pipeline_cache_loaded_bytes_ = data.size();
   return {};
 }
 
+void Device::StorePipelineCache() {
+  const std::string filename = GetPipelineCacheFilename();
+  if (filename.empty())
+    return;
+
+  size_t size = 0;
+  if (vkGetPipelineCacheData(device_, pipeline_cache_, &size, nullptr) !=
+          VK_SUCCESS ||
+      size == 0) {
+    return;
+  }
+
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(device_, pipeline_cache_, &size, data.data()) !=
+      VK_SUCCESS) {
+    return;
+  }
+
+  // Failing to store the cache only makes the next run slower.
+  FILE* file = fopen(filename.c_str(), "wb");
+  if (!file)
+    return;
+
+  if (fwrite(data.data(), 1, size, file) == size)
+    pipeline_cache_stored_bytes_ = size;
+  fclose(file);
+}
+
 bool Device::ChooseQueueFamilyIndex(const VkPhysicalDevice& physical_device) {
   uint32_t count;
   std::vector<VkQueueFamilyProperties> properties;
@@ -120,6 +242,7 @@ Result Device::ChoosePhysicalDevice() {
 
     if (ChooseQueueFamilyIndex(physical_devices[i])) {
       physical_device_ = physical_devices[i];
+      physical_device_properties_ = property;
       vkGetPhysicalDeviceMemoryProperties(physical_device_,
                                           &physical_memory_properties_);
       return {};
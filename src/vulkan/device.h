@@ -16,8 +16,11 @@
 #define SRC_VULKAN_DEVICE_H_
 
 #include <memory>
+#include <string>
 
 #include "amber/result.h"
+#include "src/vulkan/memory_allocator.h"
+#include "src/vulkan/staging_ring.h"
 #include "vulkan/vulkan.h"
 
 namespace amber {
@@ -30,6 +33,12 @@ class Device {
   explicit Device(VkDevice device);
   ~Device();
 
+  // Sets the directory the pipeline cache is loaded from at Initialize() and
+  // stored to at Shutdown(). Empty keeps the cache in memory only.
+  void SetPipelineCacheDirectory(const std::string& directory) {
+    pipeline_cache_directory_ = directory;
+  }
+
   Result Initialize();
   void Shutdown();
 
@@ -39,6 +48,20 @@ class Device {
   const VkPhysicalDeviceMemoryProperties& GetPhysicalMemoryProperties() const {
     return physical_memory_properties_;
   }
+  VkPipelineCache GetPipelineCache() const { return pipeline_cache_; }
+  // Buffers and images of the device take their memory from here.
+  MemoryAllocator* GetMemoryAllocator() const { return allocator_.get(); }
+  // Uploads to and readbacks from device local resources go through here.
+  StagingRing* GetStagingRing() const { return staging_ring_.get(); }
+
+  // Sizes of the pipeline cache data read at Initialize() and written at
+  // Shutdown(), in bytes.
+  size_t GetPipelineCacheLoadedBytes() const {
+    return pipeline_cache_loaded_bytes_;
+  }
+  size_t GetPipelineCacheStoredBytes() const {
+    return pipeline_cache_stored_bytes_;
+  }
 
  private:
   Result CreateInstance();
@@ -57,8 +80,16 @@ class Device {
   // Create a logical device.
   Result CreateDevice();
 
+  // The file the pipeline cache is persisted in, named after the vendor,
+  // device and pipeline cache UUID so drivers never see data they did not
+  // write. Empty if the cache is not persisted.
+  std::string GetPipelineCacheFilename() const;
+  Result CreatePipelineCache();
+  void StorePipelineCache();
+
   VkInstance instance_ = VK_NULL_HANDLE;
   VkPhysicalDevice physical_device_ = VK_NULL_HANDLE;
+  VkPhysicalDeviceProperties physical_device_properties_ = {};
   VkPhysicalDeviceMemoryProperties physical_memory_properties_ = {};
   VkDevice device_ = VK_NULL_HANDLE;
   VkQueueFlags queue_family_flags_ = 0;
@@ -66,6 +97,14 @@ class Device {
 
   VkQueue queue_ = VK_NULL_HANDLE;
 
+  std::unique_ptr<MemoryAllocator> allocator_;
+  std::unique_ptr<StagingRing> staging_ring_;
+
+  std::string pipeline_cache_directory_;
+  VkPipelineCache pipeline_cache_ = VK_NULL_HANDLE;
+  size_t pipeline_cache_loaded_bytes_ = 0;
+  size_t pipeline_cache_stored_bytes_ = 0;
+
   bool destroy_device_ = true;
 };
 
@@ -0,0 +1,356 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/device_verifier.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "src/builtin_shaders.h"
+#include "src/make_unique.h"
+#include "src/vulkan/shader_module_library.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+// Must match the LocalSize of kProbeVerifyShader.
+const uint32_t kWorkgroupSize = 64;
+// Larger probes loop over the values in each invocation.
+const uint32_t kMaxWorkgroups = 65535;
+
+// The push constants of kProbeVerifyShader.
+struct Params {
+  uint32_t first_word;
+  uint32_t value_count;
+  uint32_t bounds_count;
+  uint32_t unorm8;
+};
+
+const uint32_t kValuesBinding = 0;
+const uint32_t kBoundsBinding = 1;
+const uint32_t kResultBinding = 2;
+const uint32_t kBindingCount = 3;
+
+}  // namespace
+
+const uint32_t DeviceVerifier::kMinValues;
+const size_t DeviceVerifier::kMaxValueBytes;
+
+DeviceVerifier::DeviceVerifier(VkDevice device,
+                               MemoryAllocator* allocator,
+                               StagingRing* staging_ring,
+                               VkPipelineCache pipeline_cache)
+    : device_(device),
+      allocator_(allocator),
+      staging_ring_(staging_ring),
+      pipeline_cache_(pipeline_cache) {}
+
+DeviceVerifier::~DeviceVerifier() = default;
+
+Result DeviceVerifier::Initialize() {
+  Result r = CreateDescriptorSet();
+  if (!r.IsSuccess())
+    return r;
+
+  r = CreatePipeline();
+  if (!r.IsSuccess())
+    return r;
+
+  return EnsureBuffer(2 * sizeof(uint32_t),
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                      &result_);
+}
+
+Result DeviceVerifier::CreateDescriptorSet() {
+  VkDescriptorSetLayoutBinding bindings[kBindingCount] = {};
+  for (uint32_t i = 0; i < kBindingCount; ++i) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+
+  VkDescriptorSetLayoutCreateInfo layout_info = {};
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.bindingCount = kBindingCount;
+  layout_info.pBindings = bindings;
+  if (vkCreateDescriptorSetLayout(device_, &layout_info, nullptr,
+                                  &descriptor_set_layout_) != VK_SUCCESS) {
+    return Result("Vulkan::Calling vkCreateDescriptorSetLayout Fail");
+  }
+
+  VkDescriptorPoolSize pool_size = {};
+  pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  pool_size.descriptorCount = kBindingCount;
+
+  VkDescriptorPoolCreateInfo pool_info = {};
+  pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  pool_info.maxSets = 1;
+  pool_info.poolSizeCount = 1;
+  pool_info.pPoolSizes = &pool_size;
+  if (vkCreateDescriptorPool(device_, &pool_info, nullptr,
+                             &descriptor_pool_) != VK_SUCCESS) {
+    return Result("Vulkan::Calling vkCreateDescriptorPool Fail");
+  }
+
+  VkDescriptorSetAllocateInfo set_info = {};
+  set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  set_info.descriptorPool = descriptor_pool_;
+  set_info.descriptorSetCount = 1;
+  set_info.pSetLayouts = &descriptor_set_layout_;
+  if (vkAllocateDescriptorSets(device_, &set_info, &descriptor_set_) !=
+      VK_SUCCESS) {
+    return Result("Vulkan::Calling vkAllocateDescriptorSets Fail");
+  }
+
+  return {};
+}
+
+Result DeviceVerifier::CreatePipeline() {
+  VkPushConstantRange push_constants = {};
+  push_constants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  push_constants.offset = 0;
+  push_constants.size = sizeof(Params);
+
+  VkPipelineLayoutCreateInfo layout_info = {};
+  layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  layout_info.setLayoutCount = 1;
+  layout_info.pSetLayouts = &descriptor_set_layout_;
+  layout_info.pushConstantRangeCount = 1;
+  layout_info.pPushConstantRanges = &push_constants;
+  if (vkCreatePipelineLayout(device_, &layout_info, nullptr,
+                             &pipeline_layout_) != VK_SUCCESS) {
+    return Result("Vulkan::Calling vkCreatePipelineLayout Fail");
+  }
+
+  const std::vector<uint32_t> spirv(
+      kProbeVerifyShaderSpirv,
+      kProbeVerifyShaderSpirv +
+          sizeof(kProbeVerifyShaderSpirv) / sizeof(kProbeVerifyShaderSpirv[0]));
+  Result r =
+      ShaderModuleLibrary::Get().Acquire(device_, spirv, "main", &module_);
+  if (!r.IsSuccess())
+    return r;
+
+  VkComputePipelineCreateInfo pipeline_info = {};
+  pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipeline_info.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipeline_info.stage.module = module_;
+  pipeline_info.stage.pName = "main";
+  pipeline_info.layout = pipeline_layout_;
+  pipeline_info.basePipelineIndex = -1;
+  if (vkCreateComputePipelines(device_, pipeline_cache_, 1, &pipeline_info,
+                               nullptr, &pipeline_) != VK_SUCCESS) {
+    return Result("Vulkan::Calling vkCreateComputePipelines Fail");
+  }
+
+  return {};
+}
+
+Result DeviceVerifier::EnsureBuffer(size_t size,
+                                    VkBufferUsageFlags usage,
+                                    std::unique_ptr<Buffer>* buffer) {
+  if (*buffer && (*buffer)->GetSizeInBytes() >= size)
+    return {};
+
+  if (*buffer)
+    (*buffer)->Shutdown();
+  *buffer = MakeUnique<Buffer>(device_, size, allocator_, staging_ring_);
+  return (*buffer)->Initialize(usage);
+}
+
+Result DeviceVerifier::GetScratchBuffer(size_t size, VkBuffer* buffer) {
+  Result r = EnsureBuffer(size,
+                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                              VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                          &scratch_);
+  if (!r.IsSuccess())
+    return r;
+
+  *buffer = scratch_->GetVkBuffer();
+  return {};
+}
+
+Result DeviceVerifier::UploadBounds(CommandBuffer* command,
+                                   const std::vector<float>& bounds) {
+  Result r = command->BeginIfNotInRecording();
+  if (!r.IsSuccess())
+    return r;
+
+  // The bounds of a large probe can be larger than the staging ring, so
+  // they are copied a region at a time. When the regions of the batch being
+  // recorded fill the ring, the batch is submitted to make room.
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(bounds.data());
+  const size_t size = bounds.size() * sizeof(float);
+  const size_t chunk_size =
+      static_cast<size_t>(staging_ring_->GetMaxRegionSize());
+  for (size_t offset = 0; offset < size; offset += chunk_size) {
+    const size_t n = std::min(chunk_size, size - offset);
+    r = bounds_->CopyRangeToDevice(command->GetCommandBuffer(), offset, n,
+                                   data + offset);
+    if (r.IsSuccess())
+      continue;
+
+    r = command->End();
+    if (!r.IsSuccess())
+      return r;
+    r = command->Submit();
+    if (!r.IsSuccess())
+      return r;
+    r = command->BeginIfNotInRecording();
+    if (!r.IsSuccess())
+      return r;
+
+    r = bounds_->CopyRangeToDevice(command->GetCommandBuffer(), offset, n,
+                                   data + offset);
+    if (!r.IsSuccess())
+      return r;
+  }
+  return {};
+}
+
+Result DeviceVerifier::Verify(CommandBuffer* command,
+                              VkBuffer values,
+                              uint32_t first_word,
+                              uint32_t count,
+                              bool unorm8,
+                              const std::vector<float>& bounds,
+                              Mismatches* mismatches) {
+  if (bounds.empty() || bounds.size() % 2 != 0)
+    return Result("Vulkan::DeviceVerifier needs pairs of bounds");
+
+  *mismatches = Mismatches();
+  if (count == 0)
+    return {};
+
+  const size_t bounds_size = bounds.size() * sizeof(float);
+  Result r = EnsureBuffer(
+      bounds_size,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      &bounds_);
+  if (!r.IsSuccess())
+    return r;
+
+  r = UploadBounds(command, bounds);
+  if (!r.IsSuccess())
+    return r;
+
+  VkCommandBuffer cmd = command->GetCommandBuffer();
+
+  vkCmdFillBuffer(cmd, result_->GetVkBuffer(), 0, sizeof(uint32_t), 0);
+  vkCmdFillBuffer(cmd, result_->GetVkBuffer(), sizeof(uint32_t),
+                  sizeof(uint32_t), ~0U);
+
+  // Covers the uploads above and the earlier writes of the values, by
+  // shaders or by copies.
+  VkMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask =
+      VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+
+  VkDescriptorBufferInfo buffer_infos[kBindingCount] = {};
+  buffer_infos[kValuesBinding].buffer = values;
+  buffer_infos[kValuesBinding].range = VK_WHOLE_SIZE;
+  buffer_infos[kBoundsBinding].buffer = bounds_->GetVkBuffer();
+  buffer_infos[kBoundsBinding].range = VK_WHOLE_SIZE;
+  buffer_infos[kResultBinding].buffer = result_->GetVkBuffer();
+  buffer_infos[kResultBinding].range = VK_WHOLE_SIZE;
+
+  VkWriteDescriptorSet writes[kBindingCount] = {};
+  for (uint32_t i = 0; i < kBindingCount; ++i) {
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet = descriptor_set_;
+    writes[i].dstBinding = i;
+    writes[i].descriptorCount = 1;
+    writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[i].pBufferInfo = &buffer_infos[i];
+  }
+  // The last Verify() waited for the device, so the set is not in use.
+  vkUpdateDescriptorSets(device_, kBindingCount, writes, 0, nullptr);
+
+  Params params;
+  params.first_word = first_word;
+  params.value_count = count;
+  params.bounds_count = static_cast<uint32_t>(bounds.size() / 2);
+  params.unorm8 = unorm8 ? 1 : 0;
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          pipeline_layout_, 0, 1, &descriptor_set_, 0,
+                          nullptr);
+  vkCmdPushConstants(cmd, pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                     sizeof(params), &params);
+  const uint32_t groups = std::min(
+      (count + kWorkgroupSize - 1) / kWorkgroupSize, kMaxWorkgroups);
+  vkCmdDispatch(cmd, groups, 1, 1);
+
+  r = result_->CopyToHost(cmd, 0, 2 * sizeof(uint32_t));
+  if (!r.IsSuccess())
+    return r;
+
+  r = command->End();
+  if (!r.IsSuccess())
+    return r;
+
+  r = command->SubmitAndReset();
+  if (!r.IsSuccess())
+    return r;
+
+  uint32_t result[2];
+  memcpy(result, result_->HostAccessibleBytePtr(0), sizeof(result));
+  mismatches->count = result[0];
+  mismatches->first = result[1];
+  return {};
+}
+
+void DeviceVerifier::Shutdown() {
+  if (scratch_)
+    scratch_->Shutdown();
+  if (bounds_)
+    bounds_->Shutdown();
+  if (result_)
+    result_->Shutdown();
+  scratch_ = nullptr;
+  bounds_ = nullptr;
+  result_ = nullptr;
+
+  if (pipeline_ != VK_NULL_HANDLE)
+    vkDestroyPipeline(device_, pipeline_, nullptr);
+  if (module_ != VK_NULL_HANDLE)
+    ShaderModuleLibrary::Get().Release(device_, module_);
+  if (pipeline_layout_ != VK_NULL_HANDLE)
+    vkDestroyPipelineLayout(device_, pipeline_layout_, nullptr);
+  if (descriptor_pool_ != VK_NULL_HANDLE)
+    vkDestroyDescriptorPool(device_, descriptor_pool_, nullptr);
+  if (descriptor_set_layout_ != VK_NULL_HANDLE)
+    vkDestroyDescriptorSetLayout(device_, descriptor_set_layout_, nullptr);
+  pipeline_ = VK_NULL_HANDLE;
+  module_ = VK_NULL_HANDLE;
+  pipeline_layout_ = VK_NULL_HANDLE;
+  descriptor_pool_ = VK_NULL_HANDLE;
+  descriptor_set_layout_ = VK_NULL_HANDLE;
+}
+
+}  // namespace vulkan
+}  // namespace amber
@@ -0,0 +1,113 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_VULKAN_DEVICE_VERIFIER_H_
+#define SRC_VULKAN_DEVICE_VERIFIER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "amber/result.h"
+#include "src/vulkan/buffer.h"
+#include "src/vulkan/command.h"
+#include "src/vulkan/memory_allocator.h"
+#include "src/vulkan/staging_ring.h"
+#include "vulkan/vulkan.h"
+
+namespace amber {
+namespace vulkan {
+
+// Compares values in device memory against bounds with a built-in compute
+// shader. Only the number of failing values and the index of the first of
+// them are read back, instead of the values. Probes use it for large
+// comparisons when probing on the device is enabled, and read back only what
+// they need to describe a failure.
+class DeviceVerifier {
+ public:
+  struct Mismatches {
+    uint32_t count = 0;
+    // Index of the first failing value.
+    uint32_t first = 0;
+  };
+
+  // Probes with fewer values than this are compared on the host, where
+  // reading them back costs less than a dispatch.
+  static const uint32_t kMinValues = 16 * 1024;
+  // Values must fit in the storage buffer range every device supports.
+  static const size_t kMaxValueBytes = 1 << 27;
+
+  DeviceVerifier(VkDevice device,
+                 MemoryAllocator* allocator,
+                 StagingRing* staging_ring,
+                 VkPipelineCache pipeline_cache);
+  ~DeviceVerifier();
+
+  Result Initialize();
+  void Shutdown();
+
+  // Returns a buffer of at least |size| bytes for values which are not in a
+  // storage buffer already, such as the pixels of an image. The contents
+  // are kept until the next call.
+  Result GetScratchBuffer(size_t size, VkBuffer* buffer);
+
+  // Compares |count| values starting at word |first_word| of |values|
+  // against |bounds|, which holds a lo, hi pair for each value and repeats
+  // when it has fewer pairs than there are values. The values are floats,
+  // or bytes when |unorm8| is set, which are compared as 0 to 255. Records
+  // into |command|, which must be outside of a render pass, then submits it
+  // and waits. Earlier writes to |values| are waited for.
+  Result Verify(CommandBuffer* command,
+                VkBuffer values,
+                uint32_t first_word,
+                uint32_t count,
+                bool unorm8,
+                const std::vector<float>& bounds,
+                Mismatches* mismatches);
+
+ private:
+  Result CreateDescriptorSet();
+  Result CreatePipeline();
+  // Records the upload of |bounds| to |bounds_|, submitting the commands
+  // recorded so far when the staging ring runs out of room.
+  Result UploadBounds(CommandBuffer* command,
+                      const std::vector<float>& bounds);
+  // Makes |buffer| a storage buffer of at least |size| bytes.
+  Result EnsureBuffer(size_t size,
+                      VkBufferUsageFlags usage,
+                      std::unique_ptr<Buffer>* buffer);
+
+  VkDevice device_ = VK_NULL_HANDLE;
+  MemoryAllocator* allocator_ = nullptr;
+  StagingRing* staging_ring_ = nullptr;
+  VkPipelineCache pipeline_cache_ = VK_NULL_HANDLE;
+
+  VkShaderModule module_ = VK_NULL_HANDLE;
+  VkDescriptorSetLayout descriptor_set_layout_ = VK_NULL_HANDLE;
+  VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
+  VkPipeline pipeline_ = VK_NULL_HANDLE;
+  VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
+  VkDescriptorSet descriptor_set_ = VK_NULL_HANDLE;
+
+  std::unique_ptr<Buffer> scratch_;
+  std::unique_ptr<Buffer> bounds_;
+  // The mismatch count and first failing index the shader writes.
+  std::unique_ptr<Buffer> result_;
+};
+
+}  // namespace vulkan
+}  // namespace amber
+
+#endif  // SRC_VULKAN_DEVICE_VERIFIER_H_
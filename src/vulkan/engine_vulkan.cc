@@ -17,8 +17,10 @@
 #include <algorithm>
 
 #include "src/make_unique.h"
+#include "src/vulkan/compute_pipeline.h"
 #include "src/vulkan/format_data.h"
 #include "src/vulkan/graphics_pipeline.h"
+#include "src/vulkan/shader_module_library.h"
 
 namespace amber {
 namespace vulkan {
@@ -26,7 +28,16 @@ namespace {
 
 const uint32_t kFramebufferWidth = 250;
 const uint32_t kFramebufferHeight = 250;
-const VkFormat kDefaultColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+Format DefaultColorFormat() {
+  Format format;
+  format.SetFormatType(FormatType::kR8G8B8A8_UNORM);
+  format.AddComponent(FormatComponentType::kR, FormatMode::kUNorm, 8);
+  format.AddComponent(FormatComponentType::kG, FormatMode::kUNorm, 8);
+  format.AddComponent(FormatComponentType::kB, FormatMode::kUNorm, 8);
+  format.AddComponent(FormatComponentType::kA, FormatMode::kUNorm, 8);
+  return format;
+}
 
 VkShaderStageFlagBits ToVkShaderStage(ShaderType type) {
   switch (type) {
@@ -54,7 +65,14 @@ EngineVulkan::EngineVulkan() : Engine() {}
 
 EngineVulkan::~EngineVulkan() = default;
 
+void EngineVulkan::SetPipelineCacheOptions(const std::string& directory,
+                                           bool compare) {
+  pipeline_cache_directory_ = directory;
+  compare_pipeline_cache_ = compare;
+}
+
 Result EngineVulkan::InitDeviceAndCreateCommand() {
+  device_->SetPipelineCacheDirectory(pipeline_cache_directory_);
   Result r = device_->Initialize();
   if (!r.IsSuccess())
     return r;
@@ -66,6 +84,15 @@ Result EngineVulkan::InitDeviceAndCreateCommand() {
       return r;
   }
 
+  if (probe_on_device_ && !device_verifier_) {
+    device_verifier_ = MakeUnique<DeviceVerifier>(
+        device_->GetDevice(), device_->GetMemoryAllocator(),
+        device_->GetStagingRing(), device_->GetPipelineCache());
+    r = device_verifier_->Initialize();
+    if (!r.IsSuccess())
+      return r;
+  }
+
   return {};
 }
 
@@ -89,11 +116,24 @@ Result EngineVulkan::InitializeWithDevice(void* default_device) {
   return InitDeviceAndCreateCommand();
 }
 
+// static
+void EngineVulkan::ReleaseDevice(void* device) {
+  ShaderModuleLibrary::Get().ReleaseDevice(static_cast<VkDevice>(device));
+}
+
 Result EngineVulkan::Shutdown() {
   for (auto it = modules_.begin(); it != modules_.end(); ++it)
-    vkDestroyShaderModule(device_->GetDevice(), it->second, nullptr);
+    ShaderModuleLibrary::Get().Release(device_->GetDevice(), it->second);
+  modules_.clear();
 
-  pipeline_->Shutdown();
+  if (pipeline_) {
+    AddPipelineCacheStats();
+    pipeline_->Shutdown();
+  }
+  if (device_verifier_)
+    device_verifier_->Shutdown();
+  if (!retain_shader_modules_)
+    ShaderModuleLibrary::Get().ReleaseUnused(device_->GetDevice());
   pool_->Shutdown();
   device_->Shutdown();
   return {};
@@ -112,17 +152,25 @@ Result EngineVulkan::AddRequirement(Feature feature, const Format* fmt) {
 }
 
 Result EngineVulkan::CreatePipeline(PipelineType type) {
-  if (type == PipelineType::kCompute)
-    return Result("Vulkan::Compute Pipeline Not Implemented");
+  if (type == PipelineType::kCompute) {
+    pipeline_ = MakeUnique<ComputePipeline>(
+        device_->GetDevice(), device_->GetMemoryAllocator(),
+        device_->GetStagingRing(), GetShaderStageInfo());
+    pipeline_->SetPipelineCache(device_->GetPipelineCache(),
+                                compare_pipeline_cache_);
+    return pipeline_->AsCompute()->Initialize(pool_->GetCommandPool(),
+                                              device_->GetQueue());
+  }
 
-  VkFormat frame_buffer_format = kDefaultColorFormat;
+  const Format default_color_format = DefaultColorFormat();
+  const Format* frame_buffer_format = &default_color_format;
   auto it_frame_buffer =
       std::find_if(requirements_.begin(), requirements_.end(),
                    [](const EngineVulkan::Requirement& req) {
                      return req.feature == Feature::kFramebuffer;
                    });
   if (it_frame_buffer != requirements_.end()) {
-    frame_buffer_format = ToVkFormat(it_frame_buffer->format->GetFormatType());
+    frame_buffer_format = it_frame_buffer->format;
   }
 
   VkFormat depth_stencil_format = VK_FORMAT_UNDEFINED;
@@ -137,38 +185,86 @@ Result EngineVulkan::CreatePipeline(PipelineType type) {
   }
 
   pipeline_ = MakeUnique<GraphicsPipeline>(
-      type, device_->GetDevice(), device_->GetPhysicalMemoryProperties(),
-      frame_buffer_format, depth_stencil_format, GetShaderStageInfo());
+      type, device_->GetDevice(), device_->GetMemoryAllocator(),
+      device_->GetStagingRing(),
+      *frame_buffer_format, depth_stencil_format, GetShaderStageInfo());
+  pipeline_->SetPipelineCache(device_->GetPipelineCache(),
+                              compare_pipeline_cache_);
+  pipeline_->AsGraphics()->SetPixelProbeOptions(probe_early_exit_,
+                                                probe_max_threads_);
 
   return pipeline_->AsGraphics()->Initialize(
       kFramebufferWidth, kFramebufferHeight, pool_->GetCommandPool(),
       device_->GetQueue());
 }
 
-Result EngineVulkan::SetShader(ShaderType type,
-                               const std::vector<uint32_t>& data) {
-  if (type == ShaderType::kCompute)
-    return Result("Vulkan::Compute Pipeline Not Implemented");
+void EngineVulkan::AddPipelineCacheStats() {
+  // Pipelines create their VkPipeline when first used, so the times are
+  // only known once they are done with.
+  ++pipeline_cache_stats_.pipelines;
+  pipeline_cache_stats_.cached_ms += pipeline_->GetCreationMs();
+  pipeline_cache_stats_.uncached_ms += pipeline_->GetUncachedCreationMs();
+}
 
-  VkShaderModuleCreateInfo info = {};
-  info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-  info.codeSize = data.size() * sizeof(uint32_t);
-  info.pCode = data.data();
+Result EngineVulkan::ResetPipeline() {
+  if (pipeline_) {
+    AddPipelineCacheStats();
+    pipeline_->Shutdown();
+    pipeline_ = nullptr;
+  }
+
+  for (auto it = modules_.begin(); it != modules_.end(); ++it)
+    ShaderModuleLibrary::Get().Release(device_->GetDevice(), it->second);
 
+  modules_.clear();
+  specialization_.clear();
+  return {};
+}
+
+Result EngineVulkan::SetShader(ShaderType type,
+                               const std::vector<uint32_t>& data) {
   auto it = modules_.find(type);
   if (it != modules_.end())
     return Result("Vulkan::Setting Duplicated Shader Types Fail");
 
   VkShaderModule shader;
-  if (vkCreateShaderModule(device_->GetDevice(), &info, nullptr, &shader) !=
-      VK_SUCCESS) {
-    return Result("Vulkan::Calling vkCreateShaderModule Fail");
-  }
+  Result r = ShaderModuleLibrary::Get().Acquire(
+      device_->GetDevice(), data, GetEntryPoint(type), &shader);
+  if (!r.IsSuccess())
+    return r;
 
   modules_[type] = shader;
   return {};
 }
 
+Result EngineVulkan::SetShaderSpecialization(
+    ShaderType type,
+    const std::map<uint32_t, uint32_t>& constants) {
+  if (constants.empty()) {
+    specialization_.erase(type);
+    return {};
+  }
+
+  Specialization& spec = specialization_[type];
+  spec.entries.clear();
+  spec.data.clear();
+  for (const auto& constant : constants) {
+    VkSpecializationMapEntry entry = {};
+    entry.constantID = constant.first;
+    entry.offset = static_cast<uint32_t>(spec.data.size() * sizeof(uint32_t));
+    entry.size = sizeof(uint32_t);
+    spec.entries.push_back(entry);
+    spec.data.push_back(constant.second);
+  }
+
+  spec.info = {};
+  spec.info.mapEntryCount = static_cast<uint32_t>(spec.entries.size());
+  spec.info.pMapEntries = spec.entries.data();
+  spec.info.dataSize = spec.data.size() * sizeof(uint32_t);
+  spec.info.pData = spec.data.data();
+  return {};
+}
+
 std::vector<VkPipelineShaderStageCreateInfo>
 EngineVulkan::GetShaderStageInfo() {
   std::vector<VkPipelineShaderStageCreateInfo> stage_info(modules_.size());
@@ -179,8 +275,12 @@ EngineVulkan::GetShaderStageInfo() {
         VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     stage_info[stage_count].stage = ToVkShaderStage(it.first);
     stage_info[stage_count].module = it.second;
-    // TODO(jaebaek): Handle entry point command
-    stage_info[stage_count].pName = "main";
+    stage_info[stage_count].pName = GetEntryPoint(it.first).c_str();
+
+    auto spec = specialization_.find(it.first);
+    if (spec != specialization_.end())
+      stage_info[stage_count].pSpecializationInfo = &spec->second.info;
+
     ++stage_count;
   }
   return stage_info;
@@ -198,8 +298,19 @@ Result EngineVulkan::SetBuffer(BufferType type,
   if (!pipeline_->IsGraphics())
     return Result("Vulkan::SetBuffer for Non-Graphics Pipeline");
 
-  pipeline_->AsGraphics()->SetBuffer(type, location, format, values);
-  return {};
+  return pipeline_->AsGraphics()->SetBuffer(type, location, format, values);
+}
+
+Result EngineVulkan::SetBufferData(BufferType type,
+                                   uint8_t location,
+                                   const BufferView& view) {
+  if (!pipeline_)
+    return Result("Vulkan::SetBufferData no Pipeline exists");
+
+  if (!pipeline_->IsGraphics())
+    return Result("Vulkan::SetBufferData for Non-Graphics Pipeline");
+
+  return pipeline_->AsGraphics()->SetBufferData(type, location, view);
 }
 
 Result EngineVulkan::DoClearColor(const ClearColorCommand* command) {
@@ -242,12 +353,56 @@ Result EngineVulkan::DoDrawArrays(const DrawArraysCommand*) {
   return pipeline_->AsGraphics()->Draw();
 }
 
-Result EngineVulkan::DoCompute(const ComputeCommand*) {
-  return Result("Vulkan::DoCompute Not Implemented");
+Result EngineVulkan::DoCompute(const ComputeCommand* command) {
+  if (!pipeline_->IsCompute())
+    return Result("Vulkan::Compute Command for Non-Compute Pipeline");
+
+  return pipeline_->AsCompute()->Compute(command->GetX(), command->GetY(),
+                                         command->GetZ());
+}
+
+Result EngineVulkan::DoEntryPoint(const EntryPointCommand* cmd) {
+  // Used by the pipelines created after this command, and applied to the
+  // current one from its next draw or dispatch.
+  entry_points_[cmd->GetShaderType()] = cmd->GetEntryPointName();
+  if (!pipeline_)
+    return {};
+
+  if (modules_.count(cmd->GetShaderType()) == 0)
+    return Result("Vulkan::EntryPoint for a shader type without a shader");
+
+  return pipeline_->SetEntryPoint(ToVkShaderStage(cmd->GetShaderType()),
+                                  cmd->GetEntryPointName());
+}
+
+const std::string& EngineVulkan::GetEntryPoint(ShaderType type) {
+  // Shaders without an entrypoint command use "main".
+  return entry_points_.emplace(type, "main").first->second;
+}
+
+PipelineCacheStats EngineVulkan::GetPipelineCacheStats() {
+  PipelineCacheStats stats = pipeline_cache_stats_;
+  if (device_) {
+    stats.loaded_bytes = device_->GetPipelineCacheLoadedBytes();
+    stats.stored_bytes = device_->GetPipelineCacheStoredBytes();
+  }
+  return stats;
+}
+
+double EngineVulkan::GetPipelineCreationMs() {
+  return pipeline_ ? pipeline_->GetCreationMs() : 0.0;
+}
+
+DeviceMemoryStats EngineVulkan::GetDeviceMemoryStats() {
+  if (!device_ || !device_->GetMemoryAllocator())
+    return {};
+  return device_->GetMemoryAllocator()->GetStats();
 }
 
-Result EngineVulkan::DoEntryPoint(const EntryPointCommand*) {
-  return Result("Vulkan::DoEntryPoint Not Implemented");
+ShaderModuleCacheStats EngineVulkan::GetShaderModuleCacheStats() {
+  if (!device_)
+    return {};
+  return ShaderModuleLibrary::Get().GetStats(device_->GetDevice());
 }
 
 Result EngineVulkan::DoPatchParameterVertices(
@@ -259,19 +414,63 @@ Result EngineVulkan::DoProbe(const ProbeCommand* command) {
   if (!pipeline_->IsGraphics())
     return Result("Vulkan::Probe FrameBuffer for Non-Graphics Pipeline");
 
-  return pipeline_->AsGraphics()->Probe(command);
+  return pipeline_->AsGraphics()->Probe(command, device_verifier_.get());
 }
 
-Result EngineVulkan::DoProbeSSBO(const ProbeSSBOCommand*) {
-  return Result("Vulkan::DoProbeSSBO Not Implemented");
+Result EngineVulkan::DoProbeSSBO(const ProbeSSBOCommand* command) {
+  if (!pipeline_)
+    return Result("Vulkan::DoProbeSSBO no Pipeline exists");
+
+  return pipeline_->ProbeSSBO(command, buffer_verifier_,
+                              device_verifier_.get());
 }
 
-Result EngineVulkan::DoBuffer(const BufferCommand*) {
-  return Result("Vulkan::DoBuffer Not Implemented");
+Result EngineVulkan::DoProbeHash(const ProbeHashCommand* command,
+                                 uint64_t* hash) {
+  if (!pipeline_)
+    return Result("Vulkan::DoProbeHash no Pipeline exists");
+
+  if (command->IsSSBO())
+    return pipeline_->HashSSBO(command, hash);
+
+  if (!pipeline_->IsGraphics())
+    return Result("Vulkan::Probe hash FrameBuffer for Non-Graphics Pipeline");
+
+  return pipeline_->AsGraphics()->HashColorAttachment(hash);
+}
+
+Result EngineVulkan::ReadColorAttachment(Rgba8Image* image) {
+  if (!pipeline_)
+    return Result("Vulkan::ReadColorAttachment no Pipeline exists");
+  if (!pipeline_->IsGraphics()) {
+    return Result(
+        "Vulkan::ReadColorAttachment FrameBuffer for Non-Graphics Pipeline");
+  }
+
+  return pipeline_->AsGraphics()->ReadColorAttachment(image);
 }
 
-Result EngineVulkan::DoTolerance(const ToleranceCommand*) {
-  return Result("Vulkan::DoTolerance Not Implemented");
+Result EngineVulkan::DoBuffer(const BufferCommand* command) {
+  if (!pipeline_)
+    return Result("Vulkan::DoBuffer no Pipeline exists");
+
+  // Draws do not bind descriptors or push constants yet.
+  if (!pipeline_->IsCompute())
+    return Result("Vulkan::DoBuffer for Non-Compute Pipeline Not Implemented");
+
+  return pipeline_->AddBufferData(command);
+}
+
+Result EngineVulkan::DoTolerance(const ToleranceCommand* command) {
+  // Probe ssbo commands of any pipeline use the tolerances.
+  Result r = buffer_verifier_.SetTolerances(command->GetTolerances());
+  if (!r.IsSuccess())
+    return r;
+
+  if (!pipeline_ || !pipeline_->IsGraphics())
+    return {};
+
+  return pipeline_->AsGraphics()->SetTolerances(command->GetTolerances());
 }
 
 }  // namespace vulkan
@@ -15,13 +15,18 @@
 #ifndef SRC_VULKAN_ENGINE_VULKAN_H_
 #define SRC_VULKAN_ENGINE_VULKAN_H_
 
+#include <map>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "src/cast_hash.h"
 #include "src/engine.h"
+#include "src/vulkan/buffer_verifier.h"
 #include "src/vulkan/command.h"
 #include "src/vulkan/device.h"
+#include "src/vulkan/device_verifier.h"
 #include "src/vulkan/pipeline.h"
 #include "vulkan/vulkan.h"
 
@@ -33,17 +38,39 @@ class EngineVulkan : public Engine {
   EngineVulkan();
   ~EngineVulkan() override;
 
+  // Destroys the shader modules kept for the application provided |device|.
+  static void ReleaseDevice(void* device);
+
   // Engine
+  void SetPipelineCacheOptions(const std::string& directory,
+                               bool compare) override;
+  void SetProbeOnDevice(bool probe_on_device) override {
+    probe_on_device_ = probe_on_device;
+  }
+  void SetPixelProbeOptions(bool early_exit, uint32_t max_threads) override {
+    probe_early_exit_ = early_exit;
+    probe_max_threads_ = max_threads;
+  }
+  void SetRetainShaderModules(bool retain) override {
+    retain_shader_modules_ = retain;
+  }
   Result Initialize() override;
   Result InitializeWithDevice(void* default_device) override;
   Result Shutdown() override;
   Result AddRequirement(Feature feature, const Format*) override;
   Result CreatePipeline(PipelineType type) override;
+  Result ResetPipeline() override;
   Result SetShader(ShaderType type, const std::vector<uint32_t>& data) override;
+  Result SetShaderSpecialization(
+      ShaderType type,
+      const std::map<uint32_t, uint32_t>& constants) override;
   Result SetBuffer(BufferType type,
                    uint8_t location,
                    const Format& format,
                    const std::vector<Value>& data) override;
+  Result SetBufferData(BufferType type,
+                       uint8_t location,
+                       const BufferView& view) override;
   Result DoClearColor(const ClearColorCommand* cmd) override;
   Result DoClearStencil(const ClearStencilCommand* cmd) override;
   Result DoClearDepth(const ClearDepthCommand* cmd) override;
@@ -56,19 +83,58 @@ class EngineVulkan : public Engine {
       const PatchParameterVerticesCommand* cmd) override;
   Result DoProbe(const ProbeCommand* cmd) override;
   Result DoProbeSSBO(const ProbeSSBOCommand* cmd) override;
+  Result DoProbeHash(const ProbeHashCommand* cmd, uint64_t* hash) override;
+  Result ReadColorAttachment(Rgba8Image* image) override;
   Result DoBuffer(const BufferCommand* cmd) override;
   Result DoTolerance(const ToleranceCommand* cmd) override;
+  ShaderModuleCacheStats GetShaderModuleCacheStats() override;
+  PipelineCacheStats GetPipelineCacheStats() override;
+  double GetPipelineCreationMs() override;
+  DeviceMemoryStats GetDeviceMemoryStats() override;
 
  private:
   Result InitDeviceAndCreateCommand();
+  // Adds the creation times of |pipeline_| before it is shut down.
+  void AddPipelineCacheStats();
 
   std::vector<VkPipelineShaderStageCreateInfo> GetShaderStageInfo();
+  const std::string& GetEntryPoint(ShaderType type);
 
   std::unique_ptr<Device> device_;
   std::unique_ptr<CommandPool> pool_;
   std::unique_ptr<Pipeline> pipeline_;
 
+  // Compares the values of probe ssbo commands, with the tolerances of the
+  // last tolerance command.
+  BufferVerifier buffer_verifier_;
+
+  // Compares large probes on the device. Only created when enabled.
+  bool probe_on_device_ = false;
+  std::unique_ptr<DeviceVerifier> device_verifier_;
+
+  // Passed to the pixel verifier of every graphics pipeline.
+  bool probe_early_exit_ = false;
+  uint32_t probe_max_threads_ = 0;
+
+  bool retain_shader_modules_ = false;
+
+  std::string pipeline_cache_directory_;
+  bool compare_pipeline_cache_ = false;
+  PipelineCacheStats pipeline_cache_stats_;
+
   std::unordered_map<ShaderType, VkShaderModule, CastHash<ShaderType>> modules_;
+  std::unordered_map<ShaderType, std::string, CastHash<ShaderType>>
+      entry_points_;
+
+  // |info| points into |entries| and |data|. The map below is node based so
+  // the pointers stay valid as other shader types are added.
+  struct Specialization {
+    std::vector<VkSpecializationMapEntry> entries;
+    std::vector<uint32_t> data;
+    VkSpecializationInfo info;
+  };
+  std::unordered_map<ShaderType, Specialization, CastHash<ShaderType>>
+      specialization_;
 
   struct Requirement {
     Feature feature;
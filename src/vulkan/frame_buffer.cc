@@ -30,12 +30,13 @@ Result FrameBuffer::Initialize(
     VkRenderPass render_pass,
     VkFormat color_format,
     VkFormat depth_format,
-    const VkPhysicalDeviceMemoryProperties& properties) {
+    MemoryAllocator* allocator,
+    StagingRing* staging_ring) {
   std::vector<VkImageView> attachments;
 
   if (color_format != VK_FORMAT_UNDEFINED) {
     color_image_ = MakeUnique<Image>(device_, color_format, width_, height_,
-                                     depth_, properties);
+                                     depth_, allocator, staging_ring);
     Result r = color_image_->Initialize(VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
                                         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
     if (!r.IsSuccess())
@@ -45,7 +46,7 @@ Result FrameBuffer::Initialize(
 
   if (depth_format != VK_FORMAT_UNDEFINED) {
     depth_image_ = MakeUnique<Image>(device_, depth_format, width_, height_,
-                                     depth_, properties);
+                                     depth_, allocator, staging_ring);
     Result r =
         depth_image_->Initialize(VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
                                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
@@ -28,16 +28,34 @@ class FrameBuffer {
   Result Initialize(VkRenderPass render_pass,
                     VkFormat color_format,
                     VkFormat depth_format,
-                    const VkPhysicalDeviceMemoryProperties& properties);
+                    MemoryAllocator* allocator,
+                    StagingRing* staging_ring);
   void Shutdown();
 
   VkFramebuffer GetFrameBuffer() const { return frame_; }
-  const void* GetColorBufferPtr() const {
-    return color_image_->HostAccessibleMemoryPtr();
+  // Returns the host copy of the color of the pixel at |x|, |y|.
+  const uint8_t* GetColorPixelPtr(uint32_t x, uint32_t y) const {
+    return color_image_->HostAccessibleTexelPtr(x, y);
   }
+  uint32_t GetColorRowPitch() const {
+    return color_image_->HostAccessibleRowPitch();
+  }
+  uint32_t GetColorTexelSize() const { return color_image_->GetTexelSize(); }
   VkImage GetColorImage() const { return color_image_->GetVkImage(); }
-  Result CopyColorImageToHost(VkCommandBuffer command) {
-    return color_image_->CopyToHost(command);
+  Result CopyColorImageToHost(VkCommandBuffer command,
+                              uint32_t x,
+                              uint32_t y,
+                              uint32_t width,
+                              uint32_t height) {
+    return color_image_->CopyToHost(command, x, y, width, height);
+  }
+  void CopyColorImageToBuffer(VkCommandBuffer command,
+                              uint32_t x,
+                              uint32_t y,
+                              uint32_t width,
+                              uint32_t height,
+                              VkBuffer buffer) {
+    color_image_->CopyToBuffer(command, x, y, width, height, buffer, 0);
   }
 
   uint32_t GetWidth() const { return width_; }
@@ -14,10 +14,16 @@
 
 #include "src/vulkan/graphics_pipeline.h"
 
-#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
 
 #include "src/command.h"
+#include "src/content_hash.h"
 #include "src/make_unique.h"
+#include "src/reference_image.h"
+#include "src/timer.h"
 #include "src/vulkan/format_data.h"
 
 namespace amber {
@@ -67,26 +73,24 @@ const VkPipelineMultisampleStateCreateInfo kMultisampleInfo = {
     VK_FALSE,                       /* alphaToOneEnable */
 };
 
-const float kEpsilon = 0.002f;
-
-bool IsFloatPixelEqualInt(float pixel, uint8_t expected) {
-  // TODO(jaebaek): Change kEpsilon to tolerance.
-  return std::fabs(pixel - static_cast<float>(expected) / 255.0f) < kEpsilon;
-}
-
 }  // namespace
 
 GraphicsPipeline::GraphicsPipeline(
     PipelineType type,
     VkDevice device,
-    const VkPhysicalDeviceMemoryProperties& properties,
-    VkFormat color_format,
+    MemoryAllocator* allocator,
+    StagingRing* staging_ring,
+    const Format& color_format,
     VkFormat depth_stencil_format,
     std::vector<VkPipelineShaderStageCreateInfo> shader_stage_info)
-    : Pipeline(type, device, properties),
-      color_format_(color_format),
-      depth_stencil_format_(depth_stencil_format),
-      shader_stage_info_(shader_stage_info) {}
+    : Pipeline(type,
+               device,
+               allocator,
+               staging_ring,
+               std::move(shader_stage_info)),
+      color_format_(ToVkFormat(color_format.GetFormatType())),
+      color_texel_format_(color_format),
+      depth_stencil_format_(depth_stencil_format) {}
 
 GraphicsPipeline::~GraphicsPipeline() = default;
 
@@ -255,10 +259,23 @@ Result GraphicsPipeline::CreateVkGraphicsPipeline() {
   pipeline_info.renderPass = render_pass_;
   pipeline_info.subpass = 0;
 
-  if (vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &pipeline_info,
+  if (compare_pipeline_cache_) {
+    auto start = std::chrono::steady_clock::now();
+    VkPipeline uncached = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &pipeline_info,
+                                  nullptr, &uncached) != VK_SUCCESS) {
+      return Result("Vulkan::Calling vkCreateGraphicsPipelines Fail");
+    }
+    uncached_creation_ms_ += MillisecondsSince(start);
+    vkDestroyPipeline(device_, uncached, nullptr);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  if (vkCreateGraphicsPipelines(device_, pipeline_cache_, 1, &pipeline_info,
                                 nullptr, &pipeline_) != VK_SUCCESS) {
     return Result("Vulkan::Calling vkCreateGraphicsPipelines Fail");
   }
+  creation_ms_ += MillisecondsSince(start);
 
   return {};
 }
@@ -275,9 +292,15 @@ Result GraphicsPipeline::Initialize(uint32_t width,
   if (!r.IsSuccess())
     return r;
 
+  if (color_format_ != VK_FORMAT_UNDEFINED) {
+    r = color_unpacker_.Initialize(color_texel_format_);
+    if (!r.IsSuccess())
+      return r;
+  }
+
   frame_ = MakeUnique<FrameBuffer>(device_, width, height);
   r = frame_->Initialize(render_pass_, color_format_, depth_stencil_format_,
-                         memory_properties_);
+                         allocator_, staging_ring_);
   if (!r.IsSuccess())
     return r;
 
@@ -287,18 +310,31 @@ Result GraphicsPipeline::Initialize(uint32_t width,
   return {};
 }
 
-void GraphicsPipeline::SetBuffer(BufferType type,
-                                 uint8_t location,
-                                 const Format& format,
-                                 const std::vector<Value>& values) {
+Result GraphicsPipeline::SetBuffer(BufferType type,
+                                   uint8_t location,
+                                   const Format& format,
+                                   const std::vector<Value>& values) {
   // TODO(jaebaek): Handle indices data.
   if (type != BufferType::kVertexData)
-    return;
+    return {};
+
+  if (!vertex_buffer_)
+    vertex_buffer_ = MakeUnique<VertexBuffer>(device_);
+
+  return vertex_buffer_->SetData(location, format, values);
+}
+
+Result GraphicsPipeline::SetBufferData(BufferType type,
+                                       uint8_t location,
+                                       const BufferView& view) {
+  // TODO(jaebaek): Handle indices data.
+  if (type != BufferType::kVertexData)
+    return {};
 
   if (!vertex_buffer_)
     vertex_buffer_ = MakeUnique<VertexBuffer>(device_);
 
-  vertex_buffer_->SetData(location, format, values);
+  return vertex_buffer_->SetData(location, view);
 }
 
 Result GraphicsPipeline::SendBufferDataIfNeeded() {
@@ -315,8 +351,18 @@ Result GraphicsPipeline::SendBufferDataIfNeeded() {
   DeactivateRenderPassIfNeeded();
 
   // TODO(jaebaek): Send indices data too.
-  return vertex_buffer_->SendVertexData(command_->GetCommandBuffer(),
-                                        memory_properties_);
+  r = vertex_buffer_->SendVertexData(command_->GetCommandBuffer(), allocator_,
+                                     staging_ring_);
+  if (!r.IsSuccess())
+    return r;
+
+  // The render pass is already ended for the copy, so start the upload and
+  // the work recorded before it while the draw is recorded.
+  r = command_->End();
+  if (!r.IsSuccess())
+    return r;
+
+  return command_->Submit();
 }
 
 void GraphicsPipeline::ActivateRenderPassIfNeeded() {
@@ -408,6 +454,9 @@ Result GraphicsPipeline::ClearBuffer(const VkClearValue& clear_value,
   if (!r.IsSuccess())
     return r;
 
+  color_copyable_ = false;
+  readback_valid_ = false;
+
   // TODO(jaebaek): When multiple clear and draw commands exist, handle
   //                begin/end render pass properly.
   ActivateRenderPassIfNeeded();
@@ -444,6 +493,8 @@ Result GraphicsPipeline::Draw() {
   if (!r.IsSuccess())
     return r;
 
+  color_copyable_ = false;
+  readback_valid_ = false;
   ActivateRenderPassIfNeeded();
 
   vkCmdBindPipeline(command_->GetCommandBuffer(),
@@ -462,15 +513,60 @@ Result GraphicsPipeline::Draw() {
   return {};
 }
 
-Result GraphicsPipeline::SubmitProbeCommand() {
-  Result r = command_->BeginIfNotInRecording();
-  if (!r.IsSuccess())
-    return r;
+void GraphicsPipeline::PrepareColorImageForCopy() {
+  // The render pass leaves the image ready to be copied. It stays in that
+  // layout until the next draw or clear.
+  if (color_copyable_)
+    return;
 
   ActivateRenderPassIfNeeded();
   DeactivateRenderPassIfNeeded();
+  color_copyable_ = true;
+}
+
+bool GraphicsPipeline::ReadbackContains(uint32_t x,
+                                        uint32_t y,
+                                        uint32_t width,
+                                        uint32_t height) const {
+  return readback_valid_ &&
+         readback_allocation_ == staging_ring_->GetAllocationCount() &&
+         x >= readback_x_ && y >= readback_y_ &&
+         x + width <= readback_x_ + readback_width_ &&
+         y + height <= readback_y_ + readback_height_;
+}
+
+Result GraphicsPipeline::SubmitProbeCommand(uint32_t x,
+                                            uint32_t y,
+                                            uint32_t width,
+                                            uint32_t height) {
+  if (width == 0 || height == 0)
+    return {};
+
+  if (readback_valid_ &&
+      readback_allocation_ != staging_ring_->GetAllocationCount()) {
+    readback_valid_ = false;
+  }
+
+  if (readback_valid_) {
+    if (ReadbackContains(x, y, width, height))
+      return {};
+
+    const uint32_t right = std::max(x + width, readback_x_ + readback_width_);
+    const uint32_t bottom =
+        std::max(y + height, readback_y_ + readback_height_);
+    x = std::min(x, readback_x_);
+    y = std::min(y, readback_y_);
+    width = right - x;
+    height = bottom - y;
+  }
+
+  Result r = command_->BeginIfNotInRecording();
+  if (!r.IsSuccess())
+    return r;
 
-  r = frame_->CopyColorImageToHost(command_->GetCommandBuffer());
+  PrepareColorImageForCopy();
+  r = frame_->CopyColorImageToHost(command_->GetCommandBuffer(), x, y, width,
+                                   height);
   if (!r.IsSuccess())
     return r;
 
@@ -478,7 +574,17 @@ Result GraphicsPipeline::SubmitProbeCommand() {
   if (!r.IsSuccess())
     return r;
 
-  return command_->SubmitAndReset();
+  r = command_->SubmitAndReset();
+  if (!r.IsSuccess())
+    return r;
+
+  readback_valid_ = true;
+  readback_allocation_ = staging_ring_->GetAllocationCount();
+  readback_x_ = x;
+  readback_y_ = y;
+  readback_width_ = width;
+  readback_height_ = height;
+  return {};
 }
 
 Result GraphicsPipeline::VerifyPixels(const uint32_t x,
@@ -486,58 +592,91 @@ Result GraphicsPipeline::VerifyPixels(const uint32_t x,
                                       const uint32_t width,
                                       const uint32_t height,
                                       const ProbeCommand* command) {
-  const uint32_t stride = VkFormatToByteSize(color_format_);
-
-  // TODO(jaebaek): Support all VkFormat
-  const uint8_t* ptr = static_cast<const uint8_t*>(frame_->GetColorBufferPtr());
-  uint32_t count_of_invalid_pixels = 0;
-  uint32_t first_invalid_i = 0;
-  uint32_t first_invalid_j = 0;
-  for (uint32_t j = 0; j < height; ++j) {
-    const uint8_t* p = ptr + stride * frame_->GetWidth() * (j + y) + stride * x;
-    for (uint32_t i = 0; i < width; ++i) {
-      // TODO(jaebaek): Get actual pixel values based on frame buffer formats.
-      if (!IsFloatPixelEqualInt(command->GetR(), p[stride * i]) ||
-          !IsFloatPixelEqualInt(command->GetG(), p[stride * i + 1]) ||
-          !IsFloatPixelEqualInt(command->GetB(), p[stride * i + 2]) ||
-          (command->IsRGBA() &&
-           !IsFloatPixelEqualInt(command->GetA(), p[stride * i + 3]))) {
-        if (!count_of_invalid_pixels) {
-          first_invalid_i = i;
-          first_invalid_j = j;
-        }
-        ++count_of_invalid_pixels;
-      }
-    }
-  }
+  const float expected[4] = {command->GetR(), command->GetG(), command->GetB(),
+                             command->GetA()};
+  PixelVerifier::Mismatches mismatches;
+  Result r = verifier_.Verify(color_unpacker_, frame_->GetColorPixelPtr(x, y),
+                              frame_->GetColorRowPitch(), width, height,
+                              expected, command->IsRGBA(), &mismatches);
+  if (!r.IsSuccess())
+    return r;
 
-  if (count_of_invalid_pixels) {
-    const uint8_t* p =
-        ptr + stride * frame_->GetWidth() * (first_invalid_j + y) + stride * x;
+  if (mismatches.count) {
+    const double* actual = mismatches.first_rgba;
     return Result(
-        "Probe failed at: " + std::to_string(first_invalid_i + x) + ", " +
-        std::to_string(first_invalid_j + y) + "\n" +
+        "Probe failed at: " + std::to_string(mismatches.first_x + x) + ", " +
+        std::to_string(mismatches.first_y + y) + "\n" +
         "  Expected RGBA: " + std::to_string(command->GetR() * 255) + ", " +
         std::to_string(command->GetG() * 255) + ", " +
         std::to_string(command->GetB() * 255) +
         (command->IsRGBA() ? ", " + std::to_string(command->GetA() * 255) +
                                  "\n  Actual RGBA: "
                            : "\n  Actual RGB: ") +
-        std::to_string(static_cast<int>(p[stride * first_invalid_i])) + ", " +
-        std::to_string(static_cast<int>(p[stride * first_invalid_i + 1])) +
-        ", " +
-        std::to_string(static_cast<int>(p[stride * first_invalid_i + 2])) +
-        (command->IsRGBA() ? ", " + std::to_string(static_cast<int>(
-                                        p[stride * first_invalid_i + 3]))
-                           : "") +
-        "\n" + "Probe failed in " + std::to_string(count_of_invalid_pixels) +
+        std::to_string(actual[0] * 255) + ", " +
+        std::to_string(actual[1] * 255) + ", " +
+        std::to_string(actual[2] * 255) +
+        (command->IsRGBA() ? ", " + std::to_string(actual[3] * 255) : "") +
+        "\n" + "Probe failed in " + std::to_string(mismatches.count) +
         " pixels");
   }
 
   return {};
 }
 
-Result GraphicsPipeline::Probe(const ProbeCommand* command) {
+Result GraphicsPipeline::ProbeOnDevice(uint32_t x,
+                                       uint32_t y,
+                                       uint32_t width,
+                                       uint32_t height,
+                                       const ProbeCommand* command,
+                                       DeviceVerifier* device_verifier,
+                                       bool* passed) {
+  *passed = false;
+
+  // Only the bytes of 8 bit formats are compared on the device.
+  const float expected[4] = {command->GetR(), command->GetG(), command->GetB(),
+                             command->GetA()};
+  uint8_t lo8[4];
+  uint8_t hi8[4];
+  if (!verifier_.GetByteBounds(color_unpacker_, expected, command->IsRGBA(),
+                               lo8, hi8)) {
+    return {};
+  }
+  const size_t size = static_cast<size_t>(width) * height * 4;
+  if (size > DeviceVerifier::kMaxValueBytes)
+    return {};
+
+  std::vector<float> bounds(8);
+  for (uint32_t i = 0; i < 4; ++i) {
+    bounds[2 * i] = lo8[i];
+    bounds[2 * i + 1] = hi8[i];
+  }
+
+  VkBuffer buffer = VK_NULL_HANDLE;
+  Result r = device_verifier->GetScratchBuffer(size, &buffer);
+  if (!r.IsSuccess())
+    return r;
+
+  r = command_->BeginIfNotInRecording();
+  if (!r.IsSuccess())
+    return r;
+
+  PrepareColorImageForCopy();
+  frame_->CopyColorImageToBuffer(command_->GetCommandBuffer(), x, y, width,
+                                 height, buffer);
+
+  DeviceVerifier::Mismatches mismatches;
+  r = device_verifier->Verify(command_.get(), buffer, 0,
+                              static_cast<uint32_t>(size), true, bounds,
+                              &mismatches);
+  if (!r.IsSuccess())
+    return r;
+
+  *passed = mismatches.count == 0;
+  return {};
+}
+
+Result GraphicsPipeline::Probe(const ProbeCommand* command,
+                               DeviceVerifier* device_verifier) {
   uint32_t x = 0;
   uint32_t y = 0;
   uint32_t width = 0;
@@ -567,13 +706,79 @@ Result GraphicsPipeline::Probe(const ProbeCommand* command) {
         std::to_string(frame_width) + "," + std::to_string(frame_height) + ")");
   }
 
-  Result r = SubmitProbeCommand();
+  // Rectangles already read back are compared on the host. A failure on the
+  // device, or an error setting up the comparison, is compared again on the
+  // host.
+  const bool read_back = ReadbackContains(x, y, width, height);
+  if (device_verifier && !read_back &&
+      static_cast<uint64_t>(width) * height >= DeviceVerifier::kMinValues) {
+    bool passed = false;
+    Result r = ProbeOnDevice(x, y, width, height, command, device_verifier,
+                             &passed);
+    if (r.IsSuccess() && passed)
+      return {};
+  }
+
+  Result r = SubmitProbeCommand(x, y, width, height);
   if (!r.IsSuccess())
     return r;
 
   return VerifyPixels(x, y, width, height, command);
 }
 
+Result GraphicsPipeline::HashColorAttachment(uint64_t* hash) {
+  const uint32_t width = frame_->GetWidth();
+  const uint32_t height = frame_->GetHeight();
+  Result r = SubmitProbeCommand(0, 0, width, height);
+  if (!r.IsSuccess())
+    return r;
+
+  *hash = HashRows(frame_->GetColorPixelPtr(0, 0),
+                   static_cast<size_t>(width) * frame_->GetColorTexelSize(),
+                   height, frame_->GetColorRowPitch());
+  return {};
+}
+
+Result GraphicsPipeline::ReadColorAttachment(Rgba8Image* image) {
+  const uint32_t width = frame_->GetWidth();
+  const uint32_t height = frame_->GetHeight();
+  Result r = SubmitProbeCommand(0, 0, width, height);
+  if (!r.IsSuccess())
+    return r;
+
+  image->width = width;
+  image->height = height;
+  image->channels = 4;
+  image->texels.resize(static_cast<size_t>(width) * height * 4);
+
+  // Four 8 bit UNORM bytes only need to be put in RGBA order. Other formats
+  // are unpacked a row at a time and rounded to 8 bits.
+  uint32_t byte_lanes[4];
+  const bool bytes = color_unpacker_.IsUNorm8x4(byte_lanes);
+  const bool rgba = bytes && byte_lanes[0] == 0 && byte_lanes[1] == 1 &&
+                    byte_lanes[2] == 2 && byte_lanes[3] == 3;
+  std::vector<float> row(bytes ? 0 : static_cast<size_t>(width) * 4);
+  for (uint32_t y = 0; y < height; ++y) {
+    const uint8_t* src = frame_->GetColorPixelPtr(0, y);
+    uint8_t* dst = image->texels.data() + static_cast<size_t>(y) * width * 4;
+    if (rgba) {
+      memcpy(dst, src, static_cast<size_t>(width) * 4);
+    } else if (bytes) {
+      for (uint32_t x = 0; x < width; ++x) {
+        for (uint32_t i = 0; i < 4; ++i)
+          dst[4 * x + byte_lanes[i]] = src[4 * x + i];
+      }
+    } else {
+      color_unpacker_.Unpack(src, width, row.data());
+      for (size_t i = 0; i < row.size(); ++i) {
+        const float value = std::min(std::max(row[i], 0.0f), 1.0f);
+        dst[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+      }
+    }
+  }
+  return {};
+}
+
 void GraphicsPipeline::Shutdown() {
   DeactivateRenderPassIfNeeded();
 
@@ -582,6 +787,8 @@ void GraphicsPipeline::Shutdown() {
     command_->SubmitAndReset();
 
   Pipeline::Shutdown();
+  if (vertex_buffer_)
+    vertex_buffer_->Shutdown();
   frame_->Shutdown();
   vkDestroyRenderPass(device_, render_pass_, nullptr);
 }
@@ -24,6 +24,8 @@
 #include "src/value.h"
 #include "src/vulkan/frame_buffer.h"
 #include "src/vulkan/pipeline.h"
+#include "src/vulkan/pixel_verifier.h"
+#include "src/vulkan/texel_unpacker.h"
 #include "src/vulkan/vertex_buffer.h"
 #include "vulkan/vulkan.h"
 
@@ -37,8 +39,9 @@ class GraphicsPipeline : public Pipeline {
  public:
   GraphicsPipeline(PipelineType type,
                    VkDevice device,
-                   const VkPhysicalDeviceMemoryProperties& properties,
-                   VkFormat color_format,
+                   MemoryAllocator* allocator,
+                   StagingRing* staging_ring,
+                   const Format& color_format,
                    VkFormat depth_stencil_format,
                    std::vector<VkPipelineShaderStageCreateInfo>);
   ~GraphicsPipeline() override;
@@ -49,15 +52,36 @@ class GraphicsPipeline : public Pipeline {
                     VkQueue queue);
   void Shutdown() override;
 
-  void SetBuffer(BufferType type,
-                 uint8_t location,
-                 const Format& format,
-                 const std::vector<Value>& values);
+  Result SetBuffer(BufferType type,
+                   uint8_t location,
+                   const Format& format,
+                   const std::vector<Value>& values);
+  Result SetBufferData(BufferType type,
+                       uint8_t location,
+                       const BufferView& view);
 
   Result Clear();
   Result ClearBuffer(const VkClearValue& clear_value,
                      VkImageAspectFlags aspect);
-  Result Probe(const ProbeCommand*);
+  // Compares the rectangle |command| probes on the device when
+  // |device_verifier| is given and the rectangle is large, and reads it back
+  // only to describe a failure. Otherwise it is compared on the host.
+  Result Probe(const ProbeCommand* command, DeviceVerifier* device_verifier);
+
+  // Reads back the whole color attachment and stores the hash of its texels
+  // in |hash|.
+  Result HashColorAttachment(uint64_t* hash);
+
+  // Reads back the whole color attachment into |image|, 8 bits a channel.
+  Result ReadColorAttachment(Rgba8Image* image);
+  Result SetTolerances(
+      const std::vector<ToleranceCommand::Tolerance>& tolerances) {
+    return verifier_.SetTolerances(tolerances);
+  }
+  void SetPixelProbeOptions(bool early_exit, uint32_t max_threads) {
+    verifier_.SetEarlyExit(early_exit);
+    verifier_.SetMaxThreads(max_threads);
+  }
 
   VkFormat GetColorFormat() const { return color_format_; }
   VkFormat GetDepthStencilFormat() const { return depth_stencil_format_; }
@@ -80,10 +104,40 @@ class GraphicsPipeline : public Pipeline {
   void ActivateRenderPassIfNeeded();
   void DeactivateRenderPassIfNeeded();
 
+  // Pipeline
+  void EndRenderPass() override { DeactivateRenderPassIfNeeded(); }
+
   Result SendBufferDataIfNeeded();
 
-  // TODO(jaebaek): Implement image/ssbo probe.
-  Result SubmitProbeCommand();
+  // Ends the render pass, or runs an empty one when nothing was drawn, so
+  // the color image holds every draw in the layout it is copied from.
+  void PrepareColorImageForCopy();
+
+  // Whether the host copy of the frame buffer is still valid and covers the
+  // given rectangle.
+  bool ReadbackContains(uint32_t x,
+                        uint32_t y,
+                        uint32_t width,
+                        uint32_t height) const;
+  // Makes the host copy of the frame buffer cover the given rectangle. The
+  // copy is reused by later probes until the next draw or clear, or until
+  // the staging ring hands out another region which may reuse its memory; a
+  // probe outside of it copies the union of the rectangles probed since
+  // then.
+  // TODO(jaebaek): Implement image probe.
+  Result SubmitProbeCommand(uint32_t x,
+                            uint32_t y,
+                            uint32_t width,
+                            uint32_t height);
+  // Sets |passed| when the device finds no failing pixel. It stays false
+  // when the color format is not compared on the device.
+  Result ProbeOnDevice(uint32_t x,
+                       uint32_t y,
+                       uint32_t width,
+                       uint32_t height,
+                       const ProbeCommand* command,
+                       DeviceVerifier* device_verifier,
+                       bool* passed);
   Result VerifyPixels(const uint32_t x,
                       const uint32_t y,
                       const uint32_t width,
@@ -98,10 +152,10 @@ class GraphicsPipeline : public Pipeline {
 
   std::unique_ptr<FrameBuffer> frame_;
   VkFormat color_format_;
+  Format color_texel_format_;
+  TexelUnpacker color_unpacker_;
   VkFormat depth_stencil_format_;
 
-  std::vector<VkPipelineShaderStageCreateInfo> shader_stage_info_;
-
   uint32_t frame_width_ = 0;
   uint32_t frame_height_ = 0;
 
@@ -113,6 +167,19 @@ class GraphicsPipeline : public Pipeline {
   float clear_depth_ = 1.0f;
 
   std::unique_ptr<VertexBuffer> vertex_buffer_;
+  PixelVerifier verifier_;
+
+  // Whether the color image is ready to copy, and the rectangle of the frame
+  // buffer the host copy holds. Cleared by every command which changes the
+  // frame buffer. The copy is in the staging ring, so it is also stale once
+  // the allocation count of the ring moves on from |readback_allocation_|.
+  bool color_copyable_ = false;
+  bool readback_valid_ = false;
+  uint64_t readback_allocation_ = 0;
+  uint32_t readback_x_ = 0;
+  uint32_t readback_y_ = 0;
+  uint32_t readback_width_ = 0;
+  uint32_t readback_height_ = 0;
 };
 
 }  // namespace vulkan
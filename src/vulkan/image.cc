@@ -48,9 +48,12 @@ Image::Image(VkDevice device,
              uint32_t x,
              uint32_t y,
              uint32_t z,
-             const VkPhysicalDeviceMemoryProperties& properties)
-    : Resource(device, x * y * z * VkFormatToByteSize(format), properties),
-      image_info_(kDefaultImageInfo) {
+             MemoryAllocator* allocator,
+             StagingRing* staging_ring)
+    : Resource(device, x * y * z * VkFormatToByteSize(format), allocator),
+      image_info_(kDefaultImageInfo),
+      staging_ring_(staging_ring),
+      texel_size_(VkFormatToByteSize(format)) {
   image_info_.format = format;
   image_info_.extent = {x, y, z};
 }
@@ -67,7 +70,7 @@ Result Image::Initialize(VkImageUsageFlags usage) {
     return Result("Vulkan::Calling vkCreateImage Fail");
 
   AllocateResult allocate_result = AllocateAndBindMemoryToVkImage(
-      image_, &memory_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+      image_, &allocation_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
   if (!allocate_result.r.IsSuccess())
     return allocate_result.r;
 
@@ -77,11 +80,12 @@ Result Image::Initialize(VkImageUsageFlags usage) {
 
   if (CheckMemoryHostAccessible(allocate_result.memory_type_index)) {
     is_image_host_accessible_ = true;
-    return MapMemory(memory_);
+    host_row_pitch_ = image_info_.extent.width * texel_size_;
+    return MapMemory(allocation_);
   }
 
   is_image_host_accessible_ = false;
-  return Resource::Initialize();
+  return {};
 }
 
 Result Image::CreateVkImageView() {
@@ -116,19 +120,46 @@ Result Image::CreateVkImageView() {
 void Image::Shutdown() {
   vkDestroyImageView(GetDevice(), view_, nullptr);
   vkDestroyImage(GetDevice(), image_, nullptr);
-  vkFreeMemory(GetDevice(), memory_, nullptr);
+  FreeMemory(&allocation_);
 
   view_ = VK_NULL_HANDLE;
   image_ = VK_NULL_HANDLE;
-  memory_ = VK_NULL_HANDLE;
+  Resource::Shutdown();
 }
 
-Result Image::CopyToHost(VkCommandBuffer command) {
+Result Image::CopyToHost(VkCommandBuffer command,
+                         uint32_t x,
+                         uint32_t y,
+                         uint32_t width,
+                         uint32_t height) {
   if (is_image_host_accessible_)
     return {};
 
+  // The buffer offset must be a multiple of both 4 and the texel size.
+  StagingRing::Region staging_region;
+  Result r = staging_ring_->Allocate(width * height * texel_size_,
+                                     4 * texel_size_, &staging_region);
+  if (!r.IsSuccess())
+    return r;
+  SetHostAccessibleMemoryPtr(staging_region.ptr);
+  host_x_ = x;
+  host_y_ = y;
+  host_row_pitch_ = width * texel_size_;
+
+  CopyToBuffer(command, x, y, width, height, staging_region.buffer,
+               staging_region.offset);
+  return {};
+}
+
+void Image::CopyToBuffer(VkCommandBuffer command,
+                         uint32_t x,
+                         uint32_t y,
+                         uint32_t width,
+                         uint32_t height,
+                         VkBuffer buffer,
+                         VkDeviceSize offset) {
   VkBufferImageCopy copy_region = {};
-  copy_region.bufferOffset = 0;
+  copy_region.bufferOffset = offset;
   copy_region.bufferRowLength = 0;
   copy_region.bufferImageHeight = 0;
   copy_region.imageSubresource = {
@@ -137,14 +168,12 @@ Result Image::CopyToHost(VkCommandBuffer command) {
       0,                         /* baseArrayLayer */
       1,                         /* layerCount */
   };
-  copy_region.imageOffset = {0, 0, 0};
-  copy_region.imageExtent = {image_info_.extent.width,
-                             image_info_.extent.height, 1};
+  copy_region.imageOffset = {static_cast<int32_t>(x),
+                             static_cast<int32_t>(y), 0};
+  copy_region.imageExtent = {width, height, 1};
 
   vkCmdCopyImageToBuffer(command, image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                         GetHostAccessibleBuffer(), 1, &copy_region);
-
-  return {};
+                         buffer, 1, &copy_region);
 }
 
 }  // namespace vulkan
@@ -17,6 +17,7 @@
 
 #include "amber/result.h"
 #include "src/vulkan/resource.h"
+#include "src/vulkan/staging_ring.h"
 #include "vulkan/vulkan.h"
 
 namespace amber {
@@ -29,26 +30,50 @@ class Image : public Resource {
         uint32_t x,
         uint32_t y,
         uint32_t z,
-        const VkPhysicalDeviceMemoryProperties& properties);
+        MemoryAllocator* allocator,
+        StagingRing* staging_ring);
   ~Image() override;
 
   Result Initialize(VkImageUsageFlags usage);
   VkImage GetVkImage() const { return image_; }
   VkImageView GetVkImageView() const { return view_; }
 
-  // TODO(jaebaek): Determine copy all or partial data
-  Result CopyToHost(VkCommandBuffer command);
+  // Records a copy of the |width| x |height| rectangle at |x|, |y| of the
+  // image to the host. Images without host visible memory are copied into a
+  // region of the staging ring, which holds the data until the ring is next
+  // allocated from.
+  Result CopyToHost(VkCommandBuffer command,
+                    uint32_t x,
+                    uint32_t y,
+                    uint32_t width,
+                    uint32_t height);
 
-  // TODO(jaebaek): Implement CopyToDevice
-
-  // Resource
-  VkDeviceMemory GetHostAccessMemory() const override {
-    if (is_image_host_accessible_)
-      return memory_;
+  // Records a copy of the |width| x |height| rectangle at |x|, |y| of the
+  // image to |buffer| at |offset|, with the rows tightly packed. The image
+  // must be in the transfer source layout.
+  void CopyToBuffer(VkCommandBuffer command,
+                    uint32_t x,
+                    uint32_t y,
+                    uint32_t width,
+                    uint32_t height,
+                    VkBuffer buffer,
+                    VkDeviceSize offset);
 
-    return Resource::GetHostAccessMemory();
+  // Returns the host copy of the texel at |x|, |y|, which must be inside the
+  // rectangle last copied by CopyToHost().
+  const uint8_t* HostAccessibleTexelPtr(uint32_t x, uint32_t y) const {
+    return static_cast<const uint8_t*>(HostAccessibleMemoryPtr()) +
+           (y - host_y_) * host_row_pitch_ + (x - host_x_) * texel_size_;
   }
 
+  // Returns the distance in bytes between rows of the host copy.
+  uint32_t HostAccessibleRowPitch() const { return host_row_pitch_; }
+
+  uint32_t GetTexelSize() const { return texel_size_; }
+
+  // TODO(jaebaek): Implement CopyToDevice
+
+  // Resource
   void Shutdown() override;
 
  private:
@@ -58,8 +83,14 @@ class Image : public Resource {
 
   VkImage image_ = VK_NULL_HANDLE;
   VkImageView view_ = VK_NULL_HANDLE;
-  VkDeviceMemory memory_ = VK_NULL_HANDLE;
+  MemoryAllocator::Allocation allocation_;
   bool is_image_host_accessible_ = false;
+  StagingRing* staging_ring_ = nullptr;
+  uint32_t texel_size_ = 0;
+  // Origin and row pitch of the host copy of the image.
+  uint32_t host_x_ = 0;
+  uint32_t host_y_ = 0;
+  uint32_t host_row_pitch_ = 0;
 };
 
 }  // namespace vulkan
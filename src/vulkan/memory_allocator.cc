@@ -0,0 +1,291 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/memory_allocator.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "src/make_unique.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+const VkDeviceSize kBlockSize = 16 * 1024 * 1024;
+const VkDeviceSize kMinBinSize = 256;
+// Sizes up to this are rounded to a power of two, larger ones to a multiple
+// of kLargeBinGranularity.
+const VkDeviceSize kMaxPowerOfTwoBinSize = 64 * 1024;
+const VkDeviceSize kLargeBinGranularity = 4 * 1024;
+
+VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+VkDeviceSize RoundToBin(VkDeviceSize size) {
+  if (size > kMaxPowerOfTwoBinSize)
+    return AlignUp(size, kLargeBinGranularity);
+
+  VkDeviceSize bin = kMinBinSize;
+  while (bin < size)
+    bin <<= 1;
+  return bin;
+}
+
+bool TakeRange(FreeRanges* ranges,
+               VkDeviceSize size,
+               VkDeviceSize alignment,
+               VkDeviceSize* offset) {
+  for (auto it = ranges->begin(); it != ranges->end(); ++it) {
+    const VkDeviceSize begin = it->first;
+    const VkDeviceSize end = it->first + it->second;
+    const VkDeviceSize aligned = AlignUp(begin, alignment);
+    if (aligned + size > end)
+      continue;
+
+    ranges->erase(it);
+    if (aligned > begin)
+      (*ranges)[begin] = aligned - begin;
+    if (aligned + size < end)
+      (*ranges)[aligned + size] = end - aligned - size;
+    *offset = aligned;
+    return true;
+  }
+  return false;
+}
+
+void ReturnRange(FreeRanges* ranges, VkDeviceSize offset, VkDeviceSize size) {
+  auto next = ranges->lower_bound(offset);
+  if (next != ranges->end() && next->first == offset + size) {
+    size += next->second;
+    next = ranges->erase(next);
+  }
+  if (next != ranges->begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      prev->second += size;
+      return;
+    }
+  }
+  (*ranges)[offset] = size;
+}
+
+struct MemoryAllocator::Block {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize size = 0;
+  void* mapped = nullptr;
+  uint32_t memory_type_index = 0;
+  bool linear = true;
+  VkDeviceSize used = 0;
+  FreeRanges free_ranges;
+};
+
+MemoryAllocator::MemoryAllocator(
+    VkDevice device,
+    const VkPhysicalDeviceMemoryProperties& properties)
+    : device_(device), memory_properties_(properties) {}
+
+MemoryAllocator::~MemoryAllocator() = default;
+
+VkDeviceSize MemoryAllocator::GetBlockSize(uint32_t memory_type_index) const {
+  // Leave most of small heaps, such as host visible device memory, to
+  // dedicated allocations and other users of the device.
+  const uint32_t heap_index =
+      memory_properties_.memoryTypes[memory_type_index].heapIndex;
+  return std::min(kBlockSize, memory_properties_.memoryHeaps[heap_index].size /
+                                  8);
+}
+
+Result MemoryAllocator::AllocateMemory(VkDeviceSize size,
+                                       uint32_t memory_type_index,
+                                       VkDeviceMemory* memory,
+                                       void** mapped) {
+  VkMemoryAllocateInfo alloc_info = {};
+  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  alloc_info.allocationSize = size;
+  alloc_info.memoryTypeIndex = memory_type_index;
+  if (vkAllocateMemory(device_, &alloc_info, nullptr, memory) != VK_SUCCESS)
+    return Result("Vulkan::Calling vkAllocateMemory Fail");
+
+  *mapped = nullptr;
+  if ((memory_properties_.memoryTypes[memory_type_index].propertyFlags &
+       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0) {
+    return {};
+  }
+
+  if (vkMapMemory(device_, *memory, 0, VK_WHOLE_SIZE, 0, mapped) !=
+      VK_SUCCESS) {
+    vkFreeMemory(device_, *memory, nullptr);
+    *memory = VK_NULL_HANDLE;
+    return Result("Vulkan::Calling vkMapMemory Fail");
+  }
+
+  return {};
+}
+
+Result MemoryAllocator::CreateBlock(uint32_t memory_type_index,
+                                    bool linear,
+                                    Block** block) {
+  auto new_block = MakeUnique<Block>();
+  new_block->size = GetBlockSize(memory_type_index);
+  new_block->memory_type_index = memory_type_index;
+  new_block->linear = linear;
+
+  Result r = AllocateMemory(new_block->size, memory_type_index,
+                            &new_block->memory, &new_block->mapped);
+  if (!r.IsSuccess())
+    return r;
+
+  new_block->free_ranges[0] = new_block->size;
+  *block = new_block.get();
+  blocks_.push_back(std::move(new_block));
+  return {};
+}
+
+void MemoryAllocator::DestroyBlock(Block* block) {
+  if (block->mapped)
+    vkUnmapMemory(device_, block->memory);
+  vkFreeMemory(device_, block->memory, nullptr);
+
+  blocks_.erase(std::find_if(blocks_.begin(), blocks_.end(),
+                             [block](const std::unique_ptr<Block>& b) {
+                               return b.get() == block;
+                             }));
+}
+
+Result MemoryAllocator::Allocate(const VkMemoryRequirements& requirements,
+                                 uint32_t memory_type_index,
+                                 bool linear,
+                                 Allocation* allocation) {
+  if (allocation == nullptr)
+    return Result("Vulkan::Given Allocation pointer is nullptr");
+  if (memory_type_index >= memory_properties_.memoryTypeCount)
+    return Result("Vulkan::Invalid memory type index");
+
+  *allocation = Allocation();
+  allocation->memory_type_index = memory_type_index;
+
+  const VkDeviceSize size = RoundToBin(requirements.size);
+  const VkDeviceSize alignment = std::max<VkDeviceSize>(
+      requirements.alignment, 1);
+  if (size >= GetBlockSize(memory_type_index) / 2) {
+    Result r = AllocateMemory(requirements.size, memory_type_index,
+                              &allocation->memory, &allocation->mapped);
+    if (!r.IsSuccess())
+      return r;
+
+    allocation->size = requirements.size;
+    ++dedicated_allocations_;
+    dedicated_bytes_ += allocation->size;
+  } else {
+    Block* block = nullptr;
+    VkDeviceSize offset = 0;
+    for (const auto& b : blocks_) {
+      if (b->memory_type_index != memory_type_index || b->linear != linear)
+        continue;
+      if (TakeRange(&b->free_ranges, size, alignment, &offset)) {
+        block = b.get();
+        break;
+      }
+    }
+
+    if (block == nullptr) {
+      Result r = CreateBlock(memory_type_index, linear, &block);
+      if (!r.IsSuccess())
+        return r;
+      if (!TakeRange(&block->free_ranges, size, alignment, &offset))
+        return Result("Vulkan::Allocation does not fit in a memory block");
+    }
+
+    block->used += size;
+    allocation->memory = block->memory;
+    allocation->offset = offset;
+    allocation->size = size;
+    allocation->block = block;
+    if (block->mapped)
+      allocation->mapped = static_cast<uint8_t*>(block->mapped) + offset;
+  }
+
+  used_bytes_ += allocation->size;
+  peak_used_bytes_ = std::max(peak_used_bytes_, used_bytes_);
+  return {};
+}
+
+void MemoryAllocator::Free(Allocation* allocation) {
+  if (allocation->memory == VK_NULL_HANDLE)
+    return;
+
+  used_bytes_ -= allocation->size;
+
+  Block* block = allocation->block;
+  if (block == nullptr) {
+    if (allocation->mapped)
+      vkUnmapMemory(device_, allocation->memory);
+    vkFreeMemory(device_, allocation->memory, nullptr);
+    --dedicated_allocations_;
+    dedicated_bytes_ -= allocation->size;
+    *allocation = Allocation();
+    return;
+  }
+
+  ReturnRange(&block->free_ranges, allocation->offset, allocation->size);
+  block->used -= allocation->size;
+  *allocation = Allocation();
+  if (block->used > 0)
+    return;
+
+  // Keep one empty block of each kind around for the next resource.
+  for (const auto& b : blocks_) {
+    if (b.get() != block && b->used == 0 &&
+        b->memory_type_index == block->memory_type_index &&
+        b->linear == block->linear) {
+      DestroyBlock(block);
+      return;
+    }
+  }
+}
+
+void MemoryAllocator::Shutdown() {
+  for (const auto& block : blocks_) {
+    if (block->mapped)
+      vkUnmapMemory(device_, block->memory);
+    vkFreeMemory(device_, block->memory, nullptr);
+  }
+  blocks_.clear();
+}
+
+DeviceMemoryStats MemoryAllocator::GetStats() const {
+  DeviceMemoryStats stats;
+  stats.blocks = blocks_.size();
+  stats.dedicated_allocations = dedicated_allocations_;
+  stats.reserved_bytes = dedicated_bytes_;
+  stats.used_bytes = used_bytes_;
+  stats.peak_used_bytes = peak_used_bytes_;
+  for (const auto& block : blocks_) {
+    stats.reserved_bytes += block->size;
+    stats.free_ranges += block->free_ranges.size();
+    for (const auto& range : block->free_ranges) {
+      stats.free_bytes += range.second;
+      stats.largest_free_range_bytes =
+          std::max<uint64_t>(stats.largest_free_range_bytes, range.second);
+    }
+  }
+  return stats;
+}
+
+}  // namespace vulkan
+}  // namespace amber
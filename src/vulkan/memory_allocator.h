@@ -0,0 +1,110 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_VULKAN_MEMORY_ALLOCATOR_H_
+#define SRC_VULKAN_MEMORY_ALLOCATOR_H_
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "amber/result.h"
+#include "vulkan/vulkan.h"
+
+namespace amber {
+namespace vulkan {
+
+// Free ranges of a block, from offset to size.
+using FreeRanges = std::map<VkDeviceSize, VkDeviceSize>;
+
+// Rounds |size| up to the bin it is allocated from.
+VkDeviceSize RoundToBin(VkDeviceSize size);
+
+// Takes the first free range which fits |size| bytes at |alignment|. Any
+// space skipped to align the offset stays free.
+bool TakeRange(FreeRanges* ranges,
+               VkDeviceSize size,
+               VkDeviceSize alignment,
+               VkDeviceSize* offset);
+
+// Returns a range to |ranges|, merging it with its free neighbours.
+void ReturnRange(FreeRanges* ranges, VkDeviceSize offset, VkDeviceSize size);
+
+// Sub-allocates buffer and image memory out of large VkDeviceMemory blocks,
+// one set of blocks per memory type. Sizes are rounded up to a small number
+// of bins so freed ranges are reused by later resources of similar size, and
+// allocations of at least half a block get memory of their own. Host visible
+// blocks stay mapped for their whole lifetime.
+class MemoryAllocator {
+ public:
+  struct Block;
+
+  struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // Host pointer to |offset|, or nullptr if the memory is not host visible.
+    void* mapped = nullptr;
+    uint32_t memory_type_index = 0;
+    // The block the allocation was taken from, nullptr for dedicated memory.
+    Block* block = nullptr;
+  };
+
+  MemoryAllocator(VkDevice device,
+                  const VkPhysicalDeviceMemoryProperties& properties);
+  ~MemoryAllocator();
+
+  const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const {
+    return memory_properties_;
+  }
+
+  // Allocates memory satisfying |requirements| from |memory_type_index|.
+  // |linear| is true for buffers and false for optimally tiled images, which
+  // are kept in separate blocks so bufferImageGranularity never applies.
+  Result Allocate(const VkMemoryRequirements& requirements,
+                  uint32_t memory_type_index,
+                  bool linear,
+                  Allocation* allocation);
+
+  // Returns |allocation| to its block, or frees its dedicated memory.
+  void Free(Allocation* allocation);
+
+  // Frees every block. All allocations must have been freed before.
+  void Shutdown();
+
+  DeviceMemoryStats GetStats() const;
+
+ private:
+  VkDeviceSize GetBlockSize(uint32_t memory_type_index) const;
+  Result AllocateMemory(VkDeviceSize size,
+                        uint32_t memory_type_index,
+                        VkDeviceMemory* memory,
+                        void** mapped);
+  Result CreateBlock(uint32_t memory_type_index, bool linear, Block** block);
+  void DestroyBlock(Block* block);
+
+  VkDevice device_ = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties memory_properties_;
+
+  std::vector<std::unique_ptr<Block>> blocks_;
+  size_t dedicated_allocations_ = 0;
+  VkDeviceSize dedicated_bytes_ = 0;
+  VkDeviceSize used_bytes_ = 0;
+  VkDeviceSize peak_used_bytes_ = 0;
+};
+
+}  // namespace vulkan
+}  // namespace amber
+
+#endif  // SRC_VULKAN_MEMORY_ALLOCATOR_H_
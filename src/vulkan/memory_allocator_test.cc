@@ -0,0 +1,119 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/memory_allocator.h"
+
+#include "gtest/gtest.h"
+
+namespace amber {
+namespace vulkan {
+
+using MemoryAllocatorTest = testing::Test;
+
+TEST_F(MemoryAllocatorTest, RoundToBinSmallSizes) {
+  EXPECT_EQ(256U, RoundToBin(1));
+  EXPECT_EQ(256U, RoundToBin(256));
+  EXPECT_EQ(512U, RoundToBin(257));
+  EXPECT_EQ(4096U, RoundToBin(3000));
+  EXPECT_EQ(65536U, RoundToBin(65536));
+}
+
+TEST_F(MemoryAllocatorTest, RoundToBinLargeSizes) {
+  // Above 64 KiB sizes are rounded to a multiple of 4 KiB.
+  EXPECT_EQ(69632U, RoundToBin(65537));
+  EXPECT_EQ(69632U, RoundToBin(69632));
+  EXPECT_EQ(1052672U, RoundToBin(1048577));
+}
+
+TEST_F(MemoryAllocatorTest, TakeRangeSplitsFreeRange) {
+  FreeRanges ranges = {{0, 1024}};
+
+  VkDeviceSize offset = 1;
+  ASSERT_TRUE(TakeRange(&ranges, 256, 1, &offset));
+  EXPECT_EQ(0U, offset);
+  EXPECT_EQ(FreeRanges({{256, 768}}), ranges);
+
+  ASSERT_TRUE(TakeRange(&ranges, 768, 1, &offset));
+  EXPECT_EQ(256U, offset);
+  EXPECT_TRUE(ranges.empty());
+
+  EXPECT_FALSE(TakeRange(&ranges, 1, 1, &offset));
+}
+
+TEST_F(MemoryAllocatorTest, TakeRangeKeepsAlignmentPadding) {
+  FreeRanges ranges = {{16, 1008}};
+
+  VkDeviceSize offset = 0;
+  ASSERT_TRUE(TakeRange(&ranges, 256, 256, &offset));
+  EXPECT_EQ(256U, offset);
+  EXPECT_EQ(FreeRanges({{16, 240}, {512, 512}}), ranges);
+}
+
+TEST_F(MemoryAllocatorTest, TakeRangeSkipsRangesTooSmall) {
+  FreeRanges ranges = {{0, 128}, {512, 512}};
+
+  VkDeviceSize offset = 0;
+  ASSERT_TRUE(TakeRange(&ranges, 256, 1, &offset));
+  EXPECT_EQ(512U, offset);
+  EXPECT_EQ(FreeRanges({{0, 128}, {768, 256}}), ranges);
+
+  // The aligned offset of the first range no longer fits.
+  ranges = {{1, 256}, {1024, 256}};
+  ASSERT_TRUE(TakeRange(&ranges, 256, 256, &offset));
+  EXPECT_EQ(1024U, offset);
+  EXPECT_EQ(FreeRanges({{1, 256}}), ranges);
+}
+
+TEST_F(MemoryAllocatorTest, ReturnRangeWithoutNeighbours) {
+  FreeRanges ranges = {{0, 256}, {1024, 256}};
+  ReturnRange(&ranges, 512, 256);
+  EXPECT_EQ(FreeRanges({{0, 256}, {512, 256}, {1024, 256}}), ranges);
+}
+
+TEST_F(MemoryAllocatorTest, ReturnRangeCoalescesWithPrevious) {
+  FreeRanges ranges = {{0, 256}, {1024, 256}};
+  ReturnRange(&ranges, 256, 256);
+  EXPECT_EQ(FreeRanges({{0, 512}, {1024, 256}}), ranges);
+}
+
+TEST_F(MemoryAllocatorTest, ReturnRangeCoalescesWithNext) {
+  FreeRanges ranges = {{0, 256}, {1024, 256}};
+  ReturnRange(&ranges, 768, 256);
+  EXPECT_EQ(FreeRanges({{0, 256}, {768, 512}}), ranges);
+}
+
+TEST_F(MemoryAllocatorTest, ReturnRangeCoalescesWithBoth) {
+  FreeRanges ranges = {{0, 256}, {512, 256}};
+  ReturnRange(&ranges, 256, 256);
+  EXPECT_EQ(FreeRanges({{0, 768}}), ranges);
+}
+
+TEST_F(MemoryAllocatorTest, TakeAndReturnRestoresBlock) {
+  FreeRanges ranges = {{0, 4096}};
+
+  VkDeviceSize a = 0;
+  VkDeviceSize b = 0;
+  VkDeviceSize c = 0;
+  ASSERT_TRUE(TakeRange(&ranges, 1024, 256, &a));
+  ASSERT_TRUE(TakeRange(&ranges, 1024, 256, &b));
+  ASSERT_TRUE(TakeRange(&ranges, 1024, 256, &c));
+
+  ReturnRange(&ranges, b, 1024);
+  ReturnRange(&ranges, a, 1024);
+  ReturnRange(&ranges, c, 1024);
+  EXPECT_EQ(FreeRanges({{0, 4096}}), ranges);
+}
+
+}  // namespace vulkan
+}  // namespace amber
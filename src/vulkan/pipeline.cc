@@ -14,28 +14,49 @@
 
 #include "src/vulkan/pipeline.h"
 
+#include <algorithm>
 #include <limits>
+#include <string>
 
 #include "src/command.h"
+#include "src/content_hash.h"
 #include "src/make_unique.h"
+#include "src/vulkan/compute_pipeline.h"
 #include "src/vulkan/graphics_pipeline.h"
 
 namespace amber {
 namespace vulkan {
 
-Pipeline::Pipeline(PipelineType type,
-                   VkDevice device,
-                   const VkPhysicalDeviceMemoryProperties& properties)
-    : device_(device), memory_properties_(properties), pipeline_type_(type) {}
+Pipeline::Pipeline(
+    PipelineType type,
+    VkDevice device,
+    MemoryAllocator* allocator,
+    StagingRing* staging_ring,
+    std::vector<VkPipelineShaderStageCreateInfo> shader_stage_info)
+    : shader_stage_info_(std::move(shader_stage_info)),
+      device_(device),
+      allocator_(allocator),
+      staging_ring_(staging_ring),
+      pipeline_type_(type) {
+  entry_points_.reserve(shader_stage_info_.size());
+  for (auto& info : shader_stage_info_) {
+    entry_points_.push_back(info.pName ? info.pName : "main");
+    info.pName = entry_points_.back().c_str();
+  }
+}
 
 Pipeline::~Pipeline() = default;
 
+ComputePipeline* Pipeline::AsCompute() {
+  return static_cast<ComputePipeline*>(this);
+}
+
 GraphicsPipeline* Pipeline::AsGraphics() {
   return static_cast<GraphicsPipeline*>(this);
 }
 
 Result Pipeline::InitializeCommandBuffer(VkCommandPool pool, VkQueue queue) {
-  command_ = MakeUnique<CommandBuffer>(device_, pool, queue);
+  command_ = MakeUnique<CommandBuffer>(device_, pool, queue, staging_ring_);
   Result r = command_->Initialize();
   if (!r.IsSuccess())
     return r;
@@ -44,17 +65,62 @@ Result Pipeline::InitializeCommandBuffer(VkCommandPool pool, VkQueue queue) {
 }
 
 void Pipeline::Shutdown() {
-  // TODO(jaebaek): destroy pipeline_cache_ and pipeline_
   command_->Shutdown();
+  for (auto& it : buffer_descriptors_)
+    it.second->Shutdown();
+  if (pipeline_ != VK_NULL_HANDLE)
+    vkDestroyPipeline(device_, pipeline_, nullptr);
   vkDestroyPipelineLayout(device_, pipeline_layout_, nullptr);
+  DestroyDescriptorSets();
+}
+
+Result Pipeline::SetEntryPoint(VkShaderStageFlagBits stage,
+                               const std::string& name) {
+  for (size_t i = 0; i < shader_stage_info_.size(); ++i) {
+    if (shader_stage_info_[i].stage != stage)
+      continue;
+
+    if (entry_points_[i] == name)
+      return {};
+
+    if (pipeline_ != VK_NULL_HANDLE) {
+      // The recorded and submitted commands use |pipeline_|.
+      Result r = SubmitRecordedCommands();
+      if (!r.IsSuccess())
+        return r;
+
+      vkDestroyPipeline(device_, pipeline_, nullptr);
+      pipeline_ = VK_NULL_HANDLE;
+    }
+
+    entry_points_[i] = name;
+    shader_stage_info_[i].pName = entry_points_[i].c_str();
+    return {};
+  }
+  return Result("Vulkan::EntryPoint for a shader the pipeline does not have");
+}
+
+VkShaderStageFlags Pipeline::GetShaderStageFlags() const {
+  return IsCompute() ? VK_SHADER_STAGE_COMPUTE_BIT
+                     : VK_SHADER_STAGE_ALL_GRAPHICS;
 }
 
 Result Pipeline::CreatePipelineLayout() {
   VkPipelineLayoutCreateInfo pipeline_layout_info = {};
   pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipeline_layout_info.setLayoutCount = 0;
-  pipeline_layout_info.pSetLayouts = nullptr;
-  // TODO(jaebaek): Push constant for pipeline_layout_info.
+  pipeline_layout_info.setLayoutCount =
+      static_cast<uint32_t>(descriptor_set_layout_.size());
+  pipeline_layout_info.pSetLayouts = descriptor_set_layout_.data();
+
+  push_constant_range_size_ = static_cast<uint32_t>(push_constants_.size());
+  VkPushConstantRange push_constant_range = {};
+  push_constant_range.stageFlags = GetShaderStageFlags();
+  push_constant_range.offset = 0;
+  push_constant_range.size = push_constant_range_size_;
+  if (push_constant_range_size_ > 0) {
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+  }
 
   if (vkCreatePipelineLayout(device_, &pipeline_layout_info, nullptr,
                              &pipeline_layout_) != VK_SUCCESS) {
@@ -64,5 +130,453 @@ Result Pipeline::CreatePipelineLayout() {
   return {};
 }
 
+Result Pipeline::AddBufferData(const BufferCommand* command) {
+  if (command->IsPushConstant()) {
+    BufferDescriptor::WriteValues(command, &push_constants_);
+    // Push constant ranges are a multiple of 4 bytes.
+    push_constants_.resize((push_constants_.size() + 3) / 4 * 4);
+    return {};
+  }
+
+  const DescriptorType type = command->IsSSBO()
+                                  ? DescriptorType::kStorageBuffer
+                                  : DescriptorType::kUniformBuffer;
+  const auto key =
+      std::make_pair(command->GetDescriptorSet(), command->GetBinding());
+  auto it = buffer_descriptors_.find(key);
+  if (it == buffer_descriptors_.end()) {
+    auto descriptor =
+        MakeUnique<BufferDescriptor>(type, key.first, key.second);
+    it = buffer_descriptors_.emplace(key, std::move(descriptor)).first;
+    descriptors_added_ = true;
+  } else if (it->second->GetType() != type) {
+    return Result("Vulkan::Descriptor set " + std::to_string(key.first) +
+                  " binding " + std::to_string(key.second) +
+                  " already has another type of buffer");
+  }
+
+  it->second->AddData(command);
+  return {};
+}
+
+Result Pipeline::PrepareDescriptors() {
+  const bool layout_changed =
+      pipeline_layout_ == VK_NULL_HANDLE || descriptors_added_ ||
+      push_constants_.size() > push_constant_range_size_;
+  bool buffers_changed = false;
+  for (const auto& it : buffer_descriptors_) {
+    if (it.second->NeedsBuffer())
+      buffers_changed = true;
+  }
+  if (!layout_changed && !buffers_changed)
+    return {};
+
+  // Commands recorded or executing may use the descriptor sets and buffers
+  // which are about to change.
+  Result r = SubmitRecordedCommands();
+  if (!r.IsSuccess())
+    return r;
+
+  if (layout_changed) {
+    if (pipeline_ != VK_NULL_HANDLE) {
+      vkDestroyPipeline(device_, pipeline_, nullptr);
+      pipeline_ = VK_NULL_HANDLE;
+    }
+    if (pipeline_layout_ != VK_NULL_HANDLE) {
+      vkDestroyPipelineLayout(device_, pipeline_layout_, nullptr);
+      pipeline_layout_ = VK_NULL_HANDLE;
+    }
+    DestroyDescriptorSets();
+
+    r = CreateDescriptorSets();
+    if (!r.IsSuccess())
+      return r;
+
+    r = CreatePipelineLayout();
+    if (!r.IsSuccess())
+      return r;
+
+    descriptors_added_ = false;
+  }
+
+  for (auto& it : buffer_descriptors_) {
+    if (!it.second->NeedsBuffer())
+      continue;
+
+    r = it.second->CreateOrResizeBuffer(device_, allocator_, staging_ring_,
+                                        command_.get());
+    if (!r.IsSuccess())
+      return r;
+  }
+
+  WriteDescriptorSets();
+  return {};
+}
+
+Result Pipeline::CreateDescriptorSets() {
+  if (buffer_descriptors_.empty())
+    return {};
+
+  // Sets without descriptors below the last one get empty layouts.
+  const uint32_t set_count = buffer_descriptors_.rbegin()->first.first + 1;
+  std::vector<std::vector<VkDescriptorSetLayoutBinding>> bindings(set_count);
+  uint32_t storage_count = 0;
+  uint32_t uniform_count = 0;
+  for (const auto& it : buffer_descriptors_) {
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = it.first.second;
+    binding.descriptorType = ToVkDescriptorType(it.second->GetType());
+    binding.descriptorCount = 1;
+    binding.stageFlags = GetShaderStageFlags();
+    bindings[it.first.first].push_back(binding);
+
+    if (it.second->IsStorageBuffer())
+      ++storage_count;
+    else
+      ++uniform_count;
+  }
+
+  descriptor_set_layout_.resize(set_count, VK_NULL_HANDLE);
+  for (uint32_t i = 0; i < set_count; ++i) {
+    VkDescriptorSetLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = static_cast<uint32_t>(bindings[i].size());
+    layout_info.pBindings = bindings[i].data();
+    if (vkCreateDescriptorSetLayout(device_, &layout_info, nullptr,
+                                    &descriptor_set_layout_[i]) !=
+        VK_SUCCESS) {
+      return Result("Vulkan::Calling vkCreateDescriptorSetLayout Fail");
+    }
+  }
+
+  std::vector<VkDescriptorPoolSize> pool_sizes;
+  if (storage_count > 0)
+    pool_sizes.push_back({VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storage_count});
+  if (uniform_count > 0)
+    pool_sizes.push_back({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniform_count});
+
+  VkDescriptorPoolCreateInfo pool_info = {};
+  pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  pool_info.maxSets = set_count;
+  pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+  pool_info.pPoolSizes = pool_sizes.data();
+  if (vkCreateDescriptorPool(device_, &pool_info, nullptr,
+                             &descriptor_pool_) != VK_SUCCESS) {
+    return Result("Vulkan::Calling vkCreateDescriptorPool Fail");
+  }
+
+  descriptor_sets_.resize(set_count, VK_NULL_HANDLE);
+  VkDescriptorSetAllocateInfo set_info = {};
+  set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  set_info.descriptorPool = descriptor_pool_;
+  set_info.descriptorSetCount = set_count;
+  set_info.pSetLayouts = descriptor_set_layout_.data();
+  if (vkAllocateDescriptorSets(device_, &set_info, descriptor_sets_.data()) !=
+      VK_SUCCESS) {
+    return Result("Vulkan::Calling vkAllocateDescriptorSets Fail");
+  }
+
+  return {};
+}
+
+void Pipeline::DestroyDescriptorSets() {
+  // The sets are freed with the pool.
+  if (descriptor_pool_ != VK_NULL_HANDLE)
+    vkDestroyDescriptorPool(device_, descriptor_pool_, nullptr);
+  descriptor_pool_ = VK_NULL_HANDLE;
+  descriptor_sets_.clear();
+
+  for (auto layout : descriptor_set_layout_) {
+    if (layout != VK_NULL_HANDLE)
+      vkDestroyDescriptorSetLayout(device_, layout, nullptr);
+  }
+  descriptor_set_layout_.clear();
+}
+
+void Pipeline::WriteDescriptorSets() {
+  if (buffer_descriptors_.empty())
+    return;
+
+  std::vector<VkDescriptorBufferInfo> buffer_info(buffer_descriptors_.size());
+  std::vector<VkWriteDescriptorSet> writes(buffer_descriptors_.size());
+  size_t i = 0;
+  for (const auto& it : buffer_descriptors_) {
+    buffer_info[i].buffer = it.second->GetBuffer()->GetVkBuffer();
+    buffer_info[i].offset = 0;
+    buffer_info[i].range = VK_WHOLE_SIZE;
+
+    writes[i] = {};
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet = descriptor_sets_[it.first.first];
+    writes[i].dstBinding = it.first.second;
+    writes[i].descriptorCount = 1;
+    writes[i].descriptorType = ToVkDescriptorType(it.second->GetType());
+    writes[i].pBufferInfo = &buffer_info[i];
+    ++i;
+  }
+
+  vkUpdateDescriptorSets(device_, static_cast<uint32_t>(writes.size()),
+                         writes.data(), 0, nullptr);
+}
+
+bool Pipeline::HasStorageBuffers() const {
+  for (const auto& it : buffer_descriptors_) {
+    if (it.second->IsStorageBuffer())
+      return true;
+  }
+  return false;
+}
+
+bool Pipeline::HasPendingUploads() const {
+  for (const auto& it : buffer_descriptors_) {
+    if (it.second->HasPendingUpload())
+      return true;
+  }
+  return false;
+}
+
+Result Pipeline::RecordBufferUploads() {
+  for (auto& it : buffer_descriptors_) {
+    bool submitted = false;
+    while (it.second->HasPendingUpload()) {
+      const size_t pending = it.second->GetDirtyRanges().size();
+      Result r = it.second->RecordUpload(command_->GetCommandBuffer());
+      if (r.IsSuccess())
+        break;
+
+      // The staging ring is full of the regions of the batch being
+      // recorded. Submitting it makes room, unless nothing fit in the ring
+      // since the last submission either.
+      if (submitted && it.second->GetDirtyRanges().size() == pending)
+        return r;
+
+      r = SubmitRecordedCommands();
+      if (!r.IsSuccess())
+        return r;
+
+      r = command_->BeginIfNotInRecording();
+      if (!r.IsSuccess())
+        return r;
+      submitted = true;
+    }
+  }
+  return {};
+}
+
+Result Pipeline::PrepareBuffersForReadback() {
+  if (buffer_descriptors_.empty())
+    return {};
+
+  // Buffer commands since the last dispatch have not created or uploaded
+  // the buffers yet.
+  Result r = PrepareDescriptors();
+  if (!r.IsSuccess())
+    return r;
+
+  if (!HasPendingUploads())
+    return {};
+
+  r = command_->BeginIfNotInRecording();
+  if (!r.IsSuccess())
+    return r;
+
+  EndRenderPass();
+  // The uploads overwrite data the recorded dispatches use.
+  RecordMemoryBarrier(command_->GetCommandBuffer(),
+                      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                      VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_TRANSFER_BIT,
+                      VK_ACCESS_TRANSFER_WRITE_BIT);
+
+  r = RecordBufferUploads();
+  if (!r.IsSuccess())
+    return r;
+
+  // The readback copies the uploaded data, and later dispatches read it.
+  RecordMemoryBarrier(command_->GetCommandBuffer(),
+                      VK_PIPELINE_STAGE_TRANSFER_BIT,
+                      VK_ACCESS_TRANSFER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                      VK_ACCESS_TRANSFER_READ_BIT |
+                          VK_ACCESS_TRANSFER_WRITE_BIT |
+                          VK_ACCESS_UNIFORM_READ_BIT |
+                          VK_ACCESS_SHADER_READ_BIT |
+                          VK_ACCESS_SHADER_WRITE_BIT);
+  return {};
+}
+
+void Pipeline::BindDescriptors(VkPipelineBindPoint bind_point) {
+  VkCommandBuffer command = command_->GetCommandBuffer();
+  if (!descriptor_sets_.empty()) {
+    vkCmdBindDescriptorSets(command, bind_point, pipeline_layout_, 0,
+                            static_cast<uint32_t>(descriptor_sets_.size()),
+                            descriptor_sets_.data(), 0, nullptr);
+  }
+  if (push_constant_range_size_ > 0) {
+    vkCmdPushConstants(command, pipeline_layout_, GetShaderStageFlags(), 0,
+                       push_constant_range_size_, push_constants_.data());
+  }
+}
+
+Result Pipeline::SubmitRecordedCommands() {
+  if (!command_->IsRecording())
+    return command_->Wait();
+
+  EndRenderPass();
+  Result r = command_->End();
+  if (!r.IsSuccess())
+    return r;
+
+  return command_->SubmitAndReset();
+}
+
+Buffer* Pipeline::FindStorageBuffer(uint32_t descriptor_set,
+                                    uint32_t binding) {
+  auto it = buffer_descriptors_.find(std::make_pair(descriptor_set, binding));
+  if (it == buffer_descriptors_.end() || !it->second->IsStorageBuffer())
+    return nullptr;
+  return it->second->GetBuffer();
+}
+
+Result Pipeline::CopyBufferToHost(Buffer* buffer, size_t offset, size_t size) {
+  Result r = command_->BeginIfNotInRecording();
+  if (!r.IsSuccess())
+    return r;
+
+  EndRenderPass();
+  r = buffer->CopyToHost(command_->GetCommandBuffer(), offset, size);
+  if (!r.IsSuccess())
+    return r;
+
+  r = command_->End();
+  if (!r.IsSuccess())
+    return r;
+
+  return command_->SubmitAndReset();
+}
+
+Result Pipeline::ProbeSSBOOnDevice(const ProbeSSBOCommand* command,
+                                   const BufferVerifier& verifier,
+                                   DeviceVerifier* device_verifier,
+                                   Buffer* buffer,
+                                   bool* passed) {
+  *passed = false;
+
+  const size_t offset = command->GetOffset();
+  const size_t count = command->GetValues().size();
+  std::vector<float> bounds;
+  if (count < DeviceVerifier::kMinValues || offset % sizeof(float) != 0 ||
+      buffer->GetSizeInBytes() > DeviceVerifier::kMaxValueBytes ||
+      !verifier.GetFloatBounds(command, &bounds)) {
+    return {};
+  }
+
+  Result r = command_->BeginIfNotInRecording();
+  if (!r.IsSuccess())
+    return r;
+
+  EndRenderPass();
+  DeviceVerifier::Mismatches mismatches;
+  r = device_verifier->Verify(
+      command_.get(), buffer->GetVkBuffer(),
+      static_cast<uint32_t>(offset / sizeof(float)),
+      static_cast<uint32_t>(count), false, bounds, &mismatches);
+  if (!r.IsSuccess())
+    return r;
+
+  *passed = mismatches.count == 0;
+  return {};
+}
+
+Result Pipeline::ProbeSSBO(const ProbeSSBOCommand* command,
+                           const BufferVerifier& verifier,
+                           DeviceVerifier* device_verifier) {
+  Result r = PrepareBuffersForReadback();
+  if (!r.IsSuccess())
+    return r;
+
+  Buffer* buffer =
+      FindStorageBuffer(command->GetDescriptorSet(), command->GetBinding());
+  if (!buffer) {
+    return Result("Vulkan::ProbeSSBO no storage buffer at descriptor set " +
+                  std::to_string(command->GetDescriptorSet()) + " binding " +
+                  std::to_string(command->GetBinding()));
+  }
+
+  const size_t offset = command->GetOffset();
+  const size_t size = BufferVerifier::GetProbeSize(command);
+  if (offset + size > buffer->GetSizeInBytes()) {
+    return Result("Vulkan::ProbeSSBO values end at " +
+                  std::to_string(offset + size) +
+                  " which is out of the buffer size " +
+                  std::to_string(buffer->GetSizeInBytes()));
+  }
+
+  // A failure on the device is compared again on the host to describe it.
+  // So is a probe the device could not compare, such as when its bounds
+  // could not be uploaded.
+  if (device_verifier) {
+    bool passed = false;
+    r = ProbeSSBOOnDevice(command, verifier, device_verifier, buffer,
+                          &passed);
+    if (r.IsSuccess() && passed)
+      return {};
+  }
+
+  // Only the probed range is read back, a staging ring region at a time.
+  const size_t count = command->GetValues().size();
+  if (count == 0)
+    return {};
+  const size_t value_size = size / count;
+  const size_t chunk_count = std::max<size_t>(
+      1, static_cast<size_t>(staging_ring_->GetMaxRegionSize()) / value_size);
+
+  BufferVerifier::Mismatches mismatches;
+  for (size_t first = 0; first < count; first += chunk_count) {
+    const size_t n = std::min(chunk_count, count - first);
+    const size_t chunk_offset = offset + first * value_size;
+    r = CopyBufferToHost(buffer, chunk_offset, n * value_size);
+    if (!r.IsSuccess())
+      return r;
+
+    r = verifier.VerifyRange(command,
+                             buffer->HostAccessibleBytePtr(chunk_offset),
+                             first, n, &mismatches);
+    if (!r.IsSuccess())
+      return r;
+  }
+  return BufferVerifier::GetResult(command, mismatches);
+}
+
+Result Pipeline::HashSSBO(const ProbeHashCommand* command, uint64_t* hash) {
+  Result r = PrepareBuffersForReadback();
+  if (!r.IsSuccess())
+    return r;
+
+  Buffer* buffer =
+      FindStorageBuffer(command->GetDescriptorSet(), command->GetBinding());
+  if (!buffer) {
+    return Result("Vulkan::Probe hash no storage buffer at descriptor set " +
+                  std::to_string(command->GetDescriptorSet()) + " binding " +
+                  std::to_string(command->GetBinding()));
+  }
+
+  // Read back and hashed a staging ring region at a time.
+  const size_t size = buffer->GetSizeInBytes();
+  const size_t chunk_size =
+      static_cast<size_t>(staging_ring_->GetMaxRegionSize());
+  ContentHasher hasher;
+  for (size_t offset = 0; offset < size; offset += chunk_size) {
+    const size_t n = std::min(chunk_size, size - offset);
+    r = CopyBufferToHost(buffer, offset, n);
+    if (!r.IsSuccess())
+      return r;
+
+    hasher.Update(buffer->HostAccessibleBytePtr(offset), n);
+  }
+  *hash = hasher.Digest();
+  return {};
+}
+
 }  // namespace vulkan
 }  // namespace amber
@@ -15,17 +15,27 @@
 #ifndef SRC_VULKAN_PIPELINE_H_
 #define SRC_VULKAN_PIPELINE_H_
 
+#include <map>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "amber/result.h"
 #include "src/engine.h"
+#include "src/vulkan/buffer.h"
+#include "src/vulkan/buffer_descriptor.h"
+#include "src/vulkan/buffer_verifier.h"
 #include "src/vulkan/command.h"
+#include "src/vulkan/device_verifier.h"
+#include "src/vulkan/memory_allocator.h"
+#include "src/vulkan/staging_ring.h"
 #include "vulkan/vulkan.h"
 
 namespace amber {
 namespace vulkan {
 
+class ComputePipeline;
 class GraphicsPipeline;
 
 class Pipeline {
@@ -35,29 +45,142 @@ class Pipeline {
   bool IsGraphics() const { return pipeline_type_ == PipelineType::kGraphics; }
   bool IsCompute() const { return pipeline_type_ == PipelineType::kCompute; }
 
+  ComputePipeline* AsCompute();
   GraphicsPipeline* AsGraphics();
 
   virtual void Shutdown();
 
+  // Creates the VkPipeline through |cache|, which is owned by the device.
+  // When |compare| is set the pipeline is also created once without a cache,
+  // so the creation time can be reported both ways.
+  void SetPipelineCache(VkPipelineCache cache, bool compare) {
+    pipeline_cache_ = cache;
+    compare_pipeline_cache_ = compare;
+  }
+
+  // Sets the entry point of the shader at |stage|. A VkPipeline created with
+  // the previous entry point is destroyed once the commands using it are
+  // done, and created again by the next draw or dispatch.
+  Result SetEntryPoint(VkShaderStageFlagBits stage, const std::string& name);
+
+  // Time spent creating the VkPipeline with and without the pipeline cache,
+  // summed over the times it was created again for a new entry point. The
+  // uncached time is only measured when comparing.
+  double GetCreationMs() const { return creation_ms_; }
+  double GetUncachedCreationMs() const { return uncached_creation_ms_; }
+
+  // Adds the size or values of |command| to the buffer descriptor at its
+  // descriptor set and binding, or to the push constants. The buffers and
+  // descriptor sets are created when the pipeline is next used.
+  Result AddBufferData(const BufferCommand* command);
+
+  // Reads back the values |command| probes from the storage buffer at its
+  // descriptor set and binding, and compares them with |verifier|. Many
+  // floats are compared on the device instead when |device_verifier| is
+  // given, and only read back to describe a failure.
+  Result ProbeSSBO(const ProbeSSBOCommand* command,
+                   const BufferVerifier& verifier,
+                   DeviceVerifier* device_verifier);
+
+  // Reads back the whole storage buffer |command| names and stores the hash
+  // of its contents in |hash|.
+  Result HashSSBO(const ProbeHashCommand* command, uint64_t* hash);
+
  protected:
+  // The entry point names |shader_stage_info| points at are copied, so they
+  // only need to live until the constructor returns.
   Pipeline(PipelineType type,
            VkDevice device,
-           const VkPhysicalDeviceMemoryProperties& properties);
+           MemoryAllocator* allocator,
+           StagingRing* staging_ring,
+           std::vector<VkPipelineShaderStageCreateInfo> shader_stage_info);
   Result InitializeCommandBuffer(VkCommandPool pool, VkQueue queue);
 
+  // Creates the pipeline layout from the descriptor set layouts and the
+  // push constants.
   Result CreatePipelineLayout();
 
+  // Creates the descriptor sets and the pipeline layout, or creates them
+  // again when descriptors or push constants were added since, destroying
+  // |pipeline_|. Buffers are created or resized and the descriptor sets
+  // written. Submitted commands are only waited for when something they
+  // use changes.
+  Result PrepareDescriptors();
+
+  bool HasStorageBuffers() const;
+  bool HasPendingUploads() const;
+  // Records the uploads of the buffer data added since the last one. When
+  // the staging ring runs out of room, the batch being recorded is
+  // submitted and the rest recorded into the next one.
+  Result RecordBufferUploads();
+  // Creates the buffers and records the uploads of the buffer commands
+  // since the last dispatch, so probes read what the commands wrote.
+  Result PrepareBuffersForReadback();
+  // Binds the descriptor sets and pushes the push constants at
+  // |bind_point|.
+  void BindDescriptors(VkPipelineBindPoint bind_point);
+
+  // Ends and submits the commands being recorded, and waits for every
+  // submitted batch.
+  Result SubmitRecordedCommands();
+
+  // Ends the render pass of pipelines which have one, before commands which
+  // must be recorded outside of it.
+  virtual void EndRenderPass() {}
+
+  // Returns the storage buffer at |descriptor_set| and |binding|, or nullptr
+  // when there is none.
+  Buffer* FindStorageBuffer(uint32_t descriptor_set, uint32_t binding);
+
+  // Copies |size| bytes at |offset| of |buffer| to the host and waits for
+  // the copy.
+  Result CopyBufferToHost(Buffer* buffer, size_t offset, size_t size);
+
+  // Sets |passed| when the device finds no failing value of |command| in
+  // |buffer|. It stays false for probes which are compared on the host.
+  Result ProbeSSBOOnDevice(const ProbeSSBOCommand* command,
+                           const BufferVerifier& verifier,
+                           DeviceVerifier* device_verifier,
+                           Buffer* buffer,
+                           bool* passed);
+
+  // The pName of each stage points into |entry_points_|, which is never
+  // resized.
+  std::vector<VkPipelineShaderStageCreateInfo> shader_stage_info_;
+  std::vector<std::string> entry_points_;
+
   VkPipelineCache pipeline_cache_ = VK_NULL_HANDLE;
+  bool compare_pipeline_cache_ = false;
+  double creation_ms_ = 0.0;
+  double uncached_creation_ms_ = 0.0;
   VkPipeline pipeline_ = VK_NULL_HANDLE;
   VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
 
   std::vector<VkDescriptorSetLayout> descriptor_set_layout_;
+  VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
+  std::vector<VkDescriptorSet> descriptor_sets_;
+
+  // Buffer descriptors by descriptor set and binding.
+  std::map<std::pair<uint32_t, uint32_t>, std::unique_ptr<BufferDescriptor>>
+      buffer_descriptors_;
+  // Set when a descriptor was added after the descriptor sets were created.
+  bool descriptors_added_ = false;
+
+  std::vector<uint8_t> push_constants_;
+  // Size of the push constant range of |pipeline_layout_|.
+  uint32_t push_constant_range_size_ = 0;
 
   VkDevice device_ = VK_NULL_HANDLE;
-  VkPhysicalDeviceMemoryProperties memory_properties_;
+  MemoryAllocator* allocator_ = nullptr;
+  StagingRing* staging_ring_ = nullptr;
   std::unique_ptr<CommandBuffer> command_;
 
  private:
+  VkShaderStageFlags GetShaderStageFlags() const;
+  Result CreateDescriptorSets();
+  void DestroyDescriptorSets();
+  void WriteDescriptorSets();
+
   PipelineType pipeline_type_;
 };
 
@@ -0,0 +1,351 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/pixel_verifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+const double kDefaultTolerance = 0.002;
+
+// Rectangles are only split when every thread gets at least this many
+// pixels, below that starting the threads costs more than it saves.
+const uint64_t kMinPixelsPerThread = 256 * 1024;
+
+// Slack for the rounding of the expected color when it is converted to the
+// range of 8 bit values.
+const double kByteRoundingSlack = 1e-6;
+
+// The accepted values of each channel: |lo8| and |hi8| for the bytes of
+// 8 bit formats in the order they are stored, |lo| and |hi| for the lanes of
+// unpacked pixels.
+struct Bounds {
+  uint8_t lo8[4];
+  uint8_t hi8[4];
+  float lo[4];
+  float hi[4];
+};
+
+struct Scan {
+  const TexelUnpacker* unpacker;
+  // Compares the bytes of the pixels instead of unpacking them.
+  bool bytes;
+  Bounds bounds;
+};
+
+void SetByteBounds(double lo, double hi, uint8_t* lo8, uint8_t* hi8) {
+  const double lo_byte = std::ceil(lo * 255.0 - kByteRoundingSlack);
+  const double hi_byte = std::floor(hi * 255.0 + kByteRoundingSlack);
+  if (lo_byte > 255.0 || hi_byte < 0.0 || lo_byte > hi_byte) {
+    // No value passes.
+    *lo8 = 255;
+    *hi8 = 0;
+    return;
+  }
+  *lo8 = static_cast<uint8_t>(std::max(lo_byte, 0.0));
+  *hi8 = static_cast<uint8_t>(std::min(hi_byte, 255.0));
+}
+
+// Counts the pixels of an 8 bit row which are out of bounds and sets |first|
+// to the first of them.
+uint32_t ScanRow8(const uint8_t* row,
+                  uint32_t width,
+                  const Bounds& bounds,
+                  uint32_t* first) {
+  uint32_t count = 0;
+  uint32_t i = 0;
+#if defined(__SSE2__)
+  // Four pixels per step: a byte is in bounds when clamping it to the bounds
+  // leaves it unchanged, and a pixel when all four of its bytes are.
+  uint32_t lo_bits;
+  uint32_t hi_bits;
+  memcpy(&lo_bits, bounds.lo8, sizeof(lo_bits));
+  memcpy(&hi_bits, bounds.hi8, sizeof(hi_bits));
+  const __m128i lo = _mm_set1_epi32(static_cast<int>(lo_bits));
+  const __m128i hi = _mm_set1_epi32(static_cast<int>(hi_bits));
+  const __m128i all_ones = _mm_set1_epi32(-1);
+  for (; i + 4 <= width; i += 4) {
+    const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i * 4));
+    const __m128i in_bounds =
+        _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, lo), v),
+                      _mm_cmpeq_epi8(_mm_min_epu8(v, hi), v));
+    const int passed = _mm_movemask_ps(
+        _mm_castsi128_ps(_mm_cmpeq_epi32(in_bounds, all_ones)));
+    if (passed == 0xf)
+      continue;
+
+    for (uint32_t k = 0; k < 4; ++k) {
+      if (passed & (1 << k))
+        continue;
+      if (count == 0)
+        *first = i + k;
+      ++count;
+    }
+  }
+#endif  // defined(__SSE2__)
+
+  for (; i < width; ++i) {
+    const uint8_t* p = row + i * 4;
+    if (p[0] >= bounds.lo8[0] && p[0] <= bounds.hi8[0] &&
+        p[1] >= bounds.lo8[1] && p[1] <= bounds.hi8[1] &&
+        p[2] >= bounds.lo8[2] && p[2] <= bounds.hi8[2] &&
+        p[3] >= bounds.lo8[3] && p[3] <= bounds.hi8[3]) {
+      continue;
+    }
+    if (count == 0)
+      *first = i;
+    ++count;
+  }
+  return count;
+}
+
+uint32_t ScanRowFloat(const float* row,
+                      uint32_t width,
+                      const Bounds& bounds,
+                      uint32_t* first) {
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < width; ++i) {
+    const float* p = row + i * 4;
+    // Written so NaN fails.
+    if (p[0] >= bounds.lo[0] && p[0] <= bounds.hi[0] && p[1] >= bounds.lo[1] &&
+        p[1] <= bounds.hi[1] && p[2] >= bounds.lo[2] && p[2] <= bounds.hi[2] &&
+        p[3] >= bounds.lo[3] && p[3] <= bounds.hi[3]) {
+      continue;
+    }
+    if (count == 0)
+      *first = i;
+    ++count;
+  }
+  return count;
+}
+
+uint32_t ScanRow(const Scan& scan,
+                 const uint8_t* row,
+                 uint32_t width,
+                 std::vector<float>* lanes,
+                 uint32_t* first) {
+  if (scan.bytes)
+    return ScanRow8(row, width, scan.bounds, first);
+
+  lanes->resize(width * 4);
+  scan.unpacker->Unpack(row, width, lanes->data());
+  return ScanRowFloat(lanes->data(), width, scan.bounds, first);
+}
+
+struct Band {
+  uint64_t count = 0;
+  uint32_t first_x = 0;
+  uint32_t first_y = 0;
+};
+
+// Scans rows [begin, end). With |early_exit| it stops at the first failing
+// row, and also once |first_failed_row| shows an earlier band failed before
+// the current row, so the first failure overall is still found.
+Band ScanRows(const Scan& scan,
+              const uint8_t* data,
+              size_t row_pitch,
+              uint32_t width,
+              uint32_t begin,
+              uint32_t end,
+              bool early_exit,
+              std::atomic<uint32_t>* first_failed_row) {
+  Band band;
+  std::vector<float> lanes;
+  for (uint32_t y = begin; y < end; ++y) {
+    if (early_exit && y > first_failed_row->load(std::memory_order_relaxed))
+      break;
+
+    uint32_t first = 0;
+    const uint32_t count =
+        ScanRow(scan, data + y * row_pitch, width, &lanes, &first);
+    if (count == 0)
+      continue;
+
+    if (band.count == 0) {
+      band.first_x = first;
+      band.first_y = y;
+
+      uint32_t current = first_failed_row->load(std::memory_order_relaxed);
+      while (y < current && !first_failed_row->compare_exchange_weak(
+                                current, y, std::memory_order_relaxed)) {
+      }
+    }
+    band.count += count;
+    if (early_exit)
+      break;
+  }
+  return band;
+}
+
+}  // namespace
+
+PixelVerifier::PixelVerifier() {
+  for (uint32_t c = 0; c < 4; ++c)
+    tolerance_[c] = kDefaultTolerance;
+}
+
+PixelVerifier::~PixelVerifier() = default;
+
+Result PixelVerifier::SetTolerances(
+    const std::vector<ToleranceCommand::Tolerance>& tolerances) {
+  if (tolerances.empty()) {
+    for (uint32_t c = 0; c < 4; ++c)
+      tolerance_[c] = kDefaultTolerance;
+    return {};
+  }
+  if (tolerances.size() != 1 && tolerances.size() != 4)
+    return Result("Vulkan::Tolerance needs 1 or 4 values");
+
+  for (uint32_t c = 0; c < 4; ++c) {
+    const auto& tolerance = tolerances[tolerances.size() == 1 ? 0 : c];
+    tolerance_[c] =
+        tolerance.is_percent ? tolerance.value / 100.0 : tolerance.value;
+  }
+  return {};
+}
+
+void PixelVerifier::GetChannelBounds(const float expected_rgba[4],
+                                     bool check_alpha,
+                                     double lo[4],
+                                     double hi[4]) const {
+  for (uint32_t c = 0; c < 4; ++c) {
+    lo[c] = -std::numeric_limits<double>::infinity();
+    hi[c] = std::numeric_limits<double>::infinity();
+    if (c != 3 || check_alpha) {
+      lo[c] = static_cast<double>(expected_rgba[c]) - tolerance_[c];
+      hi[c] = static_cast<double>(expected_rgba[c]) + tolerance_[c];
+    }
+  }
+}
+
+bool PixelVerifier::GetByteBounds(const TexelUnpacker& unpacker,
+                                  const float expected_rgba[4],
+                                  bool check_alpha,
+                                  uint8_t lo8[4],
+                                  uint8_t hi8[4]) const {
+  uint32_t byte_lanes[4];
+  if (!unpacker.IsUNorm8x4(byte_lanes))
+    return false;
+
+  double lo[4];
+  double hi[4];
+  GetChannelBounds(expected_rgba, check_alpha, lo, hi);
+  for (uint32_t i = 0; i < 4; ++i) {
+    const uint32_t c = byte_lanes[i];
+    SetByteBounds(lo[c], hi[c], &lo8[i], &hi8[i]);
+  }
+  return true;
+}
+
+Result PixelVerifier::Verify(const TexelUnpacker& unpacker,
+                             const uint8_t* data,
+                             size_t row_pitch,
+                             uint32_t width,
+                             uint32_t height,
+                             const float expected_rgba[4],
+                             bool check_alpha,
+                             Mismatches* mismatches) const {
+  if (mismatches == nullptr)
+    return Result("Vulkan::Given Mismatches pointer is nullptr");
+
+  *mismatches = Mismatches();
+  if (width == 0 || height == 0)
+    return {};
+
+  Scan scan;
+  scan.unpacker = &unpacker;
+  uint32_t byte_lanes[4];
+  scan.bytes = unpacker.IsUNorm8x4(byte_lanes);
+  double lo[4];
+  double hi[4];
+  GetChannelBounds(expected_rgba, check_alpha, lo, hi);
+  for (uint32_t c = 0; c < 4; ++c) {
+    scan.bounds.lo[c] = static_cast<float>(lo[c]);
+    scan.bounds.hi[c] = static_cast<float>(hi[c]);
+  }
+  for (uint32_t i = 0; scan.bytes && i < 4; ++i) {
+    const uint32_t c = byte_lanes[i];
+    SetByteBounds(lo[c], hi[c], &scan.bounds.lo8[i], &scan.bounds.hi8[i]);
+  }
+
+  uint64_t threads =
+      max_threads_ > 0 ? max_threads_ : std::thread::hardware_concurrency();
+  threads = std::min(threads, static_cast<uint64_t>(width) * height /
+                                  kMinPixelsPerThread);
+  threads = std::max(std::min(threads, static_cast<uint64_t>(height)),
+                     static_cast<uint64_t>(1));
+
+  std::atomic<uint32_t> first_failed_row(height);
+  std::vector<Band> bands;
+  if (threads == 1) {
+    bands.push_back(ScanRows(scan, data, row_pitch, width, 0, height,
+                             early_exit_, &first_failed_row));
+  } else {
+    const uint32_t rows_per_band =
+        static_cast<uint32_t>((height + threads - 1) / threads);
+    std::vector<std::future<Band>> jobs;
+    for (uint32_t begin = 0; begin < height; begin += rows_per_band) {
+      const uint32_t end = std::min(begin + rows_per_band, height);
+      const bool early_exit = early_exit_;
+      jobs.push_back(std::async(std::launch::async, [=, &scan,
+                                                     &first_failed_row]() {
+        return ScanRows(scan, data, row_pitch, width, begin, end, early_exit,
+                        &first_failed_row);
+      }));
+    }
+    for (auto& job : jobs)
+      bands.push_back(job.get());
+  }
+
+  for (const auto& band : bands) {
+    if (band.count == 0)
+      continue;
+    if (mismatches->count == 0) {
+      mismatches->first_x = band.first_x;
+      mismatches->first_y = band.first_y;
+    }
+    mismatches->count += band.count;
+    if (early_exit_)
+      break;
+  }
+
+  if (mismatches->count > 0) {
+    float rgba[4];
+    unpacker.Unpack(data + mismatches->first_y * row_pitch +
+                        mismatches->first_x * unpacker.GetTexelSize(),
+                    1, rgba);
+    for (uint32_t c = 0; c < 4; ++c)
+      mismatches->first_rgba[c] = static_cast<double>(rgba[c]);
+  }
+  if (early_exit_)
+    mismatches->count = std::min<uint64_t>(mismatches->count, 1);
+  return {};
+}
+
+}  // namespace vulkan
+}  // namespace amber
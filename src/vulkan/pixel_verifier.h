@@ -0,0 +1,98 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_VULKAN_PIXEL_VERIFIER_H_
+#define SRC_VULKAN_PIXEL_VERIFIER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "amber/result.h"
+#include "src/command.h"
+#include "src/vulkan/texel_unpacker.h"
+
+namespace amber {
+namespace vulkan {
+
+// Compares a rectangle of pixels against an expected color. Each channel
+// passes when it is within the tolerance of the expected value. 8 bit UNORM
+// formats are compared several pixels at a time, other formats are unpacked
+// a row at a time first. Large rectangles are split by rows across threads.
+class PixelVerifier {
+ public:
+  struct Mismatches {
+    // Number of pixels which failed. Stops at 1 with early exit.
+    uint64_t count = 0;
+    // The first failing pixel in row major order, relative to the origin of
+    // the rectangle, and its color normalized to [0, 1].
+    uint32_t first_x = 0;
+    uint32_t first_y = 0;
+    double first_rgba[4] = {};
+  };
+
+  PixelVerifier();
+  ~PixelVerifier();
+
+  // Takes one tolerance for every channel or one for each of R, G, B and A.
+  // Absolute tolerances are in the units of the expected color, percentages
+  // are of the [0, 1] range of a channel. Without tolerances a small epsilon
+  // is used.
+  Result SetTolerances(
+      const std::vector<ToleranceCommand::Tolerance>& tolerances);
+
+  // Stops at the first failing pixel instead of counting all of them.
+  void SetEarlyExit(bool early_exit) { early_exit_ = early_exit; }
+
+  // Sets the most threads a rectangle is split across. 0 uses one per
+  // hardware thread.
+  void SetMaxThreads(uint32_t max_threads) { max_threads_ = max_threads; }
+
+  // Sets |lo8| and |hi8| to the accepted values of the bytes of a pixel, in
+  // the order they are stored, for the formats where the bytes are compared
+  // directly. Returns false for formats whose pixels are unpacked.
+  bool GetByteBounds(const TexelUnpacker& unpacker,
+                     const float expected_rgba[4],
+                     bool check_alpha,
+                     uint8_t lo8[4],
+                     uint8_t hi8[4]) const;
+
+  // Compares the |width| x |height| rectangle starting at |data|, whose rows
+  // are |row_pitch| bytes apart and whose pixels |unpacker| decodes, against
+  // |expected_rgba|. Alpha is only compared when |check_alpha| is set.
+  Result Verify(const TexelUnpacker& unpacker,
+                const uint8_t* data,
+                size_t row_pitch,
+                uint32_t width,
+                uint32_t height,
+                const float expected_rgba[4],
+                bool check_alpha,
+                Mismatches* mismatches) const;
+
+ private:
+  // The accepted range of each channel, in the units of |expected_rgba|.
+  void GetChannelBounds(const float expected_rgba[4],
+                        bool check_alpha,
+                        double lo[4],
+                        double hi[4]) const;
+
+  double tolerance_[4];
+  bool early_exit_ = false;
+  uint32_t max_threads_ = 0;
+};
+
+}  // namespace vulkan
+}  // namespace amber
+
+#endif  // SRC_VULKAN_PIXEL_VERIFIER_H_
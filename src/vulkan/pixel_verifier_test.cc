@@ -0,0 +1,287 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/pixel_verifier.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/vkscript/format_parser.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+const float kRed[4] = {1.0f, 0.0f, 0.0f, 1.0f};
+
+std::vector<uint8_t> MakeFrame(uint32_t width,
+                               uint32_t height,
+                               const uint8_t rgba[4]) {
+  std::vector<uint8_t> frame(width * height * 4);
+  for (size_t i = 0; i < frame.size(); i += 4)
+    memcpy(&frame[i], rgba, 4);
+  return frame;
+}
+
+TexelUnpacker MakeUnpacker(const std::string& name) {
+  TexelUnpacker unpacker;
+  auto format = vkscript::FormatParser().Parse(name);
+  EXPECT_TRUE(format != nullptr) << name;
+  if (format) {
+    Result r = unpacker.Initialize(*format);
+    EXPECT_TRUE(r.IsSuccess()) << r.Error();
+  }
+  return unpacker;
+}
+
+}  // namespace
+
+class PixelVerifierTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    rgba8_ = MakeUnpacker("R8G8B8A8_UNORM");
+    bgra8_ = MakeUnpacker("B8G8R8A8_UNORM");
+    rgba32f_ = MakeUnpacker("R32G32B32A32_SFLOAT");
+  }
+
+  TexelUnpacker rgba8_;
+  TexelUnpacker bgra8_;
+  TexelUnpacker rgba32f_;
+};
+
+TEST_F(PixelVerifierTest, MatchingFrame) {
+  const uint8_t red[4] = {255, 0, 0, 255};
+  auto frame = MakeFrame(37, 5, red);
+
+  PixelVerifier verifier;
+  PixelVerifier::Mismatches mismatches;
+  Result r = verifier.Verify(rgba8_, frame.data(), 37 * 4,
+                             37, 5, kRed, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(0U, mismatches.count);
+}
+
+TEST_F(PixelVerifierTest, CountsMismatches) {
+  const uint8_t red[4] = {255, 0, 0, 255};
+  auto frame = MakeFrame(37, 5, red);
+  // Both inside the SIMD steps and in the tail of a row.
+  frame[(2 * 37 + 6) * 4 + 1] = 10;
+  frame[(3 * 37 + 36) * 4 + 2] = 10;
+  frame[(4 * 37 + 1) * 4 + 0] = 0;
+
+  PixelVerifier verifier;
+  PixelVerifier::Mismatches mismatches;
+  Result r = verifier.Verify(rgba8_, frame.data(), 37 * 4,
+                             37, 5, kRed, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(3U, mismatches.count);
+  EXPECT_EQ(6U, mismatches.first_x);
+  EXPECT_EQ(2U, mismatches.first_y);
+  EXPECT_DOUBLE_EQ(1.0, mismatches.first_rgba[0]);
+  EXPECT_DOUBLE_EQ(static_cast<double>(10.0f / 255.0f),
+                   mismatches.first_rgba[1]);
+}
+
+TEST_F(PixelVerifierTest, EarlyExit) {
+  const uint8_t red[4] = {255, 0, 0, 255};
+  auto frame = MakeFrame(8, 8, red);
+  frame[(5 * 8 + 3) * 4 + 1] = 10;
+  frame[(6 * 8 + 1) * 4 + 1] = 10;
+
+  PixelVerifier verifier;
+  verifier.SetEarlyExit(true);
+  PixelVerifier::Mismatches mismatches;
+  Result r = verifier.Verify(rgba8_, frame.data(), 8 * 4, 8,
+                             8, kRed, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(1U, mismatches.count);
+  EXPECT_EQ(3U, mismatches.first_x);
+  EXPECT_EQ(5U, mismatches.first_y);
+}
+
+TEST_F(PixelVerifierTest, IgnoresAlphaForRGBProbes) {
+  const uint8_t red[4] = {255, 0, 0, 0};
+  auto frame = MakeFrame(4, 4, red);
+
+  PixelVerifier verifier;
+  PixelVerifier::Mismatches mismatches;
+  Result r = verifier.Verify(rgba8_, frame.data(), 4 * 4, 4,
+                             4, kRed, false, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(0U, mismatches.count);
+
+  r = verifier.Verify(rgba8_, frame.data(), 4 * 4, 4, 4,
+                      kRed, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(16U, mismatches.count);
+}
+
+TEST_F(PixelVerifierTest, BGRA) {
+  const uint8_t red[4] = {0, 0, 255, 255};
+  auto frame = MakeFrame(9, 3, red);
+
+  PixelVerifier verifier;
+  PixelVerifier::Mismatches mismatches;
+  Result r = verifier.Verify(bgra8_, frame.data(), 9 * 4, 9,
+                             3, kRed, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(0U, mismatches.count);
+}
+
+TEST_F(PixelVerifierTest, ByteBounds) {
+  std::vector<ToleranceCommand::Tolerance> tolerances = {{false, 0.01}};
+  PixelVerifier verifier;
+  Result r = verifier.SetTolerances(tolerances);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  // Bytes are in the order they are stored, and alpha accepts anything when
+  // it is not checked.
+  const float expected[4] = {0.5f, 0.0f, 1.0f, 1.0f};
+  uint8_t lo[4];
+  uint8_t hi[4];
+  ASSERT_TRUE(verifier.GetByteBounds(bgra8_, expected, false, lo, hi));
+  EXPECT_EQ(253U, lo[0]);
+  EXPECT_EQ(255U, hi[0]);
+  EXPECT_EQ(0U, lo[1]);
+  EXPECT_EQ(2U, hi[1]);
+  EXPECT_EQ(125U, lo[2]);
+  EXPECT_EQ(130U, hi[2]);
+  EXPECT_EQ(0U, lo[3]);
+  EXPECT_EQ(255U, hi[3]);
+
+  EXPECT_FALSE(verifier.GetByteBounds(rgba32f_, expected, false, lo, hi));
+}
+
+TEST_F(PixelVerifierTest, AbsoluteAndPercentTolerances) {
+  const uint8_t color[4] = {128, 64, 0, 255};
+  auto frame = MakeFrame(6, 2, color);
+  const float expected[4] = {0.5f, 0.3f, 0.0f, 1.0f};
+
+  PixelVerifier verifier;
+  PixelVerifier::Mismatches mismatches;
+  Result r = verifier.Verify(rgba8_, frame.data(), 6 * 4, 6,
+                             2, expected, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(12U, mismatches.count);
+
+  // 64 / 255 is 0.251, 0.049 away from the expected green.
+  std::vector<ToleranceCommand::Tolerance> tolerances = {
+      {false, 0.01}, {false, 0.05}, {false, 0.01}, {false, 0.01}};
+  r = verifier.SetTolerances(tolerances);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  r = verifier.Verify(rgba8_, frame.data(), 6 * 4, 6, 2,
+                      expected, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(0U, mismatches.count);
+
+  tolerances = {{true, 4.0}};
+  r = verifier.SetTolerances(tolerances);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  r = verifier.Verify(rgba8_, frame.data(), 6 * 4, 6, 2,
+                      expected, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(12U, mismatches.count);
+
+  tolerances = {{true, 5.0}};
+  r = verifier.SetTolerances(tolerances);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  r = verifier.Verify(rgba8_, frame.data(), 6 * 4, 6, 2,
+                      expected, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(0U, mismatches.count);
+}
+
+TEST_F(PixelVerifierTest, InvalidToleranceCount) {
+  PixelVerifier verifier;
+  std::vector<ToleranceCommand::Tolerance> tolerances = {{false, 0.1},
+                                                         {false, 0.1}};
+  Result r = verifier.SetTolerances(tolerances);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Vulkan::Tolerance needs 1 or 4 values", r.Error());
+}
+
+TEST_F(PixelVerifierTest, Float) {
+  std::vector<float> frame(3 * 2 * 4, 0.0f);
+  for (size_t i = 0; i < frame.size(); i += 4) {
+    frame[i] = 1.0f;
+    frame[i + 3] = 1.0f;
+  }
+  frame[5 * 4 + 2] = 0.25f;
+
+  PixelVerifier verifier;
+  PixelVerifier::Mismatches mismatches;
+  Result r = verifier.Verify(rgba32f_,
+                             reinterpret_cast<const uint8_t*>(frame.data()),
+                             3 * 16, 3, 2, kRed, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(1U, mismatches.count);
+  EXPECT_EQ(2U, mismatches.first_x);
+  EXPECT_EQ(1U, mismatches.first_y);
+  EXPECT_DOUBLE_EQ(0.25, mismatches.first_rgba[2]);
+}
+
+TEST_F(PixelVerifierTest, UnpacksOtherFormats) {
+  // Half of the range of R16G16B16A16_UNORM red, the rest 0 and alpha 1.
+  std::vector<uint16_t> frame(5 * 3 * 4, 0);
+  for (size_t i = 0; i < frame.size(); i += 4) {
+    frame[i] = 32768;
+    frame[i + 3] = 65535;
+  }
+  frame[7 * 4 + 1] = 1000;
+
+  const float half_red[4] = {0.5f, 0.0f, 0.0f, 1.0f};
+  PixelVerifier verifier;
+  PixelVerifier::Mismatches mismatches;
+  Result r = verifier.Verify(MakeUnpacker("R16G16B16A16_UNORM"),
+                             reinterpret_cast<const uint8_t*>(frame.data()),
+                             5 * 8, 5, 3, half_red, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(1U, mismatches.count);
+  EXPECT_EQ(2U, mismatches.first_x);
+  EXPECT_EQ(1U, mismatches.first_y);
+  EXPECT_DOUBLE_EQ(static_cast<double>(1000.0f / 65535.0f),
+                   mismatches.first_rgba[1]);
+}
+
+TEST_F(PixelVerifierTest, SplitsLargeFramesAcrossThreads) {
+  const uint32_t size = 1024;
+  const uint8_t red[4] = {255, 0, 0, 255};
+  auto frame = MakeFrame(size, size, red);
+  frame[(700 * size + 5) * 4] = 0;
+  frame[(900 * size + 9) * 4] = 0;
+  frame[(200 * size + 1000) * 4] = 0;
+
+  PixelVerifier verifier;
+  verifier.SetMaxThreads(4);
+  PixelVerifier::Mismatches mismatches;
+  Result r = verifier.Verify(rgba8_, frame.data(), size * 4,
+                             size, size, kRed, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(3U, mismatches.count);
+  EXPECT_EQ(1000U, mismatches.first_x);
+  EXPECT_EQ(200U, mismatches.first_y);
+
+  verifier.SetEarlyExit(true);
+  r = verifier.Verify(rgba8_, frame.data(), size * 4, size,
+                      size, kRed, true, &mismatches);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(1U, mismatches.count);
+  EXPECT_EQ(1000U, mismatches.first_x);
+  EXPECT_EQ(200U, mismatches.first_y);
+}
+
+}  // namespace vulkan
+}  // namespace amber
@@ -22,35 +22,13 @@
 namespace amber {
 namespace vulkan {
 
-Resource::Resource(VkDevice device,
-                   size_t size,
-                   const VkPhysicalDeviceMemoryProperties& properties)
-    : device_(device), size_(size), physical_memory_properties_(properties) {}
+Resource::Resource(VkDevice device, size_t size, MemoryAllocator* allocator)
+    : device_(device), size_(size), allocator_(allocator) {}
 
 Resource::~Resource() = default;
 
 void Resource::Shutdown() {
-  UnMapMemory(host_accessible_memory_);
-  vkDestroyBuffer(device_, host_accessible_buffer_, nullptr);
-  vkFreeMemory(device_, host_accessible_memory_, nullptr);
-}
-
-Result Resource::Initialize() {
-  Result r = CreateVkBuffer(
-      &host_accessible_buffer_,
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
-  if (!r.IsSuccess())
-    return r;
-
-  AllocateResult allocate_result = AllocateAndBindMemoryToVkBuffer(
-      host_accessible_buffer_, &host_accessible_memory_,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-      true);
-  if (!allocate_result.r.IsSuccess())
-    return allocate_result.r;
-
-  return MapMemory(host_accessible_memory_);
+  memory_ptr_ = nullptr;
 }
 
 Result Resource::CreateVkBuffer(VkBuffer* buffer, VkBufferUsageFlags usage) {
@@ -84,7 +62,8 @@ uint32_t Resource::ChooseMemory(uint32_t memory_type_bits,
       if (first_non_zero == std::numeric_limits<uint32_t>::max())
         first_non_zero = memory_type_index;
 
-      if ((physical_memory_properties_.memoryTypes[memory_type_index]
+      if ((allocator_->GetMemoryProperties()
+               .memoryTypes[memory_type_index]
                .propertyFlags &
            flags) == flags) {
         return memory_type_index;
@@ -117,14 +96,14 @@ const VkMemoryRequirements Resource::GetVkImageMemoryRequirements(
 
 Resource::AllocateResult Resource::AllocateAndBindMemoryToVkBuffer(
     VkBuffer buffer,
-    VkDeviceMemory* memory,
+    MemoryAllocator::Allocation* allocation,
     VkMemoryPropertyFlags flags,
     bool force_flags) {
   if (buffer == VK_NULL_HANDLE)
     return {Result("Vulkan::Given VkBuffer is VK_NULL_HANDLE"), 0};
 
-  if (memory == nullptr)
-    return {Result("Vulkan::Given VkDeviceMemory pointer is nullptr"), 0};
+  if (allocation == nullptr)
+    return {Result("Vulkan::Given Allocation pointer is nullptr"), 0};
 
   auto requirement = GetVkBufferMemoryRequirements(buffer);
 
@@ -133,28 +112,19 @@ Resource::AllocateResult Resource::AllocateAndBindMemoryToVkBuffer(
   if (memory_type_index == std::numeric_limits<uint32_t>::max())
     return {Result("Vulkan::Find Proper Memory Fail"), 0};
 
-  Result r = AllocateMemory(memory, requirement.size, memory_type_index);
+  Result r = allocator_->Allocate(requirement, memory_type_index, true,
+                                  allocation);
   if (!r.IsSuccess())
     return {r, 0};
 
-  return {BindMemoryToVkBuffer(buffer, *memory), memory_type_index};
-}
-
-Result Resource::AllocateMemory(VkDeviceMemory* memory,
-                                VkDeviceSize size,
-                                uint32_t memory_type_index) {
-  VkMemoryAllocateInfo alloc_info = {};
-  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  alloc_info.allocationSize = size;
-  alloc_info.memoryTypeIndex = memory_type_index;
-  if (vkAllocateMemory(device_, &alloc_info, nullptr, memory) != VK_SUCCESS)
-    return Result("Vulkan::Calling vkAllocateMemory Fail");
-
-  return {};
+  return {BindMemoryToVkBuffer(buffer, *allocation), memory_type_index};
 }
 
-Result Resource::BindMemoryToVkBuffer(VkBuffer buffer, VkDeviceMemory memory) {
-  if (vkBindBufferMemory(device_, buffer, memory, 0) != VK_SUCCESS)
+Result Resource::BindMemoryToVkBuffer(
+    VkBuffer buffer,
+    const MemoryAllocator::Allocation& allocation) {
+  if (vkBindBufferMemory(device_, buffer, allocation.memory,
+                         allocation.offset) != VK_SUCCESS)
     return Result("Vulkan::Calling vkBindBufferMemory Fail");
 
   return {};
@@ -162,14 +132,14 @@ Result Resource::BindMemoryToVkBuffer(VkBuffer buffer, VkDeviceMemory memory) {
 
 Resource::AllocateResult Resource::AllocateAndBindMemoryToVkImage(
     VkImage image,
-    VkDeviceMemory* memory,
+    MemoryAllocator::Allocation* allocation,
     VkMemoryPropertyFlags flags,
     bool force_flags) {
   if (image == nullptr)
     return {Result("Vulkan::Given VkImage pointer is nullptr"), 0};
 
-  if (memory == nullptr)
-    return {Result("Vulkan::Given VkDeviceMemory pointer is nullptr"), 0};
+  if (allocation == nullptr)
+    return {Result("Vulkan::Given Allocation pointer is nullptr"), 0};
 
   auto requirement = GetVkImageMemoryRequirements(image);
 
@@ -178,32 +148,32 @@ Resource::AllocateResult Resource::AllocateAndBindMemoryToVkImage(
   if (memory_type_index == std::numeric_limits<uint32_t>::max())
     return {Result("Vulkan::Find Proper Memory Fail"), 0};
 
-  Result r = AllocateMemory(memory, requirement.size, memory_type_index);
+  // Images are optimally tiled, see MemoryAllocator::Allocate().
+  Result r = allocator_->Allocate(requirement, memory_type_index, false,
+                                  allocation);
   if (!r.IsSuccess())
     return {r, 0};
 
-  return {BindMemoryToVkImage(image, *memory), memory_type_index};
+  return {BindMemoryToVkImage(image, *allocation), memory_type_index};
 }
 
-Result Resource::BindMemoryToVkImage(VkImage image, VkDeviceMemory memory) {
-  if (vkBindImageMemory(device_, image, memory, 0) != VK_SUCCESS)
+Result Resource::BindMemoryToVkImage(
+    VkImage image,
+    const MemoryAllocator::Allocation& allocation) {
+  if (vkBindImageMemory(device_, image, allocation.memory,
+                        allocation.offset) != VK_SUCCESS)
     return Result("Vulkan::Calling vkBindImageMemory Fail");
 
   return {};
 }
 
-Result Resource::MapMemory(VkDeviceMemory memory) {
-  if (vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, &memory_ptr_) !=
-      VK_SUCCESS) {
-    return Result("Vulkan::Calling vkMapMemory Fail");
-  }
+Result Resource::MapMemory(const MemoryAllocator::Allocation& allocation) {
+  if (allocation.mapped == nullptr)
+    return Result("Vulkan::Memory is not host visible");
 
+  memory_ptr_ = allocation.mapped;
   return {};
 }
 
-void Resource::UnMapMemory(VkDeviceMemory memory) {
-  vkUnmapMemory(device_, memory);
-}
-
 }  // namespace vulkan
 }  // namespace amber
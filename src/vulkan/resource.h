@@ -18,6 +18,7 @@
 #include <memory>
 
 #include "amber/result.h"
+#include "src/vulkan/memory_allocator.h"
 #include "vulkan/vulkan.h"
 
 namespace amber {
@@ -27,71 +28,69 @@ class Resource {
  public:
   virtual ~Resource();
 
-  virtual VkDeviceMemory GetHostAccessMemory() const {
-    return host_accessible_memory_;
-  }
-
   virtual void Shutdown();
 
   void* HostAccessibleMemoryPtr() const { return memory_ptr_; }
 
  protected:
-  Resource(VkDevice device,
-           size_t size,
-           const VkPhysicalDeviceMemoryProperties& properties);
-  Result Initialize();
+  Resource(VkDevice device, size_t size, MemoryAllocator* allocator);
   Result CreateVkBuffer(VkBuffer* buffer, VkBufferUsageFlags usage);
 
   VkDevice GetDevice() const { return device_; }
-  VkBuffer GetHostAccessibleBuffer() const { return host_accessible_buffer_; }
 
   size_t GetSize() const { return size_; }
+  MemoryAllocator* GetAllocator() const { return allocator_; }
 
   struct AllocateResult {
     Result r;
     uint32_t memory_type_index;
   };
 
-  AllocateResult AllocateAndBindMemoryToVkBuffer(VkBuffer buffer,
-                                                 VkDeviceMemory* memory,
-                                                 VkMemoryPropertyFlags flags,
-                                                 bool force_flags);
-  AllocateResult AllocateAndBindMemoryToVkImage(VkImage image,
-                                                VkDeviceMemory* memory,
-                                                VkMemoryPropertyFlags flags,
-                                                bool force_flags);
+  AllocateResult AllocateAndBindMemoryToVkBuffer(
+      VkBuffer buffer,
+      MemoryAllocator::Allocation* allocation,
+      VkMemoryPropertyFlags flags,
+      bool force_flags);
+  AllocateResult AllocateAndBindMemoryToVkImage(
+      VkImage image,
+      MemoryAllocator::Allocation* allocation,
+      VkMemoryPropertyFlags flags,
+      bool force_flags);
+  void FreeMemory(MemoryAllocator::Allocation* allocation) {
+    allocator_->Free(allocation);
+  }
 
   bool CheckMemoryHostAccessible(uint32_t memory_type_index) {
-    return (physical_memory_properties_.memoryTypes[memory_type_index]
+    return (allocator_->GetMemoryProperties()
+                .memoryTypes[memory_type_index]
                 .propertyFlags &
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ==
            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
   }
 
-  Result MapMemory(VkDeviceMemory memory);
-  void UnMapMemory(VkDeviceMemory memory);
+  // Host visible memory stays mapped by the allocator, this only makes
+  // |allocation| the memory HostAccessibleMemoryPtr() points to.
+  Result MapMemory(const MemoryAllocator::Allocation& allocation);
+  // Makes HostAccessibleMemoryPtr() point to |ptr|, which is staging memory
+  // for resources without host visible memory.
+  void SetHostAccessibleMemoryPtr(void* ptr) { memory_ptr_ = ptr; }
 
  private:
   uint32_t ChooseMemory(uint32_t memory_type_bits,
                         VkMemoryPropertyFlags flags,
                         bool force_flags);
-  Result AllocateMemory(VkDeviceMemory* memory,
-                        VkDeviceSize size,
-                        uint32_t memory_type_index);
-
-  Result BindMemoryToVkBuffer(VkBuffer buffer, VkDeviceMemory memory);
+  Result BindMemoryToVkBuffer(VkBuffer buffer,
+                              const MemoryAllocator::Allocation& allocation);
   const VkMemoryRequirements GetVkBufferMemoryRequirements(
       VkBuffer buffer) const;
 
-  Result BindMemoryToVkImage(VkImage image, VkDeviceMemory memory);
+  Result BindMemoryToVkImage(VkImage image,
+                             const MemoryAllocator::Allocation& allocation);
   const VkMemoryRequirements GetVkImageMemoryRequirements(VkImage image) const;
 
   VkDevice device_ = VK_NULL_HANDLE;
   size_t size_ = 0;
-  VkPhysicalDeviceMemoryProperties physical_memory_properties_;
-
-  VkBuffer host_accessible_buffer_ = VK_NULL_HANDLE;
-  VkDeviceMemory host_accessible_memory_ = VK_NULL_HANDLE;
+  MemoryAllocator* allocator_ = nullptr;
   void* memory_ptr_ = nullptr;
 };
 
@@ -0,0 +1,144 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/shader_module_library.h"
+
+#include <iterator>
+#include <utility>
+
+#include "src/hash.h"
+
+namespace amber {
+
+namespace vulkan {
+
+// static
+ShaderModuleLibrary& ShaderModuleLibrary::Get() {
+  static ShaderModuleLibrary* library = new ShaderModuleLibrary();
+  return *library;
+}
+
+ShaderModuleLibrary::ShaderModuleLibrary() = default;
+
+ShaderModuleLibrary::~ShaderModuleLibrary() = default;
+
+Result ShaderModuleLibrary::Acquire(VkDevice device,
+                                    const std::vector<uint32_t>& spirv,
+                                    const std::string& entry_point,
+                                    VkShaderModule* module) {
+  const Key key(HashWords(spirv), spirv.size(), entry_point);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  DeviceModules& modules = devices_[device];
+  std::vector<Module>& candidates = modules.modules[key];
+  for (auto& candidate : candidates) {
+    if (candidate.spirv == spirv) {
+      ++modules.stats.hits;
+      ++candidate.references;
+      *module = candidate.module;
+      return {};
+    }
+  }
+
+  VkShaderModuleCreateInfo info = {};
+  info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  info.codeSize = spirv.size() * sizeof(uint32_t);
+  info.pCode = spirv.data();
+
+  Module entry;
+  if (vkCreateShaderModule(device, &info, nullptr, &entry.module) !=
+      VK_SUCCESS) {
+    if (candidates.empty())
+      modules.modules.erase(key);
+    return Result("Vulkan::Calling vkCreateShaderModule Fail");
+  }
+  ++modules.stats.misses;
+
+  entry.spirv = spirv;
+  entry.references = 1;
+  *module = entry.module;
+  candidates.push_back(std::move(entry));
+  return {};
+}
+
+void ShaderModuleLibrary::Release(VkDevice device, VkShaderModule module) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto device_it = devices_.find(device);
+  if (device_it == devices_.end())
+    return;
+
+  for (auto& it : device_it->second.modules) {
+    for (auto& entry : it.second) {
+      if (entry.module == module && entry.references > 0) {
+        --entry.references;
+        return;
+      }
+    }
+  }
+}
+
+void ShaderModuleLibrary::ReleaseUnused(VkDevice device) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto device_it = devices_.find(device);
+  if (device_it == devices_.end())
+    return;
+
+  auto& modules = device_it->second.modules;
+  for (auto it = modules.begin(); it != modules.end();) {
+    auto& entries = it->second;
+    for (auto entry = entries.begin(); entry != entries.end();) {
+      if (entry->references == 0) {
+        vkDestroyShaderModule(device, entry->module, nullptr);
+        entry = entries.erase(entry);
+      } else {
+        ++entry;
+      }
+    }
+    it = entries.empty() ? modules.erase(it) : std::next(it);
+  }
+
+  if (modules.empty())
+    devices_.erase(device_it);
+}
+
+void ShaderModuleLibrary::ReleaseDevice(VkDevice device) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto device_it = devices_.find(device);
+  if (device_it == devices_.end())
+    return;
+
+  for (auto& it : device_it->second.modules) {
+    for (auto& entry : it.second)
+      vkDestroyShaderModule(device, entry.module, nullptr);
+  }
+
+  devices_.erase(device_it);
+}
+
+ShaderModuleCacheStats ShaderModuleLibrary::GetStats(VkDevice device) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto device_it = devices_.find(device);
+  if (device_it == devices_.end())
+    return {};
+
+  ShaderModuleCacheStats stats = device_it->second.stats;
+  stats.modules = 0;
+  for (const auto& it : device_it->second.modules)
+    stats.modules += it.second.size();
+  return stats;
+}
+
+}  // namespace vulkan
+
+}  // namespace amber
@@ -0,0 +1,90 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_VULKAN_SHADER_MODULE_LIBRARY_H_
+#define SRC_VULKAN_SHADER_MODULE_LIBRARY_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "amber/result.h"
+#include "vulkan/vulkan.h"
+
+namespace amber {
+
+namespace vulkan {
+
+// Reference counted shader modules shared by every engine in the process
+// which uses the same VkDevice. Modules are keyed by a hash of their SPIR-V and
+// the entry point the pipeline uses, and the SPIR-V words are compared on a
+// hit, so identical shaders attached to several pipelines share one module.
+// Modules whose last reference is released are kept until the device is
+// released or ReleaseUnused() is called, so later pipelines on the device skip
+// vkCreateShaderModule. Thread safe.
+class ShaderModuleLibrary {
+ public:
+  static ShaderModuleLibrary& Get();
+
+  // Takes a reference on the module for |spirv| and |entry_point| on
+  // |device|, creating the module if there is none yet.
+  Result Acquire(VkDevice device,
+                 const std::vector<uint32_t>& spirv,
+                 const std::string& entry_point,
+                 VkShaderModule* module);
+
+  // Drops a reference taken by Acquire().
+  void Release(VkDevice device, VkShaderModule module);
+
+  // Destroys the modules on |device| which no longer have any references.
+  void ReleaseUnused(VkDevice device);
+
+  // Destroys every module created on |device|. Must be called before the
+  // device is destroyed.
+  void ReleaseDevice(VkDevice device);
+
+  // Returns the hit and miss counts and module count for |device|.
+  ShaderModuleCacheStats GetStats(VkDevice device);
+
+ private:
+  // The hash and word count of the SPIR-V, and the entry point.
+  using Key = std::tuple<uint64_t, size_t, std::string>;
+
+  struct Module {
+    std::vector<uint32_t> spirv;
+    VkShaderModule module = VK_NULL_HANDLE;
+    uint32_t references = 0;
+  };
+
+  struct DeviceModules {
+    // Modules whose SPIR-V hashes to the same key are kept side by side.
+    std::map<Key, std::vector<Module>> modules;
+    ShaderModuleCacheStats stats;
+  };
+
+  ShaderModuleLibrary();
+  ~ShaderModuleLibrary();
+
+  std::mutex mutex_;
+  std::map<VkDevice, DeviceModules> devices_;
+};
+
+}  // namespace vulkan
+
+}  // namespace amber
+
+#endif  // SRC_VULKAN_SHADER_MODULE_LIBRARY_H_
@@ -0,0 +1,222 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/small_float.h"
+
+#include <cstring>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+const uint32_t kSignMask = 0x80000000U;
+const uint32_t kFloatInfinity = 0xffU << 23U;
+
+// The smallest float which is infinity in all the small formats, 2^16.
+const uint32_t kFloatOverflow = (127U + 16U) << 23U;
+
+// The smallest float which is a normal number in the small formats, 2^-14.
+const uint32_t kFloatMinNormal = (127U - 14U) << 23U;
+
+// The conversion works on the bits of the float, see
+// https://gist.github.com/rygorous/2156668 for the same for halfs.
+//
+// Denormal results: adding 2^(-14 - mantissa bits) * 2^23 to the value puts
+// the denormal mantissa in the low bits of the float. The addition rounds
+// to nearest even, and the result can carry into the lowest normal.
+//
+// Normal results: rebias the exponent from 127 to 15, and add just under
+// half of the dropped mantissa, plus one when the kept mantissa is odd, so
+// that the shift rounds to nearest even. Carries move into the exponent and
+// up to infinity.
+template <uint32_t kMantissaBits>
+struct SmallFloat {
+  static const uint32_t kShift = 23U - kMantissaBits;
+  static const uint32_t kInfinity = 0x1fU << kMantissaBits;
+  static const uint32_t kQuietBit = 1U << (kMantissaBits - 1U);
+  static const uint32_t kDenormalMagic =
+      ((127U - 15U) + kShift + 1U) << 23U;
+  static const uint32_t kRebias = (15U - 127U) << 23U;
+  static const uint32_t kRoundingBias = (1U << (kShift - 1U)) - 1U;
+};
+
+template <uint32_t kMantissaBits, bool kSigned>
+uint16_t ToSmallFloat(float value) {
+  using Format = SmallFloat<kMantissaBits>;
+
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint32_t sign = bits & kSignMask;
+  uint32_t abs = bits ^ sign;
+
+  uint32_t result;
+  if (abs >= kFloatOverflow) {
+    // Quiet NaNs and keep the top of their payload.
+    result = abs > kFloatInfinity ? Format::kInfinity | Format::kQuietBit |
+                                        ((abs & 0x7fffffU) >> Format::kShift)
+                                  : Format::kInfinity;
+    if (!kSigned && abs <= kFloatInfinity && sign)
+      return 0;
+  } else if (!kSigned && sign) {
+    return 0;
+  } else if (abs < kFloatMinNormal) {
+    float magic;
+    const uint32_t magic_bits = Format::kDenormalMagic;
+    memcpy(&magic, &magic_bits, sizeof(magic));
+
+    float sum;
+    memcpy(&sum, &abs, sizeof(sum));
+    sum += magic;
+    memcpy(&abs, &sum, sizeof(abs));
+    result = abs - Format::kDenormalMagic;
+  } else {
+    const uint32_t odd = (abs >> Format::kShift) & 1U;
+    result = (abs + Format::kRebias + Format::kRoundingBias + odd) >>
+             Format::kShift;
+  }
+
+  if (kSigned)
+    result |= sign >> 16U;
+  return static_cast<uint16_t>(result);
+}
+
+#if defined(__SSE2__)
+// The same as ToSmallFloat, for four floats in the 32 bit lanes of a
+// register.
+template <uint32_t kMantissaBits, bool kSigned>
+__m128i ToSmallFloat4(__m128 values) {
+  using Format = SmallFloat<kMantissaBits>;
+  const __m128i bits = _mm_castps_si128(values);
+  const __m128i sign = _mm_and_si128(bits, _mm_set1_epi32(INT32_MIN));
+  const __m128i abs = _mm_xor_si128(bits, sign);
+
+  // |abs| has no sign bit, so the signed compares work.
+  const __m128i is_nan =
+      _mm_cmpgt_epi32(abs, _mm_set1_epi32(static_cast<int>(kFloatInfinity)));
+  const __m128i is_large = _mm_cmpgt_epi32(
+      abs, _mm_set1_epi32(static_cast<int>(kFloatOverflow - 1U)));
+  const __m128i is_denormal = _mm_cmplt_epi32(
+      abs, _mm_set1_epi32(static_cast<int>(kFloatMinNormal)));
+
+  const __m128i nan = _mm_or_si128(
+      _mm_set1_epi32(static_cast<int>(Format::kInfinity | Format::kQuietBit)),
+      _mm_srli_epi32(_mm_and_si128(abs, _mm_set1_epi32(0x7fffff)),
+                     Format::kShift));
+  const __m128i large =
+      _mm_or_si128(_mm_and_si128(is_nan, nan),
+                   _mm_andnot_si128(
+                       is_nan, _mm_set1_epi32(
+                                   static_cast<int>(Format::kInfinity))));
+
+  const __m128i magic =
+      _mm_set1_epi32(static_cast<int>(Format::kDenormalMagic));
+  const __m128i denormal = _mm_sub_epi32(
+      _mm_castps_si128(
+          _mm_add_ps(_mm_castsi128_ps(abs), _mm_castsi128_ps(magic))),
+      magic);
+
+  const __m128i odd = _mm_and_si128(_mm_srli_epi32(abs, Format::kShift),
+                                    _mm_set1_epi32(1));
+  const __m128i normal = _mm_srli_epi32(
+      _mm_add_epi32(_mm_add_epi32(abs, odd),
+                    _mm_set1_epi32(static_cast<int>(Format::kRebias +
+                                                    Format::kRoundingBias))),
+      Format::kShift);
+
+  __m128i result =
+      _mm_or_si128(_mm_and_si128(is_denormal, denormal),
+                   _mm_andnot_si128(is_denormal, normal));
+  result = _mm_or_si128(_mm_and_si128(is_large, large),
+                        _mm_andnot_si128(is_large, result));
+
+  if (kSigned)
+    return _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+
+  // Negative values other than NaN become zero.
+  const __m128i negative_number = _mm_andnot_si128(is_nan, _mm_srai_epi32(
+                                                               sign, 31));
+  return _mm_andnot_si128(negative_number, result);
+}
+
+// Narrows the 32 bit lanes of |low| and |high|, which all fit in 16 bits, to
+// the 16 bit lanes of the result.
+__m128i Narrow(__m128i low, __m128i high) {
+  // Sign extend the low 16 bits so the saturating pack keeps them as is.
+  low = _mm_srai_epi32(_mm_slli_epi32(low, 16), 16);
+  high = _mm_srai_epi32(_mm_slli_epi32(high, 16), 16);
+  return _mm_packs_epi32(low, high);
+}
+#endif  // defined(__SSE2__)
+
+template <uint32_t kMantissaBits, bool kSigned>
+void ToSmallFloats(const float* src, size_t count, uint16_t* dst) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 8 <= count; i += 8) {
+    const __m128i low =
+        ToSmallFloat4<kMantissaBits, kSigned>(_mm_loadu_ps(src + i));
+    const __m128i high =
+        ToSmallFloat4<kMantissaBits, kSigned>(_mm_loadu_ps(src + i + 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), Narrow(low, high));
+  }
+#endif  // defined(__SSE2__)
+
+  for (; i < count; ++i)
+    dst[i] = ToSmallFloat<kMantissaBits, kSigned>(src[i]);
+}
+
+}  // namespace
+
+uint16_t FloatToHalf(float value) {
+  return ToSmallFloat<10, true>(value);
+}
+
+uint16_t FloatToUFloat11(float value) {
+  return ToSmallFloat<6, false>(value);
+}
+
+uint16_t FloatToUFloat10(float value) {
+  return ToSmallFloat<5, false>(value);
+}
+
+void FloatsToHalfs(const float* src, size_t count, uint16_t* dst) {
+#if defined(__F16C__)
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i halfs = _mm256_cvtps_ph(_mm256_loadu_ps(src + i),
+                                          _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), halfs);
+  }
+  ToSmallFloats<10, true>(src + i, count - i, dst + i);
+#else
+  ToSmallFloats<10, true>(src, count, dst);
+#endif
+}
+
+void FloatsToUFloat11s(const float* src, size_t count, uint16_t* dst) {
+  ToSmallFloats<6, false>(src, count, dst);
+}
+
+void FloatsToUFloat10s(const float* src, size_t count, uint16_t* dst) {
+  ToSmallFloats<5, false>(src, count, dst);
+}
+
+}  // namespace vulkan
+}  // namespace amber
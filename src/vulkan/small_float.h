@@ -0,0 +1,46 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_VULKAN_SMALL_FLOAT_H_
+#define SRC_VULKAN_SMALL_FLOAT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace amber {
+namespace vulkan {
+
+// Conversions from float to the small float formats of Vulkan: half (16
+// bits, signed) and the unsigned 11 and 10 bit floats of B10G11R11. All have
+// a 5 bit exponent with a bias of 15 and 10, 6 or 5 mantissa bits.
+//
+// Values are rounded to the nearest representable value, ties to even.
+// Values too small for a normal number become denormals or zero and values
+// too large become infinity. NaN stays NaN. The unsigned formats turn
+// negative values, including negative infinity, into zero.
+uint16_t FloatToHalf(float value);
+uint16_t FloatToUFloat11(float value);
+uint16_t FloatToUFloat10(float value);
+
+// Convert |count| floats from |src| to |dst|. These use SIMD instructions
+// where available, F16C for halfs, and give the same results as the single
+// value conversions above.
+void FloatsToHalfs(const float* src, size_t count, uint16_t* dst);
+void FloatsToUFloat11s(const float* src, size_t count, uint16_t* dst);
+void FloatsToUFloat10s(const float* src, size_t count, uint16_t* dst);
+
+}  // namespace vulkan
+}  // namespace amber
+
+#endif  // SRC_VULKAN_SMALL_FLOAT_H_
@@ -0,0 +1,231 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/small_float.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+using BulkFn = void (*)(const float*, size_t, uint16_t*);
+using SingleFn = uint16_t (*)(float);
+
+float FromBits(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// The exact value of the small float |code| with |mantissa_bits|. The code
+// after the largest finite one stands for 2^16, the next power of two, so
+// values are rounded to infinity where the range would end.
+double Decode(uint32_t code, uint32_t mantissa_bits) {
+  const uint32_t exponent = code >> mantissa_bits;
+  const uint32_t mantissa = code & ((1U << mantissa_bits) - 1U);
+  if (exponent == 0)
+    return std::ldexp(mantissa, -14 - static_cast<int>(mantissa_bits));
+  return std::ldexp((1U << mantissa_bits) + mantissa,
+                    static_cast<int>(exponent) - 15 -
+                        static_cast<int>(mantissa_bits));
+}
+
+// The |i|th float bit pattern of the chunk at |start|, clamped to the
+// largest positive NaN so the last chunk stays in range.
+uint32_t Bits(uint64_t start, uint32_t i, uint32_t step) {
+  const uint64_t bits = start + static_cast<uint64_t>(i) * step;
+  return bits < 0x7fffffffULL ? static_cast<uint32_t>(bits) : 0x7fffffffU;
+}
+
+bool IsNaN(uint16_t code, uint32_t mantissa_bits) {
+  const uint32_t infinity = 0x1fU << mantissa_bits;
+  return (code & infinity) == infinity && (code & (infinity - 1U)) != 0;
+}
+
+// Converts every |step|th float with |bulk| and checks the results against
+// rounding to nearest even worked out from the small float values
+// themselves. The positive floats are walked in increasing order, so the
+// expected code only moves up, past the midpoints between codes.
+void CheckFloats(BulkFn bulk,
+                 SingleFn single,
+                 uint32_t mantissa_bits,
+                 bool is_signed,
+                 uint32_t step) {
+  const uint32_t kChunk = 1U << 16;
+  const uint32_t infinity = 0x1fU << mantissa_bits;
+
+  std::vector<float> src(kChunk * 2);
+  std::vector<uint16_t> dst(kChunk * 2);
+  std::vector<uint16_t> expected(kChunk);
+
+  uint32_t code = 0;
+  double midpoint = (Decode(0, mantissa_bits) + Decode(1, mantissa_bits)) / 2;
+  uint64_t failures = 0;
+  for (uint64_t start = 0; start < (1ULL << 31);
+       start += static_cast<uint64_t>(kChunk) * step) {
+    for (uint32_t i = 0; i < kChunk; ++i) {
+      const uint32_t bits = Bits(start, i, step);
+      src[i] = FromBits(bits);
+      src[kChunk + i] = FromBits(bits | 0x80000000U);
+
+      const double value = static_cast<double>(src[i]);
+      while (code < infinity &&
+             (value > midpoint || (value == midpoint && (code & 1U)))) {
+        ++code;
+        midpoint = (Decode(code, mantissa_bits) +
+                    Decode(code + 1, mantissa_bits)) /
+                   2;
+      }
+      expected[i] = static_cast<uint16_t>(code);
+    }
+
+    bulk(src.data(), src.size(), dst.data());
+    for (uint32_t i = 0; i < kChunk && failures < 10; ++i) {
+      const uint32_t bits = Bits(start, i, step);
+      const uint16_t positive = dst[i];
+      const uint16_t negative = dst[kChunk + i];
+
+      if (std::isnan(src[i])) {
+        if (!IsNaN(positive, mantissa_bits) ||
+            !IsNaN(static_cast<uint16_t>(negative & 0x7fff), mantissa_bits)) {
+          ADD_FAILURE() << "NaN 0x" << std::hex << bits;
+          ++failures;
+        }
+      } else {
+        const uint16_t expected_negative =
+            is_signed ? static_cast<uint16_t>(expected[i] | 0x8000) : 0;
+        if (positive != expected[i] || negative != expected_negative) {
+          ADD_FAILURE() << "float 0x" << std::hex << bits << " gave 0x"
+                        << positive << " and 0x" << negative
+                        << ", expected 0x" << expected[i] << " and 0x"
+                        << expected_negative;
+          ++failures;
+        }
+      }
+
+      // The single value conversion agrees with the bulk one, NaN payloads
+      // included.
+      if (single(src[i]) != positive ||
+          single(src[kChunk + i]) != negative) {
+        ADD_FAILURE() << "bulk and single value differ for 0x" << std::hex
+                      << bits;
+        ++failures;
+      }
+    }
+    if (failures >= 10)
+      break;
+  }
+}
+
+}  // namespace
+
+using SmallFloatTest = testing::Test;
+
+TEST_F(SmallFloatTest, Half) {
+  EXPECT_EQ(0x3c00, FloatToHalf(1.0f));
+  EXPECT_EQ(0xc000, FloatToHalf(-2.0f));
+  EXPECT_EQ(0x8000, FloatToHalf(-0.0f));
+  EXPECT_EQ(0x7bff, FloatToHalf(65504.0f));
+  // Halfway between 65504 and 65536 rounds to even, which is infinity.
+  EXPECT_EQ(0x7bff, FloatToHalf(65519.0f));
+  EXPECT_EQ(0x7c00, FloatToHalf(65520.0f));
+  EXPECT_EQ(0xfc00, FloatToHalf(-1e10f));
+  EXPECT_EQ(0x7c00, FloatToHalf(std::numeric_limits<float>::infinity()));
+  EXPECT_TRUE(IsNaN(FloatToHalf(std::nanf("")), 10));
+
+  // 1 + 2^-11 is halfway between 1 and the next half, and rounds to even.
+  EXPECT_EQ(0x3c00, FloatToHalf(1.00048828125f));
+  // 1 + 3 * 2^-11 rounds up to the even 1 + 2^-9.
+  EXPECT_EQ(0x3c02, FloatToHalf(1.00146484375f));
+  // 12.34 rounds up, where truncating the mantissa would give 0x4a2b.
+  EXPECT_EQ(0x4a2c, FloatToHalf(12.34f));
+}
+
+TEST_F(SmallFloatTest, HalfDenormals) {
+  EXPECT_EQ(0x0001, FloatToHalf(std::ldexp(1.0f, -24)));
+  EXPECT_EQ(0x0000, FloatToHalf(std::ldexp(1.0f, -25)));
+  EXPECT_EQ(0x0002, FloatToHalf(std::ldexp(3.0f, -25)));
+  EXPECT_EQ(0x03ff, FloatToHalf(std::ldexp(1023.0f, -24)));
+  // Rounds up into the smallest normal.
+  EXPECT_EQ(0x0400, FloatToHalf(std::ldexp(2047.0f, -25)));
+  EXPECT_EQ(0x8001, FloatToHalf(-std::ldexp(1.0f, -24)));
+  EXPECT_EQ(0x0000, FloatToHalf(std::numeric_limits<float>::denorm_min()));
+}
+
+TEST_F(SmallFloatTest, UFloat11AndUFloat10) {
+  EXPECT_EQ(0x3c0, FloatToUFloat11(1.0f));
+  EXPECT_EQ(0x1e0, FloatToUFloat10(1.0f));
+  EXPECT_EQ(0x7bf, FloatToUFloat11(65024.0f));
+  EXPECT_EQ(0x7c0, FloatToUFloat11(65536.0f));
+  EXPECT_EQ(0x3df, FloatToUFloat10(64512.0f));
+  EXPECT_EQ(0x001, FloatToUFloat11(std::ldexp(1.0f, -20)));
+  EXPECT_EQ(0x001, FloatToUFloat10(std::ldexp(1.0f, -19)));
+
+  // Negative values, including negative infinity, are zero.
+  EXPECT_EQ(0, FloatToUFloat11(-1.0f));
+  EXPECT_EQ(0, FloatToUFloat10(-std::numeric_limits<float>::infinity()));
+  EXPECT_TRUE(IsNaN(FloatToUFloat11(-std::nanf("")), 6));
+  EXPECT_TRUE(IsNaN(FloatToUFloat10(std::nanf("")), 5));
+}
+
+TEST_F(SmallFloatTest, BulkMatchesSingleValues) {
+  std::vector<float> src;
+  for (int i = -40; i < 40; ++i)
+    src.push_back(std::ldexp(1.37f, i) * (i % 2 ? -1.0f : 1.0f));
+  src.push_back(std::numeric_limits<float>::infinity());
+  src.push_back(std::nanf(""));
+
+  std::vector<uint16_t> dst(src.size());
+  FloatsToHalfs(src.data(), src.size(), dst.data());
+  for (size_t i = 0; i < src.size(); ++i)
+    EXPECT_EQ(FloatToHalf(src[i]), dst[i]) << src[i];
+
+  FloatsToUFloat11s(src.data(), src.size(), dst.data());
+  for (size_t i = 0; i < src.size(); ++i)
+    EXPECT_EQ(FloatToUFloat11(src[i]), dst[i]) << src[i];
+
+  FloatsToUFloat10s(src.data(), src.size(), dst.data());
+  for (size_t i = 0; i < src.size(); ++i)
+    EXPECT_EQ(FloatToUFloat10(src[i]), dst[i]) << src[i];
+}
+
+// Every 251st float, which hits all exponents and both roundings.
+TEST_F(SmallFloatTest, SampledFloats) {
+  CheckFloats(FloatsToHalfs, FloatToHalf, 10, true, 251);
+  CheckFloats(FloatsToUFloat11s, FloatToUFloat11, 6, false, 251);
+  CheckFloats(FloatsToUFloat10s, FloatToUFloat10, 5, false, 251);
+}
+
+// Exhaustive over all 2^32 floats, which takes about half a minute per
+// format. Run with --gtest_also_run_disabled_tests.
+TEST_F(SmallFloatTest, DISABLED_AllFloatsToHalf) {
+  CheckFloats(FloatsToHalfs, FloatToHalf, 10, true, 1);
+}
+
+TEST_F(SmallFloatTest, DISABLED_AllFloatsToUFloat11) {
+  CheckFloats(FloatsToUFloat11s, FloatToUFloat11, 6, false, 1);
+}
+
+TEST_F(SmallFloatTest, DISABLED_AllFloatsToUFloat10) {
+  CheckFloats(FloatsToUFloat10s, FloatToUFloat10, 5, false, 1);
+}
+
+}  // namespace vulkan
+}  // namespace amber
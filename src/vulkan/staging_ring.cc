@@ -0,0 +1,259 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/staging_ring.h"
+
+#include "src/make_unique.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+// Matches the command buffers, which wait for the same fences.
+const uint64_t kFenceTimeout = 10000000000; /* nanosecond */
+
+VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+RingAllocator::RingAllocator(VkDeviceSize capacity) : capacity_(capacity) {}
+
+RingAllocator::~RingAllocator() = default;
+
+bool RingAllocator::Allocate(VkDeviceSize size,
+                             VkDeviceSize alignment,
+                             VkDeviceSize* offset) {
+  if (size > capacity_)
+    return false;
+
+  VkDeviceSize start = AlignUp(head_, alignment);
+  if (submissions_.empty()) {
+    head_ = 0;
+    tail_ = 0;
+    start = 0;
+  } else if (head_ > tail_) {
+    // Wrap around when the end of the ring is too short.
+    if (start + size > capacity_)
+      start = 0;
+    if (start == 0 && size > tail_)
+      return false;
+  } else if (start + size > tail_) {
+    return false;
+  }
+
+  head_ = start + size;
+  if (submissions_.empty() || submissions_.back().serial != pending_serial_)
+    submissions_.push_back({pending_serial_, head_});
+  else
+    submissions_.back().end = head_;
+
+  *offset = start;
+  return true;
+}
+
+uint64_t RingAllocator::Submit() {
+  return pending_serial_++;
+}
+
+void RingAllocator::Retire(uint64_t serial) {
+  while (!submissions_.empty() && submissions_.front().serial <= serial) {
+    tail_ = submissions_.front().end;
+    submissions_.pop_front();
+  }
+}
+
+void RingAllocator::Reset() {
+  submissions_.clear();
+  head_ = 0;
+  tail_ = 0;
+}
+
+// A host buffer for one region which is too large for the ring.
+class StagingRing::DedicatedBuffer : public Resource {
+ public:
+  DedicatedBuffer(VkDevice device, size_t size, MemoryAllocator* allocator)
+      : Resource(device, size, allocator) {}
+  ~DedicatedBuffer() override = default;
+
+  Result Initialize() {
+    Result r = CreateVkBuffer(&buffer_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                            VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    if (!r.IsSuccess())
+      return r;
+
+    AllocateResult allocate_result = AllocateAndBindMemoryToVkBuffer(
+        buffer_, &allocation_,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        true);
+    if (!allocate_result.r.IsSuccess())
+      return allocate_result.r;
+
+    return MapMemory(allocation_);
+  }
+
+  VkBuffer GetVkBuffer() const { return buffer_; }
+
+  void Shutdown() override {
+    if (buffer_ != VK_NULL_HANDLE) {
+      vkDestroyBuffer(GetDevice(), buffer_, nullptr);
+      buffer_ = VK_NULL_HANDLE;
+    }
+    FreeMemory(&allocation_);
+    Resource::Shutdown();
+  }
+
+ private:
+  VkBuffer buffer_ = VK_NULL_HANDLE;
+  MemoryAllocator::Allocation allocation_;
+};
+
+StagingRing::StagingRing(VkDevice device,
+                         size_t size,
+                         MemoryAllocator* allocator)
+    : Resource(device, size, allocator), ring_(size) {}
+
+StagingRing::~StagingRing() = default;
+
+Result StagingRing::CreateBuffer() {
+  Result r = CreateVkBuffer(&buffer_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                          VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  if (!r.IsSuccess())
+    return r;
+
+  AllocateResult allocate_result = AllocateAndBindMemoryToVkBuffer(
+      buffer_, &allocation_,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      true);
+  if (!allocate_result.r.IsSuccess())
+    return allocate_result.r;
+
+  return MapMemory(allocation_);
+}
+
+Result StagingRing::AllocateDedicated(VkDeviceSize size, Region* region) {
+  auto buffer = MakeUnique<DedicatedBuffer>(
+      GetDevice(), static_cast<size_t>(size), GetAllocator());
+  Result r = buffer->Initialize();
+  if (!r.IsSuccess()) {
+    buffer->Shutdown();
+    return r;
+  }
+
+  region->buffer = buffer->GetVkBuffer();
+  region->offset = 0;
+  region->size = size;
+  region->ptr = buffer->HostAccessibleMemoryPtr();
+  dedicated_.emplace_back(pending_serial_, std::move(buffer));
+  return {};
+}
+
+void StagingRing::DestroyRetiredDedicatedBuffers() {
+  auto it = dedicated_.begin();
+  while (it != dedicated_.end() && it->first <= retired_serial_) {
+    it->second->Shutdown();
+    ++it;
+  }
+  dedicated_.erase(dedicated_.begin(), it);
+}
+
+Result StagingRing::Allocate(VkDeviceSize size,
+                             VkDeviceSize alignment,
+                             Region* region) {
+  if (region == nullptr)
+    return Result("Vulkan::Given Region pointer is nullptr");
+
+  // Retired readback data is only kept until the next call.
+  ++allocation_count_;
+  DestroyRetiredDedicatedBuffers();
+
+  if (size > GetMaxRegionSize())
+    return AllocateDedicated(size, region);
+
+  if (buffer_ == VK_NULL_HANDLE) {
+    Result r = CreateBuffer();
+    if (!r.IsSuccess())
+      return r;
+  }
+
+  VkDeviceSize offset = 0;
+  while (!ring_.Allocate(size, alignment, &offset)) {
+    Result r;
+    if (!RetireOldestSubmission(&r))
+      return Result("Vulkan::Staging ring is full");
+    if (!r.IsSuccess())
+      return r;
+  }
+
+  region->buffer = buffer_;
+  region->offset = offset;
+  region->size = size;
+  region->ptr = static_cast<uint8_t*>(HostAccessibleMemoryPtr()) + offset;
+  return {};
+}
+
+bool StagingRing::RetireOldestSubmission(Result* result) {
+  if (fences_.empty())
+    return false;
+
+  const auto oldest = fences_.front();
+  VkResult r = vkWaitForFences(GetDevice(), 1, &oldest.second, VK_TRUE,
+                               kFenceTimeout);
+  if (r == VK_TIMEOUT) {
+    *result = Result("Vulkan::Calling vkWaitForFences Timeout");
+  } else if (r != VK_SUCCESS) {
+    *result = Result("Vulkan::Calling vkWaitForFences Fail");
+  } else {
+    Retire(oldest.first);
+    *result = {};
+  }
+  return true;
+}
+
+uint64_t StagingRing::Submit(VkFence fence) {
+  const uint64_t serial = ring_.Submit();
+  pending_serial_ = serial + 1;
+  fences_.emplace_back(serial, fence);
+  return serial;
+}
+
+void StagingRing::Retire(uint64_t serial) {
+  ring_.Retire(serial);
+  if (serial > retired_serial_)
+    retired_serial_ = serial;
+
+  // The command buffer may reset a fence once its submission is retired.
+  while (!fences_.empty() && fences_.front().first <= serial)
+    fences_.pop_front();
+}
+
+void StagingRing::Shutdown() {
+  if (buffer_ != VK_NULL_HANDLE) {
+    vkDestroyBuffer(GetDevice(), buffer_, nullptr);
+    buffer_ = VK_NULL_HANDLE;
+  }
+  FreeMemory(&allocation_);
+  for (auto& it : dedicated_)
+    it.second->Shutdown();
+  dedicated_.clear();
+  fences_.clear();
+  ring_.Reset();
+  Resource::Shutdown();
+}
+
+}  // namespace vulkan
+}  // namespace amber
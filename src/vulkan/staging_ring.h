@@ -0,0 +1,145 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_VULKAN_STAGING_RING_H_
+#define SRC_VULKAN_STAGING_RING_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "amber/result.h"
+#include "src/vulkan/resource.h"
+#include "vulkan/vulkan.h"
+
+namespace amber {
+namespace vulkan {
+
+// Hands out ranges of a ring of |capacity| bytes in ring order. The ranges
+// allocated between two calls to Submit() form a submission, and are
+// recycled together by Retire(). Only does the bookkeeping, the memory
+// belongs to the StagingRing.
+class RingAllocator {
+ public:
+  explicit RingAllocator(VkDeviceSize capacity);
+  ~RingAllocator();
+
+  VkDeviceSize GetCapacity() const { return capacity_; }
+
+  // Sets |offset| to the start of |size| bytes at |alignment|. Returns false
+  // when the ranges in use leave no room for them.
+  bool Allocate(VkDeviceSize size, VkDeviceSize alignment,
+                VkDeviceSize* offset);
+
+  // Closes the ranges allocated since the last call into a submission and
+  // returns its serial.
+  uint64_t Submit();
+
+  // Recycles the ranges of every submission up to and including |serial|.
+  void Retire(uint64_t serial);
+
+  // Recycles every range.
+  void Reset();
+
+ private:
+  struct Submission {
+    uint64_t serial;
+    // End of the last range of the submission.
+    VkDeviceSize end;
+  };
+
+  VkDeviceSize capacity_;
+  // Ranges in use are [tail_, head_), wrapping around the end of the ring.
+  // The ring is empty when |submissions_| is.
+  VkDeviceSize head_ = 0;
+  VkDeviceSize tail_ = 0;
+  std::deque<Submission> submissions_;
+  uint64_t pending_serial_ = 1;
+};
+
+// A device wide, persistently mapped host buffer which uploads to and
+// readbacks from device local resources are staged through. Regions are
+// handed out in ring order and tagged with the submission they are recorded
+// into; they are recycled once that submission has completed. Regions larger
+// than a quarter of the ring get a host buffer of their own instead, which
+// is destroyed the same way.
+class StagingRing : public Resource {
+ public:
+  struct Region {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* ptr = nullptr;
+  };
+
+  StagingRing(VkDevice device, size_t size, MemoryAllocator* allocator);
+  ~StagingRing() override;
+
+  // Takes |size| bytes at |alignment| from the ring. The buffer is created
+  // on first use so devices which never stage do not pay for it. When the
+  // ring is full, waits for the oldest submissions until there is room.
+  // Fails only when the regions allocated since the last Submit() leave no
+  // room; the caller can submit them and try again. Readback data stays
+  // valid until the next call.
+  Result Allocate(VkDeviceSize size, VkDeviceSize alignment, Region* region);
+
+  // Closes the regions allocated since the last call into a submission,
+  // which is complete once |fence| is signaled, and returns its serial.
+  uint64_t Submit(VkFence fence);
+
+  // Recycles the regions of every submission up to and including |serial|.
+  void Retire(uint64_t serial);
+
+  // The largest region taken from the ring. Larger ones get a dedicated
+  // buffer.
+  VkDeviceSize GetMaxRegionSize() const { return ring_.GetCapacity() / 4; }
+
+  // The number of regions handed out so far. Readback data is only still
+  // valid while it has not changed.
+  uint64_t GetAllocationCount() const { return allocation_count_; }
+
+  // Resource
+  void Shutdown() override;
+
+ private:
+  class DedicatedBuffer;
+
+  Result CreateBuffer();
+  Result AllocateDedicated(VkDeviceSize size, Region* region);
+  // Destroys the dedicated buffers of retired submissions.
+  void DestroyRetiredDedicatedBuffers();
+  // Waits for the oldest submission which is not retired, and retires it.
+  // Returns false when there is none.
+  bool RetireOldestSubmission(Result* result);
+
+  VkBuffer buffer_ = VK_NULL_HANDLE;
+  MemoryAllocator::Allocation allocation_;
+  RingAllocator ring_;
+
+  // Dedicated buffers with the serial of the submission they are used by.
+  std::vector<std::pair<uint64_t, std::unique_ptr<DedicatedBuffer>>>
+      dedicated_;
+  // The fences of the submissions which are not retired, oldest first.
+  std::deque<std::pair<uint64_t, VkFence>> fences_;
+  uint64_t pending_serial_ = 1;
+  uint64_t retired_serial_ = 0;
+  uint64_t allocation_count_ = 0;
+};
+
+}  // namespace vulkan
+}  // namespace amber
+
+#endif  // SRC_VULKAN_STAGING_RING_H_
@@ -0,0 +1,142 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/staging_ring.h"
+
+#include "gtest/gtest.h"
+
+namespace amber {
+namespace vulkan {
+
+using RingAllocatorTest = testing::Test;
+
+TEST_F(RingAllocatorTest, AllocatesInOrder) {
+  RingAllocator ring(1024);
+
+  VkDeviceSize offset = 1;
+  ASSERT_TRUE(ring.Allocate(100, 1, &offset));
+  EXPECT_EQ(0U, offset);
+  ASSERT_TRUE(ring.Allocate(100, 64, &offset));
+  EXPECT_EQ(128U, offset);
+  ASSERT_TRUE(ring.Allocate(796, 1, &offset));
+  EXPECT_EQ(228U, offset);
+}
+
+TEST_F(RingAllocatorTest, FullUntilRetired) {
+  RingAllocator ring(1024);
+
+  VkDeviceSize offset = 0;
+  ASSERT_TRUE(ring.Allocate(1024, 1, &offset));
+  EXPECT_FALSE(ring.Allocate(1, 1, &offset));
+
+  const uint64_t serial = ring.Submit();
+  EXPECT_FALSE(ring.Allocate(1, 1, &offset));
+
+  ring.Retire(serial);
+  ASSERT_TRUE(ring.Allocate(1, 1, &offset));
+  EXPECT_EQ(0U, offset);
+}
+
+TEST_F(RingAllocatorTest, RejectsLargerThanCapacity) {
+  RingAllocator ring(1024);
+
+  VkDeviceSize offset = 0;
+  EXPECT_FALSE(ring.Allocate(1025, 1, &offset));
+  EXPECT_TRUE(ring.Allocate(1024, 1, &offset));
+}
+
+TEST_F(RingAllocatorTest, WrapsAroundAfterRetire) {
+  RingAllocator ring(1024);
+
+  VkDeviceSize offset = 0;
+  ASSERT_TRUE(ring.Allocate(400, 1, &offset));
+  const uint64_t first = ring.Submit();
+  ASSERT_TRUE(ring.Allocate(400, 1, &offset));
+  EXPECT_EQ(400U, offset);
+  ring.Submit();
+
+  // The end of the ring is too short and the start is still in use.
+  EXPECT_FALSE(ring.Allocate(300, 1, &offset));
+
+  ring.Retire(first);
+  ASSERT_TRUE(ring.Allocate(300, 1, &offset));
+  EXPECT_EQ(0U, offset);
+
+  // The wrapped head may not run into the second submission.
+  EXPECT_FALSE(ring.Allocate(101, 1, &offset));
+  ASSERT_TRUE(ring.Allocate(100, 1, &offset));
+  EXPECT_EQ(300U, offset);
+}
+
+TEST_F(RingAllocatorTest, UsesEndBeforeWrapping) {
+  RingAllocator ring(1024);
+
+  VkDeviceSize offset = 0;
+  ASSERT_TRUE(ring.Allocate(512, 1, &offset));
+  const uint64_t first = ring.Submit();
+  ASSERT_TRUE(ring.Allocate(256, 1, &offset));
+  ring.Retire(first);
+
+  ASSERT_TRUE(ring.Allocate(256, 1, &offset));
+  EXPECT_EQ(768U, offset);
+  ASSERT_TRUE(ring.Allocate(256, 1, &offset));
+  EXPECT_EQ(0U, offset);
+}
+
+TEST_F(RingAllocatorTest, RetireCoversEarlierSubmissions) {
+  RingAllocator ring(1024);
+
+  VkDeviceSize offset = 0;
+  ASSERT_TRUE(ring.Allocate(512, 1, &offset));
+  ring.Submit();
+  ASSERT_TRUE(ring.Allocate(512, 1, &offset));
+  const uint64_t second = ring.Submit();
+  EXPECT_FALSE(ring.Allocate(1, 1, &offset));
+
+  ring.Retire(second);
+  ASSERT_TRUE(ring.Allocate(1024, 1, &offset));
+  EXPECT_EQ(0U, offset);
+}
+
+TEST_F(RingAllocatorTest, SubmitWithoutRangesKeepsRing) {
+  RingAllocator ring(1024);
+
+  VkDeviceSize offset = 0;
+  ASSERT_TRUE(ring.Allocate(512, 1, &offset));
+  const uint64_t first = ring.Submit();
+  const uint64_t empty = ring.Submit();
+  EXPECT_LT(first, empty);
+
+  ASSERT_TRUE(ring.Allocate(512, 1, &offset));
+  EXPECT_EQ(512U, offset);
+  EXPECT_FALSE(ring.Allocate(1, 1, &offset));
+
+  // Retiring the empty submission also retires the one before it.
+  ring.Retire(empty);
+  ASSERT_TRUE(ring.Allocate(512, 1, &offset));
+  EXPECT_EQ(0U, offset);
+}
+
+TEST_F(RingAllocatorTest, Reset) {
+  RingAllocator ring(1024);
+
+  VkDeviceSize offset = 0;
+  ASSERT_TRUE(ring.Allocate(1024, 1, &offset));
+  ring.Reset();
+  ASSERT_TRUE(ring.Allocate(1024, 1, &offset));
+  EXPECT_EQ(0U, offset);
+}
+
+}  // namespace vulkan
+}  // namespace amber
@@ -0,0 +1,205 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/texel_packer.h"
+
+#include <cstring>
+
+#include "src/vulkan/bit_copy.h"
+#include "src/vulkan/small_float.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+using PackFn = void (*)(const std::vector<uint8_t>& bits,
+                        const Value* values,
+                        uint32_t count,
+                        uint8_t* dst,
+                        uint32_t stride);
+
+// Each of these matches what BitCopy::CopyValueToBuffer writes for a value
+// of the given size: integers are truncated, floats are converted.
+uint8_t ToWord8(const Value& value) {
+  // BitCopy has no 8 bit float and leaves the byte zero.
+  return value.IsInteger() ? value.AsUint8() : 0;
+}
+
+uint32_t ToWord32(const Value& value) {
+  if (value.IsInteger())
+    return value.AsUint32();
+
+  const float f = value.AsFloat();
+  uint32_t word;
+  memcpy(&word, &f, sizeof(word));
+  return word;
+}
+
+uint64_t ToWord64(const Value& value) {
+  if (value.IsInteger())
+    return value.AsUint64();
+
+  const double d = value.AsDouble();
+  uint64_t word;
+  memcpy(&word, &d, sizeof(word));
+  return word;
+}
+
+// Texels of |kComponents| consecutive |T| words.
+template <typename T, T (*ToWord)(const Value&), uint32_t kComponents>
+void PackWords(const std::vector<uint8_t>&,
+               const Value* values,
+               uint32_t count,
+               uint8_t* dst,
+               uint32_t stride) {
+  for (uint32_t i = 0; i < count; ++i, dst += stride) {
+    T words[kComponents];
+    for (uint32_t k = 0; k < kComponents; ++k)
+      words[k] = ToWord(*values++);
+    memcpy(dst, words, sizeof(words));
+  }
+}
+
+// Texels of |kComponents| 16 bit words. Floats are converted to halfs a
+// block at a time.
+template <uint32_t kComponents>
+void PackHalfWords(const std::vector<uint8_t>&,
+                   const Value* values,
+                   uint32_t count,
+                   uint8_t* dst,
+                   uint32_t stride) {
+  const uint32_t kBlockTexels = 64;
+  float floats[kBlockTexels * kComponents];
+  uint16_t halfs[kBlockTexels * kComponents];
+
+  for (uint32_t start = 0; start < count; start += kBlockTexels) {
+    const uint32_t texels =
+        count - start < kBlockTexels ? count - start : kBlockTexels;
+    const uint32_t block_values = texels * kComponents;
+    for (uint32_t k = 0; k < block_values; ++k)
+      floats[k] = values[k].IsInteger() ? 0.0f : values[k].AsFloat();
+    FloatsToHalfs(floats, block_values, halfs);
+
+    for (uint32_t k = 0; k < block_values; ++k) {
+      if (values[k].IsInteger())
+        halfs[k] = values[k].AsUint16();
+    }
+    for (uint32_t i = 0; i < texels; ++i, dst += stride)
+      memcpy(dst, halfs + i * kComponents, sizeof(uint16_t) * kComponents);
+    values += block_values;
+  }
+}
+
+// Any other layout, one component at a time through BitCopy.
+void PackBits(const std::vector<uint8_t>& bits,
+              const Value* values,
+              uint32_t count,
+              uint8_t* dst,
+              uint32_t stride) {
+  for (uint32_t i = 0; i < count; ++i, dst += stride) {
+    uint8_t bit_offset = 0;
+    for (const uint8_t num_bits : bits) {
+      BitCopy::CopyValueToBuffer(dst, *values++, bit_offset, num_bits);
+      bit_offset = static_cast<uint8_t>(bit_offset + num_bits);
+    }
+  }
+}
+
+template <typename T, T (*ToWord)(const Value&)>
+PackFn SelectWords(size_t components) {
+  switch (components) {
+    case 1:
+      return PackWords<T, ToWord, 1>;
+    case 2:
+      return PackWords<T, ToWord, 2>;
+    case 3:
+      return PackWords<T, ToWord, 3>;
+    case 4:
+      return PackWords<T, ToWord, 4>;
+  }
+  return nullptr;
+}
+
+PackFn SelectHalfWords(size_t components) {
+  switch (components) {
+    case 1:
+      return PackHalfWords<1>;
+    case 2:
+      return PackHalfWords<2>;
+    case 3:
+      return PackHalfWords<3>;
+    case 4:
+      return PackHalfWords<4>;
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TexelPacker::TexelPacker() = default;
+
+TexelPacker::~TexelPacker() = default;
+
+Result TexelPacker::Initialize(const Format& format) {
+  const auto& components = format.GetComponents();
+  if (components.empty())
+    return Result("Vulkan::TexelPacker format has no components");
+
+  bits_.clear();
+  texel_size_ = format.GetByteSize();
+  if (format.GetPackSize()) {
+    // The value holds the whole packed word.
+    bits_.push_back(format.GetPackSize());
+    texel_size_ = format.GetPackSize() / 8U;
+  } else {
+    for (const auto& component : components)
+      bits_.push_back(component.num_bits);
+  }
+  values_per_texel_ = static_cast<uint32_t>(bits_.size());
+
+  bool same_bits = true;
+  for (const uint8_t num_bits : bits_)
+    same_bits = same_bits && num_bits == bits_[0];
+
+  pack_ = nullptr;
+  if (same_bits) {
+    switch (bits_[0]) {
+      case 8:
+        pack_ = SelectWords<uint8_t, ToWord8>(bits_.size());
+        break;
+      case 16:
+        pack_ = SelectHalfWords(bits_.size());
+        break;
+      case 32:
+        pack_ = SelectWords<uint32_t, ToWord32>(bits_.size());
+        break;
+      case 64:
+        pack_ = SelectWords<uint64_t, ToWord64>(bits_.size());
+        break;
+    }
+  }
+  if (pack_ == nullptr)
+    pack_ = PackBits;
+  return {};
+}
+
+void TexelPacker::Pack(const Value* values,
+                       uint32_t count,
+                       uint8_t* dst,
+                       uint32_t stride) const {
+  pack_(bits_, values, count, dst, stride);
+}
+
+}  // namespace vulkan
+}  // namespace amber
@@ -0,0 +1,68 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_VULKAN_TEXEL_PACKER_H_
+#define SRC_VULKAN_TEXEL_PACKER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "amber/result.h"
+#include "src/format.h"
+#include "src/value.h"
+
+namespace amber {
+namespace vulkan {
+
+// A plan for writing Values into texels of a Format, producing the same
+// bytes as BitCopy. The writer is chosen once per format: when every
+// component is a byte aligned 8, 16, 32 or 64 bit word the values are
+// stored directly, otherwise each component goes through BitCopy.
+class TexelPacker {
+ public:
+  TexelPacker();
+  ~TexelPacker();
+
+  Result Initialize(const Format& format);
+
+  uint32_t GetTexelSize() const { return texel_size_; }
+
+  // Packed formats take one value per texel, the others one per component.
+  uint32_t GetValuesPerTexel() const { return values_per_texel_; }
+
+  // Writes |count| texels from |values| to |dst|, with |stride| bytes
+  // between the starts of texels.
+  void Pack(const Value* values,
+            uint32_t count,
+            uint8_t* dst,
+            uint32_t stride) const;
+
+ private:
+  using PackFn = void (*)(const std::vector<uint8_t>& bits,
+                          const Value* values,
+                          uint32_t count,
+                          uint8_t* dst,
+                          uint32_t stride);
+
+  // Size in bits of each value of a texel.
+  std::vector<uint8_t> bits_;
+  uint32_t texel_size_ = 0;
+  uint32_t values_per_texel_ = 0;
+  PackFn pack_ = nullptr;
+};
+
+}  // namespace vulkan
+}  // namespace amber
+
+#endif  // SRC_VULKAN_TEXEL_PACKER_H_
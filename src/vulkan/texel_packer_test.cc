@@ -0,0 +1,149 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/texel_packer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/vkscript/format_parser.h"
+#include "src/vulkan/bit_copy.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+std::unique_ptr<Format> ParseFormat(const std::string& name) {
+  auto format = vkscript::FormatParser().Parse(name);
+  EXPECT_TRUE(format != nullptr) << name;
+  return format;
+}
+
+// The per component BitCopy loop the packer replaces.
+void PackWithBitCopy(const Format& format,
+                     const std::vector<Value>& values,
+                     uint32_t count,
+                     uint8_t* dst,
+                     uint32_t stride) {
+  const Value* value = values.data();
+  for (uint32_t i = 0; i < count; ++i, dst += stride) {
+    if (format.GetPackSize()) {
+      BitCopy::CopyValueToBuffer(dst, *value++, 0, format.GetPackSize());
+      continue;
+    }
+
+    uint8_t bit_offset = 0;
+    for (const auto& component : format.GetComponents()) {
+      BitCopy::CopyValueToBuffer(dst, *value++, bit_offset,
+                                 component.num_bits);
+      bit_offset = static_cast<uint8_t>(bit_offset + component.num_bits);
+    }
+  }
+}
+
+std::vector<Value> IntValues(uint32_t count, uint64_t step) {
+  std::vector<Value> values(count);
+  for (uint32_t i = 0; i < count; ++i)
+    values[i].SetIntValue(i * step);
+  return values;
+}
+
+std::vector<Value> FloatValues(uint32_t count) {
+  std::vector<Value> values(count);
+  for (uint32_t i = 0; i < count; ++i)
+    values[i].SetDoubleValue(1.5 + i * 0.375 - (i % 3) * 4.0);
+  return values;
+}
+
+void ExpectSameAsBitCopy(const std::string& name,
+                         const std::vector<Value>& values) {
+  auto format = ParseFormat(name);
+  ASSERT_TRUE(format != nullptr);
+
+  TexelPacker packer;
+  Result r = packer.Initialize(*format);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  ASSERT_EQ(format->GetByteSize(), packer.GetTexelSize()) << name;
+
+  // Leave a gap after every texel, as interleaved attributes do.
+  const uint32_t stride = packer.GetTexelSize() + 3;
+  const uint32_t count =
+      static_cast<uint32_t>(values.size()) / packer.GetValuesPerTexel();
+  std::vector<uint8_t> expected(stride * count, 0xcd);
+  std::vector<uint8_t> actual(stride * count, 0xcd);
+
+  PackWithBitCopy(*format, values, count, expected.data(), stride);
+  packer.Pack(values.data(), count, actual.data(), stride);
+  EXPECT_EQ(expected, actual) << name;
+}
+
+}  // namespace
+
+using TexelPackerTest = testing::Test;
+
+TEST_F(TexelPackerTest, Bytes) {
+  ExpectSameAsBitCopy("R8G8B8A8_UNORM", IntValues(40, 37));
+  ExpectSameAsBitCopy("R8G8B8_SINT", IntValues(30, 91));
+  ExpectSameAsBitCopy("R8_UINT", IntValues(10, 3));
+}
+
+TEST_F(TexelPackerTest, Words) {
+  ExpectSameAsBitCopy("R16G16_UINT", IntValues(20, 4099));
+  ExpectSameAsBitCopy("R16G16B16A16_SFLOAT", FloatValues(40));
+  ExpectSameAsBitCopy("R32G32B32A32_SFLOAT", FloatValues(40));
+  ExpectSameAsBitCopy("R32G32_SINT", IntValues(20, 123456789));
+  ExpectSameAsBitCopy("R64G64B64_SFLOAT", FloatValues(30));
+  ExpectSameAsBitCopy("R64_UINT", IntValues(10, 0x123456789abcULL));
+}
+
+TEST_F(TexelPackerTest, PackedFormats) {
+  ExpectSameAsBitCopy("A2B10G10R10_UNORM_PACK32", IntValues(10, 0x40100401));
+  ExpectSameAsBitCopy("R5G6B5_UNORM_PACK16", IntValues(10, 0x1234));
+  ExpectSameAsBitCopy("R4G4_UNORM_PACK8", IntValues(10, 0x21));
+}
+
+TEST_F(TexelPackerTest, UnalignedComponents) {
+  ExpectSameAsBitCopy("D24_UNORM_S8_UINT", IntValues(20, 0x10101));
+  ExpectSameAsBitCopy("D32_SFLOAT_S8_UINT", IntValues(20, 77));
+}
+
+TEST_F(TexelPackerTest, ValuesPerTexel) {
+  auto format = ParseFormat("A2B10G10R10_UNORM_PACK32");
+  ASSERT_TRUE(format != nullptr);
+  TexelPacker packer;
+  Result r = packer.Initialize(*format);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(1U, packer.GetValuesPerTexel());
+  EXPECT_EQ(4U, packer.GetTexelSize());
+
+  format = ParseFormat("R32G32B32_SFLOAT");
+  ASSERT_TRUE(format != nullptr);
+  r = packer.Initialize(*format);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(3U, packer.GetValuesPerTexel());
+  EXPECT_EQ(12U, packer.GetTexelSize());
+}
+
+TEST_F(TexelPackerTest, EmptyFormat) {
+  Format format;
+  TexelPacker packer;
+  Result r = packer.Initialize(format);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Vulkan::TexelPacker format has no components", r.Error());
+}
+
+}  // namespace vulkan
+}  // namespace amber
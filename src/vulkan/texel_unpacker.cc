@@ -0,0 +1,392 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/texel_unpacker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+using Component = TexelUnpacker::Component;
+using UnpackFn = void (*)(const std::vector<Component>&,
+                          uint32_t texel_size,
+                          const uint8_t* src,
+                          uint32_t count,
+                          float* dst);
+
+const uint32_t kAlphaLane = 3;
+
+void SetDefaultLanes(float* dst) {
+  dst[0] = 0.0f;
+  dst[1] = 0.0f;
+  dst[2] = 0.0f;
+  dst[kAlphaLane] = 1.0f;
+}
+
+uint32_t ToLane(FormatComponentType type, bool has_depth) {
+  switch (type) {
+    case FormatComponentType::kR:
+    case FormatComponentType::kD:
+      return 0;
+    case FormatComponentType::kG:
+      return 1;
+    case FormatComponentType::kB:
+      return 2;
+    case FormatComponentType::kA:
+      return kAlphaLane;
+    case FormatComponentType::kS:
+      return has_depth ? 1 : 0;
+    case FormatComponentType::kX:
+      break;
+  }
+  return TexelUnpacker::kNoLane;
+}
+
+// Decodes the unsigned floats of B10G11R11 and the halfs of SFLOAT formats,
+// which all have a 5 bit exponent. See BitCopy::FloatToHexFloat.
+float SmallFloatToFloat(uint32_t value, uint32_t mantissa_bits, bool sign) {
+  const uint32_t mantissa = value & ((1U << mantissa_bits) - 1U);
+  const uint32_t exponent = (value >> mantissa_bits) & 0x1fU;
+  const bool negative = sign && ((value >> (mantissa_bits + 5U)) & 1U) != 0;
+
+  float result;
+  if (exponent == 0) {
+    // Denormal: mantissa * 2^(-14 - mantissa_bits).
+    result = static_cast<float>(mantissa) /
+             static_cast<float>(1U << (14U + mantissa_bits));
+  } else {
+    // Rebias the exponent from 15 to 127, and map the maximum exponent to
+    // infinity or NaN.
+    const uint32_t bits =
+        ((exponent == 0x1fU ? 0xffU : exponent + 112U) << 23U) |
+        (mantissa << (23U - mantissa_bits));
+    memcpy(&result, &bits, sizeof(result));
+  }
+  return negative ? -result : result;
+}
+
+float HalfToFloat(uint16_t value) {
+  return SmallFloatToFloat(value, 10, true);
+}
+
+template <typename T>
+float UNormToFloat(T value) {
+  return static_cast<float>(value) /
+         static_cast<float>(std::numeric_limits<T>::max());
+}
+
+template <typename T>
+float SNormToFloat(T value) {
+  return std::max(static_cast<float>(value) /
+                      static_cast<float>(std::numeric_limits<T>::max()),
+                  -1.0f);
+}
+
+template <typename T>
+float ToFloat(T value) {
+  return static_cast<float>(value);
+}
+
+// Four 8 bit normalized components, stored as RGBA or as BGRA.
+template <bool kSwapRedBlue>
+void UnpackUNorm8x4(const std::vector<Component>&,
+                    uint32_t,
+                    const uint8_t* src,
+                    uint32_t count,
+                    float* dst) {
+  uint32_t i = 0;
+#if defined(__SSE2__)
+  // Four texels per step: widen the 16 bytes to 32 bit lanes, one texel per
+  // register, and convert.
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 max = _mm_set1_ps(255.0f);
+  for (; i + 4 <= count; i += 4) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+    const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+    const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+    const __m128i texels[4] = {
+        _mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero),
+        _mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero)};
+    for (uint32_t k = 0; k < 4; ++k) {
+      __m128 texel = _mm_div_ps(_mm_cvtepi32_ps(texels[k]), max);
+      if (kSwapRedBlue)
+        texel = _mm_shuffle_ps(texel, texel, _MM_SHUFFLE(3, 0, 1, 2));
+      _mm_storeu_ps(dst + (i + k) * 4, texel);
+    }
+  }
+#endif  // defined(__SSE2__)
+
+  const uint32_t red = kSwapRedBlue ? 2 : 0;
+  const uint32_t blue = kSwapRedBlue ? 0 : 2;
+  for (; i < count; ++i) {
+    const uint8_t* texel = src + i * 4;
+    float* lanes = dst + i * 4;
+    lanes[red] = UNormToFloat(texel[0]);
+    lanes[1] = UNormToFloat(texel[1]);
+    lanes[blue] = UNormToFloat(texel[2]);
+    lanes[kAlphaLane] = UNormToFloat(texel[3]);
+  }
+}
+
+// Components which all are one byte aligned |T|, decoded by |Convert|.
+template <typename T, float (*Convert)(T)>
+void UnpackWords(const std::vector<Component>& components,
+                 uint32_t texel_size,
+                 const uint8_t* src,
+                 uint32_t count,
+                 float* dst) {
+  for (uint32_t i = 0; i < count; ++i, src += texel_size, dst += 4) {
+    SetDefaultLanes(dst);
+    for (const auto& component : components) {
+      if (component.lane == TexelUnpacker::kNoLane)
+        continue;
+
+      T value;
+      memcpy(&value, src + component.bit_offset / 8, sizeof(value));
+      dst[component.lane] = Convert(value);
+    }
+  }
+}
+
+float DecodeField(uint32_t field, FormatMode mode, uint32_t num_bits) {
+  const uint32_t sign_bit = 1U << (num_bits - 1);
+  int64_t signed_field = static_cast<int64_t>(field);
+  if (field & sign_bit)
+    signed_field -= int64_t{1} << num_bits;
+
+  switch (mode) {
+    case FormatMode::kUNorm:
+    case FormatMode::kSRGB:
+      return static_cast<float>(static_cast<double>(field) /
+                                static_cast<double>((uint64_t{1} << num_bits) -
+                                                    1));
+    case FormatMode::kSNorm:
+      return std::max(
+          static_cast<float>(static_cast<double>(signed_field) /
+                             static_cast<double>(sign_bit - 1)),
+          -1.0f);
+    case FormatMode::kUInt:
+    case FormatMode::kUScaled:
+      return static_cast<float>(field);
+    case FormatMode::kSInt:
+    case FormatMode::kSScaled:
+      return static_cast<float>(signed_field);
+    case FormatMode::kUFloat:
+      return SmallFloatToFloat(field, num_bits - 5, false);
+    case FormatMode::kSFloat:
+      if (num_bits == 16)
+        return SmallFloatToFloat(field, 10, true);
+
+      float value;
+      memcpy(&value, &field, sizeof(value));
+      return value;
+  }
+  return 0.0f;
+}
+
+// Any texel of up to 8 bytes, one bit field at a time.
+void UnpackBits(const std::vector<Component>& components,
+                uint32_t texel_size,
+                const uint8_t* src,
+                uint32_t count,
+                float* dst) {
+  for (uint32_t i = 0; i < count; ++i, src += texel_size, dst += 4) {
+    // Texels are little endian, like the data BitCopy writes.
+    uint64_t texel = 0;
+    memcpy(&texel, src, texel_size);
+
+    SetDefaultLanes(dst);
+    for (const auto& component : components) {
+      if (component.lane == TexelUnpacker::kNoLane)
+        continue;
+
+      const uint64_t mask = (uint64_t{1} << component.num_bits) - 1;
+      const uint32_t field =
+          static_cast<uint32_t>((texel >> component.bit_offset) & mask);
+      dst[component.lane] =
+          DecodeField(field, component.mode, component.num_bits);
+    }
+  }
+}
+
+UnpackFn SelectWordKernel(FormatMode mode, uint8_t num_bits) {
+  switch (mode) {
+    case FormatMode::kUNorm:
+    case FormatMode::kSRGB:
+      if (num_bits == 8)
+        return UnpackWords<uint8_t, UNormToFloat<uint8_t>>;
+      if (num_bits == 16)
+        return UnpackWords<uint16_t, UNormToFloat<uint16_t>>;
+      break;
+    case FormatMode::kSNorm:
+      if (num_bits == 8)
+        return UnpackWords<int8_t, SNormToFloat<int8_t>>;
+      if (num_bits == 16)
+        return UnpackWords<int16_t, SNormToFloat<int16_t>>;
+      break;
+    case FormatMode::kUInt:
+    case FormatMode::kUScaled:
+      if (num_bits == 8)
+        return UnpackWords<uint8_t, ToFloat<uint8_t>>;
+      if (num_bits == 16)
+        return UnpackWords<uint16_t, ToFloat<uint16_t>>;
+      if (num_bits == 32)
+        return UnpackWords<uint32_t, ToFloat<uint32_t>>;
+      if (num_bits == 64)
+        return UnpackWords<uint64_t, ToFloat<uint64_t>>;
+      break;
+    case FormatMode::kSInt:
+    case FormatMode::kSScaled:
+      if (num_bits == 8)
+        return UnpackWords<int8_t, ToFloat<int8_t>>;
+      if (num_bits == 16)
+        return UnpackWords<int16_t, ToFloat<int16_t>>;
+      if (num_bits == 32)
+        return UnpackWords<int32_t, ToFloat<int32_t>>;
+      if (num_bits == 64)
+        return UnpackWords<int64_t, ToFloat<int64_t>>;
+      break;
+    case FormatMode::kSFloat:
+      if (num_bits == 16)
+        return UnpackWords<uint16_t, HalfToFloat>;
+      if (num_bits == 32)
+        return UnpackWords<float, ToFloat<float>>;
+      if (num_bits == 64)
+        return UnpackWords<double, ToFloat<double>>;
+      break;
+    case FormatMode::kUFloat:
+      break;
+  }
+  return nullptr;
+}
+
+bool IsValidComponent(FormatMode mode, uint8_t num_bits) {
+  if (num_bits == 0 || num_bits > 64)
+    return false;
+  if (mode == FormatMode::kUFloat)
+    return num_bits == 10 || num_bits == 11;
+  if (mode == FormatMode::kSFloat)
+    return num_bits == 16 || num_bits == 32 || num_bits == 64;
+  return true;
+}
+
+}  // namespace
+
+const uint32_t TexelUnpacker::kNoLane;
+
+TexelUnpacker::TexelUnpacker() = default;
+
+TexelUnpacker::~TexelUnpacker() = default;
+
+Result TexelUnpacker::Initialize(const Format& format) {
+  const auto& format_components = format.GetComponents();
+  if (format_components.empty())
+    return Result("Vulkan::TexelUnpacker format has no components");
+
+  bool has_depth = false;
+  uint32_t texel_bits = 0;
+  for (const auto& component : format_components) {
+    if (!IsValidComponent(component.mode, component.num_bits))
+      return Result("Vulkan::TexelUnpacker invalid format component");
+
+    has_depth |= component.type == FormatComponentType::kD;
+    texel_bits += component.num_bits;
+  }
+
+  const uint32_t pack_size = format.GetPackSize();
+  if (pack_size != 0 && pack_size != texel_bits)
+    return Result("Vulkan::TexelUnpacker components do not fill the pack");
+  if (texel_bits % 8 != 0)
+    return Result("Vulkan::TexelUnpacker texel is not a whole byte");
+
+  // Packed components are named from the highest bit down, the others are
+  // stored in the order they are named.
+  components_.clear();
+  uint32_t bits_before = 0;
+  for (const auto& component : format_components) {
+    const uint32_t bit_offset =
+        pack_size ? pack_size - bits_before - component.num_bits : bits_before;
+    components_.push_back({ToLane(component.type, has_depth), component.mode,
+                           component.num_bits, bit_offset});
+    bits_before += component.num_bits;
+  }
+  texel_size_ = texel_bits / 8;
+
+  uint32_t lanes[4];
+  if (IsUNorm8x4(lanes)) {
+    if (lanes[0] == 0 && lanes[1] == 1 && lanes[2] == 2 && lanes[3] == 3) {
+      unpack_ = UnpackUNorm8x4<false>;
+      return {};
+    }
+    if (lanes[0] == 2 && lanes[1] == 1 && lanes[2] == 0 && lanes[3] == 3) {
+      unpack_ = UnpackUNorm8x4<true>;
+      return {};
+    }
+  }
+
+  bool uniform_words = true;
+  for (const auto& component : components_) {
+    uniform_words = uniform_words && component.bit_offset % 8 == 0 &&
+                    component.mode == components_[0].mode &&
+                    component.num_bits == components_[0].num_bits;
+  }
+  unpack_ = uniform_words ? SelectWordKernel(components_[0].mode,
+                                             components_[0].num_bits)
+                          : nullptr;
+  if (unpack_ != nullptr)
+    return {};
+
+  const bool fits_bits = std::all_of(
+      components_.begin(), components_.end(),
+      [](const Component& component) { return component.num_bits <= 32; });
+  if (texel_size_ <= sizeof(uint64_t) && fits_bits) {
+    unpack_ = UnpackBits;
+    return {};
+  }
+  return Result("Vulkan::TexelUnpacker does not support the format");
+}
+
+bool TexelUnpacker::IsUNorm8x4(uint32_t lanes[4]) const {
+  if (components_.size() != 4)
+    return false;
+
+  for (const auto& component : components_) {
+    if (component.num_bits != 8 || component.bit_offset % 8 != 0 ||
+        component.lane == kNoLane ||
+        (component.mode != FormatMode::kUNorm &&
+         component.mode != FormatMode::kSRGB)) {
+      return false;
+    }
+    lanes[component.bit_offset / 8] = component.lane;
+  }
+  return true;
+}
+
+void TexelUnpacker::Unpack(const uint8_t* src,
+                           uint32_t count,
+                           float* dst) const {
+  unpack_(components_, texel_size_, src, count, dst);
+}
+
+}  // namespace vulkan
+}  // namespace amber
@@ -0,0 +1,78 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_VULKAN_TEXEL_UNPACKER_H_
+#define SRC_VULKAN_TEXEL_UNPACKER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "amber/result.h"
+#include "src/format.h"
+
+namespace amber {
+namespace vulkan {
+
+// Decodes texels stored in a Format into four float lanes each, the inverse
+// of BitCopy. Red, green, blue and alpha go to lanes 0 to 3. Depth goes to
+// lane 0 and stencil to lane 1, or to lane 0 when there is no depth. Lanes
+// without a component are 0, except alpha which is 1.
+//
+// Normalized components are scaled to [0, 1] or [-1, 1], integer and scaled
+// components keep their value and SRGB components are read as UNORM.
+class TexelUnpacker {
+ public:
+  // Where one component is stored in a texel and how it is decoded.
+  struct Component {
+    // The lane the component goes to, or kNoLane for padding.
+    uint32_t lane;
+    FormatMode mode;
+    uint8_t num_bits;
+    // Offset of the lowest bit of the component, counting from the lowest
+    // bit of the first byte of the texel.
+    uint32_t bit_offset;
+  };
+
+  static const uint32_t kNoLane = ~0U;
+
+  TexelUnpacker();
+  ~TexelUnpacker();
+
+  Result Initialize(const Format& format);
+
+  uint32_t GetTexelSize() const { return texel_size_; }
+
+  // Returns true when every texel is four 8 bit UNORM or SRGB bytes. The
+  // lane of each byte is written to |lanes|.
+  bool IsUNorm8x4(uint32_t lanes[4]) const;
+
+  // Decodes |count| texels from |src| into 4 * |count| floats at |dst|.
+  void Unpack(const uint8_t* src, uint32_t count, float* dst) const;
+
+ private:
+  using UnpackFn = void (*)(const std::vector<Component>&,
+                            uint32_t texel_size,
+                            const uint8_t* src,
+                            uint32_t count,
+                            float* dst);
+
+  std::vector<Component> components_;
+  uint32_t texel_size_ = 0;
+  UnpackFn unpack_ = nullptr;
+};
+
+}  // namespace vulkan
+}  // namespace amber
+
+#endif  // SRC_VULKAN_TEXEL_UNPACKER_H_
@@ -0,0 +1,225 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/texel_unpacker.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/vkscript/format_parser.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+template <typename T>
+std::vector<uint8_t> ToBytes(const std::vector<T>& values) {
+  std::vector<uint8_t> bytes(values.size() * sizeof(T));
+  memcpy(bytes.data(), values.data(), bytes.size());
+  return bytes;
+}
+
+// Unpacks |texels| of the format called |name|.
+std::vector<float> Unpack(const std::string& name,
+                          const std::vector<uint8_t>& data,
+                          uint32_t texels) {
+  vkscript::FormatParser parser;
+  auto format = parser.Parse(name);
+  EXPECT_TRUE(format != nullptr) << name;
+  if (!format)
+    return {};
+
+  TexelUnpacker unpacker;
+  Result r = unpacker.Initialize(*format);
+  EXPECT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(data.size(), unpacker.GetTexelSize() * texels) << name;
+
+  std::vector<float> lanes(texels * 4);
+  unpacker.Unpack(data.data(), texels, lanes.data());
+  return lanes;
+}
+
+}  // namespace
+
+using TexelUnpackerTest = testing::Test;
+
+TEST_F(TexelUnpackerTest, R8G8B8A8Unorm) {
+  // Enough texels for both the vector steps and the tail.
+  std::vector<uint8_t> data;
+  for (uint8_t i = 0; i < 7; ++i) {
+    data.push_back(static_cast<uint8_t>(i * 30));
+    data.push_back(255);
+    data.push_back(0);
+    data.push_back(51);
+  }
+
+  auto lanes = Unpack("R8G8B8A8_UNORM", data, 7);
+  ASSERT_EQ(28U, lanes.size());
+  for (uint32_t i = 0; i < 7; ++i) {
+    EXPECT_FLOAT_EQ(static_cast<float>(i * 30) / 255.0f, lanes[i * 4]);
+    EXPECT_FLOAT_EQ(1.0f, lanes[i * 4 + 1]);
+    EXPECT_FLOAT_EQ(0.0f, lanes[i * 4 + 2]);
+    EXPECT_FLOAT_EQ(0.2f, lanes[i * 4 + 3]);
+  }
+}
+
+TEST_F(TexelUnpackerTest, B8G8R8A8Unorm) {
+  std::vector<uint8_t> data;
+  for (uint32_t i = 0; i < 5; ++i) {
+    data.push_back(255);
+    data.push_back(51);
+    data.push_back(0);
+    data.push_back(102);
+  }
+
+  auto lanes = Unpack("B8G8R8A8_UNORM", data, 5);
+  ASSERT_EQ(20U, lanes.size());
+  for (uint32_t i = 0; i < 5; ++i) {
+    EXPECT_FLOAT_EQ(0.0f, lanes[i * 4]);
+    EXPECT_FLOAT_EQ(0.2f, lanes[i * 4 + 1]);
+    EXPECT_FLOAT_EQ(1.0f, lanes[i * 4 + 2]);
+    EXPECT_FLOAT_EQ(0.4f, lanes[i * 4 + 3]);
+  }
+}
+
+TEST_F(TexelUnpackerTest, A8B8G8R8PackedIsRGBAInMemory) {
+  vkscript::FormatParser parser;
+  auto format = parser.Parse("A8B8G8R8_UNORM_PACK32");
+  ASSERT_TRUE(format != nullptr);
+
+  TexelUnpacker unpacker;
+  Result r = unpacker.Initialize(*format);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  uint32_t lanes[4];
+  ASSERT_TRUE(unpacker.IsUNorm8x4(lanes));
+  EXPECT_EQ(0U, lanes[0]);
+  EXPECT_EQ(1U, lanes[1]);
+  EXPECT_EQ(2U, lanes[2]);
+  EXPECT_EQ(3U, lanes[3]);
+}
+
+TEST_F(TexelUnpackerTest, R8G8Snorm) {
+  auto lanes = Unpack("R8G8_SNORM", {0x7f, 0x80}, 1);
+  ASSERT_EQ(4U, lanes.size());
+  EXPECT_FLOAT_EQ(1.0f, lanes[0]);
+  EXPECT_FLOAT_EQ(-1.0f, lanes[1]);
+  EXPECT_FLOAT_EQ(0.0f, lanes[2]);
+  EXPECT_FLOAT_EQ(1.0f, lanes[3]);
+}
+
+TEST_F(TexelUnpackerTest, R16G16B16A16Sfloat) {
+  // 1.0, -2.0, 0.5 and 65504, the largest half.
+  auto lanes = Unpack("R16G16B16A16_SFLOAT",
+                      ToBytes<uint16_t>({0x3c00, 0xc000, 0x3800, 0x7bff}), 1);
+  ASSERT_EQ(4U, lanes.size());
+  EXPECT_FLOAT_EQ(1.0f, lanes[0]);
+  EXPECT_FLOAT_EQ(-2.0f, lanes[1]);
+  EXPECT_FLOAT_EQ(0.5f, lanes[2]);
+  EXPECT_FLOAT_EQ(65504.0f, lanes[3]);
+}
+
+TEST_F(TexelUnpackerTest, HalfDenormal) {
+  auto lanes = Unpack("R16_SFLOAT", ToBytes<uint16_t>({0x0001}), 1);
+  ASSERT_EQ(4U, lanes.size());
+  EXPECT_FLOAT_EQ(5.9604645e-08f, lanes[0]);
+}
+
+TEST_F(TexelUnpackerTest, B10G11R11Ufloat) {
+  // R = 1.0 (11 bits), G = 2.0 (11 bits), B = 0.5 (10 bits).
+  const uint32_t texel = (0x3c0U) | (0x400U << 11) | (0x1c0U << 22);
+  auto lanes = Unpack("B10G11R11_UFLOAT_PACK32", ToBytes<uint32_t>({texel}), 1);
+  ASSERT_EQ(4U, lanes.size());
+  EXPECT_FLOAT_EQ(1.0f, lanes[0]);
+  EXPECT_FLOAT_EQ(2.0f, lanes[1]);
+  EXPECT_FLOAT_EQ(0.5f, lanes[2]);
+  EXPECT_FLOAT_EQ(1.0f, lanes[3]);
+}
+
+TEST_F(TexelUnpackerTest, A2B10G10R10Unorm) {
+  const uint32_t texel = 1023U | (0U << 10) | (512U << 20) | (3U << 30);
+  auto lanes =
+      Unpack("A2B10G10R10_UNORM_PACK32", ToBytes<uint32_t>({texel}), 1);
+  ASSERT_EQ(4U, lanes.size());
+  EXPECT_FLOAT_EQ(1.0f, lanes[0]);
+  EXPECT_FLOAT_EQ(0.0f, lanes[1]);
+  EXPECT_FLOAT_EQ(512.0f / 1023.0f, lanes[2]);
+  EXPECT_FLOAT_EQ(1.0f, lanes[3]);
+}
+
+TEST_F(TexelUnpackerTest, A2R10G10B10Sint) {
+  // R = -1, G = 5, B = -512, A = -2.
+  const uint32_t texel = 0x200U | (5U << 10) | (0x3ffU << 20) | (2U << 30);
+  auto lanes = Unpack("A2R10G10B10_SINT_PACK32", ToBytes<uint32_t>({texel}), 1);
+  ASSERT_EQ(4U, lanes.size());
+  EXPECT_FLOAT_EQ(-1.0f, lanes[0]);
+  EXPECT_FLOAT_EQ(5.0f, lanes[1]);
+  EXPECT_FLOAT_EQ(-512.0f, lanes[2]);
+  EXPECT_FLOAT_EQ(-2.0f, lanes[3]);
+}
+
+TEST_F(TexelUnpackerTest, R5G6B5Unorm) {
+  const uint16_t texel = static_cast<uint16_t>((31U << 11) | (0U << 5) | 15U);
+  auto lanes = Unpack("R5G6B5_UNORM_PACK16", ToBytes<uint16_t>({texel}), 1);
+  ASSERT_EQ(4U, lanes.size());
+  EXPECT_FLOAT_EQ(1.0f, lanes[0]);
+  EXPECT_FLOAT_EQ(0.0f, lanes[1]);
+  EXPECT_FLOAT_EQ(15.0f / 31.0f, lanes[2]);
+}
+
+TEST_F(TexelUnpackerTest, R32G32Integers) {
+  auto lanes = Unpack("R32G32_SINT", ToBytes<int32_t>({-7, 123456}), 1);
+  ASSERT_EQ(4U, lanes.size());
+  EXPECT_FLOAT_EQ(-7.0f, lanes[0]);
+  EXPECT_FLOAT_EQ(123456.0f, lanes[1]);
+  EXPECT_FLOAT_EQ(0.0f, lanes[2]);
+  EXPECT_FLOAT_EQ(1.0f, lanes[3]);
+}
+
+TEST_F(TexelUnpackerTest, R64Sfloat) {
+  auto lanes = Unpack("R64_SFLOAT", ToBytes<double>({0.25, -3.5}), 2);
+  ASSERT_EQ(8U, lanes.size());
+  EXPECT_FLOAT_EQ(0.25f, lanes[0]);
+  EXPECT_FLOAT_EQ(-3.5f, lanes[4]);
+}
+
+TEST_F(TexelUnpackerTest, DepthStencil) {
+  // D24 in the low bits, S8 in the high byte.
+  const uint32_t texel = 0xffffffU | (7U << 24);
+  auto lanes = Unpack("D24_UNORM_S8_UINT", ToBytes<uint32_t>({texel}), 1);
+  ASSERT_EQ(4U, lanes.size());
+  EXPECT_FLOAT_EQ(1.0f, lanes[0]);
+  EXPECT_FLOAT_EQ(7.0f, lanes[1]);
+
+  lanes = Unpack("S8_UINT", {9}, 1);
+  ASSERT_EQ(4U, lanes.size());
+  EXPECT_FLOAT_EQ(9.0f, lanes[0]);
+
+  lanes = Unpack("X8_D24_UNORM_PACK32", ToBytes<uint32_t>({0xff000000U}), 1);
+  ASSERT_EQ(4U, lanes.size());
+  EXPECT_FLOAT_EQ(0.0f, lanes[0]);
+}
+
+TEST_F(TexelUnpackerTest, EmptyFormat) {
+  Format format;
+  TexelUnpacker unpacker;
+  Result r = unpacker.Initialize(format);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Vulkan::TexelUnpacker format has no components", r.Error());
+}
+
+}  // namespace vulkan
+}  // namespace amber
@@ -14,11 +14,10 @@
 
 #include "src/vulkan/vertex_buffer.h"
 
-#include <cassert>
 #include <cstring>
+#include <utility>
 
 #include "src/make_unique.h"
-#include "src/vulkan/bit_copy.h"
 #include "src/vulkan/format_data.h"
 
 namespace amber {
@@ -28,9 +27,46 @@ VertexBuffer::VertexBuffer(VkDevice device) : device_(device) {}
 
 VertexBuffer::~VertexBuffer() = default;
 
-void VertexBuffer::SetData(uint8_t location,
-                           const Format& format,
-                           const std::vector<Value>& values) {
+void VertexBuffer::Shutdown() {
+  if (buffer_)
+    buffer_->Shutdown();
+}
+
+Result VertexBuffer::SetData(uint8_t location,
+                             const Format& format,
+                             const std::vector<Value>& values) {
+  Attribute attribute;
+  Result r = attribute.packer.Initialize(format);
+  if (!r.IsSuccess())
+    return r;
+
+  attribute.values = values;
+  attribute.texel_size = attribute.packer.GetTexelSize();
+  AddAttribute(location, format, std::move(attribute));
+  return {};
+}
+
+Result VertexBuffer::SetData(uint8_t location, const BufferView& view) {
+  if (view.format == nullptr || view.format->GetComponents().empty())
+    return Result("Vulkan::VertexBuffer data has no format");
+
+  const Format& format = *view.format;
+  const uint32_t texel_size = format.GetByteSize();
+  if (view.stride != 0 && view.stride < texel_size)
+    return Result("Vulkan::VertexBuffer data stride is less than its format");
+
+  Attribute attribute;
+  attribute.data = static_cast<const uint8_t*>(view.data);
+  attribute.size_in_bytes = view.size_in_bytes;
+  attribute.stride = view.stride ? view.stride : texel_size;
+  attribute.texel_size = texel_size;
+  AddAttribute(location, format, std::move(attribute));
+  return {};
+}
+
+void VertexBuffer::AddAttribute(uint8_t location,
+                                const Format& format,
+                                Attribute attribute) {
   vertex_attr_desc_.emplace_back();
   // TODO(jaebaek): Support multiple binding
   vertex_attr_desc_.back().binding = 0;
@@ -38,44 +74,67 @@ void VertexBuffer::SetData(uint8_t location,
   vertex_attr_desc_.back().format = ToVkFormat(format.GetFormatType());
   vertex_attr_desc_.back().offset = stride_in_bytes_;
 
-  stride_in_bytes_ += format.GetByteSize();
-
-  formats_.push_back(format);
-  data_.push_back(values);
+  stride_in_bytes_ += attribute.texel_size;
+  attributes_.push_back(std::move(attribute));
 }
 
-void VertexBuffer::FillVertexBufferWithData(VkCommandBuffer command) {
-  // Send vertex data from host to device.
-  uint8_t* ptr = static_cast<uint8_t*>(buffer_->HostAccessibleMemoryPtr());
-  for (uint32_t i = 0; i < GetVertexCount(); ++i) {
-    for (uint32_t j = 0; j < formats_.size(); ++j) {
-      const auto pack_size = formats_[j].GetPackSize();
-      if (pack_size) {
-        BitCopy::CopyValueToBuffer(ptr, data_[j][i], 0, pack_size);
-        ptr += pack_size / 8;
-        continue;
-      }
+size_t VertexBuffer::Attribute::GetCount() const {
+  if (packer.GetValuesPerTexel())
+    return values.size() / packer.GetValuesPerTexel();
 
-      const auto& components = formats_[j].GetComponents();
-      uint8_t bit_offset = 0;
+  if (size_in_bytes < texel_size)
+    return 0;
+  return (size_in_bytes - texel_size) / stride + 1;
+}
 
-      for (uint32_t k = 0; k < components.size(); ++k) {
-        uint8_t bits = components[k].num_bits;
-        BitCopy::CopyValueToBuffer(ptr, data_[j][i * components.size() + k],
-                                   bit_offset, bits);
+size_t VertexBuffer::GetVertexCount() const {
+  if (attributes_.empty())
+    return 0;
+  return attributes_[0].GetCount();
+}
 
-        assert(k == components.size() - 1 ||
-               static_cast<uint32_t>(bit_offset) + static_cast<uint32_t>(bits) <
-                   256);
-        bit_offset += bits;
+Result VertexBuffer::WriteVertexData(uint8_t* dst) const {
+  // One attribute at a time. Values are packed in place and packed data is
+  // copied, so this is the only copy of the vertex data.
+  const size_t vertex_count = GetVertexCount();
+  for (const Attribute& attribute : attributes_) {
+    if (attribute.GetCount() < vertex_count)
+      return Result("Vulkan::VertexBuffer attribute is missing values");
+
+    if (attribute.packer.GetValuesPerTexel()) {
+      attribute.packer.Pack(attribute.values.data(),
+                            static_cast<uint32_t>(vertex_count), dst,
+                            stride_in_bytes_);
+    } else if (attribute.stride == stride_in_bytes_ &&
+               attribute.texel_size == stride_in_bytes_) {
+      memcpy(dst, attribute.data, vertex_count * stride_in_bytes_);
+    } else {
+      const uint8_t* src = attribute.data;
+      uint8_t* texel = dst;
+      for (size_t i = 0; i < vertex_count; ++i) {
+        memcpy(texel, src, attribute.texel_size);
+        src += attribute.stride;
+        texel += stride_in_bytes_;
       }
-
-      ptr += formats_[j].GetByteSize();
     }
+    dst += attribute.texel_size;
   }
+  return {};
+}
+
+Result VertexBuffer::FillVertexBufferWithData(VkCommandBuffer command) {
+  Result r = buffer_->MapForUpload();
+  if (!r.IsSuccess())
+    return r;
+
+  // Send vertex data from host to device.
+  r = WriteVertexData(
+      static_cast<uint8_t*>(buffer_->HostAccessibleMemoryPtr()));
+  if (!r.IsSuccess())
+    return r;
 
-  ptr = static_cast<uint8_t*>(buffer_->HostAccessibleMemoryPtr());
   buffer_->CopyToDevice(command);
+  return {};
 }
 
 void VertexBuffer::BindToCommandBuffer(VkCommandBuffer command) {
@@ -85,9 +144,9 @@ void VertexBuffer::BindToCommandBuffer(VkCommandBuffer command) {
   vkCmdBindVertexBuffers(command, 0, 1, &buffer, &offset);
 }
 
-Result VertexBuffer::SendVertexData(
-    VkCommandBuffer command,
-    const VkPhysicalDeviceMemoryProperties& properties) {
+Result VertexBuffer::SendVertexData(VkCommandBuffer command,
+                                    MemoryAllocator* allocator,
+                                    StagingRing* staging_ring) {
   if (!is_vertex_data_pending_)
     return Result("Vulkan::Vertices data was already sent");
 
@@ -98,17 +157,16 @@ Result VertexBuffer::SendVertexData(
   size_t bytes = stride_in_bytes_ * n_vertices;
 
   if (!buffer_) {
-    buffer_ = MakeUnique<Buffer>(device_, bytes, properties);
+    buffer_ = MakeUnique<Buffer>(device_, bytes, allocator, staging_ring);
     Result r = buffer_->Initialize(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
                                    VK_BUFFER_USAGE_TRANSFER_DST_BIT);
     if (!r.IsSuccess())
       return r;
   }
 
-  if (formats_.empty() || formats_[0].GetComponents().empty())
-    return Result("Vulkan::Formats for VertexBuffer is empty");
-
-  FillVertexBufferWithData(command);
+  Result r = FillVertexBufferWithData(command);
+  if (!r.IsSuccess())
+    return r;
 
   is_vertex_data_pending_ = false;
   return {};
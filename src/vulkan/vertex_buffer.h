@@ -19,9 +19,11 @@
 #include <vector>
 
 #include "amber/result.h"
+#include "src/buffer_data.h"
 #include "src/format.h"
 #include "src/value.h"
 #include "src/vulkan/buffer.h"
+#include "src/vulkan/texel_packer.h"
 #include "vulkan/vulkan.h"
 
 namespace amber {
@@ -33,12 +35,19 @@ class VertexBuffer {
   ~VertexBuffer();
 
   Result SendVertexData(VkCommandBuffer command,
-                        const VkPhysicalDeviceMemoryProperties& properties);
+                        MemoryAllocator* allocator,
+                        StagingRing* staging_ring);
   bool VertexDataSent() { return !is_vertex_data_pending_; }
 
-  void SetData(uint8_t location,
-               const Format& format,
-               const std::vector<Value>& values);
+  // Keeps |values| for the attribute at |location|. They are packed straight
+  // into the upload memory when they are sent to the device.
+  Result SetData(uint8_t location,
+                 const Format& format,
+                 const std::vector<Value>& values);
+
+  // Uses the packed data of |view| for the attribute at |location|. The data
+  // is read when it is sent to the device.
+  Result SetData(uint8_t location, const BufferView& view);
 
   const std::vector<VkVertexInputAttributeDescription>& GetVertexInputAttr()
       const {
@@ -53,17 +62,18 @@ class VertexBuffer {
     return vertex_binding_desc;
   }
 
-  size_t GetVertexCount() const {
-    if (data_.empty())
-      return 0;
+  size_t GetVertexCount() const;
 
-    return data_[0].size() / formats_[0].GetComponents().size();
-  }
+  // Writes GetVertexCount() interleaved vertices, each
+  // GetVertexInputBinding().stride bytes, to |dst|.
+  Result WriteVertexData(uint8_t* dst) const;
 
   void BindToCommandBuffer(VkCommandBuffer command);
 
+  void Shutdown();
+
  private:
-  void FillVertexBufferWithData(VkCommandBuffer command);
+  Result FillVertexBufferWithData(VkCommandBuffer command);
 
   VkDevice device_ = VK_NULL_HANDLE;
 
@@ -72,8 +82,26 @@ class VertexBuffer {
   std::unique_ptr<Buffer> buffer_;
   uint32_t stride_in_bytes_ = 0;
 
-  std::vector<Format> formats_;
-  std::vector<std::vector<Value>> data_;
+  // The data of an attribute. Either |values|, which |packer| packs, or
+  // packed data where element i is |texel_size| bytes at
+  // |data + i * stride|.
+  struct Attribute {
+    std::vector<Value> values;
+    TexelPacker packer;
+
+    const uint8_t* data = nullptr;
+    size_t size_in_bytes = 0;
+    uint32_t stride = 0;
+    uint32_t texel_size = 0;
+
+    size_t GetCount() const;
+  };
+
+  void AddAttribute(uint8_t location,
+                    const Format& format,
+                    Attribute attribute);
+
+  std::vector<Attribute> attributes_;
 
   std::vector<VkVertexInputAttributeDescription> vertex_attr_desc_;
 };
@@ -0,0 +1,190 @@
+// Copyright 2018 The Amber Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/vulkan/vertex_buffer.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/vkscript/format_parser.h"
+
+namespace amber {
+namespace vulkan {
+namespace {
+
+std::unique_ptr<Format> ParseFormat(const std::string& name) {
+  auto format = vkscript::FormatParser().Parse(name);
+  EXPECT_TRUE(format != nullptr) << name;
+  return format;
+}
+
+}  // namespace
+
+using VertexBufferTest = testing::Test;
+
+TEST_F(VertexBufferTest, InterleavedView) {
+  auto position = ParseFormat("R32G32_SFLOAT");
+  auto color = ParseFormat("R8G8B8A8_UNORM");
+  ASSERT_TRUE(position != nullptr && color != nullptr);
+
+  // Five vertices of a position followed by a color, 12 bytes each.
+  std::vector<uint8_t> data(5 * 12);
+
+  BufferView view;
+  view.data = data.data();
+  view.size_in_bytes = data.size();
+  view.format = position.get();
+  view.stride = 12;
+
+  VertexBuffer buffer(VK_NULL_HANDLE);
+  Result r = buffer.SetData(1, view);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  view.data = data.data() + 8;
+  view.size_in_bytes = data.size() - 8;
+  view.format = color.get();
+  r = buffer.SetData(0, view);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  EXPECT_EQ(5U, buffer.GetVertexCount());
+  EXPECT_EQ(12U, buffer.GetVertexInputBinding().stride);
+
+  const auto& attrs = buffer.GetVertexInputAttr();
+  ASSERT_EQ(2U, attrs.size());
+  EXPECT_EQ(1U, attrs[0].location);
+  EXPECT_EQ(VK_FORMAT_R32G32_SFLOAT, attrs[0].format);
+  EXPECT_EQ(0U, attrs[0].offset);
+  EXPECT_EQ(0U, attrs[1].location);
+  EXPECT_EQ(VK_FORMAT_R8G8B8A8_UNORM, attrs[1].format);
+  EXPECT_EQ(8U, attrs[1].offset);
+}
+
+TEST_F(VertexBufferTest, TightlyPackedView) {
+  auto format = ParseFormat("R16G16B16A16_UINT");
+  ASSERT_TRUE(format != nullptr);
+
+  // A stride of 0 uses the size of the format. The trailing partial vertex
+  // is not counted.
+  std::vector<uint8_t> data(7 * 8 + 3);
+  BufferView view;
+  view.data = data.data();
+  view.size_in_bytes = data.size();
+  view.format = format.get();
+
+  VertexBuffer buffer(VK_NULL_HANDLE);
+  Result r = buffer.SetData(0, view);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(7U, buffer.GetVertexCount());
+}
+
+TEST_F(VertexBufferTest, Values) {
+  auto format = ParseFormat("R32G32B32A32_SFLOAT");
+  ASSERT_TRUE(format != nullptr);
+
+  std::vector<Value> values(12);
+  for (size_t i = 0; i < values.size(); ++i)
+    values[i].SetDoubleValue(static_cast<double>(i));
+
+  VertexBuffer buffer(VK_NULL_HANDLE);
+  Result r = buffer.SetData(0, *format, values);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  EXPECT_EQ(3U, buffer.GetVertexCount());
+  EXPECT_EQ(16U, buffer.GetVertexInputBinding().stride);
+}
+
+TEST_F(VertexBufferTest, WriteVertexData) {
+  auto position = ParseFormat("R32G32_SFLOAT");
+  auto color = ParseFormat("R8G8B8A8_UINT");
+  ASSERT_TRUE(position != nullptr && color != nullptr);
+
+  std::vector<Value> positions(6);
+  for (size_t i = 0; i < positions.size(); ++i)
+    positions[i].SetDoubleValue(static_cast<double>(i) + 0.5);
+  std::vector<uint8_t> colors(3 * 4);
+  for (size_t i = 0; i < colors.size(); ++i)
+    colors[i] = static_cast<uint8_t>(i + 100);
+
+  BufferView view;
+  view.data = colors.data();
+  view.size_in_bytes = colors.size();
+  view.format = color.get();
+
+  VertexBuffer buffer(VK_NULL_HANDLE);
+  Result r = buffer.SetData(0, *position, positions);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  r = buffer.SetData(1, view);
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  ASSERT_EQ(3U, buffer.GetVertexCount());
+
+  // The values are packed and the view copied into each 12 byte vertex.
+  std::vector<uint8_t> data(3 * 12);
+  r = buffer.WriteVertexData(data.data());
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  for (size_t i = 0; i < 3; ++i) {
+    float xy[2];
+    memcpy(xy, &data[i * 12], sizeof(xy));
+    EXPECT_FLOAT_EQ(static_cast<float>(i * 2) + 0.5f, xy[0]);
+    EXPECT_FLOAT_EQ(static_cast<float>(i * 2) + 1.5f, xy[1]);
+    for (size_t c = 0; c < 4; ++c)
+      EXPECT_EQ(colors[i * 4 + c], data[i * 12 + 8 + c]);
+  }
+}
+
+TEST_F(VertexBufferTest, WriteVertexDataMissingValues) {
+  auto format = ParseFormat("R32_SFLOAT");
+  ASSERT_TRUE(format != nullptr);
+
+  VertexBuffer buffer(VK_NULL_HANDLE);
+  Result r = buffer.SetData(0, *format, std::vector<Value>(4));
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+  r = buffer.SetData(1, *format, std::vector<Value>(3));
+  ASSERT_TRUE(r.IsSuccess()) << r.Error();
+
+  std::vector<uint8_t> data(4 * 8);
+  r = buffer.WriteVertexData(data.data());
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Vulkan::VertexBuffer attribute is missing values", r.Error());
+}
+
+TEST_F(VertexBufferTest, ViewWithoutFormat) {
+  BufferView view;
+  VertexBuffer buffer(VK_NULL_HANDLE);
+  Result r = buffer.SetData(0, view);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Vulkan::VertexBuffer data has no format", r.Error());
+}
+
+TEST_F(VertexBufferTest, ViewStrideLessThanFormat) {
+  auto format = ParseFormat("R32G32B32_SFLOAT");
+  ASSERT_TRUE(format != nullptr);
+
+  std::vector<uint8_t> data(64);
+  BufferView view;
+  view.data = data.data();
+  view.size_in_bytes = data.size();
+  view.format = format.get();
+  view.stride = 8;
+
+  VertexBuffer buffer(VK_NULL_HANDLE);
+  Result r = buffer.SetData(0, view);
+  ASSERT_FALSE(r.IsSuccess());
+  EXPECT_EQ("Vulkan::VertexBuffer data stride is less than its format",
+            r.Error());
+}
+
+}  // namespace vulkan
+}  // namespace amber